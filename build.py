@@ -22,18 +22,22 @@ def exe(name):
 def outd(p):
     return join('$outdir', p.replace('\\', '__'))
 
-def add_test_suite(out):
+# The tests link against everything the compiler is made of, except its `main`.
+def add_test_suite(out, compiler_inputs):
     inputs = [
         'main_test.c',
         'test.c',
         'tokenize.test.c',
         'parse.test.c',
+        'source_cache.test.c',
+        'ir_image.test.c',
+        'compiler.test.c',
+        'source_file.test.c',
+        'simd.test.c',
+        'types.test.c',
     ]
 
-    outputs = []
-    outputs.append(outd('toteload.c.o'))
-    outputs.append(outd('tokenize.c.o'))
-    outputs.append(outd('parse.c.o'))
+    outputs = [outd(f'{f}.o') for f in compiler_inputs if f != 'main.c']
 
     for f in inputs:
         fout = outd(f'{f}.o')
@@ -108,16 +112,21 @@ def create_build_ninja():
         'string_interner.c',
         'parse.c',
         'types.c',
+        'integer.c',
+        'simd.c',
         'value.c',
         'messages.c',
         'eval.c',
         'source_file.c',
+        'source_cache.c',
         'compiler.c',
         'cli_options.c',
         'codegen.c',
         'specialize.c',
         'interpret.c',
         'ir.c',
+        'ir_image.c',
+        'ir_pass.c',
         'print.c',
     ]
 
@@ -141,7 +150,7 @@ def create_build_ninja():
         inputs  = [outd(f'{f}.o') for f in inputs],
         )
 
-    add_test_suite(out)
+    add_test_suite(out, inputs)
 
 if __name__ == '__main__':
     create_build_ninja()
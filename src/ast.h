@@ -11,11 +11,15 @@ typedef enum {
   Ast_type_slice,
   Ast_type_array,
   Ast_type_function,
+  Ast_type_struct,
+  Ast_type_optional,
+  Ast_type_range,
   Ast_builtin,
   Ast_declaration,
   Ast_assign,
   Ast_literal_int,
   Ast_literal_string,
+  Ast_literal_sequence,
   Ast_identifier,
   Ast_call,
   Ast_index,
@@ -23,18 +27,32 @@ typedef enum {
   Ast_binary_op,
   Ast_function,
   Ast_param,
+  Ast_field,
   Ast_if_else,
   Ast_for,
   Ast_defer,
   Ast_const,
   Ast_cast,
   Ast_as,
+  Ast_lazy_body,
 } AstKind;
 
-#define Ast_kind_max (Ast_as + 1)
+#define Ast_kind_max (Ast_lazy_body + 1)
 
 typedef enum {
   Builtin_debug,
+
+  // Reductions of an array
+  Builtin_sum,
+  Builtin_min,
+  Builtin_max,
+  Builtin_all,
+  Builtin_any,
+
+  // Queries of the memory layout of a type
+  Builtin_size_of,
+  Builtin_align_of,
+  Builtin_offset_of,
 } BuiltinKind;
 
 enum BinaryOpKind {
@@ -104,6 +122,38 @@ typedef struct {
   AstIndex base;
 } AstTypeArray;
 
+typedef struct {
+  AstIndex base;
+} AstTypeOptional;
+
+// `lo..hi` excludes `hi`, `lo..=hi` includes it.
+typedef struct {
+  AstIndex lo;
+  AstIndex hi;
+  u8       is_inclusive;
+} AstTypeRange;
+
+enum StructAttributeFlag {
+  StructAttribute_ordered = 1 << 0, // Keep the fields in declaration order.
+};
+
+typedef struct {
+  u8 attributes; // StructAttributeFlag
+  u32 count;
+  AstIndex fields[];
+} AstTypeStruct;
+
+enum FieldAttributeFlag {
+  FieldAttribute_hot  = 1 << 0,
+  FieldAttribute_cold = 1 << 1,
+};
+
+typedef struct {
+  TokenIndex name;
+  AstIndex   type;
+  u8         attributes; // FieldAttributeFlag
+} AstField;
+
 typedef struct {
   TokenIndex name;
   AstIndex  type;
@@ -214,6 +264,9 @@ typedef union {
   AstTypeFunction    type_function;
   AstTypeSlice       type_slice;
   AstTypeArray       type_array;
+  AstTypeStruct      type_struct;
+  AstTypeOptional    type_optional;
+  AstTypeRange       type_range;
   AstDeclaration     declaration;
   AstAssign          assign;
   AstLiteralSequence literal_sequence;
@@ -227,12 +280,15 @@ typedef union {
   AstBinaryOp        binary_op;
   AstFunction        function;
   AstParam           param;
+  AstField           field;
   AstIfElse          if_else;
   AstFor             for_;
   AstDefer           defer;
   AstConst           const_;
   AstCast            cast;
   AstAs              as;
+  TokenIndex         lazy_body; // The opening brace of a body that is not parsed yet, the span of
+                                // the node covers the whole block. See `parse_function_body`.
 } AstNodeData;
 
 typedef struct {
@@ -244,14 +300,28 @@ typedef struct {
   MessageSink *msg_sink;
   Arena *arena;
   Arena *scratch;
+
+  // Only skip over the bodies of functions that are blocks and leave an `Ast_lazy_body` in their
+  // place.
+  b32 lazy_function_bodies;
+
+  // Set by the parse: the most bytes that were in use in a scratch arena that it made itself, for a
+  // large source or for the workers of a parallel parse. The scratch arena above is not counted.
+  usize scratch_peak;
 } ParseContext;
 
+#define AST_EXTRA_ALIGN 16
+
+// The payload of node i is at `extra + datas[i]`. The payloads are one block of `extra_size` bytes,
+// and `extra` is aligned to `AST_EXTRA_ALIGN`, so the block can be copied as a whole.
 typedef struct {
   u32        count;
+  u32        capacity;
   u8        *kinds;
   SpanToken *spans;
   u32       *datas;
   void      *extra;
+  u32        extra_size;
 } AstNodes;
 
 void *ast_data(AstNodes *ast, AstIndex idx);
@@ -260,4 +330,21 @@ String ast_kind_string(u8 kind);
 
 b32 parse(ParseContext *context, Tokens *tokens, AstNodes *ast);
 
+#define PARSE_MAX_CHUNKS       64
+#define PARSE_MIN_CHUNK_TOKENS 32768
+
+// Parsing takes about 30 bytes of scratch memory per token. A scratch arena is reserved with room
+// to spare, only the memory that is used is committed.
+#define PARSE_SCRATCH_BYTES_PER_TOKEN 128
+
+// Parses like `parse`, but on up to `thread_count` threads. The tokens are split into chunks at
+// `mod` keywords, which are parsed in parallel, and the nodes of the chunks are joined in order. If
+// a chunk has an error, the source is parsed again on the calling thread from the start of the
+// first chunk that failed until the error, so the messages are the same as those of `parse`.
+b32 parse_parallel(ParseContext *context, Tokens *tokens, u32 thread_count, AstNodes *ast);
+
+// Parses the lazy body of the `Ast_function` node `function`. The nodes of the body are appended
+// to `ast` and the body of the function is replaced by the parsed block.
+b32 parse_function_body(ParseContext *context, Tokens *tokens, AstNodes *ast, AstIndex function);
+
 #endif // AST_H
@@ -7,11 +7,18 @@ u32 parse_cli_options(CLIOptions *options, u32 arg_count, char const *const *arg
     .print_ast = False,
     .print_decl_ir = False,
     .print_residual = False,
-    .source_filename = {0},
+    .time_ir_passes = False,
+    .verify_ir = False,
+    .time_passes = TimePasses_off,
+    .watch = False,
+    .ir_passes = {0},
+    .cache_dir = {0},
+    .emit_image = {0},
+    .run_image = {0},
+    .jobs = 0,
+    .source_count = 0,
   };
 
-  b32 has_found_source_filename = False;
-
   for (u32 i = 1; i < arg_count; i++) {
     String arg = string_from_cstr(args[i]);
 
@@ -40,16 +47,105 @@ u32 parse_cli_options(CLIOptions *options, u32 arg_count, char const *const *arg
       continue;
     }
 
-    if (!has_found_source_filename) {
-      has_found_source_filename = True;
-      options->source_filename = arg;
+    if (string_eq(arg, string_lit("--time-ir-passes"))) {
+      options->time_ir_passes = True;
+      continue;
+    }
+
+    if (string_eq(arg, string_lit("--verify-ir"))) {
+      options->verify_ir = True;
+      continue;
+    }
+
+    if (string_eq(arg, string_lit("--time-passes"))) {
+      options->time_passes = TimePasses_text;
+      continue;
+    }
+
+    if (string_eq(arg, string_lit("--time-passes=json"))) {
+      options->time_passes = TimePasses_json;
+      continue;
+    }
+
+    if (string_eq(arg, string_lit("--watch"))) {
+      options->watch = True;
+      continue;
+    }
+
+    String ir_passes_prefix = string_lit("--ir-passes=");
+    if (arg.len >= ir_passes_prefix.len &&
+        string_eq((String){ .str = arg.str, .len = ir_passes_prefix.len }, ir_passes_prefix)) {
+      options->ir_passes = (String){
+        .str = arg.str + ir_passes_prefix.len,
+        .len = arg.len - ir_passes_prefix.len,
+      };
+      continue;
+    }
+
+    String cache_dir_prefix = string_lit("--cache-dir=");
+    if (arg.len > cache_dir_prefix.len &&
+        string_eq((String){ .str = arg.str, .len = cache_dir_prefix.len }, cache_dir_prefix)) {
+      options->cache_dir = (String){
+        .str = arg.str + cache_dir_prefix.len,
+        .len = arg.len - cache_dir_prefix.len,
+      };
+      continue;
+    }
+
+    String emit_image_prefix = string_lit("--emit-image=");
+    if (arg.len > emit_image_prefix.len &&
+        string_eq((String){ .str = arg.str, .len = emit_image_prefix.len }, emit_image_prefix)) {
+      options->emit_image = (String){
+        .str = arg.str + emit_image_prefix.len,
+        .len = arg.len - emit_image_prefix.len,
+      };
       continue;
     }
 
-    return ParseCli_error_unknown_argument;
+    String run_image_prefix = string_lit("--run-image=");
+    if (arg.len > run_image_prefix.len &&
+        string_eq((String){ .str = arg.str, .len = run_image_prefix.len }, run_image_prefix)) {
+      options->run_image = (String){
+        .str = arg.str + run_image_prefix.len,
+        .len = arg.len - run_image_prefix.len,
+      };
+      continue;
+    }
+
+    String jobs_prefix = string_lit("--jobs=");
+    if (arg.len > jobs_prefix.len &&
+        string_eq((String){ .str = arg.str, .len = jobs_prefix.len }, jobs_prefix)) {
+      String n = (String){ .str = arg.str + jobs_prefix.len, .len = arg.len - jobs_prefix.len };
+      for (usize j = 0; j < n.len; j++) {
+        if (n.str[j] < '0' || n.str[j] > '9') {
+          return ParseCli_error_unknown_argument;
+        }
+      }
+      // The length check keeps `parse_i64` from overflowing.
+      if (n.len > 9 || parse_i64(n) > Max_parallel_for_threads) {
+        return ParseCli_error_too_many_jobs;
+      }
+      options->jobs = Cast(u32, parse_i64(n));
+      continue;
+    }
+
+    if (arg.len > 0 && arg.str[0] == '-') {
+      return ParseCli_error_unknown_argument;
+    }
+
+    if (options->source_count == CLI_MAX_SOURCE_FILES) {
+      return ParseCli_error_too_many_source_files;
+    }
+
+    options->source_filenames[options->source_count++] = arg;
+  }
+
+  // An image is run as is, there is nothing to compile.
+  if (options->run_image.str) {
+    return options->source_count == 0 ? ParseCli_ok : ParseCli_error_source_files_with_run_image;
   }
 
-  if (!has_found_source_filename) {
+  if (options->source_count == 0) {
     return ParseCli_error_no_source_filename_provided;
   }
 
@@ -3,19 +3,40 @@
 
 #include "toteload.h"
 
+#define CLI_MAX_SOURCE_FILES 256
+
+enum TimePassesFormat {
+  TimePasses_off,
+  TimePasses_text, // A table for people.
+  TimePasses_json, // A single JSON object, for tools.
+};
+
 typedef struct {
   b8 verbose;
   b8 print_tokens;
   b8 print_ast;
   b8 print_decl_ir;
   b8 print_residual;
-  String source_filename;
+  b8 time_ir_passes;
+  b8 verify_ir; // Verify the IR before and after every IR pass.
+  u8 time_passes; // A `TimePassesFormat`. Reports the time and memory used by each build.
+  b8 watch; // Build again whenever a source file changes, until the process is stopped.
+  String ir_passes; // Comma separated list of IR passes. `str` is Null if not specified.
+  String cache_dir; // Where the tokens and AST of sources are cached. `str` is Null if not specified.
+  String emit_image; // Where to write the IR image of `main.main`. `str` is Null if not specified.
+  String run_image;  // The IR image to run instead of compiling sources. `str` is Null if not specified.
+  u32 jobs; // The number of threads for the per-file stages, at most `Max_parallel_for_threads`. 0 means one per core.
+  u32 source_count;
+  String source_filenames[CLI_MAX_SOURCE_FILES];
 } CLIOptions;
 
 enum ParseCliResult {
   ParseCli_ok,
   ParseCli_error_unknown_argument,
   ParseCli_error_no_source_filename_provided,
+  ParseCli_error_too_many_source_files,
+  ParseCli_error_source_files_with_run_image,
+  ParseCli_error_too_many_jobs,
 };
 
 u32 parse_cli_options(CLIOptions *options, u32 arg_count, char const *const *args);
@@ -20,6 +20,7 @@ typedef struct {
   MessageSink *msg_sink;
   StringInterner *strings;
   DeclarationInterner *decls;
+  TypeInterner *types;
   ValueStore *values;
 
   Source *source;
@@ -37,6 +38,7 @@ void codegen_init(CodeGen *gen, CodeGenContext *context, Source *source, u32 tre
     .strings = context->strings,
     .msg_sink = context->msg_sink,
     .decls = context->decls,
+    .types = context->types,
     .values = context->values,
     .source = source,
     .builder = (IrBuilder){.scratch = context->scratch},
@@ -61,26 +63,40 @@ void codegen_init(CodeGen *gen, CodeGenContext *context, Source *source, u32 tre
 
 void codegen_deinit(CodeGen *gen) { arena_scope_end(gen->scratch, gen->scope_scratch); }
 
-internal InstructionIndex inst_add_lookup_value(CodeGen *gen, TokenIndex name, AstIndex ast_idx) {
-  StringIndex str =
-    strings_add(gen->strings, token_string(&gen->source->tokens, gen->source->text, name));
+internal void report_error_at_token(CodeGen *gen, TokenIndex tok, String msg) {
+  Message_error(
+    gen->msg_sink,
+    (MessageLocation){
+      .kind = MessageLocation_token_index,
+      .source_idx = gen->source->idx,
+      .data.token_index = tok,
+    },
+    msg
+  );
+  gen->has_error = True;
+}
+
+internal DeclarationIndex lookup_declaration(CodeGen *gen, TokenIndex name) {
+  String name_string = token_string(&gen->source->tokens, gen->source->text, name);
+  StringIndex str = strings_add(gen->strings, name_string);
 
   DeclarationIndex decl;
   b32 found = lookup_identifier(gen->decls, gen->mods, gen->mod_depth, str, &decl);
   if (!found) {
-    Message_error(
-      gen->msg_sink,
-      (MessageLocation){
-        .kind = MessageLocation_token_index,
-        .source_idx = gen->source->idx,
-        .data.token_index = name,
-      },
-      string_lit("Could not find identifier.")
-    );
-    gen->has_error = True;
+    found = lookup_integer_primitive(gen->decls, gen->types, gen->values, gen->common, name_string, str, &decl);
+  }
+
+  if (!found) {
+    report_error_at_token(gen, name, string_lit("Could not find identifier."));
     decl = 0;
   }
 
+  return decl;
+}
+
+internal InstructionIndex inst_add_lookup_value(CodeGen *gen, TokenIndex name, AstIndex ast_idx) {
+  DeclarationIndex decl = lookup_declaration(gen, name);
+
   InstructionIndex lookup = inst_alloc(&gen->builder);
   inst_set_opcode(&gen->builder, lookup, IR_lookup_value);
   inst_set_source(&gen->builder, lookup, gen->source->idx, ast_idx);
@@ -90,24 +106,7 @@ internal InstructionIndex inst_add_lookup_value(CodeGen *gen, TokenIndex name, A
 }
 
 internal InstructionIndex inst_add_lookup_value_typeof(CodeGen *gen, TokenIndex name, AstIndex ast_idx) {
-  StringIndex str =
-    strings_add(gen->strings, token_string(&gen->source->tokens, gen->source->text, name));
-
-  DeclarationIndex decl;
-  b32 found = lookup_identifier(gen->decls, gen->mods, gen->mod_depth, str, &decl);
-  if (!found) {
-    Message_error(
-      gen->msg_sink,
-      (MessageLocation){
-        .kind = MessageLocation_token_index,
-        .source_idx = gen->source->idx,
-        .data.token_index = name,
-      },
-      string_lit("Could not find identifier.")
-    );
-    gen->has_error = True;
-    decl = 0;
-  }
+  DeclarationIndex decl = lookup_declaration(gen, name);
 
   InstructionIndex lookup = inst_alloc(&gen->builder);
   inst_set_opcode(&gen->builder, lookup, IR_lookup_typeof);
@@ -218,6 +217,13 @@ IrRef gen_code(CodeGen *gen, AstIndex idx_ast, IrRef type_destination) {
   case Ast_function: {
     AstFunction *func = ast_data(ast, idx_ast);
 
+    if (ast->kinds[func->body] == Ast_lazy_body) {
+      if (!source_parse_function_body(gen->source, idx_ast, gen->scratch)) {
+        gen->has_error = True;
+        return ir_ref_from_value_index(gen->common->val.nil);
+      }
+    }
+
     InstructionIndex inst_return_type = inst_alloc(builder);
     inst_set_opcode(builder, inst_return_type, IR_return_type);
     inst_set_data(builder, inst_return_type, ref_to_u32(type_destination));
@@ -290,15 +296,8 @@ IrRef gen_code(CodeGen *gen, AstIndex idx_ast, IrRef type_destination) {
     TokenIndex *tok = ast_data(ast, idx_ast);
     i64 value = parse_i64(token_string(tokens, text, *tok));
 
-    Value *v;
-    ValueIndex idx = values_alloc(gen->values, &v);
-    ComptimeInt *data = values_alloc_data(gen->values, sizeof(ComptimeInt), Align_of(ComptimeInt));
-    *data = value;
-    *v = (Value){
-      .type = gen->common->type.comptime_int,
-      .data_size = sizeof(ComptimeInt),
-      .data = data,
-    };
+    ComptimeInt data = value;
+    ValueIndex idx = values_intern_typed(gen->values, gen->common->type.comptime_int, ComptimeInt, &data);
 
     IrRef ref_literal = ir_ref_from_value_index(idx);
 
@@ -361,11 +360,254 @@ IrRef gen_code(CodeGen *gen, AstIndex idx_ast, IrRef type_destination) {
 
       return ir_ref_from_instruction_index(inst_debug);
     } break;
+    case Builtin_sum:
+    case Builtin_min:
+    case Builtin_max:
+    case Builtin_all:
+    case Builtin_any: {
+      // The array that is reduced does not have the type of the result.
+      IrRef val = gen_code(gen, builtin->args[0], (IrRef){0});
+
+      InstructionIndex inst_reduce = inst_alloc(builder);
+      inst_set_opcode(builder, inst_reduce, IR_builtin_reduce);
+      inst_set_source(builder, inst_reduce, source_idx, idx_ast);
+
+      IrReduce *data = inst_push_data(builder, inst_reduce, IrReduce);
+      *data = (IrReduce){
+        .builtin = builtin->kind,
+        .value   = val,
+      };
+
+      IrRef res = ir_ref_from_instruction_index(inst_reduce);
+      return ir_ref_from_instruction_index(inst_as(&gen->builder, type_destination, res, source_idx, idx_ast));
+    } break;
+    case Builtin_size_of:
+    case Builtin_align_of:
+    case Builtin_offset_of: {
+      IrRef type = gen_code(gen, builtin->args[0], ir_ref_from_value_index(gen->common->val.type));
+
+      StringIndex field = 0;
+      if (builtin->kind == Builtin_offset_of) {
+        AstIndex arg = builtin->args[1];
+        if (ast->kinds[arg] != Ast_identifier) {
+          report_error_at_token(gen, ast->spans[arg].start, string_lit("Expected a field name."));
+          return (IrRef){0};
+        }
+
+        TokenIndex *name = ast_data(ast, arg);
+        field = strings_add(gen->strings, token_string(tokens, text, *name));
+      }
+
+      InstructionIndex inst_layout = inst_alloc(builder);
+      inst_set_opcode(builder, inst_layout, IR_builtin_layout);
+      inst_set_source(builder, inst_layout, source_idx, idx_ast);
+
+      IrLayout *data = inst_push_data(builder, inst_layout, IrLayout);
+      *data = (IrLayout){
+        .builtin = builtin->kind,
+        .type    = type,
+        .field   = field,
+      };
+
+      IrRef res = ir_ref_from_instruction_index(inst_layout);
+      return ir_ref_from_instruction_index(inst_as(&gen->builder, type_destination, res, source_idx, idx_ast));
+    } break;
     }
   } break;
   case Ast_literal_string: {
     Todo();
   } break;
+  case Ast_literal_sequence: {
+    AstLiteralSequence *sequence = ast_data(ast, idx_ast);
+    u32 count = sequence->count;
+
+    // The items are coerced to the base type of the array when the literal is specialized.
+    IrRef *items = arena_push_array(IrRef, gen->scratch, count);
+    for (u32 i = 0; i < count; i++) {
+      items[i] = gen_code(gen, sequence->items[i], (IrRef){0});
+    }
+
+    InstructionIndex inst_sequence = inst_alloc(builder);
+    inst_set_opcode(builder, inst_sequence, IR_sequence);
+    inst_set_source(builder, inst_sequence, source_idx, idx_ast);
+
+    IrSequence *data = inst_push_data_raw(builder, inst_sequence, sizeof(IrSequence) + count * sizeof(IrRef), Align_of(IrSequence));
+    data->type  = type_destination;
+    data->count = count;
+    memcpy(data->items, items, count * sizeof(IrRef));
+
+    return ir_ref_from_instruction_index(inst_sequence);
+  } break;
+  case Ast_type_array: {
+    AstTypeArray *type_array = ast_data(ast, idx_ast);
+
+    IrRef ref_size = gen_code(gen, type_array->size, (IrRef){0});
+    IrRef ref_base = gen_code(gen, type_array->base, ir_ref_from_value_index(gen->common->val.type));
+
+    InstructionIndex inst_type = inst_alloc(builder);
+    inst_set_opcode(builder, inst_type, IR_type);
+    inst_set_source(builder, inst_type, source_idx, idx_ast);
+
+    u32 arg_count = 2; // size + base type
+
+    IrType *data_type = inst_push_data_raw(builder, inst_type, sizeof(IrType) + arg_count * sizeof(IrRef), Align_of(IrType));
+    *data_type = (IrType){
+      .kind = Type_array,
+      .arg_count = arg_count,
+    };
+
+    data_type->args[0] = ref_size;
+    data_type->args[1] = ref_base;
+
+    IrRef res = ir_ref_from_instruction_index(inst_type);
+    return ir_ref_from_instruction_index(inst_as(&gen->builder, type_destination, res, source_idx, idx_ast));
+  } break;
+  case Ast_type_optional: {
+    AstTypeOptional *type_optional = ast_data(ast, idx_ast);
+
+    IrRef ref_base = gen_code(gen, type_optional->base, ir_ref_from_value_index(gen->common->val.type));
+
+    InstructionIndex inst_type = inst_alloc(builder);
+    inst_set_opcode(builder, inst_type, IR_type);
+    inst_set_source(builder, inst_type, source_idx, idx_ast);
+
+    IrType *data_type = inst_push_data_raw(builder, inst_type, sizeof(IrType) + sizeof(IrRef), Align_of(IrType));
+    *data_type = (IrType){
+      .kind = Type_optional,
+      .arg_count = 1,
+    };
+
+    data_type->args[0] = ref_base;
+
+    IrRef res = ir_ref_from_instruction_index(inst_type);
+    return ir_ref_from_instruction_index(inst_as(&gen->builder, type_destination, res, source_idx, idx_ast));
+  } break;
+  case Ast_type_range: {
+    AstTypeRange *type_range = ast_data(ast, idx_ast);
+
+    // The bounds are comptime_int, checked when the type is specialized.
+    IrRef ref_lo = gen_code(gen, type_range->lo, (IrRef){0});
+    IrRef ref_hi = gen_code(gen, type_range->hi, (IrRef){0});
+
+    InstructionIndex inst_type = inst_alloc(builder);
+    inst_set_opcode(builder, inst_type, IR_type);
+    inst_set_source(builder, inst_type, source_idx, idx_ast);
+
+    u32 arg_count = 3; // lo + hi + whether hi is included
+
+    IrType *data_type = inst_push_data_raw(builder, inst_type, sizeof(IrType) + arg_count * sizeof(IrRef), Align_of(IrType));
+    *data_type = (IrType){
+      .kind = Type_range,
+      .arg_count = arg_count,
+    };
+
+    data_type->args[0] = ref_lo;
+    data_type->args[1] = ref_hi;
+    data_type->args[2] = ir_ref_from_value_index(type_range->is_inclusive ? gen->common->val.true : gen->common->val.false);
+
+    IrRef res = ir_ref_from_instruction_index(inst_type);
+    return ir_ref_from_instruction_index(inst_as(&gen->builder, type_destination, res, source_idx, idx_ast));
+  } break;
+  case Ast_unary_op: {
+    AstUnaryOp *ast_unary_op = ast_data(ast, idx_ast);
+    if (ast_unary_op->op_kind != Negate) {
+      Todo();
+    }
+
+    // `-x` is `0 - x` in the type of `x`, where the 0 is coerced to it. Only the result is coerced to
+    // the destination, so `-3` is in range of `-3..3` even though 3 is not.
+    ComptimeInt zero = 0;
+    IrRef lhs = ir_ref_from_value_index(values_intern_typed(gen->values, gen->common->type.comptime_int, ComptimeInt, &zero));
+    IrRef rhs = gen_code(gen, ast_unary_op->value, (IrRef){0});
+
+    InstructionIndex inst_binary_op = inst_alloc(builder);
+    inst_set_opcode(builder, inst_binary_op, IR_binary_op);
+    inst_set_source(builder, inst_binary_op, source_idx, idx_ast);
+
+    IrBinaryOp *data = inst_push_data(builder, inst_binary_op, IrBinaryOp);
+    *data = (IrBinaryOp){
+      .op = Sub,
+      .lhs = lhs,
+      .rhs = rhs,
+    };
+
+    IrRef res = ir_ref_from_instruction_index(inst_binary_op);
+    return ir_ref_from_instruction_index(inst_as(&gen->builder, type_destination, res, source_idx, idx_ast));
+  } break;
+  case Ast_type_struct: {
+    AstTypeStruct *type_struct = ast_data(ast, idx_ast);
+    u32 count = type_struct->count;
+    b32 is_ordered = (type_struct->attributes & StructAttribute_ordered) != 0;
+
+    IrStructField *fields = arena_push_array(IrStructField, gen->scratch, count);
+    for (u32 i = 0; i < count; i++) {
+      AstField *field = ast_data(ast, type_struct->fields[i]);
+
+      StringIndex name = strings_add(gen->strings, token_string(tokens, text, field->name));
+      for (u32 j = 0; j < i; j++) {
+        if (fields[j].name == name) {
+          report_error_at_token(gen, field->name, string_lit("Duplicate field name in struct."));
+        }
+      }
+
+      u8 placement = FieldPlacement_default;
+      if (field->attributes & FieldAttribute_hot)  { placement = FieldPlacement_hot;  }
+      if (field->attributes & FieldAttribute_cold) { placement = FieldPlacement_cold; }
+
+      if (is_ordered && placement != FieldPlacement_default) {
+        report_error_at_token(gen, field->name, string_lit("Fields of an ordered struct can not be hot or cold."));
+      }
+
+      fields[i] = (IrStructField){
+        .name      = name,
+        .placement = placement,
+        .type      = gen_code(gen, field->type, ir_ref_from_value_index(gen->common->val.type)),
+      };
+    }
+
+    InstructionIndex inst_type = inst_alloc(builder);
+    inst_set_opcode(builder, inst_type, IR_type_struct);
+    inst_set_source(builder, inst_type, source_idx, idx_ast);
+
+    IrTypeStruct *data = inst_push_data_raw(builder, inst_type, sizeof(IrTypeStruct) + count * sizeof(IrStructField), Align_of(IrTypeStruct));
+    data->is_ordered  = Cast(u8, is_ordered);
+    data->field_count = count;
+    memcpy(data->fields, fields, count * sizeof(IrStructField));
+
+    IrRef res = ir_ref_from_instruction_index(inst_type);
+    return ir_ref_from_instruction_index(inst_as(&gen->builder, type_destination, res, source_idx, idx_ast));
+  } break;
+  case Ast_binary_op: {
+    AstBinaryOp *ast_binary_op = ast_data(ast, idx_ast);
+    u8 op = ast_binary_op->op_kind;
+
+    // These short circuit, so they need control flow, which the IR can not express yet.
+    if (op == Logical_and || op == Logical_or) {
+      report_error_at_token(gen, ast->spans[idx_ast].start, string_lit("`and` and `or` are not supported yet."));
+      return ir_ref_from_value_index(gen->common->val.nil);
+    }
+
+    // The operands of a comparison do not have the type of its result.
+    b32 is_comparison = op >= Cmp_equal && op <= Cmp_less_equal;
+    IrRef operand_destination = is_comparison ? (IrRef){0} : type_destination;
+
+    IrRef lhs = gen_code(gen, ast_binary_op->lhs, operand_destination);
+    IrRef rhs = gen_code(gen, ast_binary_op->rhs, operand_destination);
+
+    InstructionIndex inst_binary_op = inst_alloc(builder);
+    inst_set_opcode(builder, inst_binary_op, IR_binary_op);
+    inst_set_source(builder, inst_binary_op, source_idx, idx_ast);
+
+    IrBinaryOp *data = inst_push_data(builder, inst_binary_op, IrBinaryOp);
+    *data = (IrBinaryOp){
+      .op = op,
+      .lhs = lhs,
+      .rhs = rhs,
+    };
+
+    IrRef res = ir_ref_from_instruction_index(inst_binary_op);
+    return ir_ref_from_instruction_index(inst_as(&gen->builder, type_destination, res, source_idx, idx_ast));
+  } break;
   default:
     Todo();
   }
@@ -385,7 +627,15 @@ IrRef gen_declaration_type_of_val_code(CodeGen *gen, AstIndex idx_ast, IrRef dec
 
   u8 kind = ast->kinds[idx_ast];
   switch (Cast(AstKind, kind)) {
-  case Ast_identifier: {
+  case Ast_identifier:
+  case Ast_literal_int:
+  case Ast_literal_sequence:
+  case Ast_builtin:
+  case Ast_type_struct:
+  case Ast_type_optional:
+  case Ast_type_range:
+  case Ast_unary_op:
+  case Ast_binary_op: {
     res = declared_type;
   } break;
   case Ast_function: {
@@ -440,7 +690,7 @@ IrRef gen_declaration_type_of_val_code(CodeGen *gen, AstIndex idx_ast, IrRef dec
   return res;
 }
 
-b32 generate_code(CodeGenContext *context, Declaration *decl) {
+b32 generate_code(CodeGenContext *context, Declaration *decl, b32 defer_lazy_body) {
   // NOTE: It is possible to output dependencies on other declarations for the pieces of code.
   // However, these dependencies may contain false positives, because whether another declaration is
   // actually used can depend on running a piece of comptime code.
@@ -483,11 +733,17 @@ b32 generate_code(CodeGenContext *context, Declaration *decl) {
     decl_type = ir_ref_from_instruction_index(block_decl_type);
   }
 
+  AstNodes *ast = &source->ast;
+  b32 defer = defer_lazy_body &&
+              ast->kinds[ast_decl->value] == Ast_function &&
+              ast->kinds[Cast(AstFunction*, ast_data(ast, ast_decl->value))->body] == Ast_lazy_body;
+
   IrRef decl_val;
   {
     InstructionIndex block = inst_eval_block_begin(builder);
 
-    IrRef ref_decl_val = gen_code(&gen, ast_decl->value, decl_type);
+    IrRef ref_decl_val = defer ? ir_ref_from_value_index(gen.common->val.nil)
+                               : gen_code(&gen, ast_decl->value, decl_type);
 
     inst_block_end_with_value(builder, block, ref_decl_val);
     
@@ -500,6 +756,7 @@ b32 generate_code(CodeGenContext *context, Declaration *decl) {
   };
 
   irbuilder_flatten(builder, context->perm, &decl->data.decl.chunk);
+  decl->data.decl.value_deferred = Cast(b8, defer);
 
   codegen_deinit(&gen);
 
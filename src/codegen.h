@@ -10,9 +10,13 @@ typedef struct {
   MessageSink    *msg_sink;
   StringInterner *strings;
   DeclarationInterner *decls;
+  TypeInterner        *types;
   ValueStore          *values;
 } CodeGenContext;
 
-b32 generate_code(CodeGenContext *context, Declaration *decl);
+// Generates the code of `decl`. With `defer_lazy_body`, a declaration whose value is a function with
+// an `Ast_lazy_body` only gets the code for its type, and its value block is left empty. Such a
+// declaration is marked `value_deferred` until it is generated again without `defer_lazy_body`.
+b32 generate_code(CodeGenContext *context, Declaration *decl, b32 defer_lazy_body);
 
 #endif // CODEGEN_H
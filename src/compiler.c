@@ -1,11 +1,15 @@
 #include "compiler.h"
 #include "source_file.h"
+#include "source_cache.h"
 #include "string_interner.h"
 #include "codegen.h"
 #include "specialize.h"
 #include "interpret.h"
 #include "ir.h"
+#include "ir_pass.h"
+#include "ir_image.h"
 #include "print.h"
+#include "integer.h"
 
 #include <stdarg.h>
 
@@ -74,14 +78,14 @@ compiler_add_message(void *user, u8 severity, MessageLocation location, String f
   u32 arg_count = message_format_arg_count(format);
 
   Message *msg = arena_push(
-    &compiler->arena,
+    &compiler->build,
     sizeof(Message) + arg_count * sizeof(MessageArg),
     Align_of(Message)
   );
 
   msg->severity = severity;
   msg->location = location;
-  msg->format = arena_copy_string(&compiler->arena, format);
+  msg->format = arena_copy_string(&compiler->build, format);
 
   va_list vl;
   va_start(vl, format);
@@ -92,33 +96,49 @@ compiler_add_message(void *user, u8 severity, MessageLocation location, String f
 
   va_end(vl);
 
-  msglist_append(&compiler->msg_list, &compiler->arena, msg);
+  msglist_append(&compiler->msg_list, &compiler->build, msg);
 }
 
 internal ValueIndex add_type_value(Compiler *compiler, TypeIndex t) {
-  Value *v;
-  ValueIndex res = values_alloc(&compiler->values, &v);
-  TypeIndex *data = values_alloc_data_type(&compiler->values, TypeIndex);
-  *data = t;
-  *v = (Value){
-    .type = compiler->common.type.type,
-    .data_size = sizeof(TypeIndex),
-    .data = data,
-  };
-  return res;
+  return values_intern_typed(&compiler->values, compiler->common.type.type, TypeIndex, &t);
 }
 
-internal void add_primitive(Compiler *compiler, String name, ValueIndex val) {
-  DeclarationIndex idx = decls_add(
-    &compiler->decls,
-    (DeclarationKey){.parent = 0, .name = strings_add(&compiler->strings, name)}
-  );
+internal DeclarationIndex add_primitive_declaration(DeclarationInterner *decls, StringIndex name, ValueIndex val) {
+  DeclarationIndex idx = decls_add(decls, (DeclarationKey){.parent = 0, .name = name});
 
   decls_set_extra(
-    &compiler->decls,
+    decls,
     idx,
     (Declaration){.idx = idx, .kind = Declaration_primitive, .data.primitive = val}
   );
+
+  return idx;
+}
+
+internal void add_primitive(Compiler *compiler, String name, ValueIndex val) {
+  add_primitive_declaration(&compiler->decls, strings_add(&compiler->strings, name), val);
+}
+
+internal void init_declarations(Compiler *compiler) {
+  decls_init(
+    &compiler->decls,
+    &(InternerOptions){
+      .arena = &compiler->build,
+      .map_allocator = cstd_allocator,
+      .map_initial_size = 32,
+    }
+  );
+}
+
+internal void add_primitives(Compiler *compiler) {
+  add_primitive(compiler, string_lit("true"), compiler->common.val.true);
+  add_primitive(compiler, string_lit("false"), compiler->common.val.false);
+  add_primitive(compiler, string_lit("type"), compiler->common.val.type);
+  add_primitive(compiler, string_lit("nil"), compiler->common.val.nil);
+  add_primitive(compiler, string_lit("bool"), compiler->common.val.bool);
+  add_primitive(compiler, string_lit("never"), compiler->common.val.never);
+  add_primitive(compiler, string_lit("i32"), compiler->common.val.i32);
+  add_primitive(compiler, string_lit("i8"), compiler->common.val.i8);
 }
 
 void compiler_init(Compiler *compiler, CLIOptions *options) {
@@ -142,6 +162,14 @@ void compiler_init(Compiler *compiler, CLIOptions *options) {
     }
   );
 
+  arena_init(
+    &compiler->build,
+    &(ArenaOptions){
+      .reserve_size = MiB(64),
+      .initial_commit_size = MiB(1),
+    }
+  );
+
   compiler->msg_sink = (MessageSink){
     .user = compiler,
     .add_message = compiler_add_message,
@@ -169,6 +197,14 @@ void compiler_init(Compiler *compiler, CLIOptions *options) {
     }
   );
 
+  unify_cache_init(
+    &compiler->unify_cache,
+    &(HashMapOptions){
+      .allocator = cstd_allocator,
+      .initial_size = 32,
+    }
+  );
+
   values_init(
     &compiler->values,
     &(ValueStoreOptions){
@@ -177,14 +213,7 @@ void compiler_init(Compiler *compiler, CLIOptions *options) {
     }
   );
 
-  decls_init(
-    &compiler->decls,
-    &(InternerOptions){
-      .arena = &compiler->arena,
-      .map_allocator = cstd_allocator,
-      .map_initial_size = 32,
-    }
-  );
+  init_declarations(compiler);
 
   compiler->common.type.comptime_int = types_add(&compiler->types, &(Type){.kind = Type_comptime_int});
   compiler->common.type.type = types_add(&compiler->types, &(Type){.kind = Type_type});
@@ -203,42 +232,32 @@ void compiler_init(Compiler *compiler, CLIOptions *options) {
   compiler->common.val.i8 = add_type_value(compiler, ti_i8);
 
   {
-    Value *v;
-    compiler->common.val.true = values_alloc(&compiler->values, &v);
-    u8 *data = values_alloc_data(&compiler->values, 1, 1);
-    *data = 1;
-    *v = (Value){
-      .type = compiler->common.type.bool,
-      .data_size = 1,
-      .data = data,
-    };
-    add_primitive(compiler, string_lit("true"), compiler->common.val.true);
+    u8 data = 1;
+    compiler->common.val.true = values_intern_typed(&compiler->values, compiler->common.type.bool, u8, &data);
   }
 
   {
-    Value *v;
-    compiler->common.val.false = values_alloc(&compiler->values, &v);
-    u8 *data = values_alloc_data(&compiler->values, 1, 1);
-    *data = 0;
-    *v = (Value){
-      .type = compiler->common.type.bool,
-      .data_size = 1,
-      .data = data,
-    };
-    add_primitive(compiler, string_lit("false"), compiler->common.val.false);
+    u8 data = 0;
+    compiler->common.val.false = values_intern_typed(&compiler->values, compiler->common.type.bool, u8, &data);
   }
 
-  add_primitive(compiler, string_lit("type"), compiler->common.val.type);
-  add_primitive(compiler, string_lit("nil"), compiler->common.val.nil);
-  add_primitive(compiler, string_lit("bool"), compiler->common.val.bool);
-  add_primitive(compiler, string_lit("never"), compiler->common.val.never);
-  add_primitive(compiler, string_lit("i32"), compiler->common.val.i32);
-  add_primitive(compiler, string_lit("i8"), compiler->common.val.i8);
+  add_primitives(compiler);
 }
 
 void compiler_deinit(Compiler *compiler) {
+  // The sources own their token reservations and file mappings, which are not part of the arena.
+  for (u32 i = 1; i < compiler->sources.len; i++) {
+    source_file_deinit(sources_ptr_at_unchecked(&compiler->sources, i));
+  }
+
+  decls_deinit(&compiler->decls);
+  types_deinit(&compiler->types);
+  strings_deinit(&compiler->strings);
+  unify_cache_deinit(&compiler->unify_cache);
+  values_deinit(&compiler->values);
   arena_deinit(&compiler->arena);
   arena_deinit(&compiler->scratch);
+  arena_deinit(&compiler->build);
 }
 
 void compiler_add_sourcefile(Compiler *compiler, String filename) {
@@ -247,6 +266,56 @@ void compiler_add_sourcefile(Compiler *compiler, String filename) {
   source_file_init(source, idx, filename);
 }
 
+b32 compiler_sources_changed(Compiler *compiler) {
+  for (u32 i = 1; i < compiler->sources.len; i++) {
+    Source *source = sources_ptr_at_unchecked(&compiler->sources, i);
+    if (source_file_changed(source, &compiler->scratch)) {
+      return True;
+    }
+  }
+
+  return False;
+}
+
+void compiler_reset(Compiler *compiler) {
+  for (u32 i = 1; i < compiler->sources.len; i++) {
+    Source *source = sources_ptr_at_unchecked(&compiler->sources, i);
+
+    // A source with messages is processed again as well, or its messages would be added twice.
+    if (!source_file_changed(source, &compiler->scratch) && source->msg_list.len == 0) {
+      continue;
+    }
+
+    // The filename lives in the arena of the source.
+    ArenaSnapshot scope = arena_scope_begin(&compiler->scratch);
+
+    String filename = arena_copy_string(&compiler->scratch, source->filename);
+    source_file_deinit(source);
+    source_file_init(source, i, filename);
+
+    arena_scope_end(&compiler->scratch, scope);
+  }
+
+  compiler->msg_list   = (MessageList){0};
+  compiler->user_decls = (DeclIdxList){0};
+
+  // The declarations of the sources that did not change are added again by `compile`, but their
+  // values are evaluated again too: they may depend on a declaration that did change.
+  decls_deinit(&compiler->decls);
+
+  arena_clear(&compiler->build);
+
+  init_declarations(compiler);
+  add_primitives(compiler);
+
+  // Only the values of the primitives are still in use. The function values of the previous build
+  // refer to code in the build arena, so they must not outlive it.
+  ValueCollector c;
+  values_collect_begin(&c, &compiler->values, &compiler->types, &compiler->scratch);
+  declarations_mark_values(&c, &compiler->decls, &compiler->common);
+  values_collect_end(&c);
+}
+
 Source *compiler_get_source(Compiler *compiler, SourceIndex source_idx) {
   return sources_ptr_at_unchecked(&compiler->sources, source_idx);
 }
@@ -299,14 +368,105 @@ b32 lookup_identifier(
   return False;
 }
 
+b32 lookup_integer_primitive(
+  DeclarationInterner *decls,
+  TypeInterner *types,
+  ValueStore *values,
+  Common *common,
+  String name,
+  StringIndex name_idx,
+  DeclarationIndex *out
+) {
+  TypeInteger integer;
+  if (!int_type_from_name(name, &integer)) {
+    return False;
+  }
+
+  TypeIndex t = types_add(types, &(Type){.kind = Type_integer, .data.integer = integer});
+  ValueIndex val = values_intern_typed(values, common->type.type, TypeIndex, &t);
+
+  *out = add_primitive_declaration(decls, name_idx, val);
+
+  return True;
+}
+
+void declarations_mark_values(ValueCollector *c, DeclarationInterner *decls, Common *common) {
+  ValueIndex common_values[] = {
+    common->val.type,
+    common->val.nil,
+    common->val.bool,
+    common->val.never,
+    common->val.i32,
+    common->val.i8,
+    common->val.true,
+    common->val.false,
+  };
+
+  for (u32 i = 0; i < sizeof(common_values) / sizeof(common_values[0]); i++) {
+    values_mark(c, common_values[i]);
+  }
+
+  for (DeclarationIndex i = 1; i < decls->list.len; i++) {
+    Declaration *decl = decls_extra_get_ptr(decls, i);
+
+    switch (decl->kind) {
+    case Declaration_primitive: {
+      values_mark(c, decl->data.primitive);
+    } break;
+    case Declaration_decl: {
+      values_mark_chunk(c, &decl->data.decl.chunk);
+      values_mark(c, decl->data.decl.val);
+    } break;
+    default: break;
+    }
+  }
+}
+
 // -------------------------------------------------------------------------------------------------
 
+// The chunk is not always the one of a declaration, a residual function has its own, so the
+// instruction is reported in the message instead of as its location.
+internal b32 run_ir_pipeline(IrPipeline *pipeline, IrPassContext *context, MessageSink *sink, IrChunk *chunk) {
+  IrPipelineError err;
+  if (ir_pipeline_run(pipeline, context, chunk, &err)) {
+    return True;
+  }
+
+  char buf[256];
+  int len;
+
+  if (err.after_pass.len == 0) {
+    len = snprintf(buf, sizeof(buf), "Invalid IR at instruction %u: %s", err.verify.inst, err.verify.reason);
+  } else {
+    len = snprintf(
+      buf,
+      sizeof(buf),
+      "Invalid IR after pass '%.*s' at instruction %u: %s",
+      Cast(int, err.after_pass.len),
+      err.after_pass.str,
+      err.verify.inst,
+      err.verify.reason
+    );
+  }
+
+  Message_error(
+    sink,
+    (MessageLocation){ .kind = MessageLocation_unspecified, },
+    (String){ .str = Cast(u8*, buf), .len = Cast(usize, Min(Max(len, 0), Cast(int, sizeof(buf)) - 1)) }
+  );
+
+  return False;
+}
+
 #define MAX_RESOLVE_DEPTH 64
 
 typedef struct {
   Declaration *decl;
   RunState state;
   u8 min_required_resolve_status;
+
+  // The call stack and frames of the entry are released when it is popped.
+  ArenaSnapshot snapshot;
 } ResolveEntry;
 
 typedef struct {
@@ -319,18 +479,49 @@ typedef struct {
   u32 user_declaration_count;
   Declaration **user_declarations;
 
+  // `main.main`, which is always fully resolved. Null if there is none.
+  Declaration *entry_point;
+
   DeclarationInterner *decls;
 
+  // Used to generate the deferred function bodies, see `ensure_value_generated`.
+  CodeGenContext *codegen;
+  IrPipeline     *pipeline;
+  IrPassContext  *pass_context;
+
   Specializer *in;
   Stack(ResolveEntry) resolve_stack;
 } Resolver;
 
+// The value of a declaration whose function body was deferred can only be resolved once the code
+// of the body is generated. Only the bodies of the functions whose value is needed are ever parsed.
+// Returns False if `decl` has an error.
+internal b32 ensure_value_generated(Resolver *resolver, Declaration *decl) {
+  // A declaration that is being resolved is circular, which is reported when its entry is resumed.
+  if (decl->kind != Declaration_decl || !decl->data.decl.value_deferred ||
+      decl->resolve_status == ResolveStatus_resolving_type ||
+      decl->resolve_status == ResolveStatus_error)
+  {
+    return decl->resolve_status != ResolveStatus_error;
+  }
+
+  b32 ok = generate_code(resolver->codegen, decl, False) &&
+           run_ir_pipeline(resolver->pipeline, resolver->pass_context, resolver->msg_sink, &decl->data.decl.chunk);
+
+  // The value block refers to the result of the type block, which is only known in the frame that
+  // ran it, so the type is resolved again along with the value.
+  decl->resolve_status = ok ? ResolveStatus_unresolved : ResolveStatus_error;
+
+  return ok;
+}
+
 internal void
 push_resolve_entry(Resolver *resolver, Declaration *decl, u8 min_required_resolve_status) {
   ResolveEntry *entry = stack_push_ptr_unchecked(&resolver->resolve_stack);
 
   entry->decl = decl;
   entry->min_required_resolve_status = min_required_resolve_status;
+  entry->snapshot = arena_scope_begin(resolver->scratch);
 
   runstate_init(&entry->state, resolver->scratch);
 
@@ -346,9 +537,10 @@ internal b32 resolve_entry(Resolver *resolver) {
 
   u8 resolve_status = decl->resolve_status;
 
-  decl->resolve_status = (resolve_status + 1);
-
   if (!entry->state.requested_resolution) {
+    // An entry that is resumed after a requested resolution is already resolving.
+    decl->resolve_status = (resolve_status + 1);
+
     CallFrame *frame = top_frame(&entry->state);
     ScopeSpan *scope = push_scope(frame);
 
@@ -405,6 +597,10 @@ internal b32 resolve_entry(Resolver *resolver) {
 
     Declaration *decl_to_resolve = decls_extra_get_ptr(resolver->decls, idx);
 
+    if (err == Run_resolve_declaration_value && !ensure_value_generated(resolver, decl_to_resolve)) {
+      return False;
+    }
+
     u8 min_required_resolve_status;
     switch (err) {
     case Run_resolve_declaration_type:
@@ -425,13 +621,48 @@ internal b32 resolve_entry(Resolver *resolver) {
   Unreachable();
 }
 
+// Collections only happen between calls to `resolve_entry`. At that point every value that is in
+// use is either owned by a declaration, by a frame of a pending entry or by residual code that is
+// still being built.
+internal void collect_values(Resolver *resolver) {
+  Specializer *in = resolver->in;
+
+  ValueCollector c;
+  values_collect_begin(&c, in->values, in->types, resolver->scratch);
+
+  declarations_mark_values(&c, resolver->decls, in->common);
+
+  for (u32 i = 0; i < resolver->resolve_stack.len; i++) {
+    CallStack *frames = &resolver->resolve_stack.data[i].state.call_stack;
+
+    for (u32 j = 0; j < frames->len; j++) {
+      CallFrame *f = &frames->data[j];
+
+      for (InstructionIndex k = 0; k < f->chunk->opcode_count; k++) {
+        values_mark_ref(&c, f->inst_map[k]);
+      }
+    }
+  }
+
+  for (u32 i = 0; i < in->builders.len; i++) {
+    values_mark_builder(&c, &in->builders.data[i]);
+  }
+
+  values_collect_end(&c);
+}
+
+internal void pop_resolve_entry(Resolver *resolver) {
+  ResolveEntry entry = stack_pop(&resolver->resolve_stack);
+  arena_scope_end(resolver->scratch, entry.snapshot);
+}
+
 internal void clear_resolve_stack_with_error(Resolver *resolver) {
   resolver->ok = False;
 
   while (!stack_is_empty(&resolver->resolve_stack)) {
     ResolveEntry *entry = stack_peek_ptr_unchecked(&resolver->resolve_stack);
     entry->decl->resolve_status = ResolveStatus_error;
-    stack_pop_unchecked(&resolver->resolve_stack);
+    pop_resolve_entry(resolver);
   }
 }
 
@@ -440,9 +671,22 @@ b32 resolve_declarations(Resolver *resolver) {
     {
       Declaration *decl = resolver->user_declarations[i];
 
+      // The value of a function whose body is deferred is only resolved once something needs it.
+      u8 min_required_resolve_status = ResolveStatus_fully_resolved;
+      if (decl->data.decl.value_deferred && decl != resolver->entry_point) {
+        min_required_resolve_status = ResolveStatus_type_resolved;
+      }
+
+      if (min_required_resolve_status == ResolveStatus_fully_resolved &&
+          !ensure_value_generated(resolver, decl))
+      {
+        resolver->ok = False;
+        continue;
+      }
+
       u8 resolve_status = decl->resolve_status;
 
-      if (resolve_status == ResolveStatus_fully_resolved || resolve_status == ResolveStatus_error) {
+      if (resolve_status >= min_required_resolve_status || resolve_status == ResolveStatus_error) {
         continue;
       }
 
@@ -450,18 +694,20 @@ b32 resolve_declarations(Resolver *resolver) {
         resolve_status == ResolveStatus_unresolved || resolve_status == ResolveStatus_type_resolved
       );
 
-      push_resolve_entry(resolver, decl, ResolveStatus_fully_resolved);
+      push_resolve_entry(resolver, decl, min_required_resolve_status);
     }
 
     while (!stack_is_empty(&resolver->resolve_stack)) {
+      if (values_should_collect(resolver->in->values)) {
+        collect_values(resolver);
+      }
+
       ResolveEntry *entry = stack_peek_ptr_unchecked(&resolver->resolve_stack);
 
       u8 resolve_status = entry->decl->resolve_status;
 
       if (resolve_status >= entry->min_required_resolve_status) {
-        stack_pop_unchecked(
-          &resolver->resolve_stack
-        ); // TODO: free callstack of entry? yeah, sounds like a good idea
+        pop_resolve_entry(resolver);
         continue;
       }
 
@@ -510,36 +756,169 @@ typedef struct {
   u32 n;
 } DeclFrame;
 
-b32 compile(Compiler *compiler) {
+typedef struct {
+  Compiler *compiler;
+  u32      *sources;       // The indices of the sources that are not processed yet.
+  Arena    *scratches;     // One per worker.
+  u32       chunk_threads; // The threads for the chunks of a single source.
+  String    cache_dir;     // `str` is Null if there is no cache.
+} FrontendJobs;
+
+// Reads, tokenizes and parses a source file and indexes its declarations. A source only touches
+// its own arena and messages, the scratch arena of its worker and the string interner, which is
+// locked, so the sources can be processed in parallel. The messages of every source are printed
+// in source order, no matter which one finishes first.
+internal b32 process_source(FrontendJobs *jobs, Source *source, Arena *scratch, PhaseTimer *timer) {
+  // A source lives across builds in watch mode, during which its file can be truncated by an editor.
+  if (!source_read_file(source, jobs->compiler->options->watch)) {
+    return False;
+  }
+
+  phase_timer_next(timer, SourcePhase_cache_load);
+
+  b32 is_cached = jobs->cache_dir.str && source_cache_load(source, jobs->cache_dir, scratch);
+
+  if (!is_cached) {
+    phase_timer_next(timer, SourcePhase_tokenize);
+
+    if (!source_tokenize(source, scratch, jobs->chunk_threads)) {
+      return False;
+    }
+
+    phase_timer_next(timer, SourcePhase_parse);
+
+    if (!source_parse(source, scratch, jobs->chunk_threads)) {
+      return False;
+    }
+
+    phase_timer_next(timer, SourcePhase_cache_store);
+
+    // A source that fails to parse is not stored, so its messages are reported by every build.
+    if (jobs->cache_dir.str) {
+      source_cache_store(source, jobs->cache_dir, scratch);
+    }
+  }
+
+  phase_timer_next(timer, SourcePhase_index);
+
+  source_index_declarations(source, &jobs->compiler->strings);
+
+  return True;
+}
+
+internal void run_frontend(void *context, u32 worker, u32 index) {
+  FrontendJobs *jobs     = context;
+  Compiler     *compiler = jobs->compiler;
+  Arena        *scratch  = &jobs->scratches[worker];
+
+  Source *source = sources_ptr_at_unchecked(&compiler->sources, jobs->sources[index]);
+
+  PhaseTimer timer;
+  phase_timer_begin(&timer, source->times, SourcePhase_read, True);
+
+  b32 ok = process_source(jobs, source, scratch, &timer);
+
+  phase_timer_end(&timer);
+
+  source->status = ok ? SourceStatus_parsed : SourceStatus_failed_to_parse;
+}
+
+internal b32 run_phases(Compiler *compiler, PhaseTimer *timer) {
   b32 is_ok = True;
-  for (u32 i = 1; i < compiler->sources.len; i++) {
-    Source *source = sources_ptr_at_unchecked(&compiler->sources, i);
 
-    b32 ok;
-    ok = source_read_file(source);
-    if (!ok) {
-      is_ok = False;
-      source->status = SourceStatus_failed_to_parse;
-      continue;
+  IrPipeline pipeline;
+  {
+    String spec = compiler->options->ir_passes;
+    if (!spec.str) {
+      spec = string_lit(IR_DEFAULT_PIPELINE);
     }
 
-    ok = source_tokenize(source, &compiler->scratch);
-    if (!ok) {
-      is_ok = False;
-      source->status = SourceStatus_failed_to_parse;
-      continue;
+    u32 err = ir_pipeline_init(&pipeline, spec, compiler->options->verify_ir);
+    if (err) {
+      Message_error(
+        &compiler->msg_sink,
+        (MessageLocation){ .kind = MessageLocation_unspecified, },
+        err == IrPipelineInit_error_unknown_pass
+          ? string_lit("Unknown IR pass in --ir-passes")
+          : string_lit("Too many IR passes in --ir-passes")
+      );
+      return False;
     }
+  }
 
-    ok = source_parse(source, &compiler->scratch);
-    if (!ok) {
-      is_ok = False;
-      source->status = SourceStatus_failed_to_parse;
-      continue;
+  IrPassContext pass_context = {
+    .scratch = &compiler->scratch,
+    .types = &compiler->types,
+    .values = &compiler->values,
+  };
+  {
+    // Only the sources that are not processed yet go through the frontend. In watch mode that is
+    // every source that changed since the last build.
+    u32 *sources      = arena_push_array(u32, &compiler->scratch, compiler->sources.len);
+    u32  source_count = 0;
+    for (u32 i = 1; i < compiler->sources.len; i++) {
+      Source *source = sources_ptr_at_unchecked(&compiler->sources, i);
+      if (source->status == SourceStatus_unprocessed) {
+        sources[source_count++] = i;
+      }
+
+      memset(source->times, 0, sizeof(source->times));
+      source->parse_scratch_peak = 0;
+    }
+
+    u32 total_threads = compiler->options->jobs;
+    if (total_threads == 0) {
+      total_threads = Min(cpu_core_count(), Max_parallel_for_threads);
+    }
+    u32 thread_count = Max(Min(total_threads, source_count), 1);
+
+    Arena *scratches = arena_push_array(Arena, &compiler->scratch, thread_count);
+    for (u32 i = 0; i < thread_count; i++) {
+      arena_init(&scratches[i], &(ArenaOptions){
+        .reserve_size        = MiB(16),
+        .initial_commit_size = MiB(1),
+      });
     }
 
-    source_index_declarations(source, &compiler->strings);
+    String cache_dir = compiler->options->cache_dir;
+    if (cache_dir.str) {
+      ArenaSnapshot scope = arena_scope_begin(&compiler->scratch);
+
+      char *cstr = arena_push_array(char, &compiler->scratch, cache_dir.len + 1);
+      memcpy(cstr, cache_dir.str, cache_dir.len);
+      cstr[cache_dir.len] = '\0';
+
+      if (!directory_create(cstr)) {
+        fprintf(stderr, "Could not create cache directory '%.*s', building without a cache.\n", Cast(int, cache_dir.len), cache_dir.str);
+        cache_dir = (String){0};
+      }
 
-    source->status = SourceStatus_parsed;
+      arena_scope_end(&compiler->scratch, scope);
+    }
+
+    FrontendJobs jobs = {
+      .compiler      = compiler,
+      .sources       = sources,
+      .scratches     = scratches,
+      .chunk_threads = Max(total_threads / Max(source_count, 1), 1),
+      .cache_dir     = cache_dir,
+    };
+
+    parallel_for(thread_count, source_count, run_frontend, &jobs);
+
+    compiler->frontend_scratch_peak = 0;
+    for (u32 i = 0; i < thread_count; i++) {
+      usize peak = arena_peak_size(&scratches[i]);
+      compiler->frontend_scratch_peak = Max(compiler->frontend_scratch_peak, peak);
+      arena_deinit(&scratches[i]);
+    }
+
+    for (u32 i = 1; i < compiler->sources.len; i++) {
+      Source *source = sources_ptr_at_unchecked(&compiler->sources, i);
+      if (source->status != SourceStatus_parsed) {
+        is_ok = False;
+      }
+    }
   }
 
   if (compiler->options->print_tokens) {
@@ -560,6 +939,8 @@ b32 compile(Compiler *compiler) {
     return False;
   }
 
+  phase_timer_next(timer, CompilePhase_declarations);
+
   // Add all source file declarations to the global declaration map
   for (u32 i = 1; i < compiler->sources.len; i++) {
     Source *source = sources_ptr_at_unchecked(&compiler->sources, i);
@@ -650,7 +1031,7 @@ b32 compile(Compiler *compiler) {
           goto next_iter;
         }
 
-        user_decls_append(&compiler->user_decls, &compiler->arena, idx);
+        user_decls_append(&compiler->user_decls, &compiler->build, idx);
 
         source->decl_idxs[offset] = idx;
 
@@ -674,31 +1055,56 @@ b32 compile(Compiler *compiler) {
     }
   }
 
+  phase_timer_next(timer, CompilePhase_codegen);
+
   Declaration **user_decls =
     arena_push_array(Declaration *, &compiler->scratch, compiler->user_decls.len);
 
-  {
-    CodeGenContext context = {
-      .perm = &compiler->arena,
-      .scratch = &compiler->scratch,
-      .common = &compiler->common,
-      .msg_sink = &compiler->msg_sink,
-      .strings = &compiler->strings,
-      .decls = &compiler->decls,
-      .values = &compiler->values,
-    };
+  for (u32 i = 0; i < compiler->user_decls.len; i++) {
+    user_decls[i] = decls_extra_get_ptr(&compiler->decls, user_decls_at_unchecked(&compiler->user_decls, i));
+  }
 
-    for (u32 i = 0; i < compiler->user_decls.len; i++) {
-      Declaration *decl =
-        decls_extra_get_ptr(&compiler->decls, user_decls_at_unchecked(&compiler->user_decls, i));
-      user_decls[i] = decl;
-      is_ok &= generate_code(&context, decl);
-
-      if (compiler->options->print_decl_ir) {
-        ir_chunk_print(
-          stdout, compiler, &decl->data.decl.chunk
-        );
-      }
+  CodeGenContext codegen = {
+    .perm = &compiler->build,
+    .scratch = &compiler->scratch,
+    .common = &compiler->common,
+    .msg_sink = &compiler->msg_sink,
+    .strings = &compiler->strings,
+    .decls = &compiler->decls,
+    .types = &compiler->types,
+    .values = &compiler->values,
+  };
+
+  // The function bodies that were skipped by the parser are only parsed and generated once the value
+  // of their declaration is needed, see `ensure_value_generated`. Printing the IR or the residual
+  // value of every declaration needs all of them.
+  b32 defer_lazy_bodies = !compiler->options->print_decl_ir && !compiler->options->print_residual;
+
+  for (u32 i = 0; i < compiler->user_decls.len; i++) {
+    Declaration *decl = user_decls[i];
+    b32 ok = generate_code(&codegen, decl, defer_lazy_bodies);
+    is_ok &= ok;
+
+    if (ok && !run_ir_pipeline(&pipeline, &pass_context, &compiler->msg_sink, &decl->data.decl.chunk)) {
+      return False;
+    }
+
+    if (compiler->options->print_decl_ir) {
+      ir_chunk_print(
+        stdout, compiler, &decl->data.decl.chunk
+      );
+    }
+  }
+
+  // If there is no `main.main`, `run_main` reports it.
+  Declaration *entry_point = Null;
+  {
+    DeclarationIndex mod_main, fn_main;
+    StringIndex name_main = strings_add(&compiler->strings, string_lit("main"));
+    if (lookup_identifier(&compiler->decls, (DeclarationIndex[]){0}, 1, name_main, &mod_main) &&
+        lookup_identifier(&compiler->decls, (DeclarationIndex[]){mod_main}, 1, name_main, &fn_main))
+    {
+      entry_point = decls_extra_get_ptr(&compiler->decls, fn_main);
     }
   }
 
@@ -706,13 +1112,16 @@ b32 compile(Compiler *compiler) {
     return False;
   }
 
+  phase_timer_next(timer, CompilePhase_resolve);
+
   {
     Specializer specializer = {
-      .perm = &compiler->arena,
+      .perm = &compiler->build,
       .scratch = &compiler->scratch,
       .msg_sink = &compiler->msg_sink,
       .declarations = &compiler->decls,
       .types = &compiler->types,
+      .unify_cache = &compiler->unify_cache,
       .values = &compiler->values,
       .common = &compiler->common,
     };
@@ -725,7 +1134,11 @@ b32 compile(Compiler *compiler) {
       .scratch = &compiler->scratch,
       .user_declaration_count = compiler->user_decls.len,
       .user_declarations = user_decls,
+      .entry_point = entry_point,
       .decls = &compiler->decls,
+      .codegen = &codegen,
+      .pipeline = &pipeline,
+      .pass_context = &pass_context,
       .in = &specializer,
       .msg_sink = &compiler->msg_sink,
     };
@@ -740,6 +1153,31 @@ b32 compile(Compiler *compiler) {
     }
   }
 
+  phase_timer_next(timer, CompilePhase_optimize);
+
+  for (u32 i = 0; i < compiler->user_decls.len; i++) {
+    Declaration *decl = user_decls[i];
+
+    // The value of a deferred function that nothing depends on is not resolved.
+    if (decl->resolve_status != ResolveStatus_fully_resolved) {
+      continue;
+    }
+
+    Value *v = values_get(&compiler->values, decl->data.decl.val);
+
+    if (types_get(&compiler->types, v->type)->kind != Type_function) {
+      continue;
+    }
+
+    if (!run_ir_pipeline(&pipeline, &pass_context, &compiler->msg_sink, &Cast(ValueFunc*, value_data(v))->chunk)) {
+      return False;
+    }
+  }
+
+  if (compiler->options->time_ir_passes) {
+    ir_pipeline_print_stats(stderr, &pipeline);
+  }
+
   if (compiler->options->print_residual) {
     for (u32 i = 0; i < compiler->user_decls.len; i++) {
       DeclarationIndex idx = user_decls_at_unchecked(&compiler->user_decls, i);
@@ -750,7 +1188,7 @@ b32 compile(Compiler *compiler) {
       ValueIndex val = decl->data.decl.val;
 
       printf("%.*s : ", Cast(int, name.len), name.str);
-      type_index_print(stdout, &compiler->types, values_get(&compiler->values, val)->type);
+      type_index_print(stdout, compiler, values_get(&compiler->values, val)->type);
       printf(" = ");
       value_print(stdout, compiler, val);
       printf("\n");
@@ -760,7 +1198,21 @@ b32 compile(Compiler *compiler) {
   return is_ok;
 }
 
-b32 run_main(Compiler *compiler) {
+b32 compile(Compiler *compiler) {
+  memset(compiler->phase_times, 0, sizeof(compiler->phase_times));
+
+  PhaseTimer timer;
+  phase_timer_begin(&timer, compiler->phase_times, CompilePhase_frontend, False);
+
+  b32 ok = run_phases(compiler, &timer);
+
+  phase_timer_end(&timer);
+
+  return ok;
+}
+
+// Returns the chunk of the resolved `main.main`, or Null after reporting why there is none.
+internal IrChunk *find_main(Compiler *compiler) {
   DeclarationIndex mod_main;
   b32 ok = lookup_identifier(&compiler->decls, (DeclarationIndex[]){0}, 1, strings_add(&compiler->strings, string_lit("main")), &mod_main);
   if (!ok) {
@@ -770,7 +1222,7 @@ b32 run_main(Compiler *compiler) {
       string_lit("Module 'main' not found")
     );
 
-    return False;
+    return Null;
   }
 
   DeclarationIndex fn_main;
@@ -781,7 +1233,7 @@ b32 run_main(Compiler *compiler) {
       (MessageLocation){ .kind = MessageLocation_unspecified, },
       string_lit("Declaration 'main' not found in module 'main'")
     );
-    return False;
+    return Null;
   }
 
   Declaration *decl_main = decls_extra_get_ptr(&compiler->decls, fn_main);
@@ -789,8 +1241,10 @@ b32 run_main(Compiler *compiler) {
   // TODO: make sure main has the correct type
 
   Value *v = values_get(&compiler->values, decl_main->data.decl.val);
-  IrChunk *chunk = &Cast(ValueFunc*, v->data)->chunk;
+  return &Cast(ValueFunc*, value_data(v))->chunk;
+}
 
+internal b32 interpret_chunk(Compiler *compiler, IrChunk *chunk) {
   Interpreter in = {
     .scratch = &compiler->scratch,
     .msg_sink = &compiler->msg_sink,
@@ -801,7 +1255,103 @@ b32 run_main(Compiler *compiler) {
 
   ValueIndex res;
   u32 err = interpreter_call(&in, chunk, (ValueIndex[]){0}, 0, &res);
-  Assert(!err);
+  if (err == Interpret_error_division_by_zero) {
+    Message_error(
+      &compiler->msg_sink,
+      (MessageLocation){ .kind = MessageLocation_unspecified, },
+      string_lit("Division by zero")
+    );
+
+    return False;
+  }
+
+  if (err == Interpret_error_value_out_of_range) {
+    Message_error(
+      &compiler->msg_sink,
+      (MessageLocation){ .kind = MessageLocation_unspecified, },
+      string_lit("Result of operation is out of range of its range type")
+    );
+
+    return False;
+  }
+
+  // Any error the interpreter adds later still fails the run, even before it has its own message.
+  if (err != Interpret_ok) {
+    Message_error(
+      &compiler->msg_sink,
+      (MessageLocation){ .kind = MessageLocation_unspecified, },
+      string_lit("Interpretation of 'main' failed")
+    );
+
+    return False;
+  }
+
+  return True;
+}
+
+b32 run_main(Compiler *compiler) {
+  PhaseTimer timer;
+  phase_timer_begin(&timer, compiler->phase_times, CompilePhase_run, False);
+
+  IrChunk *chunk = find_main(compiler);
+  b32 ok = chunk && interpret_chunk(compiler, chunk);
+
+  phase_timer_end(&timer);
+
+  return ok;
+}
+
+internal void report_image_error(Compiler *compiler, u32 err) {
+  String reason;
+  switch (err) {
+  case IrImage_error_could_not_open_file:  reason = string_lit("Could not open the IR image"); break;
+  case IrImage_error_could_not_write_file: reason = string_lit("Could not write the IR image"); break;
+  case IrImage_error_unsupported_operand:  reason = string_lit("'main' can not be stored in an IR image, it refers to a declaration or a struct type"); break;
+  case IrImage_error_invalid_image:        reason = string_lit("The IR image is invalid"); break;
+  case IrImage_error_version_mismatch:     reason = string_lit("The IR image was written by another version of blu"); break;
+  default:                                 reason = string_lit("Unknown IR image error"); break;
+  }
+
+  Message_error(
+    &compiler->msg_sink,
+    (MessageLocation){ .kind = MessageLocation_unspecified, },
+    reason
+  );
+}
+
+b32 emit_image(Compiler *compiler, String filename) {
+  IrChunk *chunk = find_main(compiler);
+  if (!chunk) {
+    return False;
+  }
+
+  u32 err = ir_image_write(filename, &compiler->scratch, &compiler->types, &compiler->values, chunk);
+  if (err) {
+    report_image_error(compiler, err);
+    return False;
+  }
 
   return True;
 }
+
+b32 run_image(Compiler *compiler, String filename) {
+  memset(compiler->phase_times, 0, sizeof(compiler->phase_times));
+
+  PhaseTimer timer;
+  phase_timer_begin(&timer, compiler->phase_times, CompilePhase_run, False);
+
+  IrImage image;
+  u32 err = ir_image_load(&image, filename, &compiler->scratch, &compiler->types, &compiler->values);
+
+  b32 ok = !err && interpret_chunk(compiler, &image.chunk);
+
+  if (err) {
+    report_image_error(compiler, err);
+  } else {
+    ir_image_unload(&image);
+  }
+
+  phase_timer_end(&timer);
+
+  return ok;
+}
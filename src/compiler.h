@@ -6,7 +6,9 @@
 #include "string_interner.h"
 #include "value.h"
 #include "ir.h"
+#include "eval.h"
 #include "cli_options.h"
+#include "time_passes.h"
 
 typedef struct {
   struct {
@@ -71,6 +73,10 @@ struct Declaration {
       u32      tree_idx;
       IrChunk  chunk;
       ValueIndex val; // will be set after the declaration has been fully resolved
+
+      // The function body of the value is not generated yet, so only the type can be resolved. See
+      // `generate_code`.
+      b8 value_deferred;
     } decl;
   } data;
 };
@@ -106,6 +112,10 @@ typedef struct {
   Arena arena;
   Arena scratch;
 
+  // Holds everything that only lives for one build: the declarations, their code, the residual code
+  // and the messages. Cleared by `compiler_reset`, while `arena` keeps what carries over.
+  Arena build;
+
   CLIOptions *options;
 
   SourceList sources;
@@ -117,9 +127,16 @@ typedef struct {
   ValueStore     values;
   StringInterner strings;
   TypeInterner   types;
+  UnifyCache     unify_cache;
 
   DeclarationInterner decls;
   DeclIdxList         user_decls;
+
+  // How long each phase of the last build took. Reset by `compile`.
+  PhaseTime phase_times[CompilePhase_count];
+
+  // The most bytes that were in use in the scratch arena of a frontend worker in the last build.
+  usize frontend_scratch_peak;
 } Compiler;
 
 void compiler_init(Compiler *compiler, CLIOptions *options);
@@ -128,11 +145,32 @@ void compiler_deinit(Compiler *compiler);
 void compiler_add_sourcefile(Compiler *compiler, String filename);
 Source *compiler_get_source(Compiler *compiler, SourceIndex source_idx);
 
+// Watch mode keeps a compiler around between builds. The strings, types, values and unify cache
+// carry over to the next build, and only the sources whose file changed are read and parsed again.
+// Everything else of the previous build is released, so the memory of the compiler stays the same
+// from one build to the next.
+b32  compiler_sources_changed(Compiler *compiler);
+void compiler_reset(Compiler *compiler);
+
 b32 lookup_identifier(DeclarationInterner *decls_keys, DeclarationIndex *mods, u32 mod_count, StringIndex name, DeclarationIndex *out);
 
+// Integer types can have any bitwidth, so instead of adding a primitive declaration for each of them
+// up front, the declaration is added the first time its name is looked up. Returns False if `name`
+// is not the name of an integer type.
+b32 lookup_integer_primitive(DeclarationInterner *decls, TypeInterner *types, ValueStore *values, Common *common, String name, StringIndex name_idx, DeclarationIndex *out);
+
 void compiler_print_all_messages(Compiler *compiler);
 
+// Marks the values of all declarations, the values their IR refers to and the common values.
+void declarations_mark_values(ValueCollector *c, DeclarationInterner *decls, Common *common);
+
 b32 compile(Compiler *compiler);
 b32 run_main(Compiler *compiler);
 
+// Writes the compiled `main.main`, and the code it calls, to an IR image, see "ir_image.h".
+b32 emit_image(Compiler *compiler, String filename);
+
+// Runs the `main.main` stored in an IR image, without compiling any source.
+b32 run_image(Compiler *compiler, String filename);
+
 #endif // COMPILER_H
@@ -1,177 +1,666 @@
 #include "types.h"
 #include "value.h"
 #include "eval.h"
+#include "integer.h"
+#include "simd.h"
+#include "ast.h"
 
-internal i64 read_signed_integer_extend(u16 bitwidth, void *payload) {
-  i64 res;
+#define XXH_INLINE_ALL
+#include "xxhash.h"
 
-  // clang-format off
-  switch (bitwidth) {
-  case  8: { i8  x; memcpy(&x, payload, 1); res = x; } break;
-  case 16: { i16 x; memcpy(&x, payload, 2); res = x; } break;
-  case 32: { i32 x; memcpy(&x, payload, 4); res = x; } break;
-  case 64: { i64 x; memcpy(&x, payload, 8); res = x; } break;
-  default: Unreachable();
+// ASSUME: the cast of `type_src` to `type_dst` is valid.
+u32 eval_cast_int(
+  TypeInteger type_src, void *payload_src,
+  TypeInteger type_dst, void *payload_dst
+) {
+  u32 n = Max(int_word_count(type_src.bitwidth), int_word_count(type_dst.bitwidth));
+
+  u64 words[INT_MAX_WORD_COUNT];
+  int_load(type_src, payload_src, words, n);
+
+  if (!int_fits(type_dst, words, n, type_src.signedness == Signed)) {
+    return CastResult_integer_value_out_of_range;
   }
-  // clang-format on
 
-  return res;
+  int_store(type_dst, words, payload_dst);
+
+  return CastResult_ok;
 }
 
-internal u64 read_unsigned_integer_extend(u16 bitwidth, void *payload) {
-  u64 res = 0;
-  memcpy(&res, payload, bitwidth / 8);
+// -------------------------------------------------------------------------------------------------
 
-  return res;
+internal b32 is_comparison(u8 op) {
+  return op >= Cmp_equal && op <= Cmp_less_equal;
 }
 
-internal i64 int_value_min(u16 bitwidth) {
-  // clang-format off
-  switch (bitwidth) {
-  case 8:  return INT8_MIN;
-  case 16: return INT16_MIN;
-  case 32: return INT32_MIN;
-  case 64: return INT64_MIN;
-  default: Unreachable();
+internal b32 comparison_holds(u8 op, i32 cmp) {
+  switch (op) {
+  case Cmp_equal:         return cmp == 0;
+  case Cmp_not_equal:     return cmp != 0;
+  case Cmp_greater_than:  return cmp > 0;
+  case Cmp_greater_equal: return cmp >= 0;
+  case Cmp_less_than:     return cmp < 0;
+  case Cmp_less_equal:    return cmp <= 0;
   }
-  // clang-format on
+
+  Unreachable();
 }
 
-internal i64 int_value_max(u16 bitwidth) {
-  // clang-format off
-  switch (bitwidth) {
-  case 8:  return INT8_MAX;
-  case 16: return INT16_MAX;
-  case 32: return INT32_MAX;
-  case 64: return INT64_MAX;
-  default: Unreachable();
+// A comptime_int has no fixed bitwidth, so a result that does not fit in a `ComptimeInt` is an
+// error instead of wrapping around.
+internal u32 eval_comptime_int_op(u8 op, ComptimeInt a, ComptimeInt b, ComptimeInt *res) {
+  switch (op) {
+  case Add: {
+    if (__builtin_add_overflow(a, b, res)) {
+      return BinaryOpResult_comptime_int_overflow;
+    }
+  } break;
+  case Sub: {
+    if (__builtin_sub_overflow(a, b, res)) {
+      return BinaryOpResult_comptime_int_overflow;
+    }
+  } break;
+  case Mul: {
+    if (__builtin_mul_overflow(a, b, res)) {
+      return BinaryOpResult_comptime_int_overflow;
+    }
+  } break;
+  case Div:
+  case Mod: {
+    if (b == 0) {
+      return BinaryOpResult_division_by_zero;
+    }
+
+    if (a == INT64_MIN && b == -1) {
+      return BinaryOpResult_comptime_int_overflow;
+    }
+
+    *res = (op == Div) ? a / b : a % b;
+  } break;
+  case Bit_shift_left: {
+    if (a == 0) {
+      *res = 0;
+      break;
+    }
+
+    if (b < 0 || b >= 64) {
+      return BinaryOpResult_comptime_int_overflow;
+    }
+
+    ComptimeInt x = Cast(ComptimeInt, Cast(u64, a) << b);
+    if ((x >> b) != a) {
+      return BinaryOpResult_comptime_int_overflow;
+    }
+
+    *res = x;
+  } break;
+  case Bit_shift_right: {
+    *res = (b < 0 || b >= 64) ? (a < 0 ? -1 : 0) : a >> b;
+  } break;
+  case Bit_and: *res = a & b; break;
+  case Bit_or:  *res = a | b; break;
+  case Bit_xor: *res = a ^ b; break;
+  default: return BinaryOpResult_invalid_operand_types;
   }
-  // clang-format on
+
+  return BinaryOpResult_ok;
 }
 
-internal u64 uint_value_max(u16 bitwidth) {
-  // clang-format off
-  switch (bitwidth) {
-  case 8:  return UINT8_MAX;
-  case 16: return UINT16_MAX;
-  case 32: return UINT32_MAX;
-  case 64: return UINT64_MAX;
-  default: Unreachable();
+// The shift amount of a signed integer that is negative or does not fit in a word is treated as
+// being larger than any bitwidth.
+internal u64 shift_amount(TypeInteger type, u64 const *words, u32 n) {
+  if (type.signedness == Signed && (words[n-1] >> 63)) {
+    return UINT64_MAX;
   }
-  // clang-format on
+
+  for (u32 i = 1; i < n; i++) {
+    if (words[i]) {
+      return UINT64_MAX;
+    }
+  }
+
+  return words[0];
 }
 
-// ASSUME: the cast of `type_idx_src` to `type_idx_dst` is valid.
-// ASSUME: the bitwidth of the integers is a multiple of 8.
-u32 eval_cast_int(
-  TypeInteger type_src, void *payload_src,
-  TypeInteger type_dst, void *payload_dst
-) {
-  if (type_src.signedness == type_dst.signedness && type_src.bitwidth == type_dst.bitwidth) {
-    memcpy(payload_dst, payload_src, type_dst.bitwidth / 8);
-    return CastResult_ok;
+// Integers of up to 64 bits. `a` and `b` are extended to 64 bits and the result is wrapped around
+// to the bitwidth by the caller.
+internal u32 eval_int_op_word(u8 op, TypeInteger type, u64 a, u64 b, u64 *res) {
+  b32 is_signed = type.signedness == Signed;
+
+  switch (op) {
+  case Add: *res = a + b; break;
+  case Sub: *res = a - b; break;
+  case Mul: *res = a * b; break;
+  case Div:
+  case Mod: {
+    if (b == 0) {
+      return BinaryOpResult_division_by_zero;
+    }
+
+    if (is_signed) {
+      i64 x = Cast(i64, a);
+      i64 y = Cast(i64, b);
+
+      // INT64_MIN / -1 overflows, it wraps around to INT64_MIN.
+      if (x == INT64_MIN && y == -1) {
+        *res = (op == Div) ? a : 0;
+      } else {
+        *res = Cast(u64, (op == Div) ? x / y : x % y);
+      }
+    } else {
+      *res = (op == Div) ? a / b : a % b;
+    }
+  } break;
+  case Bit_shift_left: {
+    u64 amount = shift_amount(type, &b, 1);
+    *res = (amount >= type.bitwidth) ? 0 : a << amount;
+  } break;
+  case Bit_shift_right: {
+    u64 amount = shift_amount(type, &b, 1);
+    if (amount >= type.bitwidth) {
+      *res = (is_signed && Cast(i64, a) < 0) ? UINT64_MAX : 0;
+    } else {
+      *res = is_signed ? Cast(u64, Cast(i64, a) >> amount) : a >> amount;
+    }
+  } break;
+  case Bit_and: *res = a & b; break;
+  case Bit_or:  *res = a | b; break;
+  case Bit_xor: *res = a ^ b; break;
+  default: return BinaryOpResult_invalid_operand_types;
   }
 
-  if (type_dst.signedness == Signed && type_src.signedness == Signed) {
-    i64 i = read_signed_integer_extend(type_src.bitwidth, payload_src);
+  return BinaryOpResult_ok;
+}
+
+// Integers of more than 64 bits, stored in `n` words. The result is wrapped around to the
+// bitwidth by the caller.
+internal u32 eval_int_op_words(Arena *scratch, u8 op, TypeInteger type, u64 const *a, u64 const *b, u64 *res, u32 n) {
+  b32 is_signed = type.signedness == Signed;
+
+  switch (op) {
+  case Add: int_words_add(res, a, b, n); break;
+  case Sub: int_words_sub(res, a, b, n); break;
+  case Mul: int_words_mul(res, a, b, n); break;
+  case Div:
+  case Mod: {
+    if (int_words_is_zero(b, n)) {
+      return BinaryOpResult_division_by_zero;
+    }
+
+    b32 a_is_negative = is_signed && (a[n-1] >> 63);
+    b32 b_is_negative = is_signed && (b[n-1] >> 63);
 
-    i64 lo = int_value_min(type_dst.bitwidth);
-    i64 hi = int_value_max(type_dst.bitwidth);
+    u64 *x = arena_push_array(u64, scratch, n);
+    u64 *y = arena_push_array(u64, scratch, n);
+    u64 *q = arena_push_array(u64, scratch, n);
+    u64 *r = arena_push_array(u64, scratch, n);
 
-    if (i < lo || i > hi) {
-      return CastResult_integer_value_out_of_range;
+    // The magnitude of the smallest signed value still fits in `n` unsigned words.
+    if (a_is_negative) { int_words_neg(x, a, n); } else { memcpy(x, a, n * sizeof(u64)); }
+    if (b_is_negative) { int_words_neg(y, b, n); } else { memcpy(y, b, n * sizeof(u64)); }
+
+    int_words_divmod(q, r, x, y, n);
+
+    // Division truncates towards zero and the remainder has the sign of the dividend.
+    if (op == Div) {
+      if (a_is_negative != b_is_negative) { int_words_neg(res, q, n); } else { memcpy(res, q, n * sizeof(u64)); }
+    } else {
+      if (a_is_negative) { int_words_neg(res, r, n); } else { memcpy(res, r, n * sizeof(u64)); }
+    }
+  } break;
+  case Bit_shift_left: {
+    u64 amount = shift_amount(type, b, n);
+    if (amount >= type.bitwidth) {
+      memset(res, 0, n * sizeof(u64));
+    } else {
+      int_words_shl(res, a, n, Cast(u32, amount));
     }
+  } break;
+  case Bit_shift_right: {
+    u64 amount = shift_amount(type, b, n);
+    int_words_shr(res, a, n, Cast(u32, Min(amount, Cast(u64, n) * 64)), is_signed);
+  } break;
+  case Bit_and: for (u32 i = 0; i < n; i++) { res[i] = a[i] & b[i]; } break;
+  case Bit_or:  for (u32 i = 0; i < n; i++) { res[i] = a[i] | b[i]; } break;
+  case Bit_xor: for (u32 i = 0; i < n; i++) { res[i] = a[i] ^ b[i]; } break;
+  default: return BinaryOpResult_invalid_operand_types;
+  }
+
+  return BinaryOpResult_ok;
+}
 
-    memcpy(payload_dst, &i, type_dst.bitwidth / 8);
+internal ValueIndex bool_value(ValueStore *values, TypeIndex type_bool, b32 x) {
+  u8 data = x ? 1 : 0;
+  return values_intern_typed(values, type_bool, u8, &data);
+}
 
-    return CastResult_ok;
+// The elements of an array of integers or bools. A bool is a byte that is either 0 or 1, so
+// operations on bools are the same as on u8.
+internal TypeInteger array_element_integer(TypeInterner *types, TypeIndex base_type) {
+  Type *base = types_get(types, base_type);
+  if (base->kind == Type_bool) {
+    return (TypeInteger){ .signedness = Unsigned, .bitwidth = 8 };
   }
 
-  if (type_dst.signedness == Unsigned && type_src.signedness == Signed) {
-    i64 i = read_signed_integer_extend(type_src.bitwidth, payload_src);
+  return base->data.integer;
+}
 
-    if (i < 0) {
-      return CastResult_integer_value_out_of_range;
-    }
+// Elements that fill their storage exactly can be handed to the SIMD kernels.
+internal b32 has_simd_elements(TypeInteger integer, u32 stride) {
+  return integer.bitwidth <= 64 && integer.bitwidth == stride * 8;
+}
 
-    if (type_src.bitwidth > type_dst.bitwidth) {
-      u64 u = Cast(u64, i);
+// Arrays are computed element by element. The SIMD kernels compute a prefix of the array and the
+// remaining elements are computed one at a time.
+internal u32 eval_array_op(Arena *scratch, TypeInterner *types, ValueStore *values, TypeIndex type_bool, u8 op, TypeIndex type, Value *lhs, Value *rhs, ValueIndex *res) {
+  TypeIndex type_res;
+  if (!binary_op_result_type(types, op, type, type_bool, &type_res)) {
+    return BinaryOpResult_invalid_operand_types;
+  }
 
-      u64 hi = uint_value_max(type_dst.bitwidth);
+  TypeArray   array   = types_get(types, type)->data.array;
+  TypeInteger integer = array_element_integer(types, array.base_type);
+  b32 is_signed = integer.signedness == Signed;
 
-      if (u > hi) {
-        return CastResult_integer_value_out_of_range;
-      }
+  u32 count      = Cast(u32, array.size);
+  u32 stride     = types_size_info_by_index(types, array.base_type).stride;
+  u32 stride_res = is_comparison(op) ? 1 : stride;
+
+  TypeSizeInfo size_info = types_size_info_by_index(types, type_res);
+
+  void *data;
+  ValueIndex idx = values_alloc(values, type_res, size_info.size, size_info.align, &data);
+
+  u8 const *a = value_data(lhs);
+  u8 const *b = value_data(rhs);
+  u8       *d = data;
+
+  u32 done = 0;
+  if (has_simd_elements(integer, stride)) {
+    done = simd_binary_op(op, integer.bitwidth, is_signed, d, a, b, count);
+  }
+
+  u32 n = int_word_count(integer.bitwidth);
+
+  ArenaSnapshot snapshot = arena_scope_begin(scratch);
+
+  u64 *x = arena_push_array(u64, scratch, n);
+  u64 *y = arena_push_array(u64, scratch, n);
+  u64 *z = arena_push_array(u64, scratch, n);
+
+  u32 err = BinaryOpResult_ok;
+
+  for (u32 i = done; i < count && !err; i++) {
+    int_load(integer, a + i * stride, x, n);
+    int_load(integer, b + i * stride, y, n);
+
+    if (is_comparison(op)) {
+      d[i] = comparison_holds(op, int_words_cmp(x, y, n, is_signed)) ? 1 : 0;
+      continue;
     }
 
-    memcpy(payload_dst, &i, type_dst.bitwidth / 8);
+    if (n == 1) {
+      err = eval_int_op_word(op, integer, x[0], y[0], z);
+    } else {
+      ArenaSnapshot element = arena_scope_begin(scratch);
+      err = eval_int_op_words(scratch, op, integer, x, y, z, n);
+      arena_scope_end(scratch, element);
+    }
 
-    return CastResult_ok;
+    if (!err) {
+      int_store(integer, z, d + i * stride_res);
+    }
   }
 
-  if (type_dst.signedness == Signed && type_src.signedness == Unsigned) {
-    u64 i = read_unsigned_integer_extend(type_src.bitwidth, payload_src);
+  arena_scope_end(scratch, snapshot);
 
-    u64 hi = Cast(u64, int_value_max(type_dst.bitwidth));
+  if (err) {
+    values_dealloc(values, idx);
+    return err;
+  }
+
+  *res = idx;
+
+  return BinaryOpResult_ok;
+}
 
-    if (i > hi) {
-      return CastResult_integer_value_out_of_range;
+u32 eval_binary_op(Arena *scratch, TypeInterner *types, ValueStore *values, TypeIndex type_bool, u8 op, Value *lhs, Value *rhs, ValueIndex *res) {
+  if (lhs->type != rhs->type) {
+    return BinaryOpResult_invalid_operand_types;
+  }
+
+  TypeIndex type = lhs->type;
+  Type *t = types_get(types, type);
+
+  switch (Cast(TypeKind, t->kind)) {
+  case Type_comptime_int: {
+    ComptimeInt a, b;
+    memcpy(&a, value_data(lhs), sizeof(ComptimeInt));
+    memcpy(&b, value_data(rhs), sizeof(ComptimeInt));
+
+    if (is_comparison(op)) {
+      *res = bool_value(values, type_bool, comparison_holds(op, (a > b) - (a < b)));
+      return BinaryOpResult_ok;
     }
 
-    memcpy(payload_dst, &i, type_dst.bitwidth / 8);
+    ComptimeInt x;
+    u32 err = eval_comptime_int_op(op, a, b, &x);
+    if (err) {
+      return err;
+    }
 
-    return CastResult_ok;
+    *res = values_intern_typed(values, type, ComptimeInt, &x);
+    return BinaryOpResult_ok;
   }
+  case Type_integer: {
+    TypeInteger integer = t->data.integer;
+    u32 n = int_word_count(integer.bitwidth);
+
+    ArenaSnapshot snapshot = arena_scope_begin(scratch);
+
+    u64 *a = arena_push_array(u64, scratch, n);
+    u64 *b = arena_push_array(u64, scratch, n);
+    int_load(integer, value_data(lhs), a, n);
+    int_load(integer, value_data(rhs), b, n);
+
+    if (is_comparison(op)) {
+      i32 cmp = int_words_cmp(a, b, n, integer.signedness == Signed);
+      arena_scope_end(scratch, snapshot);
+
+      *res = bool_value(values, type_bool, comparison_holds(op, cmp));
+      return BinaryOpResult_ok;
+    }
 
-  if (type_dst.signedness == Unsigned && type_src.signedness == Unsigned) {
-    u64 i = read_unsigned_integer_extend(type_src.bitwidth, payload_src);
+    u64 *x = arena_push_array(u64, scratch, n);
 
-    u64 hi = uint_value_max(type_dst.bitwidth);
+    u32 err;
+    if (n == 1) {
+      err = eval_int_op_word(op, integer, a[0], b[0], x);
+    } else {
+      err = eval_int_op_words(scratch, op, integer, a, b, x, n);
+    }
+
+    if (!err) {
+      TypeSizeInfo size_info = types_size_info_by_index(types, type);
 
-    if (i > hi) {
-      return CastResult_integer_value_out_of_range;
+      void *data;
+      *res = values_alloc(values, type, size_info.size, size_info.align, &data);
+      int_store(integer, x, data);
     }
 
-    memcpy(payload_dst, &i, type_dst.bitwidth / 8);
+    arena_scope_end(scratch, snapshot);
 
-    return CastResult_ok;
+    return err;
   }
+  case Type_bool: {
+    b32 a = *Cast(u8*, value_data(lhs)) != 0;
+    b32 b = *Cast(u8*, value_data(rhs)) != 0;
+
+    switch (op) {
+    case Cmp_equal:     *res = bool_value(values, type_bool, a == b); break;
+    case Cmp_not_equal: *res = bool_value(values, type_bool, a != b); break;
+    case Bit_and:       *res = bool_value(values, type_bool, a & b);  break;
+    case Bit_or:        *res = bool_value(values, type_bool, a | b);  break;
+    case Bit_xor:       *res = bool_value(values, type_bool, a ^ b);  break;
+    default: return BinaryOpResult_invalid_operand_types;
+    }
 
-  Unreachable();
+    return BinaryOpResult_ok;
+  }
+  case Type_array: {
+    return eval_array_op(scratch, types, values, type_bool, op, type, lhs, rhs, res);
+  }
+  case Type_range: {
+    // Every value of a range is representable as a `ComptimeInt`, so it is computed as one and a
+    // result outside of the range is an error.
+    TypeRange   range   = t->data.range;
+    TypeInteger storage = types_range_storage(range);
+
+    u64 a, b;
+    int_load(storage, value_data(lhs), &a, 1);
+    int_load(storage, value_data(rhs), &b, 1);
+
+    if (is_comparison(op)) {
+      i32 cmp = int_words_cmp(&a, &b, 1, True);
+      *res = bool_value(values, type_bool, comparison_holds(op, cmp));
+      return BinaryOpResult_ok;
+    }
 
-  return CastResult_ok;
+    ComptimeInt x;
+    u32 err = eval_comptime_int_op(op, Cast(ComptimeInt, a), Cast(ComptimeInt, b), &x);
+    if (err) {
+      return err;
+    }
+
+    if (x < range.min || x > range.max) {
+      return BinaryOpResult_range_value_out_of_range;
+    }
+
+    u64 word = Cast(u64, x);
+    TypeSizeInfo size_info = types_size_info_by_index(types, type);
+
+    void *data;
+    *res = values_alloc(values, type, size_info.size, size_info.align, &data);
+    int_store(storage, &word, data);
+
+    return BinaryOpResult_ok;
+  }
+  case Type_function:
+  case Type_nil:
+  case Type_never:
+  case Type_slice:
+  case Type_struct:
+  case Type_optional:
+  case Type_type:
+    break;
+  }
+
+  return BinaryOpResult_invalid_operand_types;
 }
 
-internal b32 is_type_complete(TypeInterner *types, TypeIndex idx) {
-  Type *t = types_get(types, idx);
+b32 binary_op_result_type(TypeInterner *types, u8 op, TypeIndex operand_type, TypeIndex type_bool, TypeIndex *out) {
+  Type *t = types_get(types, operand_type);
 
   switch (Cast(TypeKind, t->kind)) {
-  case Type_integer:
-  case Type_bool:
   case Type_comptime_int:
-  case Type_never:
+  case Type_integer:
+  case Type_range: {
+    if (op == Logical_and || op == Logical_or) {
+      return False;
+    }
+  } break;
+  case Type_bool: {
+    switch (op) {
+    case Cmp_equal:
+    case Cmp_not_equal:
+    case Bit_and:
+    case Bit_or:
+    case Bit_xor:
+      break;
+    default:
+      return False;
+    }
+  } break;
+  case Type_array: {
+    TypeIndex base_type = t->data.array.base_type;
+    u8 base_kind = types_get(types, base_type)->kind;
+
+    TypeIndex base_res;
+    if ((base_kind != Type_integer && base_kind != Type_bool) ||
+        !binary_op_result_type(types, op, base_type, type_bool, &base_res))
+    {
+      return False;
+    }
+
+    if (is_comparison(op)) {
+      *out = types_add(types, &(Type){
+        .kind = Type_array,
+        .data.array = { .base_type = type_bool, .size = t->data.array.size },
+      });
+    } else {
+      *out = operand_type;
+    }
+
+    return True;
+  }
+  case Type_function:
   case Type_nil:
+  case Type_never:
+  case Type_slice:
+  case Type_struct:
+  case Type_optional:
   case Type_type:
-    return True;
-  case Type_array: Todo();
-  case Type_slice: Todo();
-  case Type_function: {
-    if (t->data.function.return_type == 0) {
-      return False;
+    return False;
+  }
+
+  *out = is_comparison(op) ? type_bool : operand_type;
+
+  return True;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+u32 reduce_result_type(TypeInterner *types, u8 builtin, TypeIndex operand_type, TypeIndex *out) {
+  Type *t = types_get(types, operand_type);
+  if (t->kind != Type_array) {
+    return ReduceResult_invalid_operand_type;
+  }
+
+  TypeIndex base_type = t->data.array.base_type;
+  u8 base_kind = types_get(types, base_type)->kind;
+
+  switch (builtin) {
+  case Builtin_sum:
+  case Builtin_min:
+  case Builtin_max: {
+    if (base_kind != Type_integer) {
+      return ReduceResult_invalid_operand_type;
     }
 
-    for (u32 i = 0; i < t->data.function.param_count; i++) {
-      if (t->data.function.param_types[i] == 0) {
-        return False;
-      }
+    if (builtin != Builtin_sum && t->data.array.size == 0) {
+      return ReduceResult_empty_array;
+    }
+  } break;
+  case Builtin_all:
+  case Builtin_any: {
+    if (base_kind != Type_bool) {
+      return ReduceResult_invalid_operand_type;
     }
   } break;
+  default:
+    return ReduceResult_invalid_operand_type;
   }
 
-  return True;
+  *out = base_type;
+
+  return ReduceResult_ok;
 }
 
-u32 eval_unify(Arena *scratch, TypeInterner *types, TypeIndex a, TypeIndex b, TypeIndex *unified) {
+internal void reduce_step(u8 op, b32 is_signed, u64 *acc, u64 const *x, u32 n) {
+  switch (op) {
+  case SimdReduce_sum: {
+    int_words_add(acc, acc, x, n);
+  } break;
+  case SimdReduce_min: {
+    if (int_words_cmp(x, acc, n, is_signed) < 0) {
+      memcpy(acc, x, n * sizeof(u64));
+    }
+  } break;
+  case SimdReduce_max: {
+    if (int_words_cmp(x, acc, n, is_signed) > 0) {
+      memcpy(acc, x, n * sizeof(u64));
+    }
+  } break;
+  }
+}
+
+u32 eval_reduce(Arena *scratch, TypeInterner *types, ValueStore *values, u8 builtin, Value *val, ValueIndex *res) {
+  TypeIndex type_res;
+  u32 err = reduce_result_type(types, builtin, val->type, &type_res);
+  if (err) {
+    return err;
+  }
+
+  TypeArray   array   = types_get(types, val->type)->data.array;
+  TypeInteger integer = array_element_integer(types, array.base_type);
+  b32 is_signed = integer.signedness == Signed;
+
+  u32 count  = Cast(u32, array.size);
+  u32 stride = types_size_info_by_index(types, array.base_type).stride;
+
+  u8 const *a = value_data(val);
+
+  ArenaSnapshot snapshot = arena_scope_begin(scratch);
+
+  u32 n = int_word_count(integer.bitwidth);
+  u64 *acc = arena_push_array(u64, scratch, n);
+  u64 *x   = arena_push_array(u64, scratch, n);
+
+  // #all and #any are the minimum and maximum of bools. They start from the result for an empty
+  // array. The minimum and maximum of integers start from the first element.
+  u8  op;
+  u32 start = 0;
+
+  switch (builtin) {
+  case Builtin_sum: op = SimdReduce_sum; memset(acc, 0, n * sizeof(u64)); break;
+  case Builtin_all: op = SimdReduce_min; acc[0] = 1; break;
+  case Builtin_any: op = SimdReduce_max; acc[0] = 0; break;
+  case Builtin_min:
+  case Builtin_max: {
+    op = (builtin == Builtin_min) ? SimdReduce_min : SimdReduce_max;
+    int_load(integer, a, acc, n);
+    start = 1;
+  } break;
+  default: Unreachable();
+  }
+
+  if (has_simd_elements(integer, stride)) {
+    u64 partial;
+    u32 done = simd_reduce(op, integer.bitwidth, is_signed, a, count, &partial);
+    if (done) {
+      reduce_step(op, is_signed, acc, &partial, 1);
+      start = Max(start, done);
+    }
+  }
+
+  for (u32 i = start; i < count; i++) {
+    int_load(integer, a + i * stride, x, n);
+    reduce_step(op, is_signed, acc, x, n);
+  }
+
+  TypeSizeInfo size_info = types_size_info_by_index(types, type_res);
+
+  void *data;
+  *res = values_alloc(values, type_res, size_info.size, size_info.align, &data);
+  int_store(integer, acc, data);
+
+  arena_scope_end(scratch, snapshot);
+
+  return ReduceResult_ok;
+}
+
+internal u32 hash_type_pair(void *context, u64 x) {
+  Unused(context);
+  return XXH32(&x, sizeof(x), 0);
+}
+
+internal b32 eq_type_pair(void *context, u64 a, u64 b) {
+  Unused(context);
+  return a == b;
+}
+
+#define HASHMAP_NAME            UnifyCache
+#define HASHMAP_KEY_TYPE        u64
+#define HASHMAP_VALUE_TYPE      UnifyCacheEntry
+#define HASHMAP_FUNCTION_PREFIX unify_cache
+#define HASHMAP_HASH_FN         hash_type_pair
+#define HASHMAP_KEY_COMPARE_FN  eq_type_pair
+#define HASHMAP_OUTPUT_DEFINITIONS
+#include "hashmap.h"
+
+internal u32 unify_function_types(Arena *scratch, TypeInterner *types, UnifyCache *cache, Type *type_lhs, Type *type_rhs, TypeIndex *unified);
+
+u32 eval_unify(Arena *scratch, TypeInterner *types, UnifyCache *cache, TypeIndex a, TypeIndex b, TypeIndex *unified) {
   if (a == b) {
     *unified = a;
     return UnifyResult_ok;
@@ -182,7 +671,7 @@ u32 eval_unify(Arena *scratch, TypeInterner *types, TypeIndex a, TypeIndex b, Ty
   }
 
   if (a == 0) {
-    if (!is_type_complete(types, b)) {
+    if (!types_is_complete(types, b)) {
       return UnifyResult_type_is_incomplete;
     }
 
@@ -191,7 +680,7 @@ u32 eval_unify(Arena *scratch, TypeInterner *types, TypeIndex a, TypeIndex b, Ty
   }
 
   if (b == 0) {
-    if (!is_type_complete(types, a)) {
+    if (!types_is_complete(types, a)) {
       return UnifyResult_type_is_incomplete;
     }
 
@@ -203,46 +692,28 @@ u32 eval_unify(Arena *scratch, TypeInterner *types, TypeIndex a, TypeIndex b, Ty
   Type *type_rhs = types_get(types, b);
 
   if (type_lhs->kind == Type_function && type_rhs->kind == Type_function) {
-    u32 param_count = type_lhs->data.function.param_count;
-    if (param_count != type_rhs->data.function.param_count) {
-      return UnifyResult_types_cannot_be_unified;
-    }
-
-    TypeIndex return_type;
-    u32 err = eval_unify(scratch, types, type_lhs->data.function.return_type, type_rhs->data.function.return_type, &return_type);
-    if (err) {
-      return UnifyResult_types_cannot_be_unified;
-    }
-
-    ArenaSnapshot snapshot = arena_scope_begin(scratch);
-
-    Type *f = arena_push_type_function(scratch, param_count);
-    f->kind = Type_function;
-    f->data.function.return_type = return_type;
+    // Unifying function types interns a new type every time, so the outcome is cached.
+    u64 key = (Cast(u64, a) << 32) | b;
 
-    for (u32 i = 0; i < param_count; i++) {
-      TypeIndex param_type;
-      err = eval_unify(scratch, types, type_lhs->data.function.param_types[i], type_rhs->data.function.param_types[i], &param_type);
-      if (err) {
-        break;
+    UnifyCacheEntry *entry = unify_cache_find(cache, key);
+    if (entry) {
+      if (entry->unified != 0) {
+        *unified = entry->unified;
       }
 
-      f->data.function.param_types[i] = param_type;
+      return entry->result;
     }
 
-    TypeIndex res = types_add(types, f);
+    TypeIndex res = 0;
+    u32 result = unify_function_types(scratch, types, cache, type_lhs, type_rhs, &res);
 
-    if (!err) {
-      *unified = res;
-    }
+    unify_cache_insert(cache, key, (UnifyCacheEntry){ .result = result, .unified = res });
 
-    arena_scope_end(scratch, snapshot);
-
-    if (!is_type_complete(types, res)) {
-      return UnifyResult_type_is_incomplete;
+    if (res != 0) {
+      *unified = res;
     }
 
-    return UnifyResult_ok;
+    return result;
   }
 
   if ((type_lhs->kind == Type_comptime_int && type_rhs->kind == Type_integer) || (type_lhs->kind == Type_integer && type_rhs->kind == Type_comptime_int)) {
@@ -255,20 +726,59 @@ u32 eval_unify(Arena *scratch, TypeInterner *types, TypeIndex a, TypeIndex b, Ty
   return UnifyResult_types_cannot_be_unified;
 }
 
+internal u32 unify_function_types(Arena *scratch, TypeInterner *types, UnifyCache *cache, Type *type_lhs, Type *type_rhs, TypeIndex *unified) {
+  u32 param_count = type_lhs->data.function.param_count;
+  if (param_count != type_rhs->data.function.param_count) {
+    return UnifyResult_types_cannot_be_unified;
+  }
+
+  TypeIndex return_type;
+  u32 err = eval_unify(scratch, types, cache, type_lhs->data.function.return_type, type_rhs->data.function.return_type, &return_type);
+  if (err) {
+    return UnifyResult_types_cannot_be_unified;
+  }
+
+  ArenaSnapshot snapshot = arena_scope_begin(scratch);
+
+  Type *f = arena_push_type_function(scratch, param_count);
+  f->kind = Type_function;
+  f->data.function.return_type = return_type;
+
+  // Params after one that fails to unify are left unknown.
+  memset(f->data.function.param_types, 0, param_count * sizeof(TypeIndex));
+
+  for (u32 i = 0; i < param_count; i++) {
+    TypeIndex param_type;
+    err = eval_unify(scratch, types, cache, type_lhs->data.function.param_types[i], type_rhs->data.function.param_types[i], &param_type);
+    if (err) {
+      break;
+    }
+
+    f->data.function.param_types[i] = param_type;
+  }
+
+  TypeIndex res = types_add(types, f);
+
+  if (!err) {
+    *unified = res;
+  }
+
+  arena_scope_end(scratch, snapshot);
+
+  if (!types_is_complete(types, res)) {
+    return UnifyResult_type_is_incomplete;
+  }
+
+  return UnifyResult_ok;
+}
+
 u32 eval_coerce(TypeInterner *types, ValueStore *values, TypeIndex dst, Value *val, ValueIndex *res) {
   if (dst == val->type) {
-    Value *p;
-    ValueIndex idx = values_alloc(values, &p);
-
     TypeSizeInfo size_info = types_size_info_by_index(types, dst);
-    void *data = values_alloc_data(values, size_info.size, size_info.align);
-    memcpy(data, val->data, size_info.size);
 
-    *p = (Value){
-      .type = dst,
-      .data = data,
-      .data_size = size_info.size,
-    };
+    void *data;
+    ValueIndex idx = values_alloc(values, dst, size_info.size, size_info.align, &data);
+    memcpy(data, value_data(val), size_info.size);
 
     *res = idx;
     return CoerceResult_ok;
@@ -284,27 +794,54 @@ u32 eval_coerce(TypeInterner *types, ValueStore *values, TypeIndex dst, Value *v
     };
 
     TypeSizeInfo size_info = types_size_info_by_index(types, dst);
-    void *data = values_alloc_data(values, size_info.size, size_info.align);
 
-    u32 err = eval_cast_int(comptime_int, val->data, type_dst->data.integer, data);
+    void *data;
+    ValueIndex idx = values_alloc(values, dst, size_info.size, size_info.align, &data);
+
+    u32 err = eval_cast_int(comptime_int, value_data(val), type_dst->data.integer, data);
     if (err) {
-      values_dealloc_data(values, data, size_info.size);
+      values_dealloc(values, idx);
       return CoerceResult_comptime_int_value_out_of_range;
     }
 
-    Value *v;
-    ValueIndex idx = values_alloc(values, &v);
-    *v = (Value){
-      .type = dst,
-      .data = data,
-      .data_size = size_info.size,
-    };
-
     *res = idx;
 
     return CoerceResult_ok;
   }
 
+  if (type_val->kind == Type_range || type_dst->kind == Type_range) {
+    TypeInteger storage_val, storage_dst;
+    if (!types_integer_storage(type_val, &storage_val) || !types_integer_storage(type_dst, &storage_dst)) {
+      return CoerceResult_invalid_coercion_types;
+    }
+
+    TypeSizeInfo size_info = types_size_info_by_index(types, dst);
+
+    void *data;
+    ValueIndex idx = values_alloc(values, dst, size_info.size, size_info.align, &data);
+
+    u32 err = eval_cast_int(storage_val, value_data(val), storage_dst, data);
+
+    // The value only has to be checked against the bounds of a range if its type does not prove
+    // that it lies within them.
+    if (!err && type_dst->kind == Type_range && !types_integer_contains(types, dst, val->type)) {
+      u64 x;
+      int_load(storage_dst, data, &x, 1);
+
+      ComptimeInt value = Cast(ComptimeInt, x);
+      err = value < type_dst->data.range.min || value > type_dst->data.range.max;
+    }
+
+    if (err) {
+      values_dealloc(values, idx);
+      return (type_val->kind == Type_comptime_int) ? CoerceResult_comptime_int_value_out_of_range
+                                                   : CoerceResult_integer_value_out_of_range;
+    }
+
+    *res = idx;
+    return CoerceResult_ok;
+  }
+
   if (type_val->kind == Type_function && type_dst->kind == Type_function) {
     u32 param_count = type_val->data.function.param_count;
     if (param_count != type_dst->data.function.param_count) {
@@ -324,17 +861,45 @@ u32 eval_coerce(TypeInterner *types, ValueStore *values, TypeIndex dst, Value *v
       }
     }
 
-    Value *p;
-    ValueIndex idx = values_alloc(values, &p);
+    ValueFunc *data;
+    ValueIndex idx = values_alloc_typed(values, dst, ValueFunc, &data);
+    memcpy(data, value_data(val), sizeof(ValueFunc));
 
-    u32 size = sizeof(ValueFunc);
-    void *data = values_alloc_data(values, size, Align_of(ValueFunc));
-    memcpy(data, val->data, size);
-    *p = (Value){
-      .type = dst,
-      .data = data,
-      .data_size = size,
-    };
+    *res = idx;
+    return CoerceResult_ok;
+  }
+
+  if (type_dst->kind == Type_optional) {
+    // `nil` is both the nil type and its only value, it becomes none. Any other value becomes some.
+    b32 is_nil = False;
+    if (type_val->kind == Type_type) {
+      TypeIndex t = *Cast(TypeIndex*, value_data(val));
+      is_nil = t != 0 && types_get(types, t)->kind == Type_nil;
+    }
+
+    ValueIndex some = 0;
+    if (!is_nil) {
+      u32 err = eval_coerce(types, values, type_dst->data.optional.base_type, val, &some);
+      if (err) {
+        return err;
+      }
+    }
+
+    TypeSizeInfo size_info = types_size_info_by_index(types, dst);
+    OptionalLayout layout = types_optional_layout(types, type_dst);
+
+    void *data;
+    ValueIndex idx = values_alloc(values, dst, size_info.size, size_info.align, &data);
+    memset(data, 0, size_info.size);
+
+    if (is_nil) {
+      optional_store_none(layout, data);
+    } else {
+      Value *v = values_get(values, some);
+      memcpy(data, value_data(v), v->data_size);
+      optional_store_some(layout, data);
+      values_dealloc(values, some);
+    }
 
     *res = idx;
     return CoerceResult_ok;
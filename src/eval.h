@@ -8,10 +8,43 @@ typedef enum {
   CastResult_integer_value_out_of_range,
 } CastResult;
 
-// ASSUME: the cast of `type_idx_src` to `type_idx_dst` is valid.
-// ASSUME: the bitwidth of the integers is a multiple of 8.
+// ASSUME: the cast of `type_src` to `type_dst` is valid.
 u32 eval_cast_int(TypeInteger type_src, void *payload_src, TypeInteger type_dst, void *payload_dst);
 
+typedef enum {
+  BinaryOpResult_ok,
+  BinaryOpResult_invalid_operand_types,
+  BinaryOpResult_division_by_zero,
+  BinaryOpResult_comptime_int_overflow,
+  BinaryOpResult_range_value_out_of_range,
+} BinaryOpResult;
+
+// `op` is a `BinaryOpKind`, other than the logical operators. Both operands must have the same type.
+// Integer arithmetic wraps around on overflow, comptime_int arithmetic results in an error, and so
+// does range arithmetic with a result outside of the range.
+u32 eval_binary_op(Arena *scratch, TypeInterner *types, ValueStore *values, TypeIndex type_bool, u8 op, Value *lhs, Value *rhs, ValueIndex *res);
+
+// Returns False if `op` is not defined for operands of `operand_type`. Comparisons result in a
+// bool, all other operations in the type of their operands. Operations on arrays of integers or
+// bools are element-wise, so comparing two `[N]T` results in a `[N]bool`.
+b32 binary_op_result_type(TypeInterner *types, u8 op, TypeIndex operand_type, TypeIndex type_bool, TypeIndex *out);
+
+typedef enum {
+  ReduceResult_ok,
+  ReduceResult_invalid_operand_type,
+  ReduceResult_empty_array,
+} ReduceResult;
+
+// `builtin` is one of the reduction `BuiltinKind`s. `#sum`, `#min` and `#max` reduce an array of
+// integers and `#all` and `#any` an array of bools to a value of the element type. A sum wraps
+// around on overflow. The minimum or maximum of an empty array is an error, `#all` of an empty array
+// is true and `#any` false.
+u32 eval_reduce(Arena *scratch, TypeInterner *types, ValueStore *values, u8 builtin, Value *val, ValueIndex *res);
+
+// Checks if `builtin` can reduce a value of `operand_type`. Whether a reduction fails only depends on
+// the type of the array, so every failing reduction is caught before it is evaluated.
+u32 reduce_result_type(TypeInterner *types, u8 builtin, TypeIndex operand_type, TypeIndex *out);
+
 typedef enum {
   UnifyResult_ok,
   UnifyResult_types_cannot_be_unified,
@@ -21,14 +54,32 @@ typedef enum {
   UnifyResult_type_is_incomplete,
 } UnifyResult;
 
-u32 eval_unify(Arena *scratch, TypeInterner *types, TypeIndex a, TypeIndex b, TypeIndex *unified);
+typedef struct {
+  u32       result;  // UnifyResult
+  TypeIndex unified; // 0 if `eval_unify` did not write to `unified`.
+} UnifyCacheEntry;
+
+// Maps a pair of function types, with the lhs in the upper 32 bits of the key, to the outcome of
+// unifying them. Types are never removed from the `TypeInterner`, so entries stay valid for as long
+// as the interner lives.
+#define HASHMAP_NAME            UnifyCache
+#define HASHMAP_KEY_TYPE        u64
+#define HASHMAP_VALUE_TYPE      UnifyCacheEntry
+#define HASHMAP_FUNCTION_PREFIX unify_cache
+#define HASHMAP_OUTPUT_TYPES
+#define HASHMAP_OUTPUT_DECLARATIONS
+#include "hashmap.h"
+
+u32 eval_unify(Arena *scratch, TypeInterner *types, UnifyCache *cache, TypeIndex a, TypeIndex b, TypeIndex *unified);
 
 enum CoerceResult {
   CoerceResult_ok,
   CoerceResult_invalid_coercion_types,
   CoerceResult_comptime_int_value_out_of_range,
+  CoerceResult_integer_value_out_of_range,
 };
 
+// Coercing an integer to or from a range checks its value, unless the types prove it in range.
 u32 eval_coerce(TypeInterner *types, ValueStore *values, TypeIndex dst, Value *val, ValueIndex *res);
 
 #endif // EVAL_H
@@ -0,0 +1,385 @@
+#include <inttypes.h>
+
+#include "integer.h"
+
+TypeSizeInfo int_size_info(u16 bitwidth) {
+  u32 size;
+  if (bitwidth <= 64) {
+    size = 1;
+    while (size * 8 < bitwidth) {
+      size *= 2;
+    }
+  } else {
+    size = int_word_count(bitwidth) * sizeof(u64);
+  }
+
+  u32 align = Min(size, sizeof(u64));
+
+  return (TypeSizeInfo){ .size = size, .align = align, .stride = size };
+}
+
+b32 int_type_from_name(String name, TypeInteger *out) {
+  if (name.len < 2 || name.len > 6 || (name.str[0] != 'i' && name.str[0] != 'u')) {
+    return False;
+  }
+
+  // No leading zeros, so every integer type has exactly one name.
+  if (name.str[1] == '0') {
+    return False;
+  }
+
+  u32 bitwidth = 0;
+  for (usize i = 1; i < name.len; i++) {
+    u8 c = name.str[i];
+    if (c < '0' || c > '9') {
+      return False;
+    }
+
+    bitwidth = bitwidth * 10 + (c - '0');
+  }
+
+  if (bitwidth > INT_MAX_BITWIDTH) {
+    return False;
+  }
+
+  *out = (TypeInteger){
+    .signedness = name.str[0] == 'i' ? Signed : Unsigned,
+    .bitwidth   = Cast(u16, bitwidth),
+  };
+
+  return True;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+u64 int_wrap_word(TypeInteger type, u64 x) {
+  u32 unused = 64 - type.bitwidth;
+  if (unused == 0) {
+    return x;
+  }
+
+  if (type.signedness == Signed) {
+    return Cast(u64, Cast(i64, x << unused) >> unused);
+  }
+
+  return (x << unused) >> unused;
+}
+
+void int_load(TypeInteger type, void const *payload, u64 *words, u32 word_count) {
+  u32 n = int_word_count(type.bitwidth);
+  Assert(word_count >= n);
+
+  if (n == 1) {
+    u32 size = int_size_info(type.bitwidth).size;
+    u64 x = 0;
+    memcpy(&x, payload, size);
+    words[0] = int_wrap_word((TypeInteger){ .signedness = type.signedness, .bitwidth = Cast(u16, size * 8) }, x);
+  } else {
+    memcpy(words, payload, n * sizeof(u64));
+  }
+
+  u64 fill = (type.signedness == Signed && (words[n-1] >> 63)) ? UINT64_MAX : 0;
+  for (u32 i = n; i < word_count; i++) {
+    words[i] = fill;
+  }
+}
+
+void int_store(TypeInteger type, u64 *words, void *payload) {
+  u32 n = int_word_count(type.bitwidth);
+
+  TypeInteger top = { .signedness = type.signedness, .bitwidth = Cast(u16, type.bitwidth - (n - 1) * 64) };
+  words[n-1] = int_wrap_word(top, words[n-1]);
+
+  if (n == 1) {
+    memcpy(payload, words, int_size_info(type.bitwidth).size);
+  } else {
+    memcpy(payload, words, n * sizeof(u64));
+  }
+}
+
+b32 int_fits(TypeInteger type, u64 const *words, u32 word_count, b32 is_signed) {
+  b32 is_negative = is_signed && (words[word_count-1] >> 63);
+  if (is_negative && type.signedness == Unsigned) {
+    return False;
+  }
+
+  // Every bit from `first` upwards has to be equal to the sign.
+  u32 first = (type.signedness == Signed) ? type.bitwidth - 1 : type.bitwidth;
+  u64 fill  = is_negative ? UINT64_MAX : 0;
+
+  for (u32 i = first / 64; i < word_count; i++) {
+    u32 lo = i * 64;
+    u64 mask = (first > lo) ? (UINT64_MAX << (first - lo)) : UINT64_MAX;
+
+    if ((words[i] ^ fill) & mask) {
+      return False;
+    }
+  }
+
+  return True;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+u64 int_words_add(u64 *dst, u64 const *a, u64 const *b, u32 n) {
+  u64 carry = 0;
+  for (u32 i = 0; i < n; i++) {
+    u64 x = a[i] + carry;
+    u64 c = x < carry;
+    x += b[i];
+    c += x < b[i];
+    dst[i] = x;
+    carry = c;
+  }
+  return carry;
+}
+
+u64 int_words_sub(u64 *dst, u64 const *a, u64 const *b, u32 n) {
+  u64 borrow = 0;
+  for (u32 i = 0; i < n; i++) {
+    u64 x = a[i] - b[i];
+    u64 c = a[i] < b[i];
+    c += x < borrow;
+    x -= borrow;
+    dst[i] = x;
+    borrow = c;
+  }
+  return borrow;
+}
+
+void int_words_neg(u64 *dst, u64 const *a, u32 n) {
+  u64 carry = 1;
+  for (u32 i = 0; i < n; i++) {
+    u64 x = ~a[i] + carry;
+    carry = carry && x == 0;
+    dst[i] = x;
+  }
+}
+
+// The full product of two words, the low word is returned and the high word written to `hi`.
+internal u64 mul_wide(u64 a, u64 b, u64 *hi) {
+  u64 a_lo = a & 0xffffffff, a_hi = a >> 32;
+  u64 b_lo = b & 0xffffffff, b_hi = b >> 32;
+
+  u64 lo_lo = a_lo * b_lo;
+  u64 hi_lo = a_hi * b_lo;
+  u64 lo_hi = a_lo * b_hi;
+  u64 hi_hi = a_hi * b_hi;
+
+  u64 mid = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+
+  *hi = hi_hi + (hi_lo >> 32) + (mid >> 32);
+  return (mid << 32) | (lo_lo & 0xffffffff);
+}
+
+// Divides the two words `hi:lo` by `d`, which must be greater than `hi` so the quotient fits in a
+// word. The remainder is written to `r`. This is the two-step long division on half words from
+// Hacker's Delight (divlu).
+internal u64 div_wide(u64 hi, u64 lo, u64 d, u64 *r) {
+  Assert(hi < d);
+
+  u64 const b = 1ull << 32;
+
+  // Normalize so the top bit of the divisor is set, which keeps the estimated digits close.
+  u32 s = 64 - bitwidth(d);
+  d <<= s;
+
+  u64 d1 = d >> 32;
+  u64 d0 = d & 0xffffffff;
+
+  u64 n32 = s == 0 ? hi : (hi << s) | (lo >> (64 - s));
+  u64 n10 = lo << s;
+  u64 n1  = n10 >> 32;
+  u64 n0  = n10 & 0xffffffff;
+
+  u64 q1   = n32 / d1;
+  u64 rhat = n32 - q1 * d1;
+  while (q1 >= b || q1 * d0 > b * rhat + n1) {
+    q1   -= 1;
+    rhat += d1;
+    if (rhat >= b) {
+      break;
+    }
+  }
+
+  u64 n21 = n32 * b + n1 - q1 * d;
+
+  u64 q0 = n21 / d1;
+  rhat   = n21 - q0 * d1;
+  while (q0 >= b || q0 * d0 > b * rhat + n0) {
+    q0   -= 1;
+    rhat += d1;
+    if (rhat >= b) {
+      break;
+    }
+  }
+
+  *r = (n21 * b + n0 - q0 * d) >> s;
+  return q1 * b + q0;
+}
+
+void int_words_mul(u64 *dst, u64 const *a, u64 const *b, u32 n) {
+  memset(dst, 0, n * sizeof(u64));
+
+  for (u32 i = 0; i < n; i++) {
+    if (a[i] == 0) {
+      continue;
+    }
+
+    u64 carry = 0;
+    for (u32 j = 0; i + j < n; j++) {
+      u64 hi;
+      u64 lo = mul_wide(a[i], b[j], &hi);
+
+      // The sum of the product and two words always fits in two words.
+      lo += dst[i+j];
+      hi += lo < dst[i+j];
+      lo += carry;
+      hi += lo < carry;
+
+      dst[i+j] = lo;
+      carry    = hi;
+    }
+  }
+}
+
+u64 int_words_divmod_word(u64 *q, u64 const *a, u64 b, u32 n) {
+  u64 r = 0;
+  for (u32 i = n; i-- > 0;) {
+    q[i] = div_wide(r, a[i], b, &r);
+  }
+  return r;
+}
+
+internal u32 words_bitwidth(u64 const *a, u32 n) {
+  for (u32 i = n; i-- > 0;) {
+    if (a[i]) {
+      return i * 64 + bitwidth(a[i]);
+    }
+  }
+  return 0;
+}
+
+void int_words_divmod(u64 *q, u64 *r, u64 const *a, u64 const *b, u32 n) {
+  if (words_bitwidth(b, n) <= 64) {
+    u64 rem = int_words_divmod_word(q, a, b[0], n);
+    memset(r, 0, n * sizeof(u64));
+    r[0] = rem;
+    return;
+  }
+
+  // Shift and subtract, one bit of the quotient at a time.
+  memset(q, 0, n * sizeof(u64));
+  memset(r, 0, n * sizeof(u64));
+
+  for (u32 bit = words_bitwidth(a, n); bit-- > 0;) {
+    int_words_shl(r, r, n, 1);
+    r[0] |= (a[bit / 64] >> (bit % 64)) & 1;
+
+    if (int_words_cmp(r, b, n, False) >= 0) {
+      int_words_sub(r, r, b, n);
+      q[bit / 64] |= Cast(u64, 1) << (bit % 64);
+    }
+  }
+}
+
+void int_words_shl(u64 *dst, u64 const *a, u32 n, u32 shift) {
+  u32 words = shift / 64;
+  u32 bits  = shift % 64;
+
+  for (u32 i = n; i-- > 0;) {
+    u64 x = 0;
+    if (i >= words) {
+      x = a[i - words] << bits;
+      if (bits && i > words) {
+        x |= a[i - words - 1] >> (64 - bits);
+      }
+    }
+    dst[i] = x;
+  }
+}
+
+void int_words_shr(u64 *dst, u64 const *a, u32 n, u32 shift, b32 arithmetic) {
+  u64 fill = (arithmetic && (a[n-1] >> 63)) ? UINT64_MAX : 0;
+
+  u32 words = shift / 64;
+  u32 bits  = shift % 64;
+
+  for (u32 i = 0; i < n; i++) {
+    u32 src = i + words;
+
+    u64 lo = (src < n) ? a[src] : fill;
+    u64 hi = (src + 1 < n) ? a[src + 1] : fill;
+
+    dst[i] = bits ? ((lo >> bits) | (hi << (64 - bits))) : lo;
+  }
+}
+
+i32 int_words_cmp(u64 const *a, u64 const *b, u32 n, b32 is_signed) {
+  if (is_signed) {
+    i64 x = Cast(i64, a[n-1]);
+    i64 y = Cast(i64, b[n-1]);
+    if (x != y) {
+      return x < y ? -1 : 1;
+    }
+  } else if (a[n-1] != b[n-1]) {
+    return a[n-1] < b[n-1] ? -1 : 1;
+  }
+
+  for (u32 i = n - 1; i-- > 0;) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+
+  return 0;
+}
+
+b32 int_words_is_zero(u64 const *a, u32 n) {
+  for (u32 i = 0; i < n; i++) {
+    if (a[i]) {
+      return False;
+    }
+  }
+  return True;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+// The largest power of 10 that fits in a word.
+#define DECIMAL_GROUP      10000000000000000000ull
+#define DECIMAL_GROUP_LEN  19
+
+void int_print(FILE *out, TypeInteger type, void const *payload) {
+  u32 n = int_word_count(type.bitwidth);
+
+  u64 words[INT_MAX_WORD_COUNT];
+  int_load(type, payload, words, n);
+
+  if (n == 1) {
+    if (type.signedness == Signed) {
+      fprintf(out, "%" PRId64, Cast(i64, words[0]));
+    } else {
+      fprintf(out, "%" PRIu64, words[0]);
+    }
+    return;
+  }
+
+  if (type.signedness == Signed && (words[n-1] >> 63)) {
+    fputc('-', out);
+    int_words_neg(words, words, n);
+  }
+
+  // Split the magnitude into groups of decimal digits, least significant group first.
+  u64 groups[INT_MAX_WORD_COUNT * 2];
+  u32 group_count = 0;
+
+  do {
+    groups[group_count++] = int_words_divmod_word(words, words, DECIMAL_GROUP, n);
+  } while (!int_words_is_zero(words, n));
+
+  fprintf(out, "%" PRIu64, groups[group_count-1]);
+  for (u32 i = group_count - 1; i-- > 0;) {
+    fprintf(out, "%0*" PRIu64, DECIMAL_GROUP_LEN, groups[i]);
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef INTEGER_H
+#define INTEGER_H
+
+#include <stdio.h>
+
+#include "blu.h"
+#include "types.h"
+
+// Integers can have any bitwidth from 1 up to `INT_MAX_BITWIDTH`.
+//
+// An integer of up to 64 bits is stored in the smallest of 1, 2, 4 or 8 bytes that fits it. A wider
+// integer is stored as an array of 64-bit words, least significant word first. The bits above the
+// bitwidth are always the sign extension of the value for signed integers and zero for unsigned
+// integers, so equal values have equal bytes.
+//
+// Integers of up to 64 bits are computed on a single word with native operations, after which the
+// result is masked back to its bitwidth. Wider integers are computed with the word kernels below.
+
+#define INT_MAX_BITWIDTH   UINT16_MAX
+#define INT_MAX_WORD_COUNT ((INT_MAX_BITWIDTH + 63) / 64)
+
+always_inline u32 int_word_count(u16 bitwidth) {
+  return (Cast(u32, bitwidth) + 63) / 64;
+}
+
+TypeSizeInfo int_size_info(u16 bitwidth);
+
+// Parses the name of an integer type such as `u7` or `i128`.
+b32 int_type_from_name(String name, TypeInteger *out);
+
+// Loads an integer into `word_count` words, extended according to its signedness. `word_count` must
+// be at least `int_word_count(type.bitwidth)`.
+void int_load(TypeInteger type, void const *payload, u64 *words, u32 word_count);
+
+// Wraps the `int_word_count(type.bitwidth)` words in `words` around to the bitwidth of `type` and
+// stores the result. `words` is modified.
+void int_store(TypeInteger type, u64 *words, void *payload);
+
+// Wraps a single word around to a bitwidth of at most 64 bits.
+u64 int_wrap_word(TypeInteger type, u64 x);
+
+// Returns True if the value in `words` fits in `type`. `is_signed` tells if `words` holds a signed
+// value.
+b32 int_fits(TypeInteger type, u64 const *words, u32 word_count, b32 is_signed);
+
+// Word kernels. Every array has `n` words. The destination may alias an operand, except for
+// `int_words_mul` and `int_words_divmod`.
+u64  int_words_add(u64 *dst, u64 const *a, u64 const *b, u32 n); // Returns the carry.
+u64  int_words_sub(u64 *dst, u64 const *a, u64 const *b, u32 n); // Returns the borrow.
+void int_words_neg(u64 *dst, u64 const *a, u32 n);
+void int_words_mul(u64 *dst, u64 const *a, u64 const *b, u32 n); // The low `n` words of the product.
+void int_words_divmod(u64 *q, u64 *r, u64 const *a, u64 const *b, u32 n); // Unsigned, `b` is not zero.
+u64  int_words_divmod_word(u64 *q, u64 const *a, u64 b, u32 n); // Unsigned, returns the remainder.
+void int_words_shl(u64 *dst, u64 const *a, u32 n, u32 shift);
+void int_words_shr(u64 *dst, u64 const *a, u32 n, u32 shift, b32 arithmetic);
+i32  int_words_cmp(u64 const *a, u64 const *b, u32 n, b32 is_signed);
+b32  int_words_is_zero(u64 const *a, u32 n);
+
+void int_print(FILE *out, TypeInteger type, void const *payload);
+
+#endif // INTEGER_H
@@ -15,6 +15,8 @@
 //   #define INTERNER_HASH_FN         str_hash // u32 fn(void *context, INTERNER_TYPE item)
 //   #define INTERNER_COMPARE_FN      str_eq   // b32 fn(void *context, INTERNER_TYPE a, INTERNER_TYPE b)
 //   #define INTERNER_COPY_FN         str_copy // optional, INTERNER_TYPE fn(Arena *arena, INTERNER_TYPE item)
+//   #define INTERNER_EXTRA_INIT_FN   str_info // optional, INTERNER_EXTRA_TYPE fn(INTERNER_NAME *interner, INTERNER_TYPE item)
+//   #define INTERNER_DIRECT_SLOT_FN  str_slot // optional, INTERNER_INDEX_TYPE *fn(INTERNER_NAME *interner, INTERNER_TYPE item)
 //   #define INTERNER_OUTPUT_DEFINITIONS
 //   #include "interner.h"
 //
@@ -22,7 +24,20 @@
 // item outlives the caller's memory (e.g. copying string bytes, or a variable-sized Type through
 // a pointer). Without it the item is stored as-is, which is only correct for self-contained values.
 //
+// `INTERNER_EXTRA_INIT_FN` computes the initial extra data of an item on first insertion. It is
+// called with the interned item, after `INTERNER_COPY_FN`. Without it the extra data is zeroed.
+//
+// `INTERNER_DIRECT_STATE_TYPE` adds a zero initialized `direct` field of that type to the interner.
+// `INTERNER_DIRECT_SLOT_FN` returns a pointer into `direct` for items that can be looked up without
+// hashing, or Null for all other items. A slot holds the index of its item once it has been interned
+// and 0 before that, so it requires `INTERNER_RESERVE_ZERO_INDEX`. Both have to be defined where the
+// types are output, and the slot function where the definitions are output.
+//
 // The `context` pointer from `InternerOptions` is passed to the hash and compare functions.
+//
+// `INTERNER_LOCKED` adds a mutex that makes adding and finding items safe from multiple threads.
+// Getting an item by index does not lock: an index is only known once its item has been added, and
+// items never move. It has to be defined where the types are output and where the definitions are.
 
 #ifndef INTERNER_NAME
 #error "'INTERNER_NAME' must be defined"
@@ -84,6 +99,12 @@ typedef struct {
   Arena *arena;
   INTERNER_LIST_NAME list;
   INTERNER_MAP_NAME  map;
+#ifdef INTERNER_DIRECT_STATE_TYPE
+  INTERNER_DIRECT_STATE_TYPE direct;
+#endif
+#ifdef INTERNER_LOCKED
+  Mutex lock;
+#endif
 } INTERNER_NAME;
 
 #ifndef INTERNER_H
@@ -132,6 +153,10 @@ INTERNER_LINKAGE void                 Cat(INTERNER_FUNCTION_PREFIX, _set_extra)(
 #error "'INTERNER_COMPARE_FN' must be defined"
 #endif
 
+#if defined(INTERNER_DIRECT_SLOT_FN) && !defined(INTERNER_RESERVE_ZERO_INDEX)
+#error "'INTERNER_DIRECT_SLOT_FN' requires 'INTERNER_RESERVE_ZERO_INDEX'"
+#endif
+
 #define INTERNER_LIST_PREFIX Cat(INTERNER_FUNCTION_PREFIX, __list)
 #define INTERNER_MAP_PREFIX  Cat(INTERNER_FUNCTION_PREFIX, __map)
 
@@ -163,6 +188,9 @@ INTERNER_LINKAGE
 void Cat(INTERNER_FUNCTION_PREFIX, _init)(INTERNER_NAME *interner, InternerOptions *options) {
   interner->arena = options->arena;
   zero_struct(INTERNER_LIST_NAME, &interner->list);
+#ifdef INTERNER_DIRECT_STATE_TYPE
+  zero_struct(INTERNER_DIRECT_STATE_TYPE, &interner->direct);
+#endif
   Cat(INTERNER_MAP_PREFIX, _init)(&interner->map, &(HashMapOptions){
     .allocator    = options->map_allocator,
     .initial_size = options->map_initial_size,
@@ -172,10 +200,17 @@ void Cat(INTERNER_FUNCTION_PREFIX, _init)(INTERNER_NAME *interner, InternerOptio
 #ifdef INTERNER_RESERVE_ZERO_INDEX
   Cat(INTERNER_LIST_PREFIX, _push)(&interner->list, interner->arena);
 #endif
+
+#ifdef INTERNER_LOCKED
+  mutex_init(&interner->lock);
+#endif
 }
 
 INTERNER_LINKAGE
 void Cat(INTERNER_FUNCTION_PREFIX, _deinit)(INTERNER_NAME *interner) {
+#ifdef INTERNER_LOCKED
+  mutex_deinit(&interner->lock);
+#endif
   Cat(INTERNER_MAP_PREFIX, _deinit)(&interner->map);
   zero_struct(INTERNER_NAME, interner);
 }
@@ -186,11 +221,25 @@ INTERNER_INDEX_TYPE Cat(INTERNER_FUNCTION_PREFIX, _add)(INTERNER_NAME *interner,
   return Cat(INTERNER_FUNCTION_PREFIX, _add_checked)(interner, item, &ignore);
 }
 
-INTERNER_LINKAGE INTERNER_INDEX_TYPE Cat(INTERNER_FUNCTION_PREFIX, _add_checked)(INTERNER_NAME *interner, INTERNER_TYPE item, b32 *already_present) {
+internal INTERNER_INDEX_TYPE Cat(INTERNER_FUNCTION_PREFIX, __add_checked)(INTERNER_NAME *interner, INTERNER_TYPE item, b32 *already_present) {
+#ifdef INTERNER_DIRECT_SLOT_FN
+  INTERNER_INDEX_TYPE *slot = INTERNER_DIRECT_SLOT_FN(interner, item);
+  if (slot && *slot != 0) {
+    *already_present = True;
+    return *slot;
+  }
+#endif
+
   b32 was_occupied;
   INTERNER_BUCKET_NAME *bucket = Cat(INTERNER_MAP_PREFIX, _insert_key_and_get_bucket)(&interner->map, item, &was_occupied);
 
   if (was_occupied) {
+#ifdef INTERNER_DIRECT_SLOT_FN
+    if (slot) {
+      *slot = bucket->val;
+    }
+#endif
+
     *already_present = True;
     return bucket->val;
   }
@@ -206,17 +255,47 @@ INTERNER_LINKAGE INTERNER_INDEX_TYPE Cat(INTERNER_FUNCTION_PREFIX, _add_checked)
   *bucket = (INTERNER_BUCKET_NAME){ .key = intern, .val = idx, };
   *already_present = False;
 
-#ifdef INTERNER_EXTRA_TYPE
+#if defined(INTERNER_EXTRA_TYPE) && defined(INTERNER_EXTRA_INIT_FN)
+  INTERNER_EXTRA_TYPE extra = INTERNER_EXTRA_INIT_FN(interner, intern);
+  Cat(INTERNER_LIST_PREFIX, _append)(&interner->list, interner->arena, (INTERNER_EXTRA_NAME){ .key = intern, .extra = extra });
+#elif defined(INTERNER_EXTRA_TYPE)
   Cat(INTERNER_LIST_PREFIX, _append)(&interner->list, interner->arena, (INTERNER_EXTRA_NAME){ .key = intern });
 #else
   Cat(INTERNER_LIST_PREFIX, _append)(&interner->list, interner->arena, intern);
 #endif
 
+#ifdef INTERNER_DIRECT_SLOT_FN
+  if (slot) {
+    *slot = idx;
+  }
+#endif
+
   return idx;
 }
 
-INTERNER_LINKAGE
-b32 Cat(INTERNER_FUNCTION_PREFIX, _find)(INTERNER_NAME *interner, INTERNER_TYPE item, INTERNER_INDEX_TYPE *idx) {
+INTERNER_LINKAGE INTERNER_INDEX_TYPE Cat(INTERNER_FUNCTION_PREFIX, _add_checked)(INTERNER_NAME *interner, INTERNER_TYPE item, b32 *already_present) {
+#ifdef INTERNER_LOCKED
+  mutex_lock(&interner->lock);
+#endif
+
+  INTERNER_INDEX_TYPE idx = Cat(INTERNER_FUNCTION_PREFIX, __add_checked)(interner, item, already_present);
+
+#ifdef INTERNER_LOCKED
+  mutex_unlock(&interner->lock);
+#endif
+
+  return idx;
+}
+
+internal b32 Cat(INTERNER_FUNCTION_PREFIX, __find)(INTERNER_NAME *interner, INTERNER_TYPE item, INTERNER_INDEX_TYPE *idx) {
+#ifdef INTERNER_DIRECT_SLOT_FN
+  INTERNER_INDEX_TYPE *slot = INTERNER_DIRECT_SLOT_FN(interner, item);
+  if (slot && *slot != 0) {
+    *idx = *slot;
+    return True;
+  }
+#endif
+
   INTERNER_INDEX_TYPE *v = Cat(INTERNER_MAP_PREFIX, _find)(&interner->map, item);
   if (v) {
     *idx = *v;
@@ -226,6 +305,21 @@ b32 Cat(INTERNER_FUNCTION_PREFIX, _find)(INTERNER_NAME *interner, INTERNER_TYPE
   return False;
 }
 
+INTERNER_LINKAGE
+b32 Cat(INTERNER_FUNCTION_PREFIX, _find)(INTERNER_NAME *interner, INTERNER_TYPE item, INTERNER_INDEX_TYPE *idx) {
+#ifdef INTERNER_LOCKED
+  mutex_lock(&interner->lock);
+#endif
+
+  b32 found = Cat(INTERNER_FUNCTION_PREFIX, __find)(interner, item, idx);
+
+#ifdef INTERNER_LOCKED
+  mutex_unlock(&interner->lock);
+#endif
+
+  return found;
+}
+
 INTERNER_LINKAGE
 INTERNER_TYPE Cat(INTERNER_FUNCTION_PREFIX, _get)(INTERNER_NAME *interner, INTERNER_INDEX_TYPE idx) {
 #ifdef INTERNER_EXTRA_TYPE
@@ -272,4 +366,8 @@ void Cat(INTERNER_FUNCTION_PREFIX, _set_extra)(INTERNER_NAME *interner, INTERNER
 #undef INTERNER_LIST_PREFIX
 #undef INTERNER_MAP_PREFIX
 #undef INTERNER_EXTRA_TYPE
+#undef INTERNER_EXTRA_INIT_FN
+#undef INTERNER_DIRECT_STATE_TYPE
+#undef INTERNER_DIRECT_SLOT_FN
 #undef INTERNER_RESERVE_ZERO_INDEX
+#undef INTERNER_LOCKED
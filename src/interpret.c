@@ -1,20 +1,23 @@
 #include "interpret.h"
 #include "value.h"
 #include "print.h"
+#include "eval.h"
 
 #define MAX_SCOPE_DEPTH 64
 
-internal ValueIndex resolve(Interpreter *in, CallFrame2 *f, IrRef ref) {
-  ValueIndex val = 0;
-
-  if (ref_is_some_value_index(ref)) {
-    val = ref_to_value_index(ref);
-  }
-
+// Returns the value `ref` refers to without copying it. The value is still owned by its previous
+// owner.
+internal ValueIndex lookup(CallFrame2 *f, IrRef ref) {
   if (ref_is_instruction_index(ref)) {
-    val = f->inst_values[ref_to_instruction_index(ref)];
+    return f->inst_values[ref_to_instruction_index(ref)];
   }
 
+  return ref_to_value_index(ref);
+}
+
+internal ValueIndex resolve(Interpreter *in, CallFrame2 *f, IrRef ref) {
+  ValueIndex val = lookup(f, ref);
+
   if (val) {
     return values_copy(&in->compiler->values, val);
   }
@@ -31,6 +34,7 @@ internal CallFrame2 *frame_push(Interpreter *in, IrChunk *chunk, ValueIndex *ret
   f->chunk = chunk;
   f->snapshot = arena_scope_begin(in->scratch);
   f->inst_values = arena_push_array(ValueIndex, in->scratch, count);
+  memset(f->inst_values, 0, count * sizeof(ValueIndex));
 
   stack_init(&f->scope_stack, arena_push_array(ScopeSpan2, in->scratch, MAX_SCOPE_DEPTH), MAX_SCOPE_DEPTH);
 
@@ -81,6 +85,8 @@ internal void scopes_pop_to(Interpreter *in, CallFrame2 *f, InstructionIndex blo
 typedef enum {
   Step_ok,
   Step_return,
+  Step_division_by_zero,
+  Step_value_out_of_range,
 } StepResult;
 
 internal u32 step(Interpreter *in) {
@@ -90,6 +96,9 @@ internal u32 step(Interpreter *in) {
 
   u8 op = chunk_opcode(f->chunk, pc);
   switch (Cast(IrOpcode, op)) {
+  case IR_nop: {
+    f->pc += 1;
+  } break;
   case IR_block: {
     u32 inst_count = chunk_data(f->chunk, pc);
     stack_push(&f->scope_stack, ((ScopeSpan2){ .start = pc, .end = pc + inst_count }));
@@ -104,8 +113,8 @@ internal u32 step(Interpreter *in) {
   } break;
   case IR_condbr: {
     IrCondBr *condbr = chunk_extra(f->chunk, pc);
-    Value *v = values_get(&in->compiler->values, resolve(in, f, condbr->cond));
-    if (*Cast(u8*,v->data)) {
+    Value *v = values_get(&in->compiler->values, lookup(f, condbr->cond));
+    if (*Cast(u8*,value_data(v))) {
       f->pc = condbr->then;
     } else {
       f->pc = condbr->otherwise;
@@ -113,8 +122,9 @@ internal u32 step(Interpreter *in) {
   } break;
   case IR_call: {
     IrCall *call = chunk_extra(f->chunk, pc);
-    Value *v = values_get(&in->compiler->values, resolve(in, f, call->func));
-    IrChunk *chunk = &Cast(ValueFunc*, v->data)->chunk;
+    // The function value is owned by the caller or a declaration, both of which outlive the call.
+    Value *v = values_get(&in->compiler->values, lookup(f, call->func));
+    IrChunk *chunk = &Cast(ValueFunc*, value_data(v))->chunk;
     CallFrame2 *g = frame_push(in, chunk, &f->inst_values[pc]);
 
     for (u32 i = 0; i < call->arg_count; i++) {
@@ -135,12 +145,69 @@ internal u32 step(Interpreter *in) {
     f->inst_values[pc] = val;
     f->pc += 1;
   } break;
+  case IR_binary_op: {
+    IrBinaryOp *binary_op = chunk_extra(f->chunk, pc);
+    Compiler *compiler = in->compiler;
+
+    Value *lhs = values_get(&compiler->values, lookup(f, binary_op->lhs));
+    Value *rhs = values_get(&compiler->values, lookup(f, binary_op->rhs));
+
+    ValueIndex res;
+    u32 err = eval_binary_op(in->scratch, &compiler->types, &compiler->values, compiler->common.type.bool, binary_op->op, lhs, rhs, &res);
+    if (err) {
+      // The specializer has already checked the operand types. Only range arithmetic can overflow.
+      Assert(err != BinaryOpResult_invalid_operand_types);
+      return (err == BinaryOpResult_division_by_zero) ? Step_division_by_zero : Step_value_out_of_range;
+    }
+
+    f->inst_values[pc] = res;
+    f->pc += 1;
+  } break;
+  case IR_builtin_reduce: {
+    IrReduce *reduce = chunk_extra(f->chunk, pc);
+    Compiler *compiler = in->compiler;
+
+    Value *v = values_get(&compiler->values, lookup(f, reduce->value));
+
+    ValueIndex res;
+    u32 err = eval_reduce(in->scratch, &compiler->types, &compiler->values, reduce->builtin, v, &res);
+
+    // The specializer has already checked the operand type.
+    Assert(err == ReduceResult_ok);
+
+    f->inst_values[pc] = res;
+    f->pc += 1;
+  } break;
   default: Todo();
   }
 
   return Step_ok;
 }
 
+// Collections only happen between steps, when every value that is in use is owned by a declaration
+// or by a call frame. The chunk of a frame is marked as well, because it may not belong to any
+// declaration, such as a chunk loaded from an IR image, and the values it refers to must stay.
+internal void collect_values(Interpreter *in) {
+  Compiler *compiler = in->compiler;
+
+  ValueCollector c;
+  values_collect_begin(&c, &compiler->values, &compiler->types, in->scratch);
+
+  declarations_mark_values(&c, &compiler->decls, &compiler->common);
+
+  for (u32 i = 0; i < in->call_stack.len; i++) {
+    CallFrame2 *f = &in->call_stack.data[i];
+
+    values_mark_chunk(&c, f->chunk);
+
+    for (InstructionIndex j = 0; j < f->chunk->opcode_count; j++) {
+      values_mark(&c, f->inst_values[j]);
+    }
+  }
+
+  values_collect_end(&c);
+}
+
 u32 interpreter_call(Interpreter* in, IrChunk *chunk, ValueIndex *args, u32 arg_count, ValueIndex *out) {
   // TODO: make sure that the args match the signature of the function
   CallFrame2 *f = frame_push(in, chunk, out);
@@ -150,6 +217,10 @@ u32 interpreter_call(Interpreter* in, IrChunk *chunk, ValueIndex *args, u32 arg_
   }
 
   while (True) {
+    if (values_should_collect(&in->compiler->values)) {
+      collect_values(in);
+    }
+
     u32 err = step(in);
 
     if (err == Step_ok) {
@@ -158,9 +229,17 @@ u32 interpreter_call(Interpreter* in, IrChunk *chunk, ValueIndex *args, u32 arg_
 
     if (err == Step_return) {
       if (in->call_stack.len == 0) {
-        return 0;
+        return Interpret_ok;
       }
     }
+
+    if (err == Step_division_by_zero) {
+      return Interpret_error_division_by_zero;
+    }
+
+    if (err == Step_value_out_of_range) {
+      return Interpret_error_value_out_of_range;
+    }
   }
 
   Unreachable();
@@ -31,6 +31,12 @@ typedef struct {
   CallStack2 call_stack;
 } Interpreter;
 
+typedef enum {
+  Interpret_ok,
+  Interpret_error_division_by_zero,
+  Interpret_error_value_out_of_range,
+} InterpretResult;
+
 u32 interpreter_call(Interpreter* in, IrChunk *chunk, ValueIndex *args, u32 arg_count, ValueIndex *out);
 
 #endif // INTERPRET_H
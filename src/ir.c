@@ -138,7 +138,7 @@ InstructionIndex inst_as(IrBuilder *builder, IrRef type_destination, IrRef val,
   return idx;
 }
 
-internal b32 opcode_references_extra(u8 op) {
+b32 opcode_references_extra(u8 op) {
   switch (Cast(IrOpcode, op)) {
 #define X(k,e,_1,_2) case k: return e;
 #include "x_ir.h"
@@ -150,11 +150,13 @@ internal u32 flex_array_size(u8 op, void *payload) {
   switch (Cast(IrOpcode, op)) {
   case IR_type: return Cast(IrType*, payload)->arg_count * sizeof(IrRef);
   case IR_call: return Cast(IrCall*, payload)->arg_count * sizeof(IrRef);
+  case IR_sequence: return Cast(IrSequence*, payload)->count * sizeof(IrRef);
+  case IR_type_struct: return Cast(IrTypeStruct*, payload)->field_count * sizeof(IrStructField);
   default:      return 0;
   }
 }
 
-internal u32 extra_payload_size(u8 op, void *payload) {
+u32 extra_payload_size(u8 op, void *payload) {
   switch (Cast(IrOpcode, op)) {
 #define X(k,_1,d,_2) case k: return sizeof(d) + flex_array_size(op, payload);
 #include "x_ir.h"
@@ -162,7 +164,7 @@ internal u32 extra_payload_size(u8 op, void *payload) {
   }
 }
 
-internal u32 extra_payload_align(u8 op) {
+u32 extra_payload_align(u8 op) {
   switch (Cast(IrOpcode, op)) {
 #define X(k,_1,d,_2) case k: return Align_of(d);
 #include "x_ir.h"
@@ -212,3 +214,171 @@ void irbuilder_flatten(IrBuilder *builder, Arena *arena, IrChunk *chunk) {
     .extra        = extra,
   };
 }
+
+u32 chunk_extra_size(IrChunk *chunk) {
+  u32 size = 0;
+
+  for (InstructionIndex i = 0; i < chunk->opcode_count; i++) {
+    u8 op = chunk->opcodes[i];
+
+    if (!opcode_references_extra(op)) {
+      continue;
+    }
+
+    u32 end = chunk->data[i] + extra_payload_size(op, chunk_extra(chunk, i));
+    size = Max(size, end);
+  }
+
+  return size;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+u32 ir_operand_count(u8 op, void *extra) {
+  switch (Cast(IrOpcode, op)) {
+  case IR_nop:
+  case IR_block:
+  case IR_eval_block:
+  case IR_loop:
+  case IR_repeat:
+    return 0;
+  case IR_func:
+  case IR_param:
+  case IR_alloc:
+  case IR_condbr:
+  case IR_br:
+  case IR_ret:
+  case IR_load:
+  case IR_builtin_debug:
+  case IR_lookup_typeof:
+  case IR_lookup_value:
+  case IR_typeof:
+  case IR_return_type:
+  case IR_param_type:
+  case IR_builtin_reduce:
+  case IR_builtin_layout:
+    return 1;
+  case IR_store:
+  case IR_declaration:
+  case IR_as:
+  case IR_unify:
+  case IR_binary_op:
+    return 2;
+  case IR_call:
+    return 1 + Cast(IrCall*, extra)->arg_count;
+  case IR_type:
+    return Cast(IrType*, extra)->arg_count;
+  case IR_sequence:
+    return 1 + Cast(IrSequence*, extra)->count;
+  case IR_type_struct:
+    return Cast(IrTypeStruct*, extra)->field_count;
+  }
+
+  Unreachable();
+}
+
+IrOperand ir_operand_at(u8 op, u32 *data, void *extra, u32 i) {
+#define Operand(k, ptr) (IrOperand){ .kind = (k), .p = (ptr) }
+
+  switch (Cast(IrOpcode, op)) {
+  case IR_param:
+  case IR_ret:
+  case IR_load:
+  case IR_builtin_debug:
+  case IR_typeof:
+  case IR_return_type:
+    return Operand(IrOperand_ref, data);
+  case IR_alloc:
+    return Operand(IrOperand_type, data);
+  case IR_lookup_typeof:
+  case IR_lookup_value:
+    return Operand(IrOperand_declaration, data);
+  case IR_func:
+    return Operand(IrOperand_ref, &Cast(IrFunc*, extra)->return_type.x);
+  case IR_condbr:
+    return Operand(IrOperand_ref, &Cast(IrCondBr*, extra)->cond.x);
+  case IR_br:
+    return Operand(IrOperand_ref, &Cast(IrBr*, extra)->value.x);
+  case IR_param_type:
+    return Operand(IrOperand_ref, &Cast(IrParamType*, extra)->function.x);
+  case IR_builtin_reduce:
+    return Operand(IrOperand_ref, &Cast(IrReduce*, extra)->value.x);
+  case IR_builtin_layout:
+    return Operand(IrOperand_ref, &Cast(IrLayout*, extra)->type.x);
+  case IR_store: {
+    IrStore *store = extra;
+    return Operand(IrOperand_ref, i == 0 ? &store->dst.x : &store->value.x);
+  }
+  case IR_declaration: {
+    IrDeclaration *decl = extra;
+    return Operand(IrOperand_ref, i == 0 ? &decl->declared_type.x : &decl->value.x);
+  }
+  case IR_as: {
+    IrAs *as = extra;
+    return Operand(IrOperand_ref, i == 0 ? &as->type_to.x : &as->val.x);
+  }
+  case IR_unify: {
+    IrUnify *unify = extra;
+    return Operand(IrOperand_ref, i == 0 ? &unify->type_lhs.x : &unify->type_rhs.x);
+  }
+  case IR_binary_op: {
+    IrBinaryOp *binary_op = extra;
+    return Operand(IrOperand_ref, i == 0 ? &binary_op->lhs.x : &binary_op->rhs.x);
+  }
+  case IR_call: {
+    IrCall *call = extra;
+    return Operand(IrOperand_ref, i == 0 ? &call->func.x : &call->args[i-1].x);
+  }
+  case IR_type:
+    return Operand(IrOperand_ref, &Cast(IrType*, extra)->args[i].x);
+  case IR_sequence: {
+    IrSequence *sequence = extra;
+    return Operand(IrOperand_ref, i == 0 ? &sequence->type.x : &sequence->items[i-1].x);
+  }
+  case IR_type_struct:
+    return Operand(IrOperand_ref, &Cast(IrTypeStruct*, extra)->fields[i].type.x);
+  case IR_nop:
+  case IR_block:
+  case IR_eval_block:
+  case IR_loop:
+  case IR_repeat:
+    break;
+  }
+
+  Unreachable();
+
+#undef Operand
+}
+
+internal void *chunk_extra_or_null(IrChunk *chunk, InstructionIndex idx) {
+  return opcode_references_extra(chunk->opcodes[idx]) ? chunk_extra(chunk, idx) : Null;
+}
+
+u32 chunk_operand_count(IrChunk *chunk, InstructionIndex idx) {
+  return ir_operand_count(chunk->opcodes[idx], chunk_extra_or_null(chunk, idx));
+}
+
+IrOperand chunk_operand_at(IrChunk *chunk, InstructionIndex idx, u32 i) {
+  return ir_operand_at(chunk->opcodes[idx], &chunk->data[idx], chunk_extra_or_null(chunk, idx), i);
+}
+
+internal void *inst_extra_or_null(IrBuilder *builder, InstructionIndex idx) {
+  u8 op = inst_opcode(builder, idx);
+  return opcode_references_extra(op) ? inst_get_extra(builder, idx) : Null;
+}
+
+u32 inst_operand_count(IrBuilder *builder, InstructionIndex idx) {
+  u8 op = inst_opcode(builder, idx);
+  void *extra = inst_extra_or_null(builder, idx);
+
+  if (opcode_references_extra(op) && !extra) {
+    return 0;
+  }
+
+  return ir_operand_count(op, extra);
+}
+
+IrOperand inst_operand_at(IrBuilder *builder, InstructionIndex idx, u32 i) {
+  InstData *data = datalist_ptr_at_unchecked(&builder->data, idx);
+  return ir_operand_at(inst_opcode(builder, idx), &data->data, inst_extra_or_null(builder, idx), i);
+}
@@ -75,7 +75,9 @@ typedef enum {
   IR_store,  // data references `IrStore` in extra
   IR_call,   // data references `IrCall` in extra
 
-  IR_builtin_debug, // data contains `IrRef`
+  IR_builtin_debug,  // data contains `IrRef`
+  IR_builtin_reduce, // data references `IrReduce` in extra
+  IR_builtin_layout, // data references `IrLayout` in extra
 
   IR_declaration,   // data references `IrDeclaration` in extra
   IR_lookup_typeof, // data contains `DeclarationIndex`
@@ -85,10 +87,14 @@ typedef enum {
   IR_unify, // data references `IrUnify` in extra
 
   IR_type, // data references `IrType` in extra
+  IR_type_struct, // data references `IrTypeStruct` in extra
   IR_typeof, // data contains `IrRef`
 
   IR_return_type, // data contains `IrRef`
   IR_param_type,  // data references `IrParamType` in extra
+
+  IR_binary_op, // data references `IrBinaryOp` in extra
+  IR_sequence,  // data references `IrSequence` in extra
 } IrOpcode;
 
 // -------------------------------------------------------------------------------------------------
@@ -104,6 +110,19 @@ typedef struct {
   IrRef args[];
 } IrType;
 
+// Struct types carry field names and placements besides types, so they have their own instruction.
+typedef struct {
+  StringIndex name;
+  u8 placement; // FieldPlacement
+  IrRef type;
+} IrStructField;
+
+typedef struct {
+  u8 is_ordered;
+  u32 field_count;
+  IrStructField fields[];
+} IrTypeStruct;
+
 // You can put the value directly after the declaration instruction by convention.
 // `data` can then hold an optional ref to the optional declared type.
 // This way you don't need this IrDeclaration.
@@ -125,6 +144,32 @@ typedef struct {
   IrRef val;
 } IrAs;
 
+// Both operands have the same type, see `eval_binary_op`.
+typedef struct {
+  u8 op; // BinaryOpKind
+  IrRef lhs;
+  IrRef rhs;
+} IrBinaryOp;
+
+typedef struct {
+  u8 builtin; // BuiltinKind, one of the reductions
+  IrRef value;
+} IrReduce;
+
+typedef struct {
+  u8 builtin; // BuiltinKind, one of the layout queries
+  IrRef type;
+  StringIndex field; // Only used by `#offset_of`
+} IrLayout;
+
+// A sequence literal of `count` items. `type` is the array type of the literal, the items are
+// coerced to its base type.
+typedef struct {
+  IrRef type;
+  u32 count;
+  IrRef items[];
+} IrSequence;
+
 // An IR_func instruction is followed by `param_count` IR_param instructions.
 typedef struct {
   u32 param_count;
@@ -173,6 +218,38 @@ u8 chunk_opcode(IrChunk *chunk, InstructionIndex idx);
 u32 chunk_data(IrChunk *chunk, InstructionIndex idx);
 void *chunk_extra(IrChunk *chunk, InstructionIndex idx);
 
+// The size in bytes of the extra payloads of all instructions in the chunk.
+u32 chunk_extra_size(IrChunk *chunk);
+
+// -------------------------------------------------------------------------------------------------
+
+typedef enum {
+  IrOperand_ref,         // `p` points to an `IrRef`
+  IrOperand_type,        // `p` points to a `TypeIndex`
+  IrOperand_declaration, // `p` points to a `DeclarationIndex`
+} IrOperandKind;
+
+// An operand of an instruction that refers to something outside of the instruction stream.
+// Instruction indices that are not wrapped in an `IrRef`, such as the target of a `br`, are not
+// operands. `p` points into the data word or extra payload of the instruction, so an operand can
+// be rewritten in place.
+typedef struct {
+  u8   kind;
+  u32 *p;
+} IrOperand;
+
+// `data` points to the data word of the instruction and `extra` to its payload in extra. `extra` is
+// only used by opcodes that reference extra.
+u32       ir_operand_count(u8 op, void *extra);
+IrOperand ir_operand_at(u8 op, u32 *data, void *extra, u32 i);
+
+u32       chunk_operand_count(IrChunk *chunk, InstructionIndex idx);
+IrOperand chunk_operand_at(IrChunk *chunk, InstructionIndex idx, u32 i);
+
+b32 opcode_references_extra(u8 op);
+u32 extra_payload_size(u8 op, void *payload);
+u32 extra_payload_align(u8 op);
+
 // -------------------------------------------------------------------------------------------------
 
 #define OPCODE_LIST_MIN_SIZE_LOG_2 8
@@ -229,6 +306,10 @@ void *inst_push_data_raw(IrBuilder *builder, InstructionIndex idx, u32 size, u32
 void *inst_get_extra(IrBuilder *builder, InstructionIndex idx);
 u32 inst_offset(IrBuilder *builder, InstructionIndex start);
 
+// Instructions whose payload has not been pushed yet have no operands.
+u32       inst_operand_count(IrBuilder *builder, InstructionIndex idx);
+IrOperand inst_operand_at(IrBuilder *builder, InstructionIndex idx, u32 i);
+
 InstructionIndex inst_block_begin(IrBuilder *builder);
 InstructionIndex inst_eval_block_begin(IrBuilder *builder);
 void inst_block_end(IrBuilder *builder, InstructionIndex block);
@@ -0,0 +1,752 @@
+#include "ir_image.h"
+#include <stdio.h>
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+extern Allocator const cstd_allocator;
+
+// -------------------------------------------------------------------------------------------------
+// On-disk layout. All offsets are in bytes from the start of the image.
+
+typedef struct {
+  u32 magic;
+  u32 version;
+  u64 image_size;
+
+  u32 chunk_count; // Chunk 0 is the chunk passed to `ir_image_write`.
+  u32 type_count;  // Entry 0 is nil. Types are stored after the types they refer to.
+  u32 value_count; // Entry 0 is nil.
+  u32 reloc_count;
+
+  u64 chunks; // IrImageChunk[chunk_count]
+  u64 types;  // u64[type_count], the offset of each `Type`
+  u64 values; // IrImageValue[value_count]
+  u64 relocs; // IrImageReloc[reloc_count]
+} IrImageHeader;
+
+typedef struct {
+  u32 opcode_count;
+  u32 extra_size;
+  u64 opcodes;
+  u64 data;
+  u64 sources;
+  u64 extra;
+} IrImageChunk;
+
+typedef struct {
+  u32 type;
+  u32 data_size;
+  u64 data; // For function values this is the index of the chunk instead.
+} IrImageValue;
+
+enum IrImageRelocKind {
+  IrImageReloc_value,
+  IrImageReloc_type,
+};
+
+// Points to a `u32` in the image that holds an index into the value or type table.
+typedef struct {
+  u32 kind;
+  u32 pad;
+  u64 offset;
+} IrImageReloc;
+
+// -------------------------------------------------------------------------------------------------
+
+internal u32 hash_u64(void *context, u64 x) {
+  Unused(context);
+  return XXH32(&x, sizeof(x), 0);
+}
+
+internal b32 eq_u64(void *context, u64 a, u64 b) {
+  Unused(context);
+  return a == b;
+}
+
+#define HASHMAP_NAME            ImageIndexMap
+#define HASHMAP_KEY_TYPE        u64
+#define HASHMAP_VALUE_TYPE      u32
+#define HASHMAP_FUNCTION_PREFIX indexmap
+#define HASHMAP_HASH_FN         hash_u64
+#define HASHMAP_KEY_COMPARE_FN  eq_u64
+#define HASHMAP_LINKAGE         internal
+#define HASHMAP_OUTPUT_TYPES
+#define HASHMAP_OUTPUT_DEFINITIONS
+#include "hashmap.h"
+
+#define SEGMENTLIST_NAME            ImageChunkList
+#define SEGMENTLIST_TYPE            IrChunk*
+#define SEGMENTLIST_MIN_SIZE_LOG2   4
+#define SEGMENTLIST_SEGMENT_COUNT   24
+#define SEGMENTLIST_FUNCTION_PREFIX chunklist
+#define SEGMENTLIST_LINKAGE         internal
+#define SEGMENTLIST_OUTPUT_TYPES
+#define SEGMENTLIST_OUTPUT_DEFINITIONS
+#include "segment_list.h"
+
+#define SEGMENTLIST_NAME            ImageIndexList
+#define SEGMENTLIST_TYPE            u32
+#define SEGMENTLIST_MIN_SIZE_LOG2   6
+#define SEGMENTLIST_SEGMENT_COUNT   24
+#define SEGMENTLIST_FUNCTION_PREFIX indexlist
+#define SEGMENTLIST_LINKAGE         internal
+#define SEGMENTLIST_OUTPUT_TYPES
+#define SEGMENTLIST_OUTPUT_DEFINITIONS
+#include "segment_list.h"
+
+// A relocation before the layout of the image is known.
+typedef struct {
+  u8  kind;
+  b8  in_extra;
+  u32 chunk;
+  u32 offset; // Offset into the data array or the extra of the chunk.
+} PendingReloc;
+
+#define SEGMENTLIST_NAME            PendingRelocList
+#define SEGMENTLIST_TYPE            PendingReloc
+#define SEGMENTLIST_MIN_SIZE_LOG2   6
+#define SEGMENTLIST_SEGMENT_COUNT   24
+#define SEGMENTLIST_FUNCTION_PREFIX reloclist
+#define SEGMENTLIST_LINKAGE         internal
+#define SEGMENTLIST_OUTPUT_TYPES
+#define SEGMENTLIST_OUTPUT_DEFINITIONS
+#include "segment_list.h"
+
+typedef struct {
+  Arena        *scratch;
+  TypeInterner *types;
+  ValueStore   *values;
+
+  ImageChunkList   chunks;
+  ImageIndexList   type_list;
+  ImageIndexList   value_list;
+  PendingRelocList relocs;
+
+  // Map from chunk opcode pointers, `TypeIndex` and `ValueIndex` to their index in the image.
+  ImageIndexMap chunk_map;
+  ImageIndexMap type_map;
+  ImageIndexMap value_map;
+} ImageWriter;
+
+internal char const *cstr_from_string(Arena *arena, String s) {
+  u8 *buf = arena_push_array(u8, arena, s.len + 1);
+  memcpy(buf, s.str, s.len);
+  buf[s.len] = '\0';
+  return Cast(char const*, buf);
+}
+
+// Returns False if the type can not be stored.
+internal b32 collect_type(ImageWriter *w, TypeIndex idx) {
+  if (idx == 0) {
+    return True;
+  }
+
+  if (indexmap_find(&w->type_map, idx)) {
+    return True;
+  }
+
+  Type *type = types_get(w->types, idx);
+
+  b32 ok = True;
+
+  switch (Cast(TypeKind, type->kind)) {
+  case Type_comptime_int:
+  case Type_integer:
+  case Type_bool:
+  case Type_nil:
+  case Type_never:
+  case Type_range:
+  case Type_type:
+    break;
+  case Type_slice: {
+    ok = collect_type(w, type->data.slice.base_type);
+  } break;
+  case Type_array: {
+    ok = collect_type(w, type->data.array.base_type);
+  } break;
+  case Type_optional: {
+    ok = collect_type(w, type->data.optional.base_type);
+  } break;
+  case Type_function: {
+    ok = collect_type(w, type->data.function.return_type);
+    for (u32 i = 0; ok && i < type->data.function.param_count; i++) {
+      ok = collect_type(w, type->data.function.param_types[i]);
+    }
+  } break;
+  case Type_struct: {
+    // The field names are `StringIndex`, which are only meaningful within a single session.
+    ok = False;
+  } break;
+  }
+
+  if (!ok) {
+    return False;
+  }
+
+  u32 res = w->type_list.len;
+  indexlist_append(&w->type_list, w->scratch, idx);
+  indexmap_insert(&w->type_map, idx, res);
+
+  return True;
+}
+
+internal b32 collect_chunk(ImageWriter *w, IrChunk *chunk, u32 *out);
+
+internal b32 collect_value(ImageWriter *w, ValueIndex idx, u32 *out) {
+  u32 *found = indexmap_find(&w->value_map, idx);
+  if (found) {
+    *out = *found;
+    return True;
+  }
+
+  u32 res = w->value_list.len;
+  indexlist_append(&w->value_list, w->scratch, idx);
+  indexmap_insert(&w->value_map, idx, res);
+
+  Value *v = values_get(w->values, idx);
+  if (!collect_type(w, v->type)) {
+    return False;
+  }
+
+  Type *type = types_get(w->types, v->type);
+
+  if (type->kind == Type_type && !collect_type(w, *Cast(TypeIndex*, value_data(v)))) {
+    return False;
+  }
+
+  if (type->kind == Type_function) {
+    u32 ignore;
+    b32 ok = collect_chunk(w, &Cast(ValueFunc*, value_data(v))->chunk, &ignore);
+    if (!ok) {
+      return False;
+    }
+  }
+
+  *out = res;
+
+  return True;
+}
+
+// Chunks are identified by their opcode array, because function values are copied by value.
+internal b32 collect_chunk(ImageWriter *w, IrChunk *chunk, u32 *out) {
+  u64 key = Cast(u64, Cast(usize, chunk->opcodes));
+
+  u32 *found = indexmap_find(&w->chunk_map, key);
+  if (found) {
+    *out = *found;
+    return True;
+  }
+
+  u32 res = w->chunks.len;
+  chunklist_append(&w->chunks, w->scratch, chunk);
+  indexmap_insert(&w->chunk_map, key, res);
+
+  for (InstructionIndex i = 0; i < chunk->opcode_count; i++) {
+    // These refer to field names, see `collect_type`.
+    if (chunk->opcodes[i] == IR_type_struct || chunk->opcodes[i] == IR_builtin_layout) {
+      return False;
+    }
+
+    u32 operand_count = chunk_operand_count(chunk, i);
+
+    for (u32 k = 0; k < operand_count; k++) {
+      IrOperand operand = chunk_operand_at(chunk, i, k);
+
+      PendingReloc reloc = {
+        .chunk    = res,
+        .in_extra = opcode_references_extra(chunk->opcodes[i]),
+      };
+
+      reloc.offset = reloc.in_extra ? Cast(u32, ptr_diff(operand.p, chunk->extra))
+                                    : Cast(u32, ptr_diff(operand.p, chunk->data));
+
+      switch (Cast(IrOperandKind, operand.kind)) {
+      case IrOperand_ref: {
+        IrRef ref = (IrRef){ *operand.p };
+        if (!ref_is_some_value_index(ref)) {
+          continue;
+        }
+
+        u32 ignore;
+        b32 ok = collect_value(w, ref_to_value_index(ref), &ignore);
+        if (!ok) {
+          return False;
+        }
+
+        reloc.kind = IrImageReloc_value;
+      } break;
+      case IrOperand_type: {
+        if (*operand.p == 0) {
+          continue;
+        }
+
+        if (!collect_type(w, *operand.p)) {
+          return False;
+        }
+
+        reloc.kind = IrImageReloc_type;
+      } break;
+      case IrOperand_declaration:
+        return False;
+      }
+
+      reloclist_append(&w->relocs, w->scratch, reloc);
+    }
+  }
+
+  *out = res;
+
+  return True;
+}
+
+internal always_inline u64 layout_push(u64 *at, u64 size, u32 align) {
+  u64 offset = round_up_to_power_of_two(*at, align);
+  *at = offset + size;
+  return offset;
+}
+
+u32 ir_image_write(String filename, Arena *scratch, TypeInterner *types, ValueStore *values, IrChunk *chunk) {
+  ArenaSnapshot snapshot = arena_scope_begin(scratch);
+
+  ImageWriter w = {
+    .scratch = scratch,
+    .types   = types,
+    .values  = values,
+  };
+
+  HashMapOptions map_options = { .allocator = cstd_allocator, .initial_size = 64 };
+  indexmap_init(&w.chunk_map, &map_options);
+  indexmap_init(&w.type_map, &map_options);
+  indexmap_init(&w.value_map, &map_options);
+
+  // Reserve the nil entries
+  indexlist_append(&w.type_list, scratch, 0);
+  indexlist_append(&w.value_list, scratch, 0);
+
+  u32 ignore;
+  b32 ok = collect_chunk(&w, chunk, &ignore);
+
+  if (!ok) {
+    indexmap_deinit(&w.chunk_map);
+    indexmap_deinit(&w.type_map);
+    indexmap_deinit(&w.value_map);
+    arena_scope_end(scratch, snapshot);
+    return IrImage_error_unsupported_operand;
+  }
+
+  u32 chunk_count = w.chunks.len;
+  u32 type_count  = w.type_list.len;
+  u32 value_count = w.value_list.len;
+  u32 reloc_count = w.relocs.len;
+
+  // First compute where everything goes, then copy everything into place.
+
+  u64 at = 0;
+
+  IrImageHeader header = {
+    .magic       = IR_IMAGE_MAGIC,
+    .version     = IR_IMAGE_VERSION,
+    .chunk_count = chunk_count,
+    .type_count  = type_count,
+    .value_count = value_count,
+    .reloc_count = reloc_count,
+  };
+
+  layout_push(&at, sizeof(IrImageHeader), 8);
+  header.chunks = layout_push(&at, chunk_count * sizeof(IrImageChunk), 8);
+  header.types  = layout_push(&at, type_count  * sizeof(u64), 8);
+  header.values = layout_push(&at, value_count * sizeof(IrImageValue), 8);
+  header.relocs = layout_push(&at, reloc_count * sizeof(IrImageReloc), 8);
+
+  IrImageChunk *image_chunks = arena_push_array(IrImageChunk, scratch, chunk_count);
+  for (u32 i = 0; i < chunk_count; i++) {
+    IrChunk *c = chunklist_at_unchecked(&w.chunks, i);
+    u32 n = c->opcode_count;
+    u32 extra_size = chunk_extra_size(c);
+    image_chunks[i] = (IrImageChunk){
+      .opcode_count = n,
+      .extra_size   = extra_size,
+      .opcodes      = layout_push(&at, n, 1),
+      .sources      = layout_push(&at, n * sizeof(AstAndSourceIndex), Align_of(AstAndSourceIndex)),
+      .data         = layout_push(&at, n * sizeof(u32), Align_of(u32)),
+      .extra        = layout_push(&at, extra_size, 16),
+    };
+  }
+
+  u64 *type_offsets = arena_push_array(u64, scratch, type_count);
+  type_offsets[0] = 0;
+  for (u32 i = 1; i < type_count; i++) {
+    Type *type = types_get(types, indexlist_at_unchecked(&w.type_list, i));
+    type_offsets[i] = layout_push(&at, type_intern_byte_size(type), Align_of(Type));
+  }
+
+  IrImageValue *image_values = arena_push_array(IrImageValue, scratch, value_count);
+  image_values[0] = (IrImageValue){0};
+  for (u32 i = 1; i < value_count; i++) {
+    Value *v = values_get(values, indexlist_at_unchecked(&w.value_list, i));
+    Type *type = types_get(types, v->type);
+
+    image_values[i] = (IrImageValue){
+      .type      = *indexmap_find(&w.type_map, v->type),
+      .data_size = v->data_size,
+    };
+
+    if (type->kind == Type_function) {
+      u64 key = Cast(u64, Cast(usize, Cast(ValueFunc*, value_data(v))->chunk.opcodes));
+      image_values[i].data = *indexmap_find(&w.chunk_map, key);
+    } else {
+      image_values[i].data = layout_push(&at, v->data_size, 16);
+    }
+  }
+
+  header.image_size = at;
+
+  u8 *image = arena_push_array(u8, scratch, at);
+  memset(image, 0, at);
+
+  memcpy(image, &header, sizeof(header));
+  memcpy(image + header.chunks, image_chunks, chunk_count * sizeof(IrImageChunk));
+  memcpy(image + header.types,  type_offsets, type_count  * sizeof(u64));
+  memcpy(image + header.values, image_values, value_count * sizeof(IrImageValue));
+
+  for (u32 i = 0; i < chunk_count; i++) {
+    IrChunk *c = chunklist_at_unchecked(&w.chunks, i);
+    IrImageChunk *ic = &image_chunks[i];
+    memcpy(image + ic->opcodes, c->opcodes, ic->opcode_count);
+    memcpy(image + ic->sources, c->sources, ic->opcode_count * sizeof(AstAndSourceIndex));
+    memcpy(image + ic->data,    c->data,    ic->opcode_count * sizeof(u32));
+    memcpy(image + ic->extra,   c->extra,   ic->extra_size);
+  }
+
+  for (u32 i = 1; i < type_count; i++) {
+    Type *type = types_get(types, indexlist_at_unchecked(&w.type_list, i));
+    Type *dst = Cast(Type*, image + type_offsets[i]);
+    memcpy(dst, type, type_intern_byte_size(type));
+
+    switch (Cast(TypeKind, dst->kind)) {
+    case Type_comptime_int:
+    case Type_integer:
+    case Type_bool:
+    case Type_nil:
+    case Type_never:
+    case Type_range:
+    case Type_type:
+      break;
+    case Type_slice: {
+      dst->data.slice.base_type = *indexmap_find(&w.type_map, dst->data.slice.base_type);
+    } break;
+    case Type_array: {
+      dst->data.array.base_type = *indexmap_find(&w.type_map, dst->data.array.base_type);
+    } break;
+    case Type_optional: {
+      dst->data.optional.base_type = *indexmap_find(&w.type_map, dst->data.optional.base_type);
+    } break;
+    case Type_struct:
+      Unreachable(); // Rejected by `collect_type`.
+    case Type_function: {
+      TypeFunction *func = &dst->data.function;
+      if (func->return_type) {
+        func->return_type = *indexmap_find(&w.type_map, func->return_type);
+      }
+      for (u32 k = 0; k < func->param_count; k++) {
+        if (func->param_types[k]) {
+          func->param_types[k] = *indexmap_find(&w.type_map, func->param_types[k]);
+        }
+      }
+    } break;
+    }
+  }
+
+  for (u32 i = 1; i < value_count; i++) {
+    Value *v = values_get(values, indexlist_at_unchecked(&w.value_list, i));
+    Type *type = types_get(types, v->type);
+
+    if (type->kind == Type_function) {
+      continue;
+    }
+
+    void *dst = image + image_values[i].data;
+    memcpy(dst, value_data(v), v->data_size);
+
+    if (type->kind == Type_type) {
+      TypeIndex *t = dst;
+      *t = *indexmap_find(&w.type_map, *t);
+    }
+  }
+
+  IrImageReloc *image_relocs = Cast(IrImageReloc*, image + header.relocs);
+  for (u32 i = 0; i < reloc_count; i++) {
+    PendingReloc reloc = reloclist_at_unchecked(&w.relocs, i);
+    IrImageChunk *ic = &image_chunks[reloc.chunk];
+
+    u64 offset = (reloc.in_extra ? ic->extra : ic->data) + reloc.offset;
+    u32 *p = Cast(u32*, image + offset);
+
+    ImageIndexMap *map = reloc.kind == IrImageReloc_value ? &w.value_map : &w.type_map;
+    *p = *indexmap_find(map, *p);
+
+    image_relocs[i] = (IrImageReloc){ .kind = reloc.kind, .offset = offset };
+  }
+
+  indexmap_deinit(&w.chunk_map);
+  indexmap_deinit(&w.type_map);
+  indexmap_deinit(&w.value_map);
+
+  u32 result = IrImage_ok;
+
+  FILE *f = fopen(cstr_from_string(scratch, filename), "wb");
+  if (is_null(f)) {
+    result = IrImage_error_could_not_open_file;
+  } else {
+    usize written = fwrite(image, 1, at, f);
+    if (fclose(f) != 0 || written != at) {
+      result = IrImage_error_could_not_write_file;
+    }
+  }
+
+  arena_scope_end(scratch, snapshot);
+
+  return result;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+internal always_inline b32 range_in_image(u64 image_size, u64 offset, u64 size) {
+  return offset <= image_size && size <= image_size - offset;
+}
+
+// The image is mapped at a page boundary, so an offset that is a multiple of `align` is an aligned
+// address as well.
+internal always_inline b32 aligned_range_in_image(u64 image_size, u64 offset, u64 size, u32 align) {
+  return range_in_image(image_size, offset, size) && offset % align == 0;
+}
+
+internal b32 remap_type(Type *type, TypeIndex *type_map, u32 limit) {
+#define Remap(t)                                                                                   \
+  do {                                                                                             \
+    if ((t) >= limit) { return False; }                                                            \
+    (t) = type_map[(t)];                                                                           \
+  } while (0)
+
+  switch (type->kind) {
+  case Type_comptime_int:
+  case Type_integer:
+  case Type_bool:
+  case Type_nil:
+  case Type_never:
+  case Type_range:
+  case Type_type:
+    break;
+  case Type_slice:
+    Remap(type->data.slice.base_type);
+    break;
+  case Type_array:
+    Remap(type->data.array.base_type);
+    break;
+  case Type_optional:
+    Remap(type->data.optional.base_type);
+    break;
+  case Type_function:
+    Remap(type->data.function.return_type);
+    for (u32 i = 0; i < type->data.function.param_count; i++) {
+      Remap(type->data.function.param_types[i]);
+    }
+    break;
+  case Type_struct: // Never written, see `collect_type`.
+  default:
+    return False;
+  }
+
+  return True;
+
+#undef Remap
+}
+
+u32 ir_image_load(IrImage *image, String filename, Arena *scratch, TypeInterner *types, ValueStore *values) {
+  ArenaSnapshot snapshot = arena_scope_begin(scratch);
+
+  zero_struct(IrImage, image);
+
+  b32 ok = file_map(&image->mapping, cstr_from_string(scratch, filename), 0);
+  if (!ok) {
+    arena_scope_end(scratch, snapshot);
+    return IrImage_error_could_not_open_file;
+  }
+
+  u8 *base = image->mapping.base;
+  u64 size = image->mapping.size;
+
+  u32 result = IrImage_error_invalid_image;
+
+  if (size < sizeof(IrImageHeader)) {
+    goto fail;
+  }
+
+  IrImageHeader *header = Cast(IrImageHeader*, base);
+
+  if (header->magic != IR_IMAGE_MAGIC) {
+    goto fail;
+  }
+
+  if (header->version != IR_IMAGE_VERSION) {
+    result = IrImage_error_version_mismatch;
+    goto fail;
+  }
+
+  if (header->image_size != size || header->chunk_count == 0 || header->type_count == 0 || header->value_count == 0) {
+    goto fail;
+  }
+
+  if (!aligned_range_in_image(size, header->chunks, header->chunk_count * sizeof(IrImageChunk), Align_of(IrImageChunk)) ||
+      !aligned_range_in_image(size, header->types,  header->type_count  * sizeof(u64),          Align_of(u64)) ||
+      !aligned_range_in_image(size, header->values, header->value_count * sizeof(IrImageValue), Align_of(IrImageValue)) ||
+      !aligned_range_in_image(size, header->relocs, header->reloc_count * sizeof(IrImageReloc), Align_of(IrImageReloc)))
+  {
+    goto fail;
+  }
+
+  // Types are stored after the types they refer to, so they can be added in order.
+
+  u64 *type_offsets = Cast(u64*, base + header->types);
+  TypeIndex *type_map = arena_push_array(TypeIndex, scratch, header->type_count);
+  type_map[0] = 0;
+
+  for (u32 i = 1; i < header->type_count; i++) {
+    if (!aligned_range_in_image(size, type_offsets[i], sizeof(Type), Align_of(Type))) {
+      goto fail;
+    }
+
+    Type *src = Cast(Type*, base + type_offsets[i]);
+
+    if (src->kind > Type_type) {
+      goto fail;
+    }
+
+    u32 byte_size = type_intern_byte_size(src);
+    if (!range_in_image(size, type_offsets[i], byte_size)) {
+      goto fail;
+    }
+
+    Type *type = arena_push(scratch, byte_size, Align_of(Type));
+    memcpy(type, src, byte_size);
+
+    if (!remap_type(type, type_map, i)) {
+      goto fail;
+    }
+
+    type_map[i] = types_add(types, type);
+  }
+
+  IrImageChunk *image_chunks = Cast(IrImageChunk*, base + header->chunks);
+  IrChunk *chunks = arena_push_array(IrChunk, scratch, header->chunk_count);
+
+  for (u32 i = 0; i < header->chunk_count; i++) {
+    IrImageChunk *ic = &image_chunks[i];
+    u32 n = ic->opcode_count;
+
+    if (!range_in_image(size, ic->opcodes, n) ||
+        !aligned_range_in_image(size, ic->sources, n * sizeof(AstAndSourceIndex), Align_of(AstAndSourceIndex)) ||
+        !aligned_range_in_image(size, ic->data,    n * sizeof(u32), Align_of(u32)) ||
+        !range_in_image(size, ic->extra,   ic->extra_size))
+    {
+      goto fail;
+    }
+
+    chunks[i] = (IrChunk){
+      .opcode_count = n,
+      .opcodes      = base + ic->opcodes,
+      .sources      = Cast(AstAndSourceIndex*, base + ic->sources),
+      .data         = Cast(u32*, base + ic->data),
+      .extra        = base + ic->extra,
+    };
+  }
+
+  IrImageValue *image_values = Cast(IrImageValue*, base + header->values);
+  ValueIndex *value_map = arena_push_array(ValueIndex, scratch, header->value_count);
+  value_map[0] = 0;
+
+  for (u32 i = 1; i < header->value_count; i++) {
+    IrImageValue *iv = &image_values[i];
+
+    if (iv->type == 0 || iv->type >= header->type_count) {
+      goto fail;
+    }
+
+    TypeIndex type_idx = type_map[iv->type];
+    Type *type = types_get(types, type_idx);
+
+    if (type->kind == Type_function) {
+      if (iv->data >= header->chunk_count) {
+        goto fail;
+      }
+
+      ValueFunc *func;
+      value_map[i] = values_alloc_typed(values, type_idx, ValueFunc, &func);
+      func->chunk = chunks[iv->data];
+      continue;
+    }
+
+    if (!range_in_image(size, iv->data, iv->data_size)) {
+      goto fail;
+    }
+
+    if (type->kind == Type_type) {
+      TypeIndex t;
+      if (iv->data_size != sizeof(TypeIndex)) {
+        goto fail;
+      }
+      memcpy(&t, base + iv->data, sizeof(TypeIndex));
+      if (t >= header->type_count) {
+        goto fail;
+      }
+
+      TypeIndex mapped = type_map[t];
+      value_map[i] = values_intern_typed(values, type_idx, TypeIndex, &mapped);
+      continue;
+    }
+
+    // The alignment of a payload only depends on its size.
+    void *data;
+    value_map[i] = values_alloc(values, type_idx, iv->data_size, 1, &data);
+    memcpy(data, base + iv->data, iv->data_size);
+  }
+
+  IrImageReloc *relocs = Cast(IrImageReloc*, base + header->relocs);
+
+  for (u32 i = 0; i < header->reloc_count; i++) {
+    IrImageReloc reloc = relocs[i];
+
+    if (!aligned_range_in_image(size, reloc.offset, sizeof(u32), Align_of(u32))) {
+      goto fail;
+    }
+
+    u32 *p = Cast(u32*, base + reloc.offset);
+
+    if (reloc.kind == IrImageReloc_value && *p < header->value_count) {
+      *p = value_map[*p];
+    } else if (reloc.kind == IrImageReloc_type && *p < header->type_count) {
+      *p = type_map[*p];
+    } else {
+      goto fail;
+    }
+  }
+
+  image->chunk = chunks[0];
+
+  arena_scope_end(scratch, snapshot);
+
+  return IrImage_ok;
+
+fail:
+  // Values that were already added are not removed. They are unreachable, but this only happens
+  // for corrupt images.
+  file_unmap(&image->mapping);
+  arena_scope_end(scratch, snapshot);
+  return result;
+}
+
+void ir_image_unload(IrImage *image) {
+  file_unmap(&image->mapping);
+  zero_struct(IrImage, image);
+}
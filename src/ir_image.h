@@ -0,0 +1,49 @@
+#ifndef IR_IMAGE_H
+#define IR_IMAGE_H
+
+#include "blu.h"
+#include "ir.h"
+#include "value.h"
+
+// An IR image is a binary file containing an `IrChunk`, every chunk reachable through the function
+// values it references and the values and types those chunks refer to. The file is laid out so that
+// it can be mapped into memory and used in place. The instruction arrays of the loaded chunks point
+// directly into the mapping.
+//
+// `ValueIndex` and `TypeIndex` are only meaningful within a single compiler session, so the image
+// stores its own value and type tables. Every operand that refers to a value or a type is stored as
+// an index into those tables and is listed in a relocation table. Loading an image adds the types
+// and values to the current session and patches the relocated operands. The mapping is private and
+// copy-on-write, so only the pages that contain relocations are copied.
+//
+// Chunks that look up declarations can not be stored, because there is no way to find the same
+// declaration in another session. In practice this means that only residual code can be stored.
+// For the same reason struct types, whose field names are interned strings, can not be stored.
+//
+// The image uses the native byte order and the in-memory layout of the IR structs. Bump
+// `IR_IMAGE_VERSION` whenever either of those changes.
+
+#define IR_IMAGE_MAGIC   0x52494c42 // "BLIR"
+#define IR_IMAGE_VERSION 4
+
+typedef enum {
+  IrImage_ok,
+  IrImage_error_could_not_open_file,
+  IrImage_error_could_not_write_file,
+  IrImage_error_unsupported_operand,
+  IrImage_error_invalid_image,
+  IrImage_error_version_mismatch,
+} IrImageResult;
+
+typedef struct {
+  FileMapping mapping;
+  IrChunk     chunk; // The chunk that was passed to `ir_image_write`.
+} IrImage;
+
+u32 ir_image_write(String filename, Arena *scratch, TypeInterner *types, ValueStore *values, IrChunk *chunk);
+
+// The image must stay loaded for as long as any of the loaded chunks or function values is in use.
+u32  ir_image_load(IrImage *image, String filename, Arena *scratch, TypeInterner *types, ValueStore *values);
+void ir_image_unload(IrImage *image);
+
+#endif // IR_IMAGE_H
@@ -0,0 +1,406 @@
+#include "ir_pass.h"
+#include "toteload.h"
+
+enum {
+  IR_OPCODE_COUNT = 0
+#define X(...) + 1
+#include "x_ir.h"
+#undef X
+};
+
+// -------------------------------------------------------------------------------------------------
+
+typedef struct {
+  u8 opcode;
+  InstructionIndex start;
+  InstructionIndex end;
+} VerifyScope;
+
+internal b32 is_block_opcode(u8 op) {
+  return op == IR_block || op == IR_eval_block || op == IR_loop;
+}
+
+internal b32 scopes_contain(VerifyScope *scopes, u32 depth, InstructionIndex start, u8 opcode) {
+  for (u32 i = 0; i < depth; i++) {
+    if (scopes[i].start == start && (scopes[i].opcode == opcode || opcode == IR_nop)) {
+      return True;
+    }
+  }
+
+  return False;
+}
+
+internal b32 scopes_contain_opcode(VerifyScope *scopes, u32 depth, u8 opcode) {
+  for (u32 i = 0; i < depth; i++) {
+    if (scopes[i].opcode == opcode) {
+      return True;
+    }
+  }
+
+  return False;
+}
+
+b32 ir_verify(IrPassContext *context, IrChunk *chunk, IrVerifyError *err) {
+#define Fail(msg)                                                                                  \
+  do {                                                                                             \
+    *err = (IrVerifyError){ .inst = i, .reason = (msg) };                                          \
+    goto fail;                                                                                     \
+  } while (0)
+
+  ArenaSnapshot snapshot = arena_scope_begin(context->scratch);
+
+  u32 count = chunk->opcode_count;
+  u32 type_count = Cast(u32, context->types->list.len);
+
+  // The first scope is the chunk itself and is never popped.
+  VerifyScope *scopes = arena_push_array(VerifyScope, context->scratch, count + 1);
+  u32 depth = 0;
+  scopes[depth++] = (VerifyScope){ .opcode = IR_nop, .start = UINT32_MAX, .end = count };
+
+  u32 params_left = 0;
+  u32 extra_end = 0;
+
+  for (InstructionIndex i = 0; i < count; i++) {
+    while (scopes[depth - 1].end <= i) {
+      depth -= 1;
+    }
+
+    VerifyScope *parent = &scopes[depth - 1];
+
+    u8 op = chunk->opcodes[i];
+    u32 data = chunk->data[i];
+
+    if (op >= IR_OPCODE_COUNT) {
+      Fail("invalid opcode");
+    }
+
+    if (params_left > 0) {
+      if (op != IR_param) {
+        Fail("function is not followed by its params");
+      }
+
+      params_left -= 1;
+    }
+
+    void *extra = Null;
+
+    if (opcode_references_extra(op)) {
+      if (data % extra_payload_align(op) != 0) {
+        Fail("payload is misaligned");
+      }
+
+      if (data < extra_end) {
+        Fail("payload overlaps the payload of an earlier instruction");
+      }
+
+      extra = chunk_extra(chunk, i);
+      extra_end = data + extra_payload_size(op, extra);
+    }
+
+    switch (Cast(IrOpcode, op)) {
+    case IR_block:
+    case IR_eval_block:
+    case IR_loop: {
+      if (data == 0) {
+        Fail("block has an instruction count of zero");
+      }
+
+      if (i + data > parent->end) {
+        Fail("block extends beyond its parent");
+      }
+
+      scopes[depth++] = (VerifyScope){ .opcode = op, .start = i, .end = i + data };
+    } break;
+    case IR_func: {
+      IrFunc *func = extra;
+
+      if (func->instruction_count < 1 + func->param_count) {
+        Fail("function is too small to hold its params");
+      }
+
+      if (i + func->instruction_count > parent->end) {
+        Fail("function extends beyond its parent");
+      }
+
+      scopes[depth++] = (VerifyScope){ .opcode = op, .start = i, .end = i + func->instruction_count };
+      params_left = func->param_count;
+    } break;
+    case IR_br: {
+      IrBr *br = extra;
+
+      if (!scopes_contain(scopes, depth, br->block, IR_nop) || !is_block_opcode(chunk->opcodes[br->block])) {
+        Fail("br target is not an enclosing block");
+      }
+    } break;
+    case IR_repeat: {
+      if (!scopes_contain(scopes, depth, data, IR_loop)) {
+        Fail("repeat target is not an enclosing loop");
+      }
+    } break;
+    case IR_condbr: {
+      IrCondBr *condbr = extra;
+
+      InstructionIndex targets[] = { condbr->then, condbr->otherwise };
+      for (u32 j = 0; j < 2; j++) {
+        InstructionIndex target = targets[j];
+
+        if (target <= i || target >= parent->end || !is_block_opcode(chunk->opcodes[target])) {
+          Fail("condbr target is not a block that follows it in the same scope");
+        }
+      }
+    } break;
+    case IR_ret: {
+      if (!scopes_contain_opcode(scopes, depth, IR_func)) {
+        Fail("ret outside of a function");
+      }
+    } break;
+    case IR_type: {
+      IrType *type = extra;
+
+      if (type->kind == Type_function && type->arg_count == 0) {
+        Fail("function type without a return type");
+      }
+    } break;
+    default: break;
+    }
+
+    u32 operand_count = ir_operand_count(op, extra);
+
+    for (u32 j = 0; j < operand_count; j++) {
+      IrOperand operand = ir_operand_at(op, &chunk->data[i], extra, j);
+      u32 x = *operand.p;
+
+      switch (Cast(IrOperandKind, operand.kind)) {
+      case IrOperand_ref: {
+        IrRef ref = { x };
+
+        if (ref_is_instruction_index(ref)) {
+          InstructionIndex target = ref_to_instruction_index(ref);
+
+          // A declaration refers to the blocks that compute its type and value, which follow it.
+          if (op == IR_declaration) {
+            if (target <= i || target >= count || !is_block_opcode(chunk->opcodes[target])) {
+              Fail("declaration does not refer to a block that follows it");
+            }
+          } else if (target >= i) {
+            Fail("ref does not refer to an earlier instruction");
+          }
+
+          if (chunk->opcodes[target] == IR_nop) {
+            Fail("ref refers to a nop");
+          }
+        } else if (!values_is_live(context->values, x)) {
+          Fail("value ref does not refer to a live value");
+        }
+      } break;
+      case IrOperand_type: {
+        if (x >= type_count) {
+          Fail("type out of range");
+        }
+      } break;
+      case IrOperand_declaration: {
+        if (x == 0) {
+          Fail("lookup of the nil declaration");
+        }
+      } break;
+      }
+    }
+  }
+
+  if (params_left > 0) {
+    InstructionIndex i = count;
+    Fail("function is not followed by its params");
+  }
+
+  arena_scope_end(context->scratch, snapshot);
+  return True;
+
+fail:
+  arena_scope_end(context->scratch, snapshot);
+  return False;
+
+#undef Fail
+}
+
+// -------------------------------------------------------------------------------------------------
+
+// `as _ x` has no destination type and evaluates to `x`. Uses of the `as` are rewritten to use `x`
+// and the `as` itself is replaced by a nop.
+internal b32 pass_elide_untyped_as(IrPassContext *context, IrChunk *chunk) {
+  ArenaSnapshot snapshot = arena_scope_begin(context->scratch);
+
+  u32 count = chunk->opcode_count;
+  IrRef *replacements = arena_push_array(IrRef, context->scratch, count);
+  memset(replacements, 0, count * sizeof(IrRef));
+
+  b32 changed = False;
+
+  for (InstructionIndex i = 0; i < count; i++) {
+    u32 operand_count = chunk_operand_count(chunk, i);
+
+    for (u32 j = 0; j < operand_count; j++) {
+      IrOperand operand = chunk_operand_at(chunk, i, j);
+      IrRef ref = { *operand.p };
+
+      if (operand.kind != IrOperand_ref || !ref_is_instruction_index(ref)) {
+        continue;
+      }
+
+      IrRef replacement = replacements[ref_to_instruction_index(ref)];
+      if (!ref_is_nil(replacement)) {
+        *operand.p = ref_to_u32(replacement);
+        changed = True;
+      }
+    }
+
+    if (chunk->opcodes[i] != IR_as) {
+      continue;
+    }
+
+    IrAs *as = chunk_extra(chunk, i);
+    if (ref_is_nil(as->type_to) && !ref_is_nil(as->val)) {
+      replacements[i] = as->val;
+      chunk->opcodes[i] = IR_nop;
+      changed = True;
+    }
+  }
+
+  arena_scope_end(context->scratch, snapshot);
+
+  return changed;
+}
+
+#define PASS(n, fn) { .name = { .str = Cast(u8*, n), .len = sizeof(n) - 1 }, .run = fn }
+
+internal IrPass const passes[] = {
+  PASS("elide-untyped-as", pass_elide_untyped_as),
+};
+
+#undef PASS
+
+#define PASS_COUNT (sizeof(passes) / sizeof(passes[0]))
+
+internal IrPass const *find_pass(String name) {
+  for (u32 i = 0; i < PASS_COUNT; i++) {
+    if (string_eq(passes[i].name, name)) {
+      return &passes[i];
+    }
+  }
+
+  return Null;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+u32 ir_pipeline_init(IrPipeline *pipeline, String spec, b32 verify) {
+  zero_struct(IrPipeline, pipeline);
+
+  pipeline->verify = verify;
+
+  usize start = 0;
+  while (start < spec.len) {
+    usize end = start;
+    while (end < spec.len && spec.str[end] != ',') {
+      end += 1;
+    }
+
+    String name = { .str = spec.str + start, .len = end - start };
+    start = end + 1;
+
+    if (name.len == 0) {
+      continue;
+    }
+
+    IrPass const *pass = find_pass(name);
+    if (!pass) {
+      return IrPipelineInit_error_unknown_pass;
+    }
+
+    if (pipeline->pass_count == IR_PIPELINE_MAX_PASSES) {
+      return IrPipelineInit_error_too_many_passes;
+    }
+
+    pipeline->passes[pipeline->pass_count++] = pass;
+  }
+
+  return IrPipelineInit_ok;
+}
+
+internal u32 live_instruction_count(IrChunk *chunk) {
+  u32 count = 0;
+  for (InstructionIndex i = 0; i < chunk->opcode_count; i++) {
+    count += chunk->opcodes[i] != IR_nop;
+  }
+  return count;
+}
+
+internal b32 verify_timed(IrPipeline *pipeline, IrPassContext *context, IrChunk *chunk, IrVerifyError *err) {
+  if (!pipeline->verify) {
+    return True;
+  }
+
+  u64 start = time_now_ns();
+  b32 ok = ir_verify(context, chunk, err);
+  pipeline->verify_time_ns += time_now_ns() - start;
+  return ok;
+}
+
+b32 ir_pipeline_run(IrPipeline *pipeline, IrPassContext *context, IrChunk *chunk, IrPipelineError *err) {
+  if (pipeline->pass_count == 0 && !pipeline->verify) {
+    return True;
+  }
+
+  pipeline->chunk_count += 1;
+
+  if (!verify_timed(pipeline, context, chunk, &err->verify)) {
+    err->after_pass = (String){0};
+    return False;
+  }
+
+  for (u32 i = 0; i < pipeline->pass_count; i++) {
+    IrPass const *pass = pipeline->passes[i];
+    IrPassStats *stats = &pipeline->stats[i];
+
+    u32 before = live_instruction_count(chunk);
+
+    u64 start = time_now_ns();
+    b32 changed = pass->run(context, chunk);
+    stats->time_ns += time_now_ns() - start;
+
+    stats->run_count += 1;
+    stats->change_count += changed;
+    stats->instruction_delta += Cast(i64, live_instruction_count(chunk)) - Cast(i64, before);
+
+    if (!verify_timed(pipeline, context, chunk, &err->verify)) {
+      err->after_pass = pass->name;
+      return False;
+    }
+  }
+
+  return True;
+}
+
+void ir_pipeline_print_stats(FILE *out, IrPipeline *pipeline) {
+  fprintf(out, "IR passes (%u chunks):\n", pipeline->chunk_count);
+  fprintf(out, "  %-24s %8s %8s %12s %12s\n", "pass", "runs", "changed", "time (ms)", "instructions");
+
+  for (u32 i = 0; i < pipeline->pass_count; i++) {
+    IrPass const *pass = pipeline->passes[i];
+    IrPassStats *stats = &pipeline->stats[i];
+
+    fprintf(
+      out,
+      "  %-24.*s %8u %8u %12.3f %+12lld\n",
+      Cast(int, pass->name.len),
+      pass->name.str,
+      stats->run_count,
+      stats->change_count,
+      Cast(f64, stats->time_ns) / 1e6,
+      Cast(long long, stats->instruction_delta)
+    );
+  }
+
+  if (pipeline->verify) {
+    fprintf(out, "  %-24s %8s %8s %12.3f\n", "(verify)", "", "", Cast(f64, pipeline->verify_time_ns) / 1e6);
+  }
+}
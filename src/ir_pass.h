@@ -0,0 +1,86 @@
+#ifndef IR_PASS_H
+#define IR_PASS_H
+
+#include <stdio.h>
+
+#include "blu.h"
+#include "ir.h"
+#include "value.h"
+
+typedef struct {
+  Arena        *scratch;
+  TypeInterner *types;
+  ValueStore   *values;
+} IrPassContext;
+
+// -------------------------------------------------------------------------------------------------
+
+typedef struct {
+  InstructionIndex inst;
+  char const      *reason;
+} IrVerifyError;
+
+// Checks that:
+// - Blocks and functions are properly nested and functions are followed by their params.
+// - Instruction refs point to earlier instructions, value refs refer to live values, type operands
+//   are in range and branch targets are enclosing blocks. The exception is IR_declaration, which
+//   refers to the blocks that follow it.
+// - Extra payloads are aligned, do not overlap and have sensible sizes.
+b32 ir_verify(IrPassContext *context, IrChunk *chunk, IrVerifyError *err);
+
+// -------------------------------------------------------------------------------------------------
+
+// A pass transforms a chunk in place. Instructions can not be added or removed, but can be replaced
+// by IR_nop. Returns True if the chunk was changed.
+typedef b32 (*IrPassFunction)(IrPassContext *context, IrChunk *chunk);
+
+typedef struct {
+  String         name;
+  IrPassFunction run;
+} IrPass;
+
+#define IR_PIPELINE_MAX_PASSES 32
+
+// The pipeline that runs when no pipeline is specified on the command line. Only passes that keep
+// the meaning of every chunk belong here. An `as` without a destination type evaluates to its
+// value, so eliding it leaves the meaning alone.
+#define IR_DEFAULT_PIPELINE "elide-untyped-as"
+
+typedef struct {
+  u64 time_ns;
+  i64 instruction_delta; // Change in the number of instructions that are not IR_nop.
+  u32 run_count;
+  u32 change_count;
+} IrPassStats;
+
+typedef struct {
+  u32           pass_count;
+  IrPass const *passes[IR_PIPELINE_MAX_PASSES];
+  IrPassStats   stats[IR_PIPELINE_MAX_PASSES];
+
+  b32 verify; // Verify the chunks, see `ir_pipeline_run`.
+  u64 verify_time_ns;
+  u32 chunk_count;
+} IrPipeline;
+
+typedef struct {
+  IrVerifyError verify;
+  String        after_pass; // Empty if the chunk was invalid before the first pass.
+} IrPipelineError;
+
+enum IrPipelineInitResult {
+  IrPipelineInit_ok,
+  IrPipelineInit_error_unknown_pass,
+  IrPipelineInit_error_too_many_passes,
+};
+
+// `spec` is a comma separated list of pass names. An empty `spec` results in an empty pipeline.
+u32 ir_pipeline_init(IrPipeline *pipeline, String spec, b32 verify);
+
+// If the pipeline verifies, the chunk is verified before the first pass and after every pass, even
+// if there are no passes. Otherwise the passes are trusted to produce valid IR.
+b32 ir_pipeline_run(IrPipeline *pipeline, IrPassContext *context, IrChunk *chunk, IrPipelineError *err);
+
+void ir_pipeline_print_stats(FILE *out, IrPipeline *pipeline);
+
+#endif // IR_PASS_H
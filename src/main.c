@@ -1,9 +1,51 @@
 #include "toteload.h"
 #include "compiler.h"
 #include "cli_options.h"
+#include "print.h"
 
 #include <stdio.h>
 
+// The sources are polled instead of watched with an OS facility such as inotify or kqueue, which
+// would need a separate implementation per platform. Polling a handful of modification times every
+// 100 ms costs next to nothing and is quicker than anyone saves a file and looks at the output.
+#define Watch_poll_interval_ms 100
+
+// Builds and runs the program, then waits for a source file to change and does it again. The
+// compiler is kept between builds, see `compiler_reset`. It only stops when the process is killed.
+internal _Noreturn void watch(Compiler *compiler) {
+  while (True) {
+    ArenaSnapshot scope = arena_scope_begin(&compiler->scratch);
+
+    u64 start = time_now_ns();
+
+    b32 ok = compile(compiler) &&
+             (!compiler->options->emit_image.str || emit_image(compiler, compiler->options->emit_image)) &&
+             run_main(compiler);
+    if (!ok) {
+      compiler_print_all_messages(compiler);
+    }
+
+    u64 elapsed = time_now_ns() - start;
+
+    arena_scope_end(&compiler->scratch, scope);
+
+    // The process is only ever stopped from the outside, so the output of a build is flushed now.
+    fflush(stdout);
+
+    if (compiler->options->time_passes) {
+      time_passes_print(stderr, compiler, compiler->options->time_passes);
+    }
+
+    fprintf(stderr, "[watch] %s in %.1f ms, waiting for changes...\n", ok ? "Done" : "Failed", Cast(f64, elapsed) / 1e6);
+
+    while (!compiler_sources_changed(compiler)) {
+      sleep_ms(Watch_poll_interval_ms);
+    }
+
+    compiler_reset(compiler);
+  }
+}
+
 int main(int argc, char const *argv[]) {
   u32 err = 0;
   b32 ok = False;
@@ -17,20 +59,30 @@ int main(int argc, char const *argv[]) {
   Compiler compiler;
   compiler_init(&compiler, &cli);
 
-  compiler_add_sourcefile(&compiler, cli.source_filename);
+  for (u32 i = 0; i < cli.source_count; i++) {
+    compiler_add_sourcefile(&compiler, cli.source_filenames[i]);
+  }
 
-  ok = compile(&compiler);
+  if (cli.run_image.str) {
+    ok = run_image(&compiler, cli.run_image);
+  } else if (cli.watch) {
+    watch(&compiler);
+  } else {
+    ok = compile(&compiler) &&
+         (!cli.emit_image.str || emit_image(&compiler, cli.emit_image)) &&
+         run_main(&compiler);
+  }
 
   if (!ok) {
     compiler_print_all_messages(&compiler);
-    return 1;
   }
 
-  ok = run_main(&compiler);
-  if (!ok) {
-    compiler_print_all_messages(&compiler);
-    return 1;
+  if (cli.time_passes) {
+    fflush(stdout);
+    time_passes_print(stderr, &compiler, cli.time_passes);
   }
 
+  compiler_deinit(&compiler);
+
   return (ok) ? 0 : 1;
 }
@@ -52,6 +52,7 @@ internal b32 location_kind_has_line_col(u8 kind) {
 typedef struct {
   u32 line;
   u32 col;
+  u32 display_col;
   String textline;
   u32 underline_len;
 } PositionInfo;
@@ -111,18 +112,14 @@ internal PositionInfo get_position_info(Source *source, Declaration *decl, Messa
   } break;
   }
 
-  LineInfo info = tokens_find_line_info(source->text, &source->tokens, offset);
+  SourcePosition pos = position_find(&source->positions, offset);
 
-  u32 line = info.line;
-  u32 col = offset - info.offset_start_of_line + 1;
-
-  // subtract 1 from the line length to exclude the newline
-  String textline =
-    (String){.str = source->text.str + info.offset_start_of_line, .len = info.line_len - 1};
+  String textline = (String){.str = source->text.str + pos.line_start, .len = pos.line_len};
 
   return (PositionInfo){
-    .line = line,
-    .col = col,
+    .line = pos.line,
+    .col = pos.col,
+    .display_col = pos.display_col,
     .textline = textline,
     .underline_len = len,
   };
@@ -162,9 +159,10 @@ void print_message(Message *message, Source *source, Declaration *decl) {
   if (info.line) {
     printf("%5u | %.*s\n", info.line, Cast(int, info.textline.len), info.textline.str);
     // Forgive me, Father, for I have sinned.
+    // The display column lines the caret up with the text, also after tabs.
     printf(
       "      |%*c\033[32m%.*s\033[39m\n",
-      info.col,
+      info.display_col,
       ' ',
       Min(info.underline_len, 64),
       "^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^"
@@ -67,6 +67,12 @@ typedef Message* MessagePtr;
 #define Message_error(psink, ...) (psink)->add_message((psink)->user, Severity_Error, __VA_ARGS__)
 
 u32 message_format_arg_count(String fmt);
+
+// An `add_message` that drops the message. Used for work that is redone with the real sink if it
+// fails, such as the chunks of a file that is tokenized or parsed in parallel.
+internal void message_discard(void *user, u8 severity, MessageLocation location, String format, ...) {
+  Unused(user, severity, location, format);
+}
 void print_message(Message *message, Source *source, Declaration *decl);
 
 #endif // MESSAGES_H
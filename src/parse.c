@@ -83,6 +83,16 @@ typedef struct {
   AstCall      base;
 } AstCallTmp;
 
+typedef struct {
+  AstIndexList       items;
+  AstLiteralSequence base;
+} AstLiteralSequenceTmp;
+
+typedef struct {
+  AstIndexList  fields;
+  AstTypeStruct base;
+} AstTypeStructTmp;
+
 #pragma clang diagnostic pop
 
 _Static_assert(Offsetof(AstSourceTmp, items)             == 0, "List must be at offset 0.");
@@ -92,6 +102,8 @@ _Static_assert(Offsetof(AstBuiltinTmp, args)             == 0, "List must be at
 _Static_assert(Offsetof(AstTypeFunctionTmp, param_types) == 0, "List must be at offset 0.");
 _Static_assert(Offsetof(AstFunctionTmp, params)          == 0, "List must be at offset 0.");
 _Static_assert(Offsetof(AstCallTmp, args)                == 0, "List must be at offset 0.");
+_Static_assert(Offsetof(AstLiteralSequenceTmp, items)    == 0, "List must be at offset 0.");
+_Static_assert(Offsetof(AstTypeStructTmp, fields)        == 0, "List must be at offset 0.");
 
 #define Tmp_base_offset sizeof(AstIndexList)
 
@@ -101,6 +113,8 @@ _Static_assert(Offsetof(AstBlockTmp, base)        == Tmp_base_offset, "Base must
 _Static_assert(Offsetof(AstBuiltinTmp, base)      == Tmp_base_offset, "Base must be at a common offset.");
 _Static_assert(Offsetof(AstTypeFunctionTmp, base) == Tmp_base_offset, "Base must be at a common offset.");
 _Static_assert(Offsetof(AstFunctionTmp, base)     == Tmp_base_offset, "Base must be at a common offset.");
+_Static_assert(Offsetof(AstLiteralSequenceTmp, base) == Tmp_base_offset, "Base must be at a common offset.");
+_Static_assert(Offsetof(AstTypeStructTmp, base)   == Tmp_base_offset, "Base must be at a common offset.");
 
 #define Op_count (BinaryOpKind_max + AssignKind_max)
 
@@ -112,9 +126,16 @@ _Static_assert(Offsetof(AstFunctionTmp, base)     == Tmp_base_offset, "Base must
 typedef struct {
   Tokens      *tokens;
   TokenIndex   at;
+  TokenIndex   end; // The parser stops here, which is not the end of the tokens for a chunk.
 
   MessageSink *msg_sink;
 
+  b32          lazy_function_bodies;
+
+  // The index of the first node in the lists below. The nodes of a lazily parsed body are
+  // numbered after the nodes that are already in the AST.
+  AstIndex     first;
+
   KindList     kinds;
   SpanList     spans;
   TmpList      tmp;
@@ -124,7 +145,7 @@ typedef struct {
 } Parser;
 
 internal AstIndex node_alloc(Parser *parser) {
-  AstIndex idx = parser->kinds.len;
+  AstIndex idx = parser->first + parser->kinds.len;
   kindlist_append(&parser->kinds, parser->scratch, 0);
   spanlist_append(&parser->spans, parser->scratch, (SpanToken){0});
   tmplist_append(&parser->tmp, parser->scratch, Null);
@@ -132,16 +153,16 @@ internal AstIndex node_alloc(Parser *parser) {
 }
 
 internal u8 *node_kind(Parser *parser, AstIndex idx) {
-  return kindlist_ptr_at_unchecked(&parser->kinds, idx);
+  return kindlist_ptr_at_unchecked(&parser->kinds, idx - parser->first);
 }
 
 internal SpanToken *node_span(Parser *parser, AstIndex idx) {
-  return spanlist_ptr_at_unchecked(&parser->spans, idx);
+  return spanlist_ptr_at_unchecked(&parser->spans, idx - parser->first);
 }
 
 internal void *node_push_data_raw(Parser *parser, AstIndex idx, usize size, u32 align) {
   void *p = arena_push(parser->scratch, size, align);
-  *tmplist_ptr_at_unchecked(&parser->tmp, idx) = p;
+  *tmplist_ptr_at_unchecked(&parser->tmp, idx - parser->first) = p;
   return p;
 }
 
@@ -169,12 +190,12 @@ internal b32 parse_builtin_print(Parser *parser, AstIndex *out);
 
 internal b32 parse_expression_impl(Parser *parser, AstIndex *out, u32 prev_op);
 
-internal b32 is_token_index_past_end(Tokens *tokens, TokenIndex idx) {
-  return idx >= tokens->tok_count;
+internal b32 is_token_index_past_end(Parser *parser, TokenIndex idx) {
+  return idx >= parser->end;
 }
 
 internal b32 is_parser_past_end(Parser *parser) {
-  return is_token_index_past_end(parser->tokens, parser->at);
+  return is_token_index_past_end(parser, parser->at);
 }
 
 internal b32 next(Parser *parser, u8 *token_kind) {
@@ -247,7 +268,7 @@ internal b32 peek_or_error(Parser *parser, u8 *token_kind) {
 internal b32 peek2(Parser *parser, u8 *token_kind) {
   TokenIndex lookahead = parser->at + 1;
 
-  if (is_token_index_past_end(parser->tokens, lookahead)) {
+  if (is_token_index_past_end(parser, lookahead)) {
     return False;
   }
 
@@ -344,19 +365,46 @@ internal b32 parse_mod_section(Parser *parser, AstIndex *out) {
   return True;
 }
 
-internal b32 parse_builtin_debug(Parser *parser, AstIndex *out) {
+internal b32 parse_builtin(Parser *parser, AstIndex *out) {
   AstIndex   idx   = node_alloc(parser);
   TokenIndex start = parser->at;
 
-  Try(expect_token(parser, Tok_builtin_debug));
+  u8 tok;
+  next(parser, &tok);
 
   AstBuiltinTmp *builtin = node_push_data(parser, AstBuiltinTmp, idx);
   zero_struct(AstBuiltinTmp, builtin);
-  builtin->base.kind = Builtin_debug;
+
+  u32 arg_count = 1;
+
+  // clang-format off
+  switch (tok) {
+  case Tok_builtin_debug:     builtin->base.kind = Builtin_debug;     break;
+  case Tok_builtin_sum:       builtin->base.kind = Builtin_sum;       break;
+  case Tok_builtin_min:       builtin->base.kind = Builtin_min;       break;
+  case Tok_builtin_max:       builtin->base.kind = Builtin_max;       break;
+  case Tok_builtin_all:       builtin->base.kind = Builtin_all;       break;
+  case Tok_builtin_any:       builtin->base.kind = Builtin_any;       break;
+  case Tok_builtin_size_of:   builtin->base.kind = Builtin_size_of;   break;
+  case Tok_builtin_align_of:  builtin->base.kind = Builtin_align_of;  break;
+  case Tok_builtin_offset_of: builtin->base.kind = Builtin_offset_of; arg_count = 2; break;
+
+  default: { Unreachable(); } break;
+  }
+  // clang-format on
 
   Try(expect_token(parser, Tok_paren_open));
-  AstIndex *e = list_push(&builtin->args, parser->scratch);
-  Try(parse_expression(parser, e));
+  Try(parse_comma_separated_items_until(parser, &builtin->args, parse_expression, Tok_paren_close));
+
+  if (builtin->args.len != arg_count) {
+    Message_error(
+      parser->msg_sink,
+      (MessageLocation){ .kind = MessageLocation_token_index, .data.token_index = parser->at },
+      string_lit("Wrong number of arguments for builtin.")
+    );
+    return False;
+  }
+
   Try(expect_token(parser, Tok_paren_close));
 
   *node_kind(parser, idx) = Ast_builtin;
@@ -397,6 +445,129 @@ internal b32 parse_block(Parser *parser, AstIndex *out) {
   return True;
 }
 
+// `.{ a, b, c }`, `start` is the token of the dot.
+internal b32 parse_literal_sequence(Parser *parser, TokenIndex start, AstIndex *out) {
+  AstIndex idx = node_alloc(parser);
+
+  AstLiteralSequenceTmp *sequence = node_push_data(parser, AstLiteralSequenceTmp, idx);
+  zero_struct(AstLiteralSequenceTmp, sequence);
+
+  Try(expect_token(parser, Tok_brace_open));
+  Try(parse_comma_separated_items_until(parser, &sequence->items, parse_expression, Tok_brace_close));
+  Try(expect_token(parser, Tok_brace_close));
+
+  *node_kind(parser, idx) = Ast_literal_sequence;
+  *node_span(parser, idx) = (SpanToken){ .start = start, .end = parser->at, };
+
+  *out = idx;
+
+  return True;
+}
+
+// `name: type`, optionally followed by `#hot` or `#cold`.
+internal b32 parse_field(Parser *parser, AstIndex *out) {
+  AstIndex   idx   = node_alloc(parser);
+  TokenIndex start = parser->at;
+
+  AstField *field = node_push_data(parser, AstField, idx);
+  zero_struct(AstField, field);
+  field->name = parser->at;
+
+  Try(expect_token(parser, Tok_identifier));
+  Try(expect_token(parser, Tok_colon));
+  Try(parse_type(parser, &field->type));
+
+  if (consume_if_match(parser, Tok_attribute_hot)) {
+    field->attributes |= FieldAttribute_hot;
+  } else if (consume_if_match(parser, Tok_attribute_cold)) {
+    field->attributes |= FieldAttribute_cold;
+  }
+
+  *node_kind(parser, idx) = Ast_field;
+  *node_span(parser, idx) = (SpanToken){ .start = start, .end = parser->at, };
+
+  *out = idx;
+
+  return True;
+}
+
+// Whether the next tokens start a range type, which is `[-](literal|name)` followed by `..` or `..=`.
+internal b32 is_at_range(Parser *parser) {
+  Tokens    *tokens = parser->tokens;
+  TokenIndex at     = parser->at;
+
+  if (!is_token_index_past_end(parser, at) && tokens->kinds[at] == Tok_minus) {
+    at += 1;
+  }
+
+  if (is_token_index_past_end(parser, at + 1)) {
+    return False;
+  }
+
+  u8 bound = tokens->kinds[at];
+  u8 op    = tokens->kinds[at + 1];
+
+  return (bound == Tok_literal_int || bound == Tok_identifier) &&
+         (op == Tok_dot_dot || op == Tok_dot_dot_equals);
+}
+
+// A bound of a range type, which is an integer literal or a name, optionally negated.
+internal b32 parse_range_bound(Parser *parser, AstIndex *out) {
+  u8 tok;
+  Try(peek_or_error(parser, &tok));
+
+  switch (tok) {
+  case Tok_literal_int: return parse_literal_int(parser, out);
+  case Tok_identifier:  return parse_identifier(parser, out);
+  case Tok_minus: {
+    AstIndex   idx   = node_alloc(parser);
+    TokenIndex start = parser->at;
+
+    u8 ignored;
+    next(parser, &ignored);
+
+    AstUnaryOp *unary_op = node_push_data(parser, AstUnaryOp, idx);
+    unary_op->op_kind = Negate;
+
+    Try(parse_range_bound(parser, &unary_op->value));
+
+    *node_kind(parser, idx) = Ast_unary_op;
+    *node_span(parser, idx) = (SpanToken){ .start = start, .end = parser->at, };
+
+    *out = idx;
+
+    return True;
+  }
+  }
+
+  Message_error(
+    parser->msg_sink,
+    (MessageLocation){ .kind = MessageLocation_token_index, .data.token_index = parser->at },
+    string_lit("Unexpected token {tok} encountered as bound of a range."), tok
+  );
+  return False;
+}
+
+// `lo..hi` or `lo..=hi`, the span of `idx` is set by the caller.
+internal b32 parse_type_range(Parser *parser, AstIndex idx) {
+  AstTypeRange *type_range = node_push_data(parser, AstTypeRange, idx);
+  zero_struct(AstTypeRange, type_range);
+
+  Try(parse_range_bound(parser, &type_range->lo));
+
+  if (consume_if_match(parser, Tok_dot_dot_equals)) {
+    type_range->is_inclusive = True;
+  } else {
+    Try(expect_token(parser, Tok_dot_dot));
+  }
+
+  Try(parse_range_bound(parser, &type_range->hi));
+
+  *node_kind(parser, idx) = Ast_type_range;
+
+  return True;
+}
+
 internal b32 parse_type(Parser *parser, AstIndex *out) {
   u8 tok;
   Try(peek(parser, &tok));
@@ -455,7 +626,38 @@ internal b32 parse_type(Parser *parser, AstIndex *out) {
 
     *node_kind(parser, idx) = Ast_type_function;
   } break;
+  case Tok_keyword_struct: {
+    u8 ignored;
+    next(parser, &ignored);
+
+    AstTypeStructTmp *type_struct = node_push_data(parser, AstTypeStructTmp, idx);
+    zero_struct(AstTypeStructTmp, type_struct);
+
+    if (consume_if_match(parser, Tok_attribute_ordered)) {
+      type_struct->base.attributes |= StructAttribute_ordered;
+    }
+
+    Try(expect_token(parser, Tok_brace_open));
+    Try(parse_comma_separated_items_until(parser, &type_struct->fields, parse_field, Tok_brace_close));
+    Try(expect_token(parser, Tok_brace_close));
+
+    *node_kind(parser, idx) = Ast_type_struct;
+  } break;
+  case Tok_question: {
+    u8 ignored;
+    next(parser, &ignored);
+
+    AstTypeOptional *type_optional = node_push_data(parser, AstTypeOptional, idx);
+    Try(parse_type(parser, &type_optional->base));
+
+    *node_kind(parser, idx) = Ast_type_optional;
+  } break;
   case Tok_identifier: {
+    if (is_at_range(parser)) {
+      Try(parse_type_range(parser, idx));
+      break;
+    }
+
     TokenIndex identifier = parser->at;
 
     u8 ignored;
@@ -466,6 +668,10 @@ internal b32 parse_type(Parser *parser, AstIndex *out) {
 
     *node_kind(parser, idx) = Ast_identifier;
   } break;
+  case Tok_literal_int:
+  case Tok_minus: {
+    Try(parse_type_range(parser, idx));
+  } break;
   default:
     Message_error(
       parser->msg_sink,
@@ -576,6 +782,73 @@ internal b32 parse_param(Parser *parser, AstIndex *out) {
   return True;
 }
 
+// Whether an expression that ends right before a token of `kind` can not continue with it.
+internal b32 is_expression_end(u8 kind) {
+  switch (kind) {
+  case Tok_identifier:
+  case Tok_keyword_mod:
+  case Tok_comma:
+  case Tok_paren_close:
+  case Tok_bracket_close:
+  case Tok_brace_close:
+    return True;
+  default:
+    return False;
+  }
+}
+
+// Skips over a function body that is a block, up to its matching closing brace, and leaves an
+// `Ast_lazy_body` for it. Returns False without consuming anything if the body is not a block on
+// its own, e.g. when the block is the operand of an operator, or if its braces are unbalanced.
+internal b32 skip_lazy_body(Parser *parser, AstIndex *out) {
+  Tokens    *tokens = parser->tokens;
+  TokenIndex start  = parser->at;
+
+  if (is_token_index_past_end(parser, start) || tokens->kinds[start] != Tok_brace_open) {
+    return False;
+  }
+
+  u32 depth = 0;
+  for (TokenIndex i = start; i < parser->end; i++) {
+    u8 kind = tokens->kinds[i];
+
+    if (kind == Tok_brace_open) {
+      depth += 1;
+      continue;
+    }
+
+    if (kind != Tok_brace_close) {
+      continue;
+    }
+
+    depth -= 1;
+    if (depth > 0) {
+      continue;
+    }
+
+    TokenIndex end = i + 1;
+    if (!is_token_index_past_end(parser, end) && !is_expression_end(tokens->kinds[end])) {
+      return False;
+    }
+
+    AstIndex idx = node_alloc(parser);
+
+    TokenIndex *brace = node_push_data(parser, TokenIndex, idx);
+    *brace = start;
+
+    *node_kind(parser, idx) = Ast_lazy_body;
+    *node_span(parser, idx) = (SpanToken){ .start = start, .end = end, };
+
+    parser->at = end;
+
+    *out = idx;
+
+    return True;
+  }
+
+  return False;
+}
+
 internal b32 parse_function(Parser *parser, AstIndex *out) {
   AstIndex   idx   = node_alloc(parser);
   TokenIndex start = parser->at;
@@ -591,7 +864,9 @@ internal b32 parse_function(Parser *parser, AstIndex *out) {
     Try(parse_type(parser, &function->base.return_type));
   }
 
-  Try(parse_expression(parser, &function->base.body));
+  if (!(parser->lazy_function_bodies && skip_lazy_body(parser, &function->base.body))) {
+    Try(parse_expression(parser, &function->base.body));
+  }
 
   *node_kind(parser, idx) = Ast_function;
   *node_span(parser, idx) = (SpanToken){ .start = start, .end = parser->at, };
@@ -782,10 +1057,17 @@ internal b32 parse_base_expression(Parser *parser, AstIndex *out) {
   case Tok_keyword_for:      Try(parse_for(parser, &base));            break;
   case Tok_keyword_defer:    Try(parse_defer(parser, &base));          break;
   case Tok_keyword_if:       Try(parse_if_else(parser, &base));        break;
-  case Tok_literal_int:      Try(parse_literal_int(parser, &base));    break;
   case Tok_literal_string:   Try(parse_literal_string(parser, &base)); break;
   case Tok_bar:              Try(parse_function(parser, &base));       break;
-  case Tok_builtin_debug:    Try(parse_builtin_debug(parser, &base));  break;
+  case Tok_builtin_debug:
+  case Tok_builtin_sum:
+  case Tok_builtin_min:
+  case Tok_builtin_max:
+  case Tok_builtin_all:
+  case Tok_builtin_any:
+  case Tok_builtin_size_of:
+  case Tok_builtin_align_of:
+  case Tok_builtin_offset_of: Try(parse_builtin(parser, &base));       break;
   case Tok_keyword_const:    Try(parse_const(parser, &base));          break;
   case Tok_keyword_cast:     Try(parse_cast(parser, &base));           break;
   case Tok_keyword_as:       Try(parse_as(parser, &base));             break;
@@ -793,10 +1075,15 @@ internal b32 parse_base_expression(Parser *parser, AstIndex *out) {
     // clang-format on
 
   case Tok_dot: {
+    TokenIndex start = parser->at;
+
     u8 ignored;
     next(parser, &ignored);
     Try(peek(parser, &tok));
     switch (tok) {
+    case Tok_brace_open: {
+      Try(parse_literal_sequence(parser, start, &base));
+    } break;
     default:
       Message_error(
         parser->msg_sink,
@@ -807,22 +1094,39 @@ internal b32 parse_base_expression(Parser *parser, AstIndex *out) {
     }
   } break;
 
+  case Tok_literal_int: {
+    if (is_at_range(parser)) {
+      Try(parse_type(parser, &base));
+    } else {
+      Try(parse_literal_int(parser, &base));
+    }
+  } break;
+
   case Tok_identifier: {
     u8 tok2;
     if (peek2(parser, &tok2) && tok2 == Tok_colon) {
       Try(parse_declaration(parser, &base));
+    } else if (is_at_range(parser)) {
+      Try(parse_type(parser, &base));
     } else {
       Try(parse_identifier(parser, &base));
     }
   } break;
 
   case Tok_star:
-  case Tok_bracket_open: {
+  case Tok_bracket_open:
+  case Tok_keyword_struct:
+  case Tok_question: {
     Try(parse_type(parser, &base));
   } break;
 
   case Tok_exclamation:
   case Tok_minus: {
+    if (is_at_range(parser)) {
+      Try(parse_type(parser, &base));
+      break;
+    }
+
     AstIndex   ast_index = node_alloc(parser);
     TokenIndex start     = parser->at;
 
@@ -1038,7 +1342,9 @@ internal b32 has_variable_length_payload(u8 kind) {
   case Ast_source:
   case Ast_mod_section:
   case Ast_block:
+  case Ast_literal_sequence:
   case Ast_type_function:
+  case Ast_type_struct:
   case Ast_builtin:
   case Ast_call:
   case Ast_function:
@@ -1075,52 +1381,182 @@ internal void *push_data(void *base, Arena *extra, u32 *datas, AstIndex i, u32 s
   return p;
 }
 
-b32 parse(ParseContext *context, Tokens *tokens, AstNodes *ast) {
-  ArenaSnapshot scope = arena_scope_begin(context->scratch);
+// Makes room for `count` nodes in `ast`. The arrays grow by at least doubling, so that appending
+// the nodes of lazy bodies one at a time does not copy the arrays every time.
+internal void reserve_nodes(AstNodes *ast, Arena *arena, u32 count) {
+  if (count <= ast->capacity) {
+    return;
+  }
 
-  Parser parser = {
-    .tokens   = tokens,
-    .at       = 0,
-    .msg_sink = context->msg_sink,
-    .arena    = context->arena,
-    .scratch  = context->scratch,
-  };
+  u32 capacity = (ast->capacity == 0) ? count : Max(count, 2 * ast->capacity);
 
-  // Reserve the zero index
-  node_alloc(&parser);
+  u8        *kinds = arena_push_array(u8,        arena, capacity);
+  SpanToken *spans = arena_push_array(SpanToken, arena, capacity);
+  u32       *datas = arena_push_array(u32,       arena, capacity);
 
-  AstIndex root;
-  b32 ok = parse_source(&parser, &root);
+  if (ast->count > 0) {
+    memcpy(kinds, ast->kinds, ast->count * sizeof(u8));
+    memcpy(spans, ast->spans, ast->count * sizeof(SpanToken));
+    memcpy(datas, ast->datas, ast->count * sizeof(u32));
+  }
 
-  if (!ok) {
-    arena_scope_end(context->scratch, scope);
-    return False;
+  ast->capacity = capacity;
+  ast->kinds    = kinds;
+  ast->spans    = spans;
+  ast->datas    = datas;
+}
+
+#define Rebase(idx) if (idx) { idx += offset; }
+
+// Moves the node indices in the payload of a node `offset` nodes further. The zero index means
+// there is no node and stays as it is.
+internal void rebase_node(u8 kind, AstNodeData *data, u32 offset) {
+  switch (kind) {
+  case Ast_source: {
+    for (u32 i = 0; i < data->source.count; i++) { Rebase(data->source.items[i]); }
+  } break;
+  case Ast_mod_section: {
+    for (u32 i = 0; i < data->mod_section.count; i++) { Rebase(data->mod_section.items[i]); }
+  } break;
+  case Ast_block: {
+    for (u32 i = 0; i < data->block.count; i++) { Rebase(data->block.items[i]); }
+  } break;
+  case Ast_literal_sequence: {
+    for (u32 i = 0; i < data->literal_sequence.count; i++) { Rebase(data->literal_sequence.items[i]); }
+  } break;
+  case Ast_type_slice: {
+    Rebase(data->type_slice.base);
+  } break;
+  case Ast_type_array: {
+    Rebase(data->type_array.size);
+    Rebase(data->type_array.base);
+  } break;
+  case Ast_type_function: {
+    Rebase(data->type_function.return_type);
+    for (u32 i = 0; i < data->type_function.count; i++) { Rebase(data->type_function.param_types[i]); }
+  } break;
+  case Ast_type_struct: {
+    for (u32 i = 0; i < data->type_struct.count; i++) { Rebase(data->type_struct.fields[i]); }
+  } break;
+  case Ast_type_optional: {
+    Rebase(data->type_optional.base);
+  } break;
+  case Ast_type_range: {
+    Rebase(data->type_range.lo);
+    Rebase(data->type_range.hi);
+  } break;
+  case Ast_builtin: {
+    for (u32 i = 0; i < data->builtin.count; i++) { Rebase(data->builtin.args[i]); }
+  } break;
+  case Ast_declaration: {
+    Rebase(data->declaration.type);
+    Rebase(data->declaration.value);
+  } break;
+  case Ast_assign: {
+    Rebase(data->assign.lhs);
+    Rebase(data->assign.value);
+  } break;
+  case Ast_call: {
+    Rebase(data->call.callee);
+    for (u32 i = 0; i < data->call.count; i++) { Rebase(data->call.args[i]); }
+  } break;
+  case Ast_index: {
+    Rebase(data->index.indexable);
+    Rebase(data->index.index_at);
+  } break;
+  case Ast_unary_op: {
+    Rebase(data->unary_op.value);
+  } break;
+  case Ast_binary_op: {
+    Rebase(data->binary_op.lhs);
+    Rebase(data->binary_op.rhs);
+  } break;
+  case Ast_function: {
+    Rebase(data->function.return_type);
+    Rebase(data->function.body);
+    for (u32 i = 0; i < data->function.count; i++) { Rebase(data->function.params[i]); }
+  } break;
+  case Ast_param: {
+    Rebase(data->param.type);
+  } break;
+  case Ast_field: {
+    Rebase(data->field.type);
+  } break;
+  case Ast_if_else: {
+    Rebase(data->if_else.cond);
+    Rebase(data->if_else.then);
+    Rebase(data->if_else.otherwise);
+  } break;
+  case Ast_for: {
+    Rebase(data->for_.iterable);
+    Rebase(data->for_.iterator);
+    Rebase(data->for_.body);
+  } break;
+  case Ast_defer: {
+    Rebase(data->defer.value);
+  } break;
+  case Ast_const: {
+    Rebase(data->const_.expr);
+  } break;
+  case Ast_cast: {
+    Rebase(data->cast.type_dst);
+    Rebase(data->cast.value);
+  } break;
+  case Ast_as: {
+    Rebase(data->as.type_dst);
+    Rebase(data->as.value);
+  } break;
+  case Ast_literal_int:
+  case Ast_literal_string:
+  case Ast_identifier:
+  case Ast_lazy_body:
+    break;
   }
+}
+
+#undef Rebase
+
+// Appends the nodes of `parser` to `ast`, with their payloads in the final layout. The nodes of
+// a parser that did not number them from `ast->count` are rebased.
+internal void append_nodes(Parser *parser, Arena *arena, AstNodes *ast) {
+  u32 first = ast->count;
+  u32 count = Cast(u32, parser->kinds.len);
 
-  u32 count = Cast(u32, parser.kinds.len);
+  Assert(parser->first <= first);
+  u32 offset = first - parser->first;
 
-  u8        *kinds = arena_push_array(u8,        context->arena, count);
-  SpanToken *spans = arena_push_array(SpanToken, context->arena, count);
-  u32       *datas = arena_push_array(u32,       context->arena, count);
+  reserve_nodes(ast, arena, first + count);
 
-  kindlist_copy_to_array(&parser.kinds, kinds);
-  spanlist_copy_to_array(&parser.spans, spans);
+  kindlist_copy_to_array(&parser->kinds, ast->kinds + first);
+  spanlist_copy_to_array(&parser->spans, ast->spans + first);
 
-  void *extra = context->arena->at;
+  if (!ast->extra) {
+    ast->extra = arena_push(arena, 0, AST_EXTRA_ALIGN);
+  }
+
+  void *extra = ast->extra;
+  u32  *datas = ast->datas;
+
+  for (u32 j = 0; j < count; j++) {
+    AstIndex i = first + j;
+
+    // The zero index is reserved and has no payload.
+    if (i == 0) {
+      continue;
+    }
 
-  for (AstIndex i = 1; i < count; i++) {
-    u8 kind = kinds[i];
+    u8 kind = ast->kinds[i];
     u32 size = base_payload_size(kind);
     u32 align = payload_align(kind);
-    void *payload = tmplist_at_unchecked(&parser.tmp, i);
+    void *payload = tmplist_at_unchecked(&parser->tmp, j);
 
     if (!has_variable_length_payload(kind)) {
-      void *mem = push_data(extra, context->arena, datas, i, size, align);
+      void *mem = push_data(extra, arena, datas, i, size, align);
       memcpy(mem, payload, size);
     } else {
       AstIndexList *list = payload;
       u32 n = list->len;
-      void *mem = push_data(extra, context->arena, datas, i, size + n * sizeof(AstIndex), align);
+      void *mem = push_data(extra, arena, datas, i, size + n * sizeof(AstIndex), align);
       void *base = ptr_offset(payload, Tmp_base_offset);
       memcpy(mem, base, size);
       // TODO: change the way the count pointer is computed, because this feels a bit fragile.
@@ -1130,16 +1566,309 @@ b32 parse(ParseContext *context, Tokens *tokens, AstNodes *ast) {
       *count = n;
       list_copy_to_array(list, ptr_offset(mem, size));
     }
+
+    if (offset != 0) {
+      rebase_node(kind, ptr_offset(extra, datas[i]), offset);
+    }
+  }
+
+  ast->count      = first + count;
+  ast->extra_size = Cast(u32, ptr_diff(arena->at, ast->extra));
+}
+
+internal usize parse_scratch_size(u32 tok_count) {
+  return MiB(1) + Cast(usize, tok_count) * PARSE_SCRATCH_BYTES_PER_TOKEN;
+}
+
+// Returns a scratch arena with room to parse `tok_count` tokens. That is the scratch arena of the
+// context if enough of it is left, which is not the case for a large source. Otherwise `own` is
+// initialized and returned. Release it with `parse_scratch_end`.
+internal Arena *parse_scratch_begin(ParseContext *context, u32 tok_count, Arena *own) {
+  usize size = parse_scratch_size(tok_count);
+
+  Arena *scratch = context->scratch;
+  if (Cast(usize, ptr_diff(scratch->reserve_end, scratch->at)) >= size) {
+    return scratch;
+  }
+
+  arena_init(own, &(ArenaOptions){
+    .reserve_size        = size,
+    .initial_commit_size = MiB(1),
+  });
+
+  return own;
+}
+
+internal void parse_scratch_end(ParseContext *context, Arena *scratch, ArenaSnapshot scope) {
+  if (scratch == context->scratch) {
+    arena_scope_end(scratch, scope);
+  } else {
+    context->scratch_peak = Max(context->scratch_peak, arena_peak_size(scratch));
+    arena_deinit(scratch);
+  }
+}
+
+b32 parse(ParseContext *context, Tokens *tokens, AstNodes *ast) {
+  Arena  own;
+  Arena *scratch = parse_scratch_begin(context, tokens->tok_count, &own);
+
+  ArenaSnapshot scope = arena_scope_begin(scratch);
+
+  Parser parser = {
+    .tokens   = tokens,
+    .at       = 0,
+    .end      = tokens->tok_count,
+    .msg_sink = context->msg_sink,
+    .arena    = context->arena,
+    .scratch  = scratch,
+
+    .lazy_function_bodies = context->lazy_function_bodies,
+  };
+
+  // Reserve the zero index
+  node_alloc(&parser);
+
+  AstIndex root;
+  b32 ok = parse_source(&parser, &root);
+
+  if (ok) {
+    *ast = (AstNodes){0};
+    append_nodes(&parser, context->arena, ast);
+  }
+
+  parse_scratch_end(context, scratch, scope);
+
+  return ok;
+}
+
+// Parses the mod sections from `start` with the message sink of the context until one fails, to
+// report the error of a chunk that failed. The sections before `start` were parsed without error,
+// and parsing goes on past the end of the chunk, so the messages are the same as those of `parse`.
+internal void parse_to_error(ParseContext *context, Tokens *tokens, TokenIndex start) {
+  Arena  own;
+  Arena *scratch = parse_scratch_begin(context, tokens->tok_count - start, &own);
+
+  ArenaSnapshot scope = arena_scope_begin(scratch);
+
+  Parser parser = {
+    .tokens   = tokens,
+    .at       = start,
+    .end      = tokens->tok_count,
+    .msg_sink = context->msg_sink,
+    .arena    = context->arena,
+    .scratch  = scratch,
+    .first    = 1,
+
+    .lazy_function_bodies = context->lazy_function_bodies,
+  };
+
+  while (!is_parser_past_end(&parser)) {
+    AstIndex section;
+    if (!parse_mod_section(&parser, &section)) {
+      break;
+    }
+  }
+
+  parse_scratch_end(context, scratch, scope);
+}
+
+typedef struct {
+  ParseContext *context;
+  Tokens       *tokens;
+  Arena       **scratches; // One per worker.
+
+  // A chunk that fails is parsed again with the message sink of the context, see `parse_to_error`.
+  MessageSink   discard;
+
+  u32           chunk_count;
+  TokenIndex    starts[PARSE_MAX_CHUNKS + 1];
+  Parser        parsers[PARSE_MAX_CHUNKS];
+  AstIndexList  sections[PARSE_MAX_CHUNKS];
+  b32           ok[PARSE_MAX_CHUNKS];
+} ParseChunks;
+
+internal void parse_chunk(void *context, u32 worker, u32 index) {
+  ParseChunks *job = context;
+
+  Parser *parser = &job->parsers[index];
+  *parser = (Parser){
+    .tokens   = job->tokens,
+    .at       = job->starts[index],
+    .end      = job->starts[index + 1],
+    .msg_sink = &job->discard,
+    .arena    = job->context->arena,
+    .scratch  = job->scratches[worker],
+    .first    = 1,
+
+    .lazy_function_bodies = job->context->lazy_function_bodies,
+  };
+
+  AstIndexList *sections = &job->sections[index];
+  *sections = (AstIndexList){0};
+
+  job->ok[index] = True;
+  while (!is_parser_past_end(parser)) {
+    AstIndex *section = list_push(sections, parser->scratch);
+    if (!parse_mod_section(parser, section)) {
+      job->ok[index] = False;
+      return;
+    }
+  }
+}
+
+b32 parse_parallel(ParseContext *context, Tokens *tokens, u32 thread_count, AstNodes *ast) {
+  if (thread_count <= 1) {
+    return parse(context, tokens, ast);
+  }
+
+  u32 max_chunks = Min(2 * thread_count, PARSE_MAX_CHUNKS);
+  u32 size       = Max(tokens->tok_count / max_chunks, PARSE_MIN_CHUNK_TOKENS);
+
+  if (tokens->tok_count < 2 * size) {
+    return parse(context, tokens, ast);
+  }
+
+  // The job and the nodes of the chunks live in the scratch arena until they are joined.
+  ArenaSnapshot scope = arena_scope_begin(context->scratch);
+
+  ParseChunks *job = arena_push_one(ParseChunks, context->scratch);
+  zero_struct(ParseChunks, job);
+
+  job->context = context;
+  job->tokens  = tokens;
+  job->discard = (MessageSink){ .add_message = message_discard, };
+
+  // Every chunk but the first starts at a `mod` keyword, which can only start a mod section.
+  job->starts[0]   = 0;
+  job->chunk_count = 1;
+  for (u32 target = size; target < tokens->tok_count && job->chunk_count < max_chunks;) {
+    u8 *mod = memchr(tokens->kinds + target, Tok_keyword_mod, tokens->tok_count - target);
+    if (!mod) {
+      break;
+    }
+
+    TokenIndex start = Cast(TokenIndex, mod - tokens->kinds);
+    job->starts[job->chunk_count++] = start;
+    target = start + size;
+  }
+  job->starts[job->chunk_count] = tokens->tok_count;
+
+  u32 worker_count = Min(thread_count, job->chunk_count);
+
+  // The nodes of every chunk that a worker parses stay in its scratch arena until they are joined.
+  // Any worker may end up parsing most of the chunks, so every one has room for all of the tokens.
+  Arena  arenas[PARSE_MAX_CHUNKS];
+  Arena *scratches[PARSE_MAX_CHUNKS];
+  scratches[0] = parse_scratch_begin(context, tokens->tok_count, &arenas[0]);
+  for (u32 i = 1; i < worker_count; i++) {
+    arena_init(&arenas[i], &(ArenaOptions){
+      .reserve_size        = parse_scratch_size(tokens->tok_count),
+      .initial_commit_size = MiB(1),
+    });
+    scratches[i] = &arenas[i];
+  }
+  job->scratches = scratches;
+
+  parallel_for(worker_count, job->chunk_count, parse_chunk, job);
+
+  b32        ok     = True;
+  TokenIndex failed = 0;
+  for (u32 i = 0; ok && i < job->chunk_count; i++) {
+    ok     = job->ok[i];
+    failed = job->starts[i];
+  }
+
+  if (ok) {
+    // The root parser only has the reserved zero index and the source node. The nodes of every
+    // chunk follow, in order, so the source refers to its sections by where they end up.
+    Parser root = {
+      .tokens  = tokens,
+      .arena   = context->arena,
+      .scratch = context->scratch,
+    };
+
+    node_alloc(&root);
+    AstIndex idx = node_alloc(&root);
+
+    AstSourceTmp *source = node_push_data(&root, AstSourceTmp, idx);
+    zero_struct(AstSourceTmp, source);
+
+    u32 base = 2;
+    for (u32 i = 0; i < job->chunk_count; i++) {
+      AstIndexList *sections = &job->sections[i];
+      for (u32 j = 0; j < sections->len; j++) {
+        *list_push(&source->items, root.scratch) = list_at_unchecked(sections, j) + base - 1;
+      }
+
+      base += Cast(u32, job->parsers[i].kinds.len);
+    }
+
+    *node_kind(&root, idx) = Ast_source;
+    *node_span(&root, idx) = (SpanToken){ .start = 0, .end = tokens->tok_count, };
+
+    *ast = (AstNodes){0};
+    reserve_nodes(ast, context->arena, base);
+
+    append_nodes(&root, context->arena, ast);
+    for (u32 i = 0; i < job->chunk_count; i++) {
+      append_nodes(&job->parsers[i], context->arena, ast);
+    }
+
+    Assert(ast->count == base);
+  }
+
+  for (u32 i = 0; i < worker_count; i++) {
+    if (scratches[i] != context->scratch) {
+      context->scratch_peak = Max(context->scratch_peak, arena_peak_size(scratches[i]));
+      arena_deinit(scratches[i]);
+    }
+  }
+
+  arena_scope_end(context->scratch, scope);
+
+  if (!ok) {
+    parse_to_error(context, tokens, failed);
   }
 
-  *ast = (AstNodes){
-    .count = count,
-    .kinds = kinds,
-    .spans = spans,
-    .datas = datas,
-    .extra = extra,
+  return ok;
+}
+
+b32 parse_function_body(ParseContext *context, Tokens *tokens, AstNodes *ast, AstIndex function) {
+  Assert(ast->kinds[function] == Ast_function);
+
+  AstFunction *func = ast_data(ast, function);
+  AstIndex     lazy = func->body;
+
+  Assert(ast->kinds[lazy] == Ast_lazy_body);
+
+  SpanToken span = ast->spans[lazy];
+
+  ArenaSnapshot scope = arena_scope_begin(context->scratch);
+
+  Parser parser = {
+    .tokens   = tokens,
+    .at       = span.start,
+    .end      = span.end,
+    .msg_sink = context->msg_sink,
+    .arena    = context->arena,
+    .scratch  = context->scratch,
+    .first    = ast->count,
+
+    .lazy_function_bodies = context->lazy_function_bodies,
   };
 
+  AstIndex body;
+  b32 ok = parse_block(&parser, &body);
+
+  if (ok) {
+    Assert(parser.at == span.end);
+
+    append_nodes(&parser, context->arena, ast);
+
+    // The payloads are not moved by appending, so `func` still points at the function.
+    func->body = body;
+  }
+
   arena_scope_end(context->scratch, scope);
 
   return ok;
@@ -1,5 +1,4 @@
 #include <string.h>
-#include <inttypes.h>
 
 #include "blu.h"
 #include "types.h"
@@ -8,6 +7,8 @@
 #include "compiler.h"
 #include "source_file.h"
 #include "print.h"
+#include "integer.h"
+#include "ast.h"
 
 static char const *ir_opcode_names[] = {
 #define X(k, e, d, name) [k] = name,
@@ -15,13 +16,18 @@ static char const *ir_opcode_names[] = {
 #undef X
 };
 
-void type_index_print(FILE *out, TypeInterner *types, TypeIndex idx) {
+internal void string_print(FILE *out, Compiler *compiler, StringIndex idx) {
+  String s = strings_get(&compiler->strings, idx);
+  fprintf(out, "%.*s", Cast(int, s.len), s.str);
+}
+
+void type_index_print(FILE *out, Compiler *compiler, TypeIndex idx) {
   if (idx == 0) {
     fputc('?', out);
     return;
   }
 
-  Type *type = types_get(types, idx);
+  Type *type = types_get(&compiler->types, idx);
   switch (Cast(TypeKind, type->kind)) {
   case Type_comptime_int: {
     fputs("comptime_int", out);
@@ -38,10 +44,10 @@ void type_index_print(FILE *out, TypeInterner *types, TypeIndex idx) {
       if (i != 0) {
         fputs(", ", out);
       }
-      type_index_print(out, types, type->data.function.param_types[i]);
+      type_index_print(out, compiler, type->data.function.param_types[i]);
     }
     fputs(") ", out);
-    type_index_print(out, types, type->data.function.return_type);
+    type_index_print(out, compiler, type->data.function.return_type);
   } break;
   case Type_nil: {
     fputs("nil", out);
@@ -51,11 +57,31 @@ void type_index_print(FILE *out, TypeInterner *types, TypeIndex idx) {
   } break;
   case Type_slice: {
     fputs("[]", out);
-    type_index_print(out, types, type->data.slice.base_type);
+    type_index_print(out, compiler, type->data.slice.base_type);
   } break;
   case Type_array: {
     fprintf(out, "[%llu]", Cast(unsigned long long, type->data.array.size));
-    type_index_print(out, types, type->data.array.base_type);
+    type_index_print(out, compiler, type->data.array.base_type);
+  } break;
+  case Type_optional: {
+    fputc('?', out);
+    type_index_print(out, compiler, type->data.optional.base_type);
+  } break;
+  case Type_range: {
+    fprintf(out, "%lld..=%lld", Cast(long long, type->data.range.min), Cast(long long, type->data.range.max));
+  } break;
+  case Type_struct: {
+    fputs(type->data.struct_.is_ordered ? "struct #ordered {" : "struct {", out);
+    for (u32 i = 0; i < type->data.struct_.field_count; i++) {
+      TypeStructField *field = &type->data.struct_.fields[i];
+      fputs(i != 0 ? ", " : " ", out);
+      string_print(out, compiler, field->name);
+      fputs(": ", out);
+      type_index_print(out, compiler, field->type);
+      if (field->placement == FieldPlacement_hot)  { fputs(" #hot", out);  }
+      if (field->placement == FieldPlacement_cold) { fputs(" #cold", out); }
+    }
+    fputs(" }", out);
   } break;
   case Type_type: {
     fputs("type", out);
@@ -63,57 +89,79 @@ void type_index_print(FILE *out, TypeInterner *types, TypeIndex idx) {
   }
 }
 
-internal i64 read_signed(u16 bitwidth, void *data) {
-  i64 res = 0;
-  switch (bitwidth) {
-  case  8: { i8  x; memcpy(&x, data, 1); res = x; } break;
-  case 16: { i16 x; memcpy(&x, data, 2); res = x; } break;
-  case 32: { i32 x; memcpy(&x, data, 4); res = x; } break;
-  case 64: { i64 x; memcpy(&x, data, 8); res = x; } break;
-  }
-  return res;
-}
-
-internal u64 read_unsigned(u16 bitwidth, void *data) {
-  u64 res = 0;
-  memcpy(&res, data, bitwidth / 8);
-  return res;
-}
-
-void value_print(FILE *out, Compiler *compiler, ValueIndex idx) {
-  Value *value = values_get(&compiler->values, idx);
-  Type  *type  = types_get(&compiler->types, value->type);
+// `idx` is the value that `data` is part of, values without a readable form are printed as it.
+internal void payload_print(FILE *out, Compiler *compiler, ValueIndex idx, TypeIndex type_idx, void *data) {
+  Type *type = types_get(&compiler->types, type_idx);
   switch (Cast(TypeKind, type->kind)) {
   case Type_comptime_int: {
-    fprintf(out, "%lld", Cast(long long, read_signed(64, value->data)));
+    ComptimeInt x;
+    memcpy(&x, data, sizeof(ComptimeInt));
+    fprintf(out, "%lld", Cast(long long, x));
   } break;
   case Type_integer: {
-    if (type->data.integer.signedness == Signed) {
-      fprintf(out, "%" PRId64, Cast(i64, read_signed(type->data.integer.bitwidth, value->data)));
-    } else {
-      fprintf(out, "%" PRIu64, Cast(u64, read_unsigned(type->data.integer.bitwidth, value->data)));
-    }
+    int_print(out, type->data.integer, data);
+  } break;
+  case Type_range: {
+    int_print(out, types_range_storage(type->data.range), data);
   } break;
   case Type_bool: {
-    fputs((*Cast(u8 *, value->data)) ? "true" : "false", out);
+    fputs((*Cast(u8 *, data)) ? "true" : "false", out);
   } break;
   case Type_type: {
-    type_index_print(out, &compiler->types, *Cast(TypeIndex *, value->data));
+    type_index_print(out, compiler, *Cast(TypeIndex *, data));
   } break;
   case Type_function: {
-    ValueFunc *func = value->data;
+    ValueFunc *func = data;
     fputs("\n", out);
     ir_chunk_print(out, compiler, &func->chunk);
   } break;
+  case Type_array: {
+    TypeIndex base_type = type->data.array.base_type;
+    u32 stride = types_size_info_by_index(&compiler->types, base_type).stride;
+
+    fputs(".{", out);
+    for (u64 i = 0; i < type->data.array.size; i++) {
+      if (i != 0) {
+        fputs(", ", out);
+      }
+      payload_print(out, compiler, idx, base_type, ptr_offset(data, i * stride));
+    }
+    fputs("}", out);
+  } break;
+  case Type_optional: {
+    OptionalLayout layout = types_optional_layout(&compiler->types, type);
+    if (optional_is_some(layout, data)) {
+      payload_print(out, compiler, idx, type->data.optional.base_type, data);
+    } else {
+      fputs("nil", out);
+    }
+  } break;
+  case Type_struct: {
+    fputs(".{", out);
+    for (u32 i = 0; i < type->data.struct_.field_count; i++) {
+      TypeStructField *field = &type->data.struct_.fields[i];
+      if (i != 0) {
+        fputs(", ", out);
+      }
+      string_print(out, compiler, field->name);
+      fputs(" = ", out);
+      payload_print(out, compiler, idx, field->type, ptr_offset(data, field->offset));
+    }
+    fputs("}", out);
+  } break;
   case Type_nil:
   case Type_never:
-  case Type_slice:
-  case Type_array: {
-    fprintf(out, "$%u", idx);
+  case Type_slice: {
+    fprintf(out, "$%u", value_index_slot(idx));
   } break;
   }
 }
 
+void value_print(FILE *out, Compiler *compiler, ValueIndex idx) {
+  Value *value = values_get(&compiler->values, idx);
+  payload_print(out, compiler, idx, value->type, value_data(value));
+}
+
 internal void ir_ref_print(FILE *out, Compiler *compiler, IrRef ref) {
   if (ref_is_nil(ref)) {
     fprintf(out, "_");
@@ -137,12 +185,56 @@ internal char const* typekind_string(u8 kind) {
   case Type_never:        return "never";
   case Type_slice:        return "slice";
   case Type_array:        return "array";
+  case Type_struct:       return "struct";
+  case Type_optional:     return "optional";
+  case Type_range:        return "range";
   case Type_type:         return "type";
   }
 
   return "<invalid>";
 }
 
+internal char const *binary_op_string(u8 op) {
+  switch (op) {
+  case Mul:               return "*";
+  case Div:               return "/";
+  case Mod:               return "%";
+  case Sub:               return "-";
+  case Add:               return "+";
+  case Bit_shift_left:    return "<<";
+  case Bit_shift_right:   return ">>";
+  case Bit_and:           return "&";
+  case Bit_or:            return "|";
+  case Bit_xor:           return "^";
+  case Cmp_equal:         return "==";
+  case Cmp_not_equal:     return "!=";
+  case Cmp_greater_than:  return ">";
+  case Cmp_greater_equal: return ">=";
+  case Cmp_less_than:     return "<";
+  case Cmp_less_equal:    return "<=";
+  case Logical_and:       return "and";
+  case Logical_or:        return "or";
+  }
+
+  return "<invalid>";
+}
+
+internal char const *builtin_string(u8 builtin) {
+  switch (Cast(BuiltinKind, builtin)) {
+  case Builtin_debug: return "#debug";
+  case Builtin_sum:   return "#sum";
+  case Builtin_min:   return "#min";
+  case Builtin_max:   return "#max";
+  case Builtin_all:   return "#all";
+  case Builtin_any:   return "#any";
+  case Builtin_size_of:   return "#size_of";
+  case Builtin_align_of:  return "#align_of";
+  case Builtin_offset_of: return "#offset_of";
+  }
+
+  return "<invalid>";
+}
+
 typedef struct {
   u32 count;
   u32 at;
@@ -194,7 +286,7 @@ void ir_chunk_print(FILE *out, Compiler *compiler, IrChunk *chunk) {
       stack_push(&blocks, ((BlockPrint){ .count = func->instruction_count - 1, .at = 0 }));
     } break;
     case IR_alloc: {
-      type_index_print(out, &compiler->types, data);
+      type_index_print(out, compiler, data);
     } break;
     case IR_condbr: {
       IrCondBr *cond_br = extra;
@@ -237,7 +329,12 @@ void ir_chunk_print(FILE *out, Compiler *compiler, IrChunk *chunk) {
     } break;
     case IR_call: {
       IrCall *call = extra;
-      fprintf(out, "$%u", ref_to_u32(call->func));
+      // Function values are printed as their index, printing the entire function would be too noisy.
+      if (ref_is_instruction_index(call->func)) {
+        fprintf(out, "%%%u", ref_to_instruction_index(call->func));
+      } else {
+        fprintf(out, "$%u", value_index_slot(ref_to_value_index(call->func)));
+      }
       if (call->arg_count) {
         fputs(" ", out);
       }
@@ -271,6 +368,53 @@ void ir_chunk_print(FILE *out, Compiler *compiler, IrChunk *chunk) {
       fputs(" ", out);
       ir_ref_print(out, compiler, unify->type_rhs);
     } break;
+    case IR_builtin_reduce: {
+      IrReduce *reduce = extra;
+      fprintf(out, "%s ", builtin_string(reduce->builtin));
+      ir_ref_print(out, compiler, reduce->value);
+    } break;
+    case IR_builtin_layout: {
+      IrLayout *layout = extra;
+      fprintf(out, "%s ", builtin_string(layout->builtin));
+      ir_ref_print(out, compiler, layout->type);
+      if (layout->builtin == Builtin_offset_of) {
+        fputs(" ", out);
+        string_print(out, compiler, layout->field);
+      }
+    } break;
+    case IR_type_struct: {
+      IrTypeStruct *type_struct = extra;
+      fputs(type_struct->is_ordered ? "#ordered {" : "{", out);
+      for (u32 j = 0; j < type_struct->field_count; j++) {
+        IrStructField *field = &type_struct->fields[j];
+        fputs(j != 0 ? ", " : " ", out);
+        string_print(out, compiler, field->name);
+        fputs(": ", out);
+        ir_ref_print(out, compiler, field->type);
+        if (field->placement == FieldPlacement_hot)  { fputs(" #hot", out);  }
+        if (field->placement == FieldPlacement_cold) { fputs(" #cold", out); }
+      }
+      fputs(" }", out);
+    } break;
+    case IR_sequence: {
+      IrSequence *sequence = extra;
+      ir_ref_print(out, compiler, sequence->type);
+      fputs(" .{", out);
+      for (u32 j = 0; j < sequence->count; j++) {
+        if (j != 0) {
+          fputs(", ", out);
+        }
+        ir_ref_print(out, compiler, sequence->items[j]);
+      }
+      fputs("}", out);
+    } break;
+    case IR_binary_op: {
+      IrBinaryOp *binary_op = extra;
+      fprintf(out, "%s ", binary_op_string(binary_op->op));
+      ir_ref_print(out, compiler, binary_op->lhs);
+      fputs(" ", out);
+      ir_ref_print(out, compiler, binary_op->rhs);
+    } break;
     case IR_type: {
       IrType *type = extra;
       fprintf(out, "%s ", typekind_string(type->kind));
@@ -358,3 +502,191 @@ void print_ast_nodes(AstNodes *nodes, Tokens *tokens, String source) {
     printf("%.*s\n", Cast(int, kind_string.len), kind_string.str);
   }
 }
+
+internal char const *compile_phase_names[] = {
+  [CompilePhase_frontend]     = "frontend",
+  [CompilePhase_declarations] = "declarations",
+  [CompilePhase_codegen]      = "codegen",
+  [CompilePhase_resolve]      = "resolve",
+  [CompilePhase_optimize]     = "optimize",
+  [CompilePhase_run]          = "run",
+};
+
+internal char const *source_phase_names[] = {
+  [SourcePhase_read]        = "read",
+  [SourcePhase_cache_load]  = "cache load",
+  [SourcePhase_tokenize]    = "tokenize",
+  [SourcePhase_parse]       = "parse",
+  [SourcePhase_cache_store] = "cache store",
+  [SourcePhase_index]       = "index",
+};
+
+internal void json_string_print(FILE *out, String s) {
+  fputc('"', out);
+
+  for (usize i = 0; i < s.len; i++) {
+    u8 c = s.str[i];
+    if (c == '"' || c == '\\') {
+      fprintf(out, "\\%c", c);
+    } else if (c < 0x20) {
+      fprintf(out, "\\u%04x", c);
+    } else {
+      fputc(c, out);
+    }
+  }
+
+  fputc('"', out);
+}
+
+internal void json_phases_print(FILE *out, PhaseTime *times, char const **names, u32 count) {
+  fputc('[', out);
+
+  for (u32 i = 0; i < count; i++) {
+    fprintf(
+      out,
+      "%s{\"name\":\"%s\",\"wall_ns\":%llu,\"cpu_ns\":%llu}",
+      i == 0 ? "" : ",",
+      names[i],
+      Cast(unsigned long long, times[i].wall_ns),
+      Cast(unsigned long long, times[i].cpu_ns)
+    );
+  }
+
+  fputc(']', out);
+}
+
+// `width` is that of the name column, including the indent of the table itself.
+internal void text_phases_print(FILE *out, PhaseTime *times, char const **names, u32 count, int indent, int width) {
+  for (u32 i = 0; i < count; i++) {
+    fprintf(
+      out,
+      "%*s%-*s %12.3f %12.3f\n",
+      indent, "",
+      width - indent + 2, names[i],
+      Cast(f64, times[i].wall_ns) / 1e6,
+      Cast(f64, times[i].cpu_ns) / 1e6
+    );
+  }
+}
+
+internal void json_arena_print(FILE *out, Arena *arena) {
+  fprintf(
+    out,
+    "{\"used_bytes\":%llu,\"peak_bytes\":%llu,\"committed_bytes\":%llu}",
+    Cast(unsigned long long, arena_used_size(arena)),
+    Cast(unsigned long long, arena_peak_size(arena)),
+    Cast(unsigned long long, arena_committed_size(arena))
+  );
+}
+
+internal void text_arena_print(FILE *out, String name, Arena *arena, int width) {
+  fprintf(
+    out,
+    "  %-*.*s %12llu %12llu %12llu\n",
+    width,
+    Cast(int, name.len),
+    name.str,
+    Cast(unsigned long long, arena_used_size(arena) / KiB(1)),
+    Cast(unsigned long long, arena_peak_size(arena) / KiB(1)),
+    Cast(unsigned long long, arena_committed_size(arena) / KiB(1))
+  );
+}
+
+// Prints a row for memory that is not an arena of its own, with only the column of `size` filled in.
+// `column` is 0 for used, 1 for peak and 2 for committed.
+internal void text_size_print(FILE *out, String name, usize size, u32 column, int indent, int width) {
+  char const *columns[3] = { "-", "-", "-" };
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%llu", Cast(unsigned long long, size / KiB(1)));
+  columns[column] = buffer;
+
+  fprintf(
+    out,
+    "%*s%-*.*s %12s %12s %12s\n",
+    indent, "",
+    width - indent + 2,
+    Cast(int, name.len),
+    name.str,
+    columns[0],
+    columns[1],
+    columns[2]
+  );
+}
+
+void time_passes_print(FILE *out, Compiler *compiler, u32 format) {
+  if (format == TimePasses_json) {
+    fputs("{\"phases\":", out);
+    json_phases_print(out, compiler->phase_times, compile_phase_names, CompilePhase_count);
+
+    fputs(",\"sources\":[", out);
+    for (u32 i = 1; i < compiler->sources.len; i++) {
+      Source *source = compiler_get_source(compiler, i);
+
+      fprintf(out, "%s{\"filename\":", i == 1 ? "" : ",");
+      json_string_print(out, source->filename);
+      fputs(",\"phases\":", out);
+      json_phases_print(out, source->times, source_phase_names, SourcePhase_count);
+      fputs(",\"arena\":", out);
+      json_arena_print(out, &source->arena);
+      fprintf(
+        out,
+        ",\"tokens_committed_bytes\":%llu,\"parse_scratch_peak_bytes\":%llu}",
+        Cast(unsigned long long, source->tokens.committed),
+        Cast(unsigned long long, source->parse_scratch_peak)
+      );
+    }
+
+    fputs("],\"compiler_arena\":", out);
+    json_arena_print(out, &compiler->arena);
+    fputs(",\"compiler_build\":", out);
+    json_arena_print(out, &compiler->build);
+    fputs(",\"compiler_scratch\":", out);
+    json_arena_print(out, &compiler->scratch);
+    fprintf(
+      out,
+      ",\"frontend_scratch_peak_bytes\":%llu}\n",
+      Cast(unsigned long long, compiler->frontend_scratch_peak)
+    );
+
+    return;
+  }
+
+  // The names are padded to line up the columns, unless a filename is longer than that.
+  int width = 24;
+  for (u32 i = 1; i < compiler->sources.len; i++) {
+    width = Max(width, Cast(int, compiler_get_source(compiler, i)->filename.len));
+  }
+
+  fprintf(out, "Passes:\n");
+  fprintf(out, "  %-*s %12s %12s\n", width, "phase", "wall (ms)", "cpu (ms)");
+
+  PhaseTime total = {0};
+  for (u32 i = 0; i < CompilePhase_count; i++) {
+    total.wall_ns += compiler->phase_times[i].wall_ns;
+    total.cpu_ns  += compiler->phase_times[i].cpu_ns;
+  }
+
+  text_phases_print(out, compiler->phase_times, compile_phase_names, CompilePhase_count, 2, width);
+  text_phases_print(out, &total, (char const *[]){ "(total)" }, 1, 2, width);
+
+  for (u32 i = 1; i < compiler->sources.len; i++) {
+    Source *source = compiler_get_source(compiler, i);
+
+    fprintf(out, "  %.*s\n", Cast(int, source->filename.len), source->filename.str);
+    text_phases_print(out, source->times, source_phase_names, SourcePhase_count, 4, width);
+  }
+
+  fprintf(out, "Memory (KiB):\n");
+  fprintf(out, "  %-*s %12s %12s %12s\n", width, "arena", "used", "peak", "committed");
+  text_arena_print(out, string_lit("compiler"), &compiler->arena, width);
+  text_arena_print(out, string_lit("compiler build"), &compiler->build, width);
+  text_arena_print(out, string_lit("compiler scratch"), &compiler->scratch, width);
+  text_size_print(out, string_lit("frontend scratch"), compiler->frontend_scratch_peak, 1, 2, width);
+
+  for (u32 i = 1; i < compiler->sources.len; i++) {
+    Source *source = compiler_get_source(compiler, i);
+    text_arena_print(out, source->filename, &source->arena, width);
+    text_size_print(out, string_lit("tokens"), source->tokens.committed, 2, 4, width);
+    text_size_print(out, string_lit("parse scratch"), source->parse_scratch_peak, 1, 4, width);
+  }
+}
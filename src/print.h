@@ -7,9 +7,13 @@
 #include "ast.h"
 
 void ir_chunk_print(FILE *out, Compiler *compiler, IrChunk *chunk);
-void type_index_print(FILE *out, TypeInterner *types, TypeIndex idx);
+void type_index_print(FILE *out, Compiler *compiler, TypeIndex idx);
 void value_print(FILE *out, Compiler *compiler, ValueIndex idx);
 void print_tokens(Tokens *tokens, String text);
 void print_ast_nodes(AstNodes *nodes, Tokens *tokens, String text);
 
+// Prints the times and arena sizes of the last build, see "time_passes.h". `format` is a
+// `TimePassesFormat`.
+void time_passes_print(FILE *out, Compiler *compiler, u32 format);
+
 #endif // PRINT_H
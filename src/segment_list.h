@@ -58,10 +58,6 @@ SEGMENTLIST_LINKAGE void              Cat(SEGMENTLIST_FUNCTION_PREFIX, _copy_to_
 // Without the toggle of this preprocessor block, the functions defined here would be defined twice
 // if you define two segment lists in the same translation unit leading to compile errors.
 
-internal usize segment_count_at_size(usize min_size_log2, usize size) {
-  return bitwidth(size >> min_size_log2) + 1;
-}
-
 internal usize segment_size(usize min_size_log2, usize si) {
   return (usize)1 << (min_size_log2 + si);
 }
@@ -70,6 +66,15 @@ internal usize segment_idx(usize min_size_log2, usize i) {
   return bitwidth((i >> min_size_log2) + 1) - 1;
 }
 
+// The number of segments needed to hold `size` items.
+internal usize segment_count_at_size(usize min_size_log2, usize size) {
+  if (size == 0) {
+    return 0;
+  }
+
+  return segment_idx(min_size_log2, size - 1) + 1;
+}
+
 internal usize item_idx(usize min_size_log2, usize i, usize si) {
   return i + ((usize)1 << min_size_log2) - ((usize)1 << (min_size_log2 + si));
 }
@@ -0,0 +1,338 @@
+#include "simd.h"
+#include "ast.h"
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#define SIMD_ENABLED
+#include <immintrin.h>
+#endif
+
+#ifdef SIMD_ENABLED
+
+#if defined(__AVX2__)
+typedef __m256i Vec;
+#define VEC_SIZE 32
+#define V(name) _mm256_##name
+#define vec_load(p)     _mm256_loadu_si256(Cast(Vec const *, (p)))
+#define vec_store(p, x) _mm256_storeu_si256(Cast(Vec *, (p)), (x))
+#define vec_and(x, y)   _mm256_and_si256((x), (y))
+#define vec_or(x, y)    _mm256_or_si256((x), (y))
+#define vec_xor(x, y)   _mm256_xor_si256((x), (y))
+#define vec_zero()      _mm256_setzero_si256()
+#else
+typedef __m128i Vec;
+#define VEC_SIZE 16
+#define V(name) _mm_##name
+#define vec_load(p)     _mm_loadu_si128(Cast(Vec const *, (p)))
+#define vec_store(p, x) _mm_storeu_si128(Cast(Vec *, (p)), (x))
+#define vec_and(x, y)   _mm_and_si128((x), (y))
+#define vec_or(x, y)    _mm_or_si128((x), (y))
+#define vec_xor(x, y)   _mm_xor_si128((x), (y))
+#define vec_zero()      _mm_setzero_si128()
+#endif
+
+// The kernels below switch on `bits` for every vector. `bits` does not change within a loop, so the
+// switch is hoisted out of the loop by the compiler.
+
+always_inline Vec vec_add(u32 bits, Vec x, Vec y) {
+  switch (bits) {
+  case 8:  return V(add_epi8)(x, y);
+  case 16: return V(add_epi16)(x, y);
+  case 32: return V(add_epi32)(x, y);
+  default: return V(add_epi64)(x, y);
+  }
+}
+
+always_inline Vec vec_sub(u32 bits, Vec x, Vec y) {
+  switch (bits) {
+  case 8:  return V(sub_epi8)(x, y);
+  case 16: return V(sub_epi16)(x, y);
+  case 32: return V(sub_epi32)(x, y);
+  default: return V(sub_epi64)(x, y);
+  }
+}
+
+// There is no multiplication of 8 or 64-bit lanes.
+always_inline Vec vec_mul(u32 bits, Vec x, Vec y) {
+  switch (bits) {
+  case 16: return V(mullo_epi16)(x, y);
+  default: return V(mullo_epi32)(x, y);
+  }
+}
+
+always_inline Vec vec_cmpeq(u32 bits, Vec x, Vec y) {
+  switch (bits) {
+  case 8:  return V(cmpeq_epi8)(x, y);
+  case 16: return V(cmpeq_epi16)(x, y);
+  case 32: return V(cmpeq_epi32)(x, y);
+  default: return V(cmpeq_epi64)(x, y);
+  }
+}
+
+// Only a signed comparison exists. Unsigned lanes are compared by flipping their sign bits first.
+always_inline Vec vec_cmpgt(u32 bits, b32 is_signed, Vec x, Vec y) {
+  if (!is_signed) {
+    Vec bias;
+    switch (bits) {
+    case 8:  bias = V(set1_epi8)(INT8_MIN);    break;
+    case 16: bias = V(set1_epi16)(INT16_MIN);  break;
+    case 32: bias = V(set1_epi32)(INT32_MIN);  break;
+    default: bias = V(set1_epi64x)(INT64_MIN); break;
+    }
+
+    x = vec_xor(x, bias);
+    y = vec_xor(y, bias);
+  }
+
+  switch (bits) {
+  case 8:  return V(cmpgt_epi8)(x, y);
+  case 16: return V(cmpgt_epi16)(x, y);
+  case 32: return V(cmpgt_epi32)(x, y);
+  default: return V(cmpgt_epi64)(x, y);
+  }
+}
+
+// There is no minimum or maximum of 64-bit lanes.
+always_inline Vec vec_min(u32 bits, b32 is_signed, Vec x, Vec y) {
+  switch (bits) {
+  case 8:  return is_signed ? V(min_epi8)(x, y)  : V(min_epu8)(x, y);
+  case 16: return is_signed ? V(min_epi16)(x, y) : V(min_epu16)(x, y);
+  default: return is_signed ? V(min_epi32)(x, y) : V(min_epu32)(x, y);
+  }
+}
+
+always_inline Vec vec_max(u32 bits, b32 is_signed, Vec x, Vec y) {
+  switch (bits) {
+  case 8:  return is_signed ? V(max_epi8)(x, y)  : V(max_epu8)(x, y);
+  case 16: return is_signed ? V(max_epi16)(x, y) : V(max_epu16)(x, y);
+  default: return is_signed ? V(max_epi32)(x, y) : V(max_epu32)(x, y);
+  }
+}
+
+// Writes a bool per lane of the comparison mask `m`.
+always_inline void store_mask(u8 *dst, Vec m, u32 size, b32 negate) {
+  u32 bytes = Cast(u32, V(movemask_epi8)(m));
+
+  for (u32 j = 0; j < VEC_SIZE / size; j++) {
+    dst[j] = Cast(u8, ((bytes >> (j * size)) & 1) ^ negate);
+  }
+}
+
+internal u64 load_lane(u8 const *p, u32 bits, b32 is_signed) {
+  switch (bits) {
+  case 8:  return is_signed ? Cast(u64, *Cast(i8 const *, p))  : *p;
+  case 16: { u16 x; memcpy(&x, p, 2); return is_signed ? Cast(u64, Cast(i16, x)) : x; }
+  case 32: { u32 x; memcpy(&x, p, 4); return is_signed ? Cast(u64, Cast(i32, x)) : x; }
+  default: { u64 x; memcpy(&x, p, 8); return x; }
+  }
+}
+
+internal b32 has_binary_op_kernel(u8 op, u32 bits) {
+  switch (op) {
+  case Add:
+  case Sub:
+  case Bit_and:
+  case Bit_or:
+  case Bit_xor:
+  case Cmp_equal:
+  case Cmp_not_equal:
+  case Cmp_greater_than:
+  case Cmp_greater_equal:
+  case Cmp_less_than:
+  case Cmp_less_equal:
+    return True;
+  case Mul:
+    return bits == 16 || bits == 32;
+  default:
+    return False;
+  }
+}
+
+#define Simd_map(expr)                                                                             \
+  for (u32 i = 0; i < n; i += lanes) {                                                             \
+    Vec x = vec_load(pa + i * size);                                                               \
+    Vec y = vec_load(pb + i * size);                                                               \
+    vec_store(pd + i * size, (expr));                                                              \
+  }
+
+#define Simd_compare(expr, negate)                                                                 \
+  for (u32 i = 0; i < n; i += lanes) {                                                             \
+    Vec x = vec_load(pa + i * size);                                                               \
+    Vec y = vec_load(pb + i * size);                                                               \
+    store_mask(pd + i, (expr), size, (negate));                                                    \
+  }
+
+u32 simd_binary_op(u8 op, u32 bits, b32 is_signed, void *dst, void const *a, void const *b, u32 count) {
+  if (!has_binary_op_kernel(op, bits)) {
+    return 0;
+  }
+
+  u32 size  = bits / 8;
+  u32 lanes = VEC_SIZE / size;
+  u32 n     = count - count % lanes;
+
+  u8 const *pa = a;
+  u8 const *pb = b;
+  u8       *pd = dst;
+
+  // clang-format off
+  switch (op) {
+  case Add:               Simd_map(vec_add(bits, x, y));                          break;
+  case Sub:               Simd_map(vec_sub(bits, x, y));                          break;
+  case Mul:               Simd_map(vec_mul(bits, x, y));                          break;
+  case Bit_and:           Simd_map(vec_and(x, y));                                break;
+  case Bit_or:            Simd_map(vec_or(x, y));                                 break;
+  case Bit_xor:           Simd_map(vec_xor(x, y));                                break;
+  case Cmp_equal:         Simd_compare(vec_cmpeq(bits, x, y), 0);                 break;
+  case Cmp_not_equal:     Simd_compare(vec_cmpeq(bits, x, y), 1);                 break;
+  case Cmp_greater_than:  Simd_compare(vec_cmpgt(bits, is_signed, x, y), 0);      break;
+  case Cmp_less_equal:    Simd_compare(vec_cmpgt(bits, is_signed, x, y), 1);      break;
+  case Cmp_less_than:     Simd_compare(vec_cmpgt(bits, is_signed, y, x), 0);      break;
+  case Cmp_greater_equal: Simd_compare(vec_cmpgt(bits, is_signed, y, x), 1);      break;
+  default: Unreachable();
+  }
+  // clang-format on
+
+  return n;
+}
+
+u32 simd_reduce(u8 op, u32 bits, b32 is_signed, void const *a, u32 count, u64 *res) {
+  if (op != SimdReduce_sum && bits == 64) {
+    return 0;
+  }
+
+  u32 size  = bits / 8;
+  u32 lanes = VEC_SIZE / size;
+  u32 n     = count - count % lanes;
+
+  if (n == 0) {
+    return 0;
+  }
+
+  u8 const *pa = a;
+
+  Vec acc = (op == SimdReduce_sum) ? vec_zero() : vec_load(pa);
+
+  switch (op) {
+  case SimdReduce_sum: {
+    for (u32 i = 0; i < n; i += lanes) {
+      acc = vec_add(bits, acc, vec_load(pa + i * size));
+    }
+  } break;
+  case SimdReduce_min: {
+    for (u32 i = lanes; i < n; i += lanes) {
+      acc = vec_min(bits, is_signed, acc, vec_load(pa + i * size));
+    }
+  } break;
+  case SimdReduce_max: {
+    for (u32 i = lanes; i < n; i += lanes) {
+      acc = vec_max(bits, is_signed, acc, vec_load(pa + i * size));
+    }
+  } break;
+  default: Unreachable();
+  }
+
+  u8 lane_bytes[VEC_SIZE];
+  vec_store(lane_bytes, acc);
+
+  u64 x = load_lane(lane_bytes, bits, is_signed);
+  for (u32 j = 1; j < lanes; j++) {
+    u64 y = load_lane(lane_bytes + j * size, bits, is_signed);
+
+    switch (op) {
+    case SimdReduce_sum: x += y; break;
+    case SimdReduce_min: x = (is_signed ? Cast(i64, y) < Cast(i64, x) : y < x) ? y : x; break;
+    case SimdReduce_max: x = (is_signed ? Cast(i64, y) > Cast(i64, x) : y > x) ? y : x; break;
+    }
+  }
+
+  *res = x;
+
+  return n;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+#define VEC_BYTE_MASK ((VEC_SIZE == 32) ? UINT32_MAX : 0xFFFFu)
+
+always_inline u32 vec_movemask8(Vec m) {
+  return Cast(u32, V(movemask_epi8)(m));
+}
+
+always_inline Vec vec_eq8(Vec x, u8 c) {
+  return V(cmpeq_epi8)(x, V(set1_epi8)(Cast(char, c)));
+}
+
+// Bytes from 0x80 on are negative, so they are never within an ASCII range.
+always_inline Vec vec_in_range8(Vec x, u8 lo, u8 hi) {
+  return vec_and(V(cmpgt_epi8)(x, V(set1_epi8)(Cast(char, lo - 1))), V(cmpgt_epi8)(V(set1_epi8)(Cast(char, hi + 1)), x));
+}
+
+// A mask with a bit set for every byte of `x` that a scan of `kind` stops at.
+always_inline u32 scan_stop_mask(u32 kind, Vec x, u8 a, u8 b) {
+  switch (kind) {
+  case Scan_whitespace: {
+    Vec m = vec_or(vec_or(vec_eq8(x, ' '), vec_eq8(x, '\t')), vec_or(vec_eq8(x, '\r'), vec_eq8(x, '\n')));
+    return ~vec_movemask8(m) & VEC_BYTE_MASK;
+  }
+  case Scan_identifier: {
+    // Setting bit 5 maps upper case letters to lower case ones.
+    Vec lower = vec_or(x, V(set1_epi8)(0x20));
+    Vec m = vec_or(vec_or(vec_in_range8(lower, 'a', 'z'), vec_in_range8(x, '0', '9')), vec_eq8(x, '_'));
+    return ~vec_movemask8(m) & VEC_BYTE_MASK;
+  }
+  default:
+    return vec_movemask8(vec_or(vec_eq8(x, a), vec_eq8(x, b)));
+  }
+}
+
+u32 simd_scan(u32 kind, u8 const *s, u32 len, u8 a, u8 b) {
+  u32 at = 0;
+
+  for (; at + VEC_SIZE <= len; at += VEC_SIZE) {
+    u32 stop = scan_stop_mask(kind, vec_load(s + at), a, b);
+    if (stop) {
+      return at + count_trailing_zeros64(stop);
+    }
+  }
+
+  return at;
+}
+
+u32 simd_match_byte64(u8 const *s, u32 len, u8 c, u64 *mask) {
+  if (len < 64) {
+    return 0;
+  }
+
+  u64 m = 0;
+  for (u32 i = 0; i < 64; i += VEC_SIZE) {
+    m |= Cast(u64, vec_movemask8(vec_eq8(vec_load(s + i), c))) << i;
+  }
+
+  *mask = m;
+
+  return 64;
+}
+
+#else
+
+u32 simd_binary_op(u8 op, u32 bits, b32 is_signed, void *dst, void const *a, void const *b, u32 count) {
+  Unused(op, bits, is_signed, dst, a, b, count);
+  return 0;
+}
+
+u32 simd_reduce(u8 op, u32 bits, b32 is_signed, void const *a, u32 count, u64 *res) {
+  Unused(op, bits, is_signed, a, count, res);
+  return 0;
+}
+
+u32 simd_scan(u32 kind, u8 const *s, u32 len, u8 a, u8 b) {
+  Unused(kind, s, len, a, b);
+  return 0;
+}
+
+u32 simd_match_byte64(u8 const *s, u32 len, u8 c, u64 *mask) {
+  Unused(s, len, c, mask);
+  return 0;
+}
+
+#endif // SIMD_ENABLED
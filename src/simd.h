@@ -0,0 +1,45 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "blu.h"
+
+// Vectorized kernels for arrays of integers of 8, 16, 32 or 64 bits and for scanning text. The
+// kernels use AVX2 or SSE4.2, whichever is the widest the compiler targets, and do nothing on other
+// targets.
+//
+// A kernel only processes the longest prefix of the array that fills whole vectors and returns the
+// number of elements in that prefix. The caller is responsible for the remaining elements. A kernel
+// returns 0 if it has no vector implementation of the operation, for example for division.
+
+// `op` is a `BinaryOpKind`. Comparisons write a bool, a 0 or 1 byte, per element to `dst`. Other
+// operations write an element of `bits` bits per element.
+u32 simd_binary_op(u8 op, u32 bits, b32 is_signed, void *dst, void const *a, void const *b, u32 count);
+
+typedef enum {
+  SimdReduce_sum,
+  SimdReduce_min,
+  SimdReduce_max,
+} SimdReduceOp;
+
+// Writes the reduction of the processed prefix to `res`. A minimum or maximum is extended to 64 bits
+// according to `is_signed`, a sum is only correct in its lower `bits` bits.
+u32 simd_reduce(u8 op, u32 bits, b32 is_signed, void const *a, u32 count, u64 *res);
+
+// The scanning kernels below look at the text `s` of `len` bytes in whole vectors as well. A scan
+// returns the offset of the first byte it stops at, or the length of the processed prefix if it did
+// not find one there. Either way the caller continues from that offset with scalar code.
+
+typedef enum {
+  Scan_whitespace, // Stops at a byte other than a space, tab, carriage return or newline.
+  Scan_identifier, // Stops at a byte that can not be part of an identifier, i.e. not [a-zA-Z0-9_].
+  Scan_until,      // Stops at the byte `a` or `b`.
+} SimdScanKind;
+
+// `a` and `b` are only used by `Scan_until`.
+u32 simd_scan(u32 kind, u8 const *s, u32 len, u8 a, u8 b);
+
+// Sets bit i of `mask` if byte i of `s` is `c`, for the first 64 bytes. Returns 64, or 0 if `len` is
+// less than that.
+u32 simd_match_byte64(u8 const *s, u32 len, u8 c, u64 *mask);
+
+#endif // SIMD_H
@@ -0,0 +1,338 @@
+#include "source_cache.h"
+#include <stdio.h>
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+// -------------------------------------------------------------------------------------------------
+// On-disk layout. All offsets are in bytes from the start of the entry.
+
+typedef struct {
+  u32 magic;
+  u32 version;
+  u64 layout;     // See `layout_fingerprint`.
+  u64 checksum;   // XXH3 of the rest of the entry, from `entry_size` on.
+  u64 entry_size;
+
+  // The hash and length of the text the entry was made from.
+  u64 hash_low;
+  u64 hash_high;
+  u64 text_len;
+
+  u32 tok_count;
+  u32 line_count;
+  u32 node_count;
+  u32 extra_size;
+
+  u64 token_kinds; // u8[tok_count]
+  u64 token_spans; // SpanU32[tok_count]
+  u64 lines;       // u32[line_count]
+  u64 node_kinds;  // u8[node_count]
+  u64 node_spans;  // SpanToken[node_count]
+  u64 node_datas;  // u32[node_count]
+  u64 extra;       // u8[extra_size], aligned to AST_EXTRA_ALIGN
+} SourceCacheHeader;
+
+// A hash of the sizes of everything that is stored as is, so that an entry written by a build of
+// blu with a different layout is rejected even if `SOURCE_CACHE_VERSION` was not bumped.
+internal u64 layout_fingerprint(void) {
+  u64 const layout[] = {
+    sizeof(SourceCacheHeader),
+    sizeof(SpanU32),
+    sizeof(SpanToken),
+    sizeof(AstIndex),
+    sizeof(TokenIndex),
+    sizeof(AstNodeData),
+    sizeof(AstBuiltin),
+    sizeof(AstTypeFunction),
+    sizeof(AstTypeSlice),
+    sizeof(AstTypeArray),
+    sizeof(AstTypeOptional),
+    sizeof(AstTypeRange),
+    sizeof(AstTypeStruct),
+    sizeof(AstField),
+    sizeof(AstDeclaration),
+    sizeof(AstSource),
+    sizeof(AstModSection),
+    sizeof(AstBlock),
+    sizeof(AstLiteralSequence),
+    sizeof(AstParam),
+    sizeof(AstFunction),
+    sizeof(AstIfElse),
+    sizeof(AstFor),
+    sizeof(AstUnaryOp),
+    sizeof(AstBinaryOp),
+    sizeof(AstCall),
+    sizeof(AstIndexData),
+    sizeof(AstDefer),
+    sizeof(AstAssign),
+    sizeof(AstConst),
+    sizeof(AstCast),
+    sizeof(AstAs),
+    AST_EXTRA_ALIGN,
+    Tok_kind_max,
+    Ast_kind_max,
+  };
+
+  return XXH3_64bits(layout, sizeof(layout));
+}
+
+internal always_inline u64 layout_push(u64 *at, u64 size, u32 align) {
+  u64 offset = round_up_to_power_of_two(*at, align);
+  *at = offset + size;
+  return offset;
+}
+
+internal always_inline b32 range_in_entry(u64 entry_size, u64 offset, u64 size) {
+  return offset <= entry_size && size <= entry_size - offset;
+}
+
+// `<cache_dir>/<hash>.blufe`, or with `suffix` appended for the temporary file.
+internal char const *entry_filename(Arena *arena, String cache_dir, XXH128_hash_t hash, String suffix) {
+  usize len = cache_dir.len + 1 + 32 + 6 + suffix.len;
+
+  char *buf = arena_push_array(char, arena, len + 1);
+  memcpy(buf, cache_dir.str, cache_dir.len);
+  snprintf(
+    buf + cache_dir.len, len + 1 - cache_dir.len,
+    "/%016llx%016llx.blufe%.*s",
+    Cast(unsigned long long, hash.high64), Cast(unsigned long long, hash.low64),
+    Cast(int, suffix.len), suffix.str
+  );
+
+  return buf;
+}
+
+char const *source_cache_entry_filename(Arena *arena, String cache_dir, String text) {
+  return entry_filename(arena, cache_dir, XXH3_128bits(text.str, text.len), (String){0});
+}
+
+internal u8 const zeros[AST_EXTRA_ALIGN] = {0};
+
+// Writes `size` bytes at `offset`, after padding the file with zeros from `*pos` up to there. The
+// padding and the data are added to `checksum`.
+internal b32 write_at(FILE *f, XXH3_state_t *checksum, u64 *pos, u64 offset, void const *data, u64 size) {
+  Assert(offset >= *pos && offset - *pos <= sizeof(zeros));
+
+  u64 padding = offset - *pos;
+  if (fwrite(zeros, 1, padding, f) != padding || fwrite(data, 1, size, f) != size) {
+    return False;
+  }
+
+  XXH3_64bits_update(checksum, zeros, padding);
+  XXH3_64bits_update(checksum, data, size);
+
+  *pos = offset + size;
+
+  return True;
+}
+
+b32 source_cache_load(Source *source, String cache_dir, Arena *scratch) {
+  ArenaSnapshot scope = arena_scope_begin(scratch);
+
+  XXH128_hash_t hash = XXH3_128bits(source->text.str, source->text.len);
+
+  FileMapping mapping;
+  b32 ok = file_map(&mapping, entry_filename(scratch, cache_dir, hash, (String){0}), FileMap_read_only);
+
+  arena_scope_end(scratch, scope);
+
+  if (!ok) {
+    return False;
+  }
+
+  u8 *base = mapping.base;
+  u64 size = mapping.size;
+
+  if (size < sizeof(SourceCacheHeader)) {
+    goto fail;
+  }
+
+  SourceCacheHeader *header = Cast(SourceCacheHeader*, base);
+
+  if (header->magic != SOURCE_CACHE_MAGIC || header->version != SOURCE_CACHE_VERSION ||
+      header->layout != layout_fingerprint() || header->entry_size != size)
+  {
+    goto fail;
+  }
+
+  if (header->hash_low != hash.low64 || header->hash_high != hash.high64 ||
+      header->text_len != source->text.len)
+  {
+    goto fail;
+  }
+
+  u32 tok_count  = header->tok_count;
+  u32 line_count = header->line_count;
+  u32 node_count = header->node_count;
+  u32 extra_size = header->extra_size;
+
+  if (line_count == 0 || node_count <= AstIndex_source) {
+    goto fail;
+  }
+
+  if (!range_in_entry(size, header->token_kinds, tok_count) ||
+      !range_in_entry(size, header->token_spans, Cast(u64, tok_count) * sizeof(SpanU32)) ||
+      !range_in_entry(size, header->lines,       Cast(u64, line_count) * sizeof(u32)) ||
+      !range_in_entry(size, header->node_kinds,  node_count) ||
+      !range_in_entry(size, header->node_spans,  Cast(u64, node_count) * sizeof(SpanToken)) ||
+      !range_in_entry(size, header->node_datas,  Cast(u64, node_count) * sizeof(u32)) ||
+      !range_in_entry(size, header->extra,       extra_size))
+  {
+    goto fail;
+  }
+
+  // The checksum covers the payloads, whose node and token indices are not checked one by one
+  // below. Everything else is checked as well, it is cheap compared to tokenizing and parsing.
+  u64 checked = offsetof(SourceCacheHeader, entry_size);
+  if (XXH3_64bits(base + checked, size - checked) != header->checksum) {
+    goto fail;
+  }
+
+  u8        *node_kinds  = base + header->node_kinds;
+  u32       *node_datas  = Cast(u32*, base + header->node_datas);
+  SpanToken *node_spans  = Cast(SpanToken*, base + header->node_spans);
+  u8        *token_kinds = base + header->token_kinds;
+  SpanU32   *token_spans = Cast(SpanU32*, base + header->token_spans);
+  u32       *lines       = Cast(u32*, base + header->lines);
+
+  if (node_kinds[AstIndex_source] != Ast_source) {
+    goto fail;
+  }
+
+  for (u32 i = 1; i < node_count; i++) {
+    if (node_kinds[i] >= Ast_kind_max || node_datas[i] >= extra_size ||
+        node_spans[i].start > node_spans[i].end || node_spans[i].end > tok_count)
+    {
+      goto fail;
+    }
+  }
+
+  for (u32 i = 0; i < tok_count; i++) {
+    if (token_kinds[i] >= Tok_kind_max ||
+        token_spans[i].start > token_spans[i].end || token_spans[i].end > source->text.len)
+    {
+      goto fail;
+    }
+  }
+
+  for (u32 i = 0; i < line_count; i++) {
+    if (lines[i] > source->text.len || (i > 0 && lines[i] < lines[i-1])) {
+      goto fail;
+    }
+  }
+
+  source->tokens = (Tokens){
+    .tok_count  = tok_count,
+    .line_count = line_count,
+    .capacity   = 0, // The arrays belong to the mapping.
+    .kinds = token_kinds,
+    .spans = token_spans,
+    .lines = lines,
+  };
+
+  position_index_init(&source->positions, source->text, &source->tokens);
+
+  void *extra = arena_push(&source->arena, extra_size, AST_EXTRA_ALIGN);
+  memcpy(extra, base + header->extra, extra_size);
+
+  // The capacity is the count, so the first lazily parsed body moves the arrays into the arena.
+  source->ast = (AstNodes){
+    .count      = node_count,
+    .capacity   = node_count,
+    .kinds      = node_kinds,
+    .spans      = node_spans,
+    .datas      = node_datas,
+    .extra      = extra,
+    .extra_size = extra_size,
+  };
+
+  source->cache = mapping;
+
+  return True;
+
+fail:
+  file_unmap(&mapping);
+  return False;
+}
+
+b32 source_cache_store(Source *source, String cache_dir, Arena *scratch) {
+  ArenaSnapshot scope = arena_scope_begin(scratch);
+
+  Tokens   *tokens = &source->tokens;
+  AstNodes *ast    = &source->ast;
+
+  XXH128_hash_t hash = XXH3_128bits(source->text.str, source->text.len);
+
+  u64 at = 0;
+
+  SourceCacheHeader header = {
+    .magic      = SOURCE_CACHE_MAGIC,
+    .version    = SOURCE_CACHE_VERSION,
+    .layout     = layout_fingerprint(),
+    .hash_low   = hash.low64,
+    .hash_high  = hash.high64,
+    .text_len   = source->text.len,
+    .tok_count  = tokens->tok_count,
+    .line_count = tokens->line_count,
+    .node_count = ast->count,
+    .extra_size = ast->extra_size,
+  };
+
+  layout_push(&at, sizeof(SourceCacheHeader), 8);
+  header.token_kinds = layout_push(&at, tokens->tok_count, 1);
+  header.token_spans = layout_push(&at, tokens->tok_count * sizeof(SpanU32), Align_of(SpanU32));
+  header.lines       = layout_push(&at, tokens->line_count * sizeof(u32), Align_of(u32));
+  header.node_kinds  = layout_push(&at, ast->count, 1);
+  header.node_spans  = layout_push(&at, ast->count * sizeof(SpanToken), Align_of(SpanToken));
+  header.node_datas  = layout_push(&at, ast->count * sizeof(u32), Align_of(u32));
+  header.extra       = layout_push(&at, ast->extra_size, AST_EXTRA_ALIGN);
+
+  header.entry_size = at;
+
+  // The temporary file is unique to this source and this moment, so that sources with the same
+  // text, or builds running at the same time, do not write to the same file.
+  char suffix[48];
+  int suffix_len = snprintf(suffix, sizeof(suffix), ".%u.%llx.tmp", source->idx, Cast(unsigned long long, time_now_ns()));
+
+  char const *filename = entry_filename(scratch, cache_dir, hash, (String){0});
+  char const *tmp      = entry_filename(scratch, cache_dir, hash, (String){ .str = Cast(u8*, suffix), .len = Cast(usize, suffix_len) });
+
+  b32 ok = False;
+
+  FILE *f = fopen(tmp, "wb");
+  if (!is_null(f)) {
+    usize checked = offsetof(SourceCacheHeader, entry_size);
+
+    XXH3_state_t checksum;
+    XXH3_64bits_reset(&checksum);
+    XXH3_64bits_update(&checksum, Cast(u8*, &header) + checked, sizeof(header) - checked);
+
+    // The arrays are written one after the other instead of being copied into one buffer first.
+    // The header is written last, once the checksum is known.
+    u64 pos = sizeof(header);
+    ok = fseek(f, Cast(long, sizeof(header)), SEEK_SET) == 0 &&
+         write_at(f, &checksum, &pos, header.token_kinds, tokens->kinds, tokens->tok_count) &&
+         write_at(f, &checksum, &pos, header.token_spans, tokens->spans, tokens->tok_count * sizeof(SpanU32)) &&
+         write_at(f, &checksum, &pos, header.lines,       tokens->lines, tokens->line_count * sizeof(u32)) &&
+         write_at(f, &checksum, &pos, header.node_kinds,  ast->kinds,    ast->count) &&
+         write_at(f, &checksum, &pos, header.node_spans,  ast->spans,    ast->count * sizeof(SpanToken)) &&
+         write_at(f, &checksum, &pos, header.node_datas,  ast->datas,    ast->count * sizeof(u32)) &&
+         write_at(f, &checksum, &pos, header.extra,       ast->extra,    ast->extra_size);
+
+    header.checksum = XXH3_64bits_digest(&checksum);
+
+    ok = ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, f) == 1;
+
+    ok = (fclose(f) == 0) && ok && pos == at;
+
+    // Renaming can fail if the entry was already added by another build, which is just as good.
+    if (!ok || rename(tmp, filename) != 0) {
+      remove(tmp);
+    }
+  }
+
+  arena_scope_end(scratch, scope);
+
+  return ok;
+}
@@ -0,0 +1,39 @@
+#ifndef SOURCE_CACHE_H
+#define SOURCE_CACHE_H
+
+#include "blu.h"
+#include "source_file.h"
+
+// The tokens and the AST of a source only depend on its text, so they can be stored in a cache
+// directory and used again by a later build of the same text. An entry is named after the XXH3
+// hash of the text and holds the token and node arrays, which are index based and can be used in
+// place. Loading an entry maps it into memory. The token and node arrays point directly into the
+// mapping, only the node payloads are copied into the arena of the source, because the payloads of
+// lazily parsed function bodies are added to them later.
+//
+// The declaration tree of a source refers to interned strings, which are only meaningful within a
+// single compiler session, so it is not stored. It is indexed again from the AST, which is cheap.
+//
+// An entry uses the native byte order and the in-memory layout of the arrays. The header holds a
+// fingerprint of that layout, so a change to it rejects the entries of older builds by itself.
+// Bump `SOURCE_CACHE_VERSION` whenever the output of the tokenizer or the parser changes.
+//
+// An entry is only trusted after its checksum and the bounds of its spans are verified, so a
+// corrupted or truncated entry is ignored and written again.
+
+#define SOURCE_CACHE_MAGIC   0x45464c42 // "BLFE"
+#define SOURCE_CACHE_VERSION 2
+
+// Sets up the tokens, positions and AST of `source` from its entry in `cache_dir`. Returns False
+// if there is no valid entry for the text of the source, in which case the source is unchanged.
+b32 source_cache_load(Source *source, String cache_dir, Arena *scratch);
+
+// Stores the tokens and AST of `source`, which must have just been parsed, in `cache_dir`. The
+// entry is written to a temporary file first and then renamed, so another build never sees a
+// partially written entry. Returns False if the entry could not be written.
+b32 source_cache_store(Source *source, String cache_dir, Arena *scratch);
+
+// The path of the entry for `text` in `cache_dir`, as a C string allocated in `arena`.
+char const *source_cache_entry_filename(Arena *arena, String cache_dir, String text);
+
+#endif // SOURCE_CACHE_H
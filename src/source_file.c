@@ -1,7 +1,6 @@
 #include "source_file.h"
 #include "messages.h"
 #include <stdarg.h>
-#include <stdio.h>
 
 internal void source_add_message(void *user, u8 severity, MessageLocation location, String format, ...) {
   Source *source = user;
@@ -29,8 +28,11 @@ internal void source_add_message(void *user, u8 severity, MessageLocation locati
 
 void source_file_init(Source *source, SourceIndex idx, String filename) {
   zero_struct(Source, source);
+
+  // The AST takes up to about 20 bytes per byte of text. The size of the file is not known yet,
+  // and only the memory that is used is committed, so there is room for a source of tens of MiB.
   arena_init(&source->arena, &(ArenaOptions){
-    .reserve_size        = MiB(64),
+    .reserve_size        = GiB(1),
     .initial_commit_size = MiB(1),
   });
   source->idx      = idx;
@@ -42,99 +44,117 @@ void source_file_init(Source *source, SourceIndex idx, String filename) {
 }
 
 void source_file_deinit(Source *source) {
+  tokens_deinit(&source->tokens);
+  file_unmap(&source->cache);
+  file_unmap(&source->mapping);
   arena_deinit(&source->arena);
 }
 
-enum ReadFileResult {
-  ReadFile_ok,
-  ReadFile_error_could_not_open_file,
-  ReadFile_error_unexpected_content_size,
-  ReadFile_error_ftell_error,
-};
-
-// `read_file` reads the contents of the given filename and stores it in the provided arena.
-internal u32 read_file(String filename, Arena *arena, String *content) {
-  FILE *f;
-  {
-    ArenaSnapshot scope = arena_scope_begin(arena);
-    u8 *buf = arena_push_array(u8, arena, filename.len + 1);
-    memcpy(buf, filename.str, filename.len);
-    buf[filename.len] = '\0';
-
-    f = fopen(Cast(char const *, buf), "rb");
-    if (is_null(f)) {
-      arena_scope_end(arena, scope);
-      return ReadFile_error_could_not_open_file;
-    }
-
-    arena_scope_end(arena, scope);
-  }
-
-  fseek(f, 0, SEEK_END);
+// The tokens and spans address the text with 32-bit offsets, and the tokenizer needs one more
+// than the length of the text.
+#define Max_source_size (Cast(u64, UINT32_MAX) - 1)
 
-  i32 sizei = ftell(f);
-  if (sizei < 0) {
-    fclose(f);
-    return ReadFile_error_ftell_error;
-  }
-
-  u32 size = Cast(u32, sizei);
+internal char const *filename_cstr(Arena *arena, String filename) {
+  u8 *buf = arena_push_array(u8, arena, filename.len + 1);
+  memcpy(buf, filename.str, filename.len);
+  buf[filename.len] = '\0';
+  return Cast(char const *, buf);
+}
 
-  ArenaSnapshot savepoint = arena_scope_begin(arena);
+// The text of a source points directly into a read-only mapping of the file, unless it is copied.
+b32 source_read_file(Source *source, b32 copy) {
+  ArenaSnapshot scope = arena_scope_begin(&source->arena);
 
-  u8 *data = arena_push_array(u8, arena, size);
+  char const *filename = filename_cstr(&source->arena, source->filename);
 
-  fseek(f, 0, SEEK_SET);
+  // The time is taken before the file is mapped, so that a change in between is seen as a change
+  // by `source_file_changed`.
+  file_modified_time(filename, &source->modified_time);
 
-  u64 bytes_read = fread(data, 1, size, f);
+  u32 flags = FileMap_read_only | FileMap_sequential | (copy ? FileMap_copy : 0);
+  b32 ok    = file_map(&source->mapping, filename, flags);
 
-  fclose(f);
+  arena_scope_end(&source->arena, scope);
 
-  if (bytes_read != size) {
-    arena_scope_end(arena, savepoint);
-    return ReadFile_error_unexpected_content_size;
+  if (!ok) {
+    Message_error(
+      &source->msg_sink,
+      (MessageLocation){ .kind = MessageLocation_unspecified },
+      string_lit("Could not open/read file {str}."), source->filename
+    );
+    return False;
   }
 
-  *content = (String){
-    .str = data,
-    .len = size,
-  };
-
-  return ReadFile_ok;
-}
-
-b32 source_read_file(Source *source) {
-  u32 err = read_file(source->filename, &source->arena, &source->text);
-  if (err) {
+  if (source->mapping.size > Max_source_size) {
     Message_error(
       &source->msg_sink,
       (MessageLocation){ .kind = MessageLocation_unspecified },
-      string_lit("Could not open/read file {str}."), source->filename
+      string_lit("File is too large, a source file can be at most 4 GiB.")
     );
+    file_unmap(&source->mapping);
     return False;
   }
 
+  // An empty file has no mapping.
+  source->text = (String){
+    .str = source->mapping.base ? source->mapping.base : Cast(u8 *, ""),
+    .len = source->mapping.size,
+  };
+
   return True;
 }
 
-b32 source_tokenize(Source *source, Arena *scratch) {
+b32 source_file_changed(Source *source, Arena *scratch) {
+  ArenaSnapshot scope = arena_scope_begin(scratch);
+
+  // A file that can not be found has no time, just like a source that failed to find its file.
+  u64 time = 0;
+  file_modified_time(filename_cstr(scratch, source->filename), &time);
+
+  arena_scope_end(scratch, scope);
+
+  return time != source->modified_time;
+}
+
+b32 source_tokenize(Source *source, Arena *scratch, u32 thread_count) {
   TokenizeContext context = {
+    .msg_sink = &source->msg_sink,
+    .scratch  = scratch,
+  };
+
+  b32 ok = tokenize_parallel(&context, source->text, thread_count, &source->tokens);
+
+  position_index_init(&source->positions, source->text, &source->tokens);
+
+  return ok;
+}
+
+b32 source_parse(Source *source, Arena *scratch, u32 thread_count) {
+  ParseContext context = {
     .msg_sink = &source->msg_sink,
     .arena    = &source->arena,
     .scratch  = scratch,
+
+    .lazy_function_bodies = True,
   };
 
-  return tokenize(&context, source->text, &source->tokens);
+  b32 ok = parse_parallel(&context, &source->tokens, thread_count, &source->ast);
+
+  source->parse_scratch_peak = context.scratch_peak;
+
+  return ok;
 }
 
-b32 source_parse(Source *source, Arena *scratch) {
+b32 source_parse_function_body(Source *source, AstIndex function, Arena *scratch) {
   ParseContext context = {
     .msg_sink = &source->msg_sink,
     .arena    = &source->arena,
     .scratch  = scratch,
+
+    .lazy_function_bodies = True,
   };
 
-  return parse(&context, &source->tokens, &source->ast);
+  return parse_function_body(&context, &source->tokens, &source->ast, function);
 }
 
 void source_index_declarations(Source *source, StringInterner *strings) {
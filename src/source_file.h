@@ -7,6 +7,7 @@
 #include "messages.h"
 #include "string_interner.h"
 #include "ir.h"
+#include "time_passes.h"
 
 enum SourceDeclarationKind {
   SourceDeclaration_root,
@@ -36,24 +37,49 @@ struct Source {
   MessageList msg_list;
   MessageSink msg_sink;
 
-  // The filename, text (source code / file contents), messages, tokens and AST are all stored
-  // in the arena of this source.
-  String   filename;
-  String   text;
-  Tokens   tokens;
-  AstNodes ast;
+  // The filename, messages and AST are all stored in the arena of this source. The text (source
+  // code / file contents) points into the read-only mapping of the file, or into its copy. The
+  // tokens have their own memory.
+  String      filename;
+  FileMapping mapping;
+  u64         modified_time; // Of the file, when it was read. 0 if it could not be found.
+  String      text;
+  Tokens      tokens;
+  AstNodes    ast;
+  FileMapping cache; // The cache entry the tokens and AST were loaded from, if any.
+
+  // Resolves byte offsets to lines and columns for messages. Set up by `source_tokenize`.
+  PositionIndex positions;
 
   u32                decl_tree_size;
   SourceDeclaration *decls;
   DeclarationIndex  *decl_idxs;
+
+  // How long each phase of this source took in the last build. All 0 if the build did not need to
+  // process the source again.
+  PhaseTime times[SourcePhase_count];
+
+  // The `scratch_peak` of the parse of this source in the last build, see `ParseContext`.
+  usize parse_scratch_peak;
 };
 
 void source_file_init(Source *source, SourceIndex idx, String filename);
 void source_file_deinit(Source *source);
 
-b32 source_read_file(Source *source);
-b32 source_tokenize(Source *source, Arena *scratch);
-b32 source_parse(Source *source, Arena *scratch);
+// A source that is mapped crashes the compiler if its file is truncated while the source is in use,
+// see `file_map`. With `copy` the file is read into memory instead, which is slower to read but
+// safe when the file is edited during a build, like in watch mode.
+b32 source_read_file(Source *source, b32 copy);
+
+// Whether the file was modified since it was read by `source_read_file`.
+b32 source_file_changed(Source *source, Arena *scratch);
+// A large source is split into chunks that are tokenized and parsed on up to `thread_count`
+// threads.
+b32 source_tokenize(Source *source, Arena *scratch, u32 thread_count);
+b32 source_parse(Source *source, Arena *scratch, u32 thread_count);
+
+// The bodies of functions are parsed on demand, when code is first generated for them.
+b32 source_parse_function_body(Source *source, AstIndex function, Arena *scratch);
 
 // - Creates the declaration tree for this source file and stores it in `decls`.
 // - Writes the size of the the tree in `decl_tree_size` (the number of SourceDeclarations).
@@ -1,6 +1,7 @@
 #include "specialize.h"
 #include "ir.h"
 #include "eval.h"
+#include "ast.h"
 
 extern Allocator const cstd_allocator;
 
@@ -306,7 +307,7 @@ internal b32 _get_value_expect_type(Specializer *in, CallFrame *f, ValueIndex va
     return False;
   }
 
-  *out = *Cast(TypeIndex*, v->data);
+  *out = *Cast(TypeIndex*, value_data(v));
 
   return True;
 }
@@ -344,16 +345,7 @@ internal TypeIndex type_of_val(Specializer *in, ValueIndex v) {
 }
 
 internal ValueIndex val_from_type(Specializer *in, TypeIndex t) {
-  Value *v;
-  ValueIndex res = values_alloc(in->values, &v);
-  TypeIndex *data = values_alloc_data(in->values, sizeof(TypeIndex), Align_of(TypeIndex));
-  *data = t;
-  *v = (Value){
-    .type = in->common->type.type,
-    .data_size = sizeof(TypeIndex),
-    .data = data,
-  };
-  return res;
+  return values_intern_typed(in->values, in->common->type.type, TypeIndex, &t);
 }
 
 internal TypeIndex ref_typeof(Specializer *in, CallFrame *f, IrRef ref) {
@@ -371,6 +363,18 @@ internal TypeIndex ref_typeof(Specializer *in, CallFrame *f, IrRef ref) {
   return type;
 }
 
+internal void report_error(Specializer *in, CallFrame *f, InstructionIndex pc, String msg) {
+  Message_error(
+    in->msg_sink,
+    (MessageLocation){
+      .kind = MessageLocation_ir_instruction,
+      .decl_idx = f->decl_idx,
+      .data.offset = pc,
+    },
+    msg
+  );
+}
+
 internal u32 step(Specializer *in, RunState *state) {
   CallFrame *f = top_frame(state);
   ScopeSpan *s = stack_peek_ptr(&f->scopes);
@@ -485,11 +489,25 @@ internal u32 step(Specializer *in, RunState *state) {
     ResolvedRef ref = resolve(f, as->val);
 
     TypeIndex type_dst;
-    b32 ok = expect_type_value(in, f, as->type_to, &type_dst);
+    b32 ok = expect_type_value_or_nil(in, f, as->type_to, &type_dst);
     if (!ok) {
       return Step_encountered_error;
     }
 
+    // Without a destination type the value is passed through as is.
+    if (!type_dst) {
+      if (ref_is_some_value_index(ref)) {
+        f->inst_types[pc] = type_of_val(in, ref_to_value_index(ref));
+        ref = resolved_ref_from_value_index(values_copy(in->values, ref_to_value_index(ref)));
+      } else {
+        f->inst_types[pc] = ref_typeof(in, f, as->val);
+      }
+
+      store_inst_value(f, pc, ref);
+      s->pc = pc + 1;
+      break;
+    }
+
     f->inst_types[pc] = type_dst;
 
     // If the value is comptime known, we try to do the coercion right away.
@@ -511,6 +529,18 @@ internal u32 step(Specializer *in, RunState *state) {
           );
         }
 
+        if (err == CoerceResult_integer_value_out_of_range) {
+          Message_error(
+            in->msg_sink,
+            (MessageLocation){
+              .kind = MessageLocation_ir_instruction,
+              .decl_idx = f->decl_idx,
+              .data.offset = s->pc,
+            },
+            string_lit("Value is out of range of destination type")
+          );
+        }
+
         if (err == CoerceResult_invalid_coercion_types) {
           Message_error(
             in->msg_sink,
@@ -534,7 +564,8 @@ internal u32 step(Specializer *in, RunState *state) {
       TypeIndex from = ref_typeof(in, f, as->val);
 
       if (!is_type_coercible_to(in->types, type_dst, from)) {
-        Todo();
+        report_error(in, f, pc, string_lit("Value may be out of range of destination type"));
+        return Step_encountered_error;
       }
 
       f->inst_types[pc] = type_dst;
@@ -625,12 +656,200 @@ internal u32 step(Specializer *in, RunState *state) {
       });
       
     } break;
+    case Type_array: {
+      Assert(type->arg_count == 2);
+
+      ValueIndex val_size;
+      b32 ok = expect_comptime_value(in, f, type->args[0], &val_size);
+      if (!ok) {
+        return Step_encountered_error;
+      }
+
+      TypeIndex base_type;
+      ok = expect_type_value(in, f, type->args[1], &base_type);
+      if (!ok) {
+        return Step_encountered_error;
+      }
+
+      Value *v = values_get(in->values, val_size);
+      if (v->type != in->common->type.comptime_int) {
+        report_error(in, f, pc, string_lit("Size of an array must be a comptime_int"));
+        return Step_encountered_error;
+      }
+
+      ComptimeInt size;
+      memcpy(&size, value_data(v), sizeof(ComptimeInt));
+
+      // The payload of a value is at most 4GiB.
+      u64 stride = types_size_info_by_index(in->types, base_type).stride;
+      if (size < 0 || Cast(u64, size) * stride > UINT32_MAX) {
+        report_error(in, f, pc, string_lit("Size of an array is out of range"));
+        return Step_encountered_error;
+      }
+
+      t = types_add(in->types, &(Type){
+        .kind = Type_array,
+        .data.array = { .base_type = base_type, .size = Cast(u64, size) },
+      });
+    } break;
+    case Type_optional: {
+      Assert(type->arg_count == 1);
+
+      TypeIndex base_type;
+      b32 ok = expect_type_value(in, f, type->args[0], &base_type);
+      if (!ok) {
+        return Step_encountered_error;
+      }
+
+      t = types_add(in->types, &(Type){
+        .kind = Type_optional,
+        .data.optional = { .base_type = base_type },
+      });
+    } break;
+    case Type_range: {
+      Assert(type->arg_count == 3);
+
+      ComptimeInt bounds[2];
+      for (u32 i = 0; i < 2; i++) {
+        ValueIndex val_bound;
+        b32 ok = expect_comptime_value(in, f, type->args[i], &val_bound);
+        if (!ok) {
+          return Step_encountered_error;
+        }
+
+        Value *v = values_get(in->values, val_bound);
+        if (v->type != in->common->type.comptime_int) {
+          report_error(in, f, pc, string_lit("Bounds of a range must be a comptime_int"));
+          return Step_encountered_error;
+        }
+
+        memcpy(&bounds[i], value_data(v), sizeof(ComptimeInt));
+      }
+
+      ValueIndex val_inclusive;
+      b32 ok = expect_comptime_value(in, f, type->args[2], &val_inclusive);
+      Assert(ok);
+
+      b32 is_inclusive = *Cast(u8*, value_data(values_get(in->values, val_inclusive))) != 0;
+
+      ComptimeInt min = bounds[0];
+      ComptimeInt max = bounds[1];
+
+      // Checked before the exclusive max is made inclusive, which would overflow for INT64_MIN.
+      b32 is_empty = is_inclusive ? (min > max) : (min >= max);
+      if (is_empty) {
+        report_error(in, f, pc, string_lit("Range is empty"));
+        return Step_encountered_error;
+      }
+
+      if (!is_inclusive) {
+        max -= 1;
+      }
+
+      t = types_add(in->types, &(Type){
+        .kind = Type_range,
+        .data.range = { .min = min, .max = max },
+      });
+    } break;
     default: Panic();
     }
     ValueIndex v = val_from_type(in, t);
     store_inst_value(f, pc, resolved_ref_from_value_index(v));
     s->pc += 1;
   } break;
+  case IR_type_struct: {
+    IrTypeStruct *type_struct = chunk_extra(f->chunk, pc);
+    u32 field_count = type_struct->field_count;
+
+    ArenaSnapshot snapshot = arena_scope_begin(in->scratch);
+
+    Type *type = arena_push_type_struct(in->scratch, field_count);
+    type->kind = Type_struct;
+    type->data.struct_.is_ordered  = type_struct->is_ordered;
+    type->data.struct_.field_count = field_count;
+
+    for (u32 i = 0; i < field_count; i++) {
+      IrStructField *field = &type_struct->fields[i];
+
+      TypeIndex field_type;
+      b32 ok = expect_type_value(in, f, field->type, &field_type);
+      if (!ok) {
+        arena_scope_end(in->scratch, snapshot);
+        return Step_encountered_error;
+      }
+
+      type->data.struct_.fields[i] = (TypeStructField){
+        .name      = field->name,
+        .type      = field_type,
+        .placement = field->placement,
+      };
+    }
+
+    if (!types_struct_layout(in->types, in->scratch, type)) {
+      arena_scope_end(in->scratch, snapshot);
+      report_error(in, f, pc, string_lit("Size of a struct is out of range"));
+      return Step_encountered_error;
+    }
+
+    TypeIndex t = types_add(in->types, type);
+
+    arena_scope_end(in->scratch, snapshot);
+
+    ValueIndex v = val_from_type(in, t);
+    store_inst_value(f, pc, resolved_ref_from_value_index(v));
+    s->pc += 1;
+  } break;
+  case IR_builtin_layout: {
+    IrLayout *layout = chunk_extra(f->chunk, pc);
+
+    TypeIndex type;
+    b32 ok = expect_type_value(in, f, layout->type, &type);
+    if (!ok) {
+      return Step_encountered_error;
+    }
+
+    if (!types_is_complete(in->types, type)) {
+      report_error(in, f, pc, string_lit("Layout of an incomplete type is unknown"));
+      return Step_encountered_error;
+    }
+
+    TypeSizeInfo size_info = types_size_info_by_index(in->types, type);
+
+    ComptimeInt res;
+    switch (Cast(BuiltinKind, layout->builtin)) {
+    case Builtin_size_of:  res = size_info.size;  break;
+    case Builtin_align_of: res = size_info.align; break;
+    case Builtin_offset_of: {
+      Type *t = types_get(in->types, type);
+      if (t->kind != Type_struct) {
+        report_error(in, f, pc, string_lit("#offset_of expects a struct type"));
+        return Step_encountered_error;
+      }
+
+      u32 i = 0;
+      for (; i < t->data.struct_.field_count; i++) {
+        if (t->data.struct_.fields[i].name == layout->field) {
+          break;
+        }
+      }
+
+      if (i == t->data.struct_.field_count) {
+        report_error(in, f, pc, string_lit("Struct has no field with this name"));
+        return Step_encountered_error;
+      }
+
+      res = t->data.struct_.fields[i].offset;
+    } break;
+    default: Unreachable();
+    }
+
+    ValueIndex v = values_intern_typed(in->values, in->common->type.comptime_int, ComptimeInt, &res);
+
+    f->inst_types[pc] = in->common->type.comptime_int;
+    store_inst_value(f, pc, resolved_ref_from_value_index(v));
+
+    s->pc += 1;
+  } break;
   case IR_unify: {
     IrUnify *unify = chunk_extra(f->chunk, pc);
 
@@ -649,7 +868,7 @@ internal u32 step(Specializer *in, RunState *state) {
     }
 
     TypeIndex type_unified;
-    u32 err = eval_unify(in->scratch, in->types, type_lhs, type_rhs, &type_unified);
+    u32 err = eval_unify(in->scratch, in->types, in->unify_cache, type_lhs, type_rhs, &type_unified);
     Assert(!err);
 
     ValueIndex v = val_from_type(in, type_unified);
@@ -716,14 +935,8 @@ internal u32 step(Specializer *in, RunState *state) {
 
       TypeIndex t = types_add(in->types, type);
 
-      ValueFunc *data = values_alloc_data_type(in->values, ValueFunc);
-      Value *v;
-      ValueIndex vidx = values_alloc(in->values, &v);
-      *v = (Value){
-        .type = t,
-        .data = data,
-        .data_size = sizeof(ValueFunc),
-      };
+      ValueFunc *data;
+      ValueIndex vidx = values_alloc_typed(in->values, t, ValueFunc, &data);
 
       IrBuilder *builder = get_builder(in);
 
@@ -747,7 +960,7 @@ internal u32 step(Specializer *in, RunState *state) {
     ResolvedRef cond = resolve(f, condbr->cond);
     if (ref_is_some_value_index(cond)) {
       Value *v = values_get(in->values, ref_to_value_index(cond));
-      if (*Cast(u8*,v->data)) {
+      if (*Cast(u8*,value_data(v))) {
         s->pc = condbr->then;
       } else {
         s->pc = condbr->otherwise;
@@ -824,6 +1037,253 @@ internal u32 step(Specializer *in, RunState *state) {
 
     s->pc += 1;
   } break;
+  case IR_binary_op: {
+    IrBinaryOp *binary_op = chunk_extra(f->chunk, pc);
+    TypeIndex type_comptime_int = in->common->type.comptime_int;
+
+    ResolvedRef operands[2] = { resolve(f, binary_op->lhs), resolve(f, binary_op->rhs) };
+    IrRef operand_refs[2] = { binary_op->lhs, binary_op->rhs };
+
+    TypeIndex operand_types[2];
+    for (u32 i = 0; i < 2; i++) {
+      operand_types[i] = ref_is_some_value_index(operands[i])
+        ? type_of_val(in, ref_to_value_index(operands[i]))
+        : ref_typeof(in, f, operand_refs[i]);
+    }
+
+    // A comptime_int operand is coerced to the type of the other operand. Only one of the operands
+    // can be coerced, because comptime_int is coerced to nothing when both are comptime_int.
+    ValueIndex coerced = 0;
+    for (u32 i = 0; i < 2; i++) {
+      TypeIndex other = operand_types[1 - i];
+      if (operand_types[i] != type_comptime_int || other == type_comptime_int) {
+        continue;
+      }
+
+      Value *v = values_get(in->values, ref_to_value_index(operands[i]));
+      u32 err = eval_coerce(in->types, in->values, other, v, &coerced);
+      if (err) {
+        report_error(in, f, pc, (err == CoerceResult_comptime_int_value_out_of_range)
+          ? string_lit("Value of comptime_int is out of range of the other operand")
+          : string_lit("Operands of a binary operation must have the same type"));
+        return Step_encountered_error;
+      }
+
+      operands[i] = resolved_ref_from_value_index(coerced);
+      operand_types[i] = other;
+    }
+
+    TypeIndex type_res = 0;
+    b32 is_valid = operand_types[0] == operand_types[1] &&
+      binary_op_result_type(in->types, binary_op->op, operand_types[0], in->common->type.bool, &type_res);
+
+    if (!is_valid) {
+      if (coerced) {
+        values_dealloc(in->values, coerced);
+      }
+
+      report_error(in, f, pc, (operand_types[0] != operand_types[1])
+        ? string_lit("Operands of a binary operation must have the same type")
+        : string_lit("Invalid operand types for binary operation"));
+      return Step_encountered_error;
+    }
+
+    f->inst_types[pc] = type_res;
+
+    if (ref_is_some_value_index(operands[0]) && ref_is_some_value_index(operands[1])) {
+      Value *lhs = values_get(in->values, ref_to_value_index(operands[0]));
+      Value *rhs = values_get(in->values, ref_to_value_index(operands[1]));
+
+      ValueIndex res;
+      u32 err = eval_binary_op(in->scratch, in->types, in->values, in->common->type.bool, binary_op->op, lhs, rhs, &res);
+
+      if (coerced) {
+        values_dealloc(in->values, coerced);
+      }
+
+      switch (err) {
+      case BinaryOpResult_ok: break;
+      case BinaryOpResult_invalid_operand_types: {
+        report_error(in, f, pc, string_lit("Invalid operand types for binary operation"));
+        return Step_encountered_error;
+      }
+      case BinaryOpResult_division_by_zero: {
+        report_error(in, f, pc, string_lit("Division by zero"));
+        return Step_encountered_error;
+      }
+      case BinaryOpResult_comptime_int_overflow: {
+        report_error(in, f, pc, string_lit("Result of comptime_int operation is out of range"));
+        return Step_encountered_error;
+      }
+      case BinaryOpResult_range_value_out_of_range: {
+        report_error(in, f, pc, string_lit("Result of operation is out of range of its range type"));
+        return Step_encountered_error;
+      }
+      }
+
+      store_inst_value(f, pc, resolved_ref_from_value_index(res));
+      s->pc += 1;
+      break;
+    }
+
+    // The residual instruction owns the values it refers to. A coerced operand already belongs to it.
+    for (u32 i = 0; i < 2; i++) {
+      if (ref_is_some_value_index(operands[i]) && ref_to_value_index(operands[i]) != coerced) {
+        operands[i] = resolved_ref_from_value_index(values_copy(in->values, ref_to_value_index(operands[i])));
+      }
+    }
+
+    IrBuilder *builder = get_builder(in);
+    InstructionIndex inst = inst_alloc(builder);
+    inst_set_opcode(builder, inst, IR_binary_op);
+    IrBinaryOp *data = inst_push_data(builder, inst, IrBinaryOp);
+    *data = (IrBinaryOp){
+      .op  = binary_op->op,
+      .lhs = operands[0],
+      .rhs = operands[1],
+    };
+
+    store_inst_value(f, pc, resolved_ref_from_instruction_index(inst));
+
+    s->pc += 1;
+  } break;
+  case IR_sequence: {
+    IrSequence *sequence = chunk_extra(f->chunk, pc);
+
+    TypeIndex type;
+    b32 ok = expect_type_value_or_nil(in, f, sequence->type, &type);
+    if (!ok) {
+      return Step_encountered_error;
+    }
+
+    if (!type) {
+      report_error(in, f, pc, string_lit("Type of sequence literal cannot be inferred"));
+      return Step_encountered_error;
+    }
+
+    // A literal of an optional type is some value of its base type.
+    TypeIndex optional_type = 0;
+    if (types_get(in->types, type)->kind == Type_optional) {
+      optional_type = type;
+      type = types_get(in->types, type)->data.optional.base_type;
+    }
+
+    // An array literal has an item per element, a struct literal has an item per field in
+    // declaration order.
+    Type *t = types_get(in->types, type);
+    b32 is_array  = t->kind == Type_array && t->data.array.size == sequence->count;
+    b32 is_struct = t->kind == Type_struct && t->data.struct_.field_count == sequence->count;
+    if (!is_array && !is_struct) {
+      report_error(in, f, pc, string_lit("Sequence literal does not match its array or struct type"));
+      return Step_encountered_error;
+    }
+
+    TypeSizeInfo size_info = types_size_info_by_index(in->types, type);
+
+    void *data;
+    ValueIndex v = values_alloc(in->values, type, size_info.size, size_info.align, &data);
+
+    // Zero the padding between struct fields, so equal values have equal payloads.
+    memset(data, 0, size_info.size);
+
+    for (u32 i = 0; i < sequence->count; i++) {
+      ValueIndex item;
+      ok = expect_comptime_value(in, f, sequence->items[i], &item);
+      if (!ok) {
+        values_dealloc(in->values, v);
+        return Step_encountered_error;
+      }
+
+      TypeIndex item_type;
+      u32 offset;
+      if (is_array) {
+        item_type = t->data.array.base_type;
+        offset    = i * types_size_info_by_index(in->types, item_type).stride;
+      } else {
+        item_type = t->data.struct_.fields[i].type;
+        offset    = t->data.struct_.fields[i].offset;
+      }
+
+      ValueIndex coerced;
+      u32 err = eval_coerce(in->types, in->values, item_type, values_get(in->values, item), &coerced);
+      if (err) {
+        values_dealloc(in->values, v);
+        report_error(in, f, pc, (err == CoerceResult_comptime_int_value_out_of_range)
+          ? string_lit("Value of comptime_int is out of range of the item's type")
+          : string_lit("Item of sequence literal does not match its type"));
+        return Step_encountered_error;
+      }
+
+      Value *x = values_get(in->values, coerced);
+      memcpy(ptr_offset(data, offset), value_data(x), types_size_info_by_index(in->types, item_type).size);
+      values_dealloc(in->values, coerced);
+    }
+
+    if (optional_type) {
+      ValueIndex some;
+      u32 err = eval_coerce(in->types, in->values, optional_type, values_get(in->values, v), &some);
+      Assert(err == CoerceResult_ok);
+
+      values_dealloc(in->values, v);
+      v    = some;
+      type = optional_type;
+    }
+
+    f->inst_types[pc] = type;
+    store_inst_value(f, pc, resolved_ref_from_value_index(v));
+
+    s->pc += 1;
+  } break;
+  case IR_builtin_reduce: {
+    IrReduce *reduce = chunk_extra(f->chunk, pc);
+    ResolvedRef val = resolve(f, reduce->value);
+
+    TypeIndex operand_type = ref_is_some_value_index(val)
+      ? type_of_val(in, ref_to_value_index(val))
+      : ref_typeof(in, f, reduce->value);
+
+    TypeIndex type_res;
+    u32 err = reduce_result_type(in->types, reduce->builtin, operand_type, &type_res);
+    switch (err) {
+    case ReduceResult_ok: break;
+    case ReduceResult_invalid_operand_type: {
+      report_error(in, f, pc, string_lit("Invalid operand type for reduction"));
+      return Step_encountered_error;
+    }
+    case ReduceResult_empty_array: {
+      report_error(in, f, pc, string_lit("Empty array has no minimum or maximum"));
+      return Step_encountered_error;
+    }
+    }
+
+    f->inst_types[pc] = type_res;
+
+    if (ref_is_some_value_index(val)) {
+      ValueIndex res;
+      err = eval_reduce(in->scratch, in->types, in->values, reduce->builtin, values_get(in->values, ref_to_value_index(val)), &res);
+      Assert(err == ReduceResult_ok);
+
+      store_inst_value(f, pc, resolved_ref_from_value_index(res));
+      s->pc += 1;
+      break;
+    }
+
+    IrBuilder *builder = get_builder(in);
+    InstructionIndex inst = inst_alloc(builder);
+    inst_set_opcode(builder, inst, IR_builtin_reduce);
+    IrReduce *data = inst_push_data(builder, inst, IrReduce);
+    *data = (IrReduce){
+      .builtin = reduce->builtin,
+      .value   = val,
+    };
+
+    store_inst_value(f, pc, resolved_ref_from_instruction_index(inst));
+
+    s->pc += 1;
+  } break;
+  case IR_nop: {
+    s->pc += 1;
+  } break;
   default: Todo();
   }
 
@@ -74,6 +74,7 @@ typedef struct {
 
   DeclarationInterner *declarations;
   TypeInterner        *types;
+  UnifyCache          *unify_cache;
   ValueStore          *values;
   Common              *common;
 
@@ -17,6 +17,7 @@ b32 str_eq(void *context, String a, String b) {
 #define INTERNER_TYPE            String
 #define INTERNER_INDEX_TYPE      StringIndex
 #define INTERNER_FUNCTION_PREFIX strings
+#define INTERNER_LOCKED
 #define INTERNER_HASH_FN         str_hash
 #define INTERNER_COMPARE_FN      str_eq
 #define INTERNER_COPY_FN         arena_copy_string
@@ -7,6 +7,7 @@
 #define INTERNER_TYPE            String
 #define INTERNER_INDEX_TYPE      StringIndex
 #define INTERNER_FUNCTION_PREFIX strings
+#define INTERNER_LOCKED
 #define INTERNER_OUTPUT_TYPES
 #define INTERNER_OUTPUT_DECLARATIONS
 #include "interner.h"
@@ -0,0 +1,85 @@
+#ifndef TIME_PASSES_H
+#define TIME_PASSES_H
+
+#include "blu.h"
+
+// `--time-passes` reports, after every build, the wall and CPU time of each phase of the build and
+// of each source in the frontend, and how much memory the arenas of the compiler and the sources
+// use. For every arena it has the bytes in use at the end of the build, the most that were in use
+// at any point and the bytes committed. The memory that does not live in one of those arenas is
+// reported as well: the most bytes in use in the scratch arena of a frontend worker, and per source
+// the bytes committed for its tokens and the most bytes in use in the scratch arenas of its parse.
+// The report is printed by `time_passes_print`.
+//
+// The frontend processes sources in parallel, so the CPU time of a phase of a source is that of the
+// thread that processed it. The threads that tokenize and parse the chunks of a large source are
+// not counted there, but they are in the CPU time of the frontend as a whole.
+
+enum CompilePhase {
+  CompilePhase_frontend,     // Reads, tokenizes, parses and indexes the sources.
+  CompilePhase_declarations, // Adds the declarations of all sources to the declaration map.
+  CompilePhase_codegen,      // Generates and optimizes the IR of every declaration, except for
+                             // the function bodies that are deferred.
+  CompilePhase_resolve,      // Evaluates the declarations and generates the deferred bodies
+                             // that are needed.
+  CompilePhase_optimize,     // Optimizes the residual functions.
+  CompilePhase_run,          // Runs `main.main`.
+  CompilePhase_count,
+};
+
+enum SourcePhase {
+  SourcePhase_read,
+  SourcePhase_cache_load,
+  SourcePhase_tokenize,
+  SourcePhase_parse,
+  SourcePhase_cache_store,
+  SourcePhase_index,
+  SourcePhase_count,
+};
+
+typedef struct {
+  u64 wall_ns;
+  u64 cpu_ns;
+} PhaseTime;
+
+// Adds the time between two calls to the current phase in `times`.
+typedef struct {
+  PhaseTime *times;
+  u32        phase;
+  b32        per_thread; // Measure the CPU time of the calling thread instead of the process.
+  PhaseTime  start;
+} PhaseTimer;
+
+internal always_inline PhaseTime phase_time_now(b32 per_thread) {
+  return (PhaseTime){
+    .wall_ns = time_now_ns(),
+    .cpu_ns  = per_thread ? thread_cpu_time_ns() : process_cpu_time_ns(),
+  };
+}
+
+internal always_inline void phase_timer_begin(PhaseTimer *timer, PhaseTime *times, u32 phase, b32 per_thread) {
+  *timer = (PhaseTimer){
+    .times      = times,
+    .phase      = phase,
+    .per_thread = per_thread,
+    .start      = phase_time_now(per_thread),
+  };
+}
+
+// Ends the current phase and starts `phase`.
+internal always_inline void phase_timer_next(PhaseTimer *timer, u32 phase) {
+  PhaseTime now = phase_time_now(timer->per_thread);
+
+  PhaseTime *t = &timer->times[timer->phase];
+  t->wall_ns += now.wall_ns - timer->start.wall_ns;
+  t->cpu_ns  += now.cpu_ns  - timer->start.cpu_ns;
+
+  timer->phase = phase;
+  timer->start = now;
+}
+
+internal always_inline void phase_timer_end(PhaseTimer *timer) {
+  phase_timer_next(timer, timer->phase);
+}
+
+#endif // TIME_PASSES_H
@@ -1,36 +1,7 @@
 #include "blu.h"
 #include "tokens.h"
 #include "source_file.h"
-
-#define SEGMENTLIST_NAME            KindList
-#define SEGMENTLIST_TYPE            u8
-#define SEGMENTLIST_FUNCTION_PREFIX kindlist
-#define SEGMENTLIST_LINKAGE         internal
-#define SEGMENTLIST_MIN_SIZE_LOG2   8
-#define SEGMENTLIST_SEGMENT_COUNT   24
-#define SEGMENTLIST_OUTPUT_TYPES
-#define SEGMENTLIST_OUTPUT_DEFINITIONS
-#include "segment_list.h"
-
-#define SEGMENTLIST_NAME            SpanList
-#define SEGMENTLIST_TYPE            SpanU32
-#define SEGMENTLIST_FUNCTION_PREFIX spanlist
-#define SEGMENTLIST_LINKAGE         internal
-#define SEGMENTLIST_MIN_SIZE_LOG2   8
-#define SEGMENTLIST_SEGMENT_COUNT   24
-#define SEGMENTLIST_OUTPUT_TYPES
-#define SEGMENTLIST_OUTPUT_DEFINITIONS
-#include "segment_list.h"
-
-#define SEGMENTLIST_NAME            OffsetList
-#define SEGMENTLIST_TYPE            u32
-#define SEGMENTLIST_FUNCTION_PREFIX lines
-#define SEGMENTLIST_LINKAGE         internal
-#define SEGMENTLIST_MIN_SIZE_LOG2   8
-#define SEGMENTLIST_SEGMENT_COUNT   24
-#define SEGMENTLIST_OUTPUT_TYPES
-#define SEGMENTLIST_OUTPUT_DEFINITIONS
-#include "segment_list.h"
+#include "simd.h"
 
 enum TokenizerResult {
   TokResult_ok,
@@ -43,10 +14,14 @@ typedef struct {
   u8 const *end;
   u8 const *at;
 
+  // The byte offset of `start` in the source, which is not 0 for a chunk. Messages are located in
+  // the source.
+  u32 offset;
+
   MessageSink *msg_sink;
 } Tokenizer;
 
-internal b32 is_whitespace_except_newline(u8 c) { return (c == ' ') || (c == '\r') || (c == '\t'); }
+internal b32 is_whitespace(u8 c) { return (c == ' ') || (c == '\r') || (c == '\t') || (c == '\n'); }
 internal b32 is_numeric(u8 c) { return c >= '0' && c <= '9'; }
 internal b32 is_alpha(u8 c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
 internal b32 is_identifier_start(u8 c) { return c == '_' || is_alpha(c); }
@@ -56,18 +31,39 @@ internal b32 is_at_end(Tokenizer *tokenizer) {
   return tokenizer->at == tokenizer->end;
 }
 
-internal void skip_whitespace(Tokenizer *tokenizer) {
-  while (!is_at_end(tokenizer) && is_whitespace_except_newline(*tokenizer->at)) {
-    tokenizer->at += 1;
-  }
+internal u32 remaining(Tokenizer *tokenizer) {
+  return Cast(u32, tokenizer->end - tokenizer->at);
 }
 
+// The scanning loops below first skip as many bytes as they can a vector at a time with
+// `simd_scan`, and then continue byte by byte from where it stopped.
+
 internal void step_until_new_line(Tokenizer *tokenizer) {
+  tokenizer->at += simd_scan(Scan_until, tokenizer->at, remaining(tokenizer), '\n', '\n');
+
   while (!is_at_end(tokenizer) && *tokenizer->at != '\n') {
     tokenizer->at += 1;
   }
 }
 
+// Newlines are skipped like any other whitespace, the offsets of the lines are already found by
+// `scan_lines`.
+internal void skip_whitespace_and_comments(Tokenizer *tokenizer) {
+  while (True) {
+    tokenizer->at += simd_scan(Scan_whitespace, tokenizer->at, remaining(tokenizer), 0, 0);
+
+    while (!is_at_end(tokenizer) && is_whitespace(*tokenizer->at)) {
+      tokenizer->at += 1;
+    }
+
+    if (is_at_end(tokenizer) || *tokenizer->at != ';') {
+      return;
+    }
+
+    step_until_new_line(tokenizer);
+  }
+}
+
 #define Return_token(Kind)                                                                         \
   {                                                                                                \
     *kind       = Kind;                                                                            \
@@ -76,13 +72,118 @@ internal void step_until_new_line(Tokenizer *tokenizer) {
     return TokResult_ok;                                                                           \
   }
 
-#define Return_if_match(s, Kind)                                                                   \
-  if (string_eq(string_lit(s), (String){.str = token_start, .len = Cast(usize, tokenizer->at - token_start)})) { \
-    Return_token(Kind);                                                                            \
+#define Return_if_keyword(lit, Kind)                                                               \
+  if (word.len == sizeof(lit) - 1 && memcmp(word.str, lit, sizeof(lit) - 1) == 0) {                \
+    return Kind;                                                                                   \
   }
 
+// The token kind of a keyword or builtin, or Tok_kind_max if `word` is neither. The first byte, or
+// the second one of a builtin, selects the few words that can match. The builtins that also share
+// their length are told apart by their third byte, so that an identifier is compared with at most
+// one word.
+internal u8 keyword_kind(String word) {
+  u8 first = word.str[0];
+  if (first == '#') {
+    if (word.len < 2) {
+      return Tok_kind_max;
+    }
+
+    first = word.str[1];
+
+    // clang-format off
+    switch (first) {
+    case 'a':
+      if (word.len > 2 && word.str[2] == 'l') {
+        Return_if_keyword("#all",      Tok_builtin_all);
+        Return_if_keyword("#align_of", Tok_builtin_align_of);
+      } else {
+        Return_if_keyword("#any",      Tok_builtin_any);
+      }
+      break;
+    case 'c':
+      Return_if_keyword("#cold",      Tok_attribute_cold);
+      break;
+    case 'd':
+      Return_if_keyword("#debug",     Tok_builtin_debug);
+      break;
+    case 'h':
+      Return_if_keyword("#hot",       Tok_attribute_hot);
+      break;
+    case 'm':
+      if (word.len > 2 && word.str[2] == 'i') {
+        Return_if_keyword("#min", Tok_builtin_min);
+      } else {
+        Return_if_keyword("#max", Tok_builtin_max);
+      }
+      break;
+    case 'o':
+      Return_if_keyword("#offset_of", Tok_builtin_offset_of);
+      Return_if_keyword("#ordered",   Tok_attribute_ordered);
+      break;
+    case 's':
+      Return_if_keyword("#sum",       Tok_builtin_sum);
+      Return_if_keyword("#size_of",   Tok_builtin_size_of);
+      break;
+    }
+    // clang-format on
+
+    return Tok_kind_max;
+  }
+
+  // clang-format off
+  switch (first) {
+  case 'a':
+    Return_if_keyword("and",      Tok_keyword_and);
+    Return_if_keyword("as",       Tok_keyword_as);
+    break;
+  case 'b':
+    Return_if_keyword("break",    Tok_keyword_break);
+    Return_if_keyword("bitcast",  Tok_keyword_bitcast);
+    break;
+  case 'c':
+    Return_if_keyword("cast",     Tok_keyword_cast);
+    Return_if_keyword("const",    Tok_keyword_const);
+    Return_if_keyword("continue", Tok_keyword_continue);
+    break;
+  case 'd':
+    Return_if_keyword("do",       Tok_keyword_do);
+    Return_if_keyword("defer",    Tok_keyword_defer);
+    break;
+  case 'e':
+    Return_if_keyword("else",     Tok_keyword_else);
+    break;
+  case 'f':
+    Return_if_keyword("for",      Tok_keyword_for);
+    break;
+  case 'i':
+    Return_if_keyword("if",       Tok_keyword_if);
+    Return_if_keyword("inline",   Tok_keyword_inline);
+    break;
+  case 'm':
+    Return_if_keyword("mod",      Tok_keyword_mod);
+    break;
+  case 'n':
+    Return_if_keyword("no_cache", Tok_keyword_no_cache);
+    break;
+  case 'o':
+    Return_if_keyword("or",       Tok_keyword_or);
+    break;
+  case 'r':
+    Return_if_keyword("return",   Tok_keyword_return);
+    break;
+  case 's':
+    Return_if_keyword("struct",   Tok_keyword_struct);
+    break;
+  }
+  // clang-format on
+
+  return Tok_kind_max;
+}
+
+#undef Return_if_keyword
+
 internal u32 next(Tokenizer *tokenizer, u8 *kind, SpanU32 *span) {
-  skip_whitespace(tokenizer);
+  skip_whitespace_and_comments(tokenizer);
 
   if (is_at_end(tokenizer)) {
     return TokResult_end;
@@ -96,7 +197,6 @@ internal u32 next(Tokenizer *tokenizer, u8 *kind, SpanU32 *span) {
   // clang-format off
   switch (c) {
   case ',': Return_token(Tok_comma);
-  case '.': Return_token(Tok_dot);
   case ':': Return_token(Tok_colon);
   case '{': Return_token(Tok_brace_open);
   case '}': Return_token(Tok_brace_close);
@@ -111,13 +211,23 @@ internal u32 next(Tokenizer *tokenizer, u8 *kind, SpanU32 *span) {
   case '|': Return_token(Tok_bar);
   case '^': Return_token(Tok_caret);
   case '~': Return_token(Tok_tilde);
-  case '\n': Return_token(Tok_newline);
+  case '?': Return_token(Tok_question);
   }
   // clang-format on
 
-  if (c == ';') {
-    step_until_new_line(tokenizer);
-    Return_token(Tok_line_comment);
+  if (c == '.') {
+    if (is_at_end(tokenizer) || *tokenizer->at != '.') {
+      Return_token(Tok_dot);
+    }
+
+    tokenizer->at += 1;
+
+    if (!is_at_end(tokenizer) && *tokenizer->at == '=') {
+      tokenizer->at += 1;
+      Return_token(Tok_dot_dot_equals);
+    }
+
+    Return_token(Tok_dot_dot);
   }
 
   if (c == '-') {
@@ -206,6 +316,11 @@ internal u32 next(Tokenizer *tokenizer, u8 *kind, SpanU32 *span) {
 
   if (c == '"') {
     while (!is_at_end(tokenizer) && *tokenizer->at != '"') {
+      tokenizer->at += simd_scan(Scan_until, tokenizer->at, remaining(tokenizer), '"', '\\');
+      if (is_at_end(tokenizer) || *tokenizer->at == '"') {
+        break;
+      }
+
       if (*tokenizer->at == '\\') {
         tokenizer->at += 1;
         if (is_at_end(tokenizer)) {
@@ -220,7 +335,7 @@ internal u32 next(Tokenizer *tokenizer, u8 *kind, SpanU32 *span) {
         tokenizer->msg_sink,
         (MessageLocation){ 
           .kind = MessageLocation_byte_offset,
-          .data.offset = Cast(u32, tokenizer->end - tokenizer->start),
+          .data.offset = tokenizer->offset + Cast(u32, tokenizer->end - tokenizer->start),
         },
         string_lit("End of source encountered while parsing string literal.")
       );
@@ -241,18 +356,23 @@ internal u32 next(Tokenizer *tokenizer, u8 *kind, SpanU32 *span) {
   }
 
   if (is_identifier_start(c) || c == '#') {
+    tokenizer->at += simd_scan(Scan_identifier, tokenizer->at, remaining(tokenizer), 0, 0);
+
     while (!is_at_end(tokenizer) && is_identifier_rest(*tokenizer->at)) {
       tokenizer->at += 1;
     }
 
-    if (c == '#') {
-      Return_if_match("#debug", Tok_builtin_debug);
+    u8 keyword = keyword_kind((String){ .str = token_start, .len = Cast(usize, tokenizer->at - token_start) });
+    if (keyword != Tok_kind_max) {
+      Return_token(keyword);
+    }
 
+    if (c == '#') {
       Message_error(
         tokenizer->msg_sink,
         (MessageLocation){
           .kind = MessageLocation_byte_offset,
-          .data.offset = Cast(u32, ptr_diff(token_start, tokenizer->start)),
+          .data.offset = tokenizer->offset + Cast(u32, ptr_diff(token_start, tokenizer->start)),
         },
         string_lit("Unrecognized builtin encountered.")
       );
@@ -260,26 +380,6 @@ internal u32 next(Tokenizer *tokenizer, u8 *kind, SpanU32 *span) {
       return TokResult_error;
     }
 
-    // clang-format off
-    Return_if_match("return",   Tok_keyword_return);
-    Return_if_match("if",       Tok_keyword_if);
-    Return_if_match("else",     Tok_keyword_else);
-    Return_if_match("for",      Tok_keyword_for);
-    Return_if_match("do",       Tok_keyword_do);
-    Return_if_match("break",    Tok_keyword_break);
-    Return_if_match("continue", Tok_keyword_continue);
-    Return_if_match("and",      Tok_keyword_and);
-    Return_if_match("or",       Tok_keyword_or);
-    Return_if_match("defer",    Tok_keyword_defer);
-    Return_if_match("const",    Tok_keyword_const);
-    Return_if_match("cast",     Tok_keyword_cast);
-    Return_if_match("bitcast",  Tok_keyword_bitcast);
-    Return_if_match("as",       Tok_keyword_as);
-    Return_if_match("mod",      Tok_keyword_mod);
-    Return_if_match("no_cache", Tok_keyword_no_cache);
-    Return_if_match("inline",   Tok_keyword_inline);
-    // clang-format on
-
     Return_token(Tok_identifier);
   }
 
@@ -287,7 +387,7 @@ internal u32 next(Tokenizer *tokenizer, u8 *kind, SpanU32 *span) {
     tokenizer->msg_sink,
     (MessageLocation){
       .kind = MessageLocation_byte_offset,
-      .data.offset = Cast(u32, ptr_diff(token_start, tokenizer->start)),
+      .data.offset = tokenizer->offset + Cast(u32, ptr_diff(token_start, tokenizer->start)),
     },
     string_lit("Unrecognized token encountered.")
   );
@@ -295,34 +395,121 @@ internal u32 next(Tokenizer *tokenizer, u8 *kind, SpanU32 *span) {
   return TokResult_error;
 }
 
-LineInfo tokens_find_line_info(String text, Tokens *tokens, u32 byte_offset) {
-  // OPTIMIZE: A binary search is probably faster for big enough files and a better default.
-  u32 len = tokens->line_count;
-  for (u32 i = 1; i < len; i++) {
-    u32 offset = tokens->lines[i];
-    if (offset > byte_offset) {
-      u32 offset_prev = tokens->lines[i-1];
-      return (LineInfo){
-        .line = i,
-        .offset_start_of_line = offset_prev,
-        .line_len = offset - offset_prev,
-      };
+void position_index_init(PositionIndex *index, String text, Tokens *tokens) {
+  *index = (PositionIndex){
+    .text       = text,
+    .lines      = tokens->lines,
+    .line_count = tokens->line_count,
+  };
+}
+
+// The index of the line that contains `offset`, searching from line index `first` on.
+internal u32 find_line(PositionIndex *index, u32 first, u32 offset) {
+  u32 lo = first;
+  u32 hi = index->line_count;
+
+  // Find the last line that starts at or before `offset`.
+  while (hi - lo > 1) {
+    u32 mid = lo + (hi - lo) / 2;
+    if (index->lines[mid] <= offset) {
+      lo = mid;
+    } else {
+      hi = mid;
     }
   }
 
-  u32 offset = text.len;
-  for (u32 i = byte_offset; i < text.len; i++) {
-    if (text.str[i] == '\n') {
-      offset = i;
-      break;
+  return lo;
+}
+
+internal SourcePosition line_position(PositionIndex *index, u32 line) {
+  u32 start = index->lines[line];
+  u32 end   = (line + 1 < index->line_count) ? index->lines[line + 1] - 1 : Cast(u32, index->text.len);
+
+  return (SourcePosition){
+    .line        = line + 1,
+    .col         = 1,
+    .display_col = 1,
+    .line_start  = start,
+    .line_len    = end - start,
+  };
+}
+
+// Advances the columns of `pos` over the bytes from `from` up to `to`. Continuation bytes of UTF-8
+// sequences do not start a new column.
+internal void advance_columns(PositionIndex *index, SourcePosition *pos, u32 from, u32 to) {
+  u8 const *s = index->text.str;
+
+  for (u32 i = from; i < to; i++) {
+    u8 c = s[i];
+    if ((c & 0xC0) == 0x80) {
+      continue;
+    }
+
+    pos->col += 1;
+
+    if (c == '\t') {
+      pos->display_col = (pos->display_col - 1) / POSITION_TAB_WIDTH * POSITION_TAB_WIDTH + POSITION_TAB_WIDTH + 1;
+    } else {
+      pos->display_col += 1;
     }
   }
+}
 
-  return (LineInfo){
-    .line = len,
-    .offset_start_of_line = tokens->lines[len-1],
-    .line_len = offset - tokens->lines[len-1],
-  };
+SourcePosition position_find(PositionIndex *index, u32 offset) {
+  SourcePosition pos  = index->cached;
+  u32            from = index->cached_offset;
+
+  b32 is_on_cached_line = pos.line != 0 && offset >= from && offset <= pos.line_start + pos.line_len;
+  if (!is_on_cached_line) {
+    pos  = line_position(index, find_line(index, 0, offset));
+    from = pos.line_start;
+  }
+
+  advance_columns(index, &pos, from, offset);
+
+  index->cached        = pos;
+  index->cached_offset = offset;
+
+  return pos;
+}
+
+internal int cmp_u64(void const *a, void const *b) {
+  u64 x = *Cast(u64 const *, a);
+  u64 y = *Cast(u64 const *, b);
+  return (x > y) - (x < y);
+}
+
+void position_find_batch(PositionIndex *index, Arena *scratch, u32 const *offsets, SourcePosition *out, u32 count) {
+  ArenaSnapshot scope = arena_scope_begin(scratch);
+
+  // The offset is in the upper half of a key, so that sorting the keys sorts by offset, and the
+  // index into `offsets` is in the lower half.
+  u64 *keys = arena_push_array(u64, scratch, count);
+  for (u32 i = 0; i < count; i++) {
+    keys[i] = (Cast(u64, offsets[i]) << 32) | i;
+  }
+
+  qsort(keys, count, sizeof(u64), cmp_u64);
+
+  // Every offset continues from the line and column of the one before it.
+  SourcePosition pos  = {0};
+  u32            from = 0;
+
+  for (u32 i = 0; i < count; i++) {
+    u32 offset = Cast(u32, keys[i] >> 32);
+
+    if (pos.line == 0 || offset > pos.line_start + pos.line_len) {
+      pos  = line_position(index, find_line(index, (pos.line == 0) ? 0 : pos.line - 1, offset));
+      from = pos.line_start;
+    }
+
+    advance_columns(index, &pos, from, offset);
+    from = offset;
+
+    out[Cast(u32, keys[i])] = pos;
+  }
+
+  arena_scope_end(scratch, scope);
 }
 
 u8 tokens_kind(Tokens *tokens, TokenIndex idx) {
@@ -333,68 +520,451 @@ SpanU32 tokens_span(Tokens *tokens, TokenIndex idx) {
   return tokens->spans[idx];
 }
 
-b32 tokenize(TokenizeContext *context, String text, Tokens *tokens) {
+// Every token is at least one byte long and every line but the first starts after a newline, so
+// the arrays of a text of n bytes never need more than n + 1 elements. The arrays are reserved for
+// that size up front and their pages are committed as they fill up, so they are written to once,
+// in place, and only take up the memory they actually use.
+
+#define Commit_growth_size KiB(64)
+
+internal usize reserved_size(usize stride, u32 capacity) {
+  return round_up_to_power_of_two(stride * capacity, vmem_page_size());
+}
+
+typedef struct {
+  void  *base;
+  usize  stride;
+  usize  committed; // In bytes.
+  usize  reserved;  // In bytes.
+} ReservedArray;
+
+internal ReservedArray reserved_array(usize stride, u32 capacity) {
+  usize size = reserved_size(stride, capacity);
+  return (ReservedArray){
+    .base     = vmem_reserve(size),
+    .stride   = stride,
+    .reserved = size,
+  };
+}
+
+internal void reserved_array_release(ReservedArray *array) {
+  if (array->base) {
+    vmem_release(array->base, array->reserved);
+  }
+}
+
+// Reserves the arrays of the tokens of a text of `len` bytes. Returns False, after reporting why,
+// if the text does not fit the 32-bit offsets of the tokens or the arrays could not be reserved.
+internal b32 tokens_reserve(MessageSink *sink, usize len, u32 *capacity, ReservedArray *kinds, ReservedArray *spans, ReservedArray *lines) {
+  if (len >= UINT32_MAX) {
+    Message_error(
+      sink,
+      (MessageLocation){ .kind = MessageLocation_unspecified },
+      string_lit("Text is too large to tokenize, it can be at most 4 GiB.")
+    );
+    return False;
+  }
+
+  *capacity = Cast(u32, len) + 1;
+
+  *kinds = reserved_array(sizeof(u8),      *capacity);
+  *spans = reserved_array(sizeof(SpanU32), *capacity);
+  *lines = reserved_array(sizeof(u32),     *capacity);
+
+  if (!kinds->base || !spans->base || !lines->base) {
+    reserved_array_release(kinds);
+    reserved_array_release(spans);
+    reserved_array_release(lines);
+
+    Message_error(
+      sink,
+      (MessageLocation){ .kind = MessageLocation_unspecified },
+      string_lit("Could not reserve memory for the tokens.")
+    );
+    return False;
+  }
+
+  return True;
+}
+
+// Makes sure that at least the first `count` elements of `array` are committed.
+internal void reserved_array_commit(ReservedArray *array, u32 count) {
+  usize size = array->stride * count;
+  if (size <= array->committed) {
+    return;
+  }
+
+  usize grown     = round_up_to_power_of_two(Max(size, array->committed + Commit_growth_size), vmem_page_size());
+  usize committed = Min(grown, array->reserved);
+
+  b32 ok = vmem_commit(ptr_offset(array->base, array->committed), committed - array->committed);
+  Assert(ok);
+
+  array->committed = committed;
+}
+
+// Writes the offset of the start of every line to `lines` and returns the number of lines.
+internal u32 scan_lines(String text, ReservedArray *lines) {
+  u32 *offsets = lines->base;
+  u32  count   = 0;
+
+  reserved_array_commit(lines, 1);
+  offsets[count++] = 0;
+
+  u32 len = Cast(u32, text.len);
+  u32 at  = 0;
+
+  while (True) {
+    u64 mask;
+    u32 n = simd_match_byte64(text.str + at, len - at, '\n', &mask);
+    if (n == 0) {
+      break;
+    }
+
+    reserved_array_commit(lines, count + 64);
+
+    for (; mask != 0; mask &= mask - 1) {
+      offsets[count++] = at + count_trailing_zeros64(mask) + 1;
+    }
+
+    at += n;
+  }
+
+  for (; at < len; at++) {
+    if (text.str[at] == '\n') {
+      reserved_array_commit(lines, count + 1);
+      offsets[count++] = at + 1;
+    }
+  }
+
+  return count;
+}
+
+// Tokenizes `text`, which starts at byte `offset` of the source.
+internal b32 tokenize_at(TokenizeContext *context, String text, u32 offset, Tokens *tokens) {
   Tokenizer tokenizer = {
     .start    = text.str,
     .end      = ptr_offset(text.str, text.len),
     .at       = text.str,
+    .offset   = offset,
     .msg_sink = context->msg_sink,
   };
 
-  ArenaSnapshot scope = arena_scope_begin(context->scratch);
+  *tokens = (Tokens){0};
 
-  KindList kindlist = {0};
-  SpanList spanlist = {0};
-  OffsetList linelist = {0};
+  u32 capacity;
+  ReservedArray kinds, spans, lines;
+  if (!tokens_reserve(context->msg_sink, text.len, &capacity, &kinds, &spans, &lines)) {
+    return False;
+  }
 
-  lines_append(&linelist, context->scratch, 0);
+  u32 line_count = scan_lines(text, &lines);
 
+  u8      *kind = kinds.base;
+  SpanU32 *span = spans.base;
+
+  u32 tok_count = 0;
   u32 res;
   while (True) {
-    u8 kind;
-    SpanU32 span;
-    res = next(&tokenizer, &kind, &span);
+    reserved_array_commit(&kinds, tok_count + 1);
+    reserved_array_commit(&spans, tok_count + 1);
+
+    res = next(&tokenizer, &kind[tok_count], &span[tok_count]);
 
     if (res != TokResult_ok) {
       break;
     }
 
-    if (kind == Tok_line_comment) {
-      continue;
+    tok_count += 1;
+  }
+
+  *tokens = (Tokens){
+    .tok_count  = tok_count,
+    .line_count = line_count,
+    .capacity   = capacity,
+    .committed  = kinds.committed + spans.committed + lines.committed,
+    .kinds = kinds.base,
+    .spans = spans.base,
+    .lines = lines.base,
+  };
+
+  return res == TokResult_end;
+}
+
+b32 tokenize(TokenizeContext *context, String text, Tokens *tokens) {
+  return tokenize_at(context, text, 0, tokens);
+}
+
+void tokens_deinit(Tokens *tokens) {
+  if (tokens->capacity == 0) {
+    return;
+  }
+
+  vmem_release(tokens->kinds, reserved_size(sizeof(u8),      tokens->capacity));
+  vmem_release(tokens->spans, reserved_size(sizeof(SpanU32), tokens->capacity));
+  vmem_release(tokens->lines, reserved_size(sizeof(u32),     tokens->capacity));
+
+  memset(tokens, 0, sizeof(Tokens));
+}
+
+// The first byte at or after `at` that is `a` or `b`, or `len` if there is none.
+internal u32 find_either(u8 const *s, u32 at, u32 len, u8 a, u8 b) {
+  at += simd_scan(Scan_until, s + at, len - at, a, b);
+
+  while (at < len && s[at] != a && s[at] != b) {
+    at += 1;
+  }
+
+  return at;
+}
+
+// The first line in `[from, to)` that starts with the keyword `mod`, or 0 if there is none.
+internal u32 find_mod_line(u8 const *s, u32 from, u32 to) {
+  while (True) {
+    u32 newline = find_either(s, from, to, '\n', '\n');
+
+    u32 line = newline + 1;
+    if (line + 3 >= to) {
+      return 0;
+    }
+
+    if (memcmp(s + line, "mod", 3) == 0 && is_whitespace(s[line + 3])) {
+      return line;
+    }
+
+    from = line;
+  }
+}
+
+// Splits `text` into at most `max_chunks` chunks of at least `min_size` bytes, and writes the byte
+// offset at which every chunk starts to `starts`. A chunk only starts at a line that starts with a
+// `mod` section, outside of strings and comments, so that the chunks can be tokenized and parsed
+// on their own. Returns the number of chunks.
+internal u32 find_chunks(String text, u32 max_chunks, u32 min_size, u32 *starts) {
+  u8 const *s   = text.str;
+  u32       len = Cast(u32, text.len);
+
+  starts[0] = 0;
+  u32 count = 1;
+
+  u32 size   = Max(len / max_chunks, min_size);
+  u32 target = size;
+
+  u32 at = 0;
+  while (at < len && count < max_chunks) {
+    // Up to the next string or comment there is only code, so any line in between can start a
+    // chunk.
+    u32 stop = find_either(s, at, len, '"', ';');
+
+    while (target < stop && count < max_chunks) {
+      u32 line = find_mod_line(s, Max(at, target), stop);
+      if (line == 0) {
+        break;
+      }
+
+      starts[count++] = line;
+      target = line + size;
+    }
+
+    if (stop >= len) {
+      break;
     }
 
-    if (kind == Tok_newline) {
-      lines_append(&linelist, context->scratch, span.end);
+    if (s[stop] == ';') {
+      at = find_either(s, stop, len, '\n', '\n');
       continue;
     }
 
-    kindlist_append(&kindlist, context->scratch, kind);
-    spanlist_append(&spanlist, context->scratch, span);
+    at = stop + 1;
+    while (True) {
+      at = find_either(s, at, len, '"', '\\');
+      if (at >= len) {
+        break;
+      }
+
+      if (s[at] == '\\') {
+        at += 2;
+        continue;
+      }
+
+      at += 1;
+      break;
+    }
+  }
+
+  return count;
+}
+
+typedef struct {
+  String     text;
+  u32        chunk_count;
+  u32        starts[TOKENIZE_MAX_CHUNKS];
+  Tokens     parts[TOKENIZE_MAX_CHUNKS];
+  b32        ok[TOKENIZE_MAX_CHUNKS];
+
+  // Where the tokens and lines of every part go in the joined arrays.
+  u32        tok_offsets[TOKENIZE_MAX_CHUNKS];
+  u32        line_offsets[TOKENIZE_MAX_CHUNKS];
+  Tokens    *joined;
+} TokenizeChunks;
+
+internal String chunk_text(TokenizeChunks *job, u32 index) {
+  u32 start = job->starts[index];
+  u32 end   = (index + 1 < job->chunk_count) ? job->starts[index + 1] : Cast(u32, job->text.len);
+
+  return (String){ .str = job->text.str + start, .len = end - start, };
+}
+
+internal void tokenize_chunk(void *context, u32 worker, u32 index) {
+  Unused(worker);
+
+  TokenizeChunks *job = context;
+
+  // A chunk that fails is tokenized again with the message sink of the context, which reports the
+  // error.
+  MessageSink sink = { .add_message = message_discard, };
+  TokenizeContext chunk_context = { .msg_sink = &sink, };
+
+  job->ok[index] = tokenize_at(&chunk_context, chunk_text(job, index), job->starts[index], &job->parts[index]);
+}
+
+// Copies a part into its place in the joined arrays, rebasing its offsets onto the whole text. The
+// first line of every part but the first is the last line of the part before it.
+internal void join_chunk(void *context, u32 worker, u32 index) {
+  Unused(worker);
+
+  TokenizeChunks *job    = context;
+  Tokens         *part   = &job->parts[index];
+  Tokens         *joined = job->joined;
+  u32             start  = job->starts[index];
+
+  u32 tok_offset = job->tok_offsets[index];
+  memcpy(joined->kinds + tok_offset, part->kinds, part->tok_count);
+  for (u32 i = 0; i < part->tok_count; i++) {
+    joined->spans[tok_offset + i] = (SpanU32){
+      .start = part->spans[i].start + start,
+      .end   = part->spans[i].end   + start,
+    };
+  }
+
+  u32 first_line  = (index == 0) ? 0 : 1;
+  u32 line_offset = job->line_offsets[index];
+  for (u32 i = first_line; i < part->line_count; i++) {
+    joined->lines[line_offset + i - first_line] = part->lines[i] + start;
+  }
+
+  tokens_deinit(part);
+}
+
+b32 tokenize_parallel(TokenizeContext *context, String text, u32 thread_count, Tokens *tokens) {
+  // The chunks are found with 32-bit offsets as well, `tokenize` reports a text that is too large.
+  if (thread_count <= 1 || text.len >= UINT32_MAX) {
+    return tokenize(context, text, tokens);
   }
 
-  u32 tok_count  = kindlist.len;
-  u32 line_count = linelist.len;
+  Assert(context->scratch);
+
+  ArenaSnapshot scope = arena_scope_begin(context->scratch);
+
+  TokenizeChunks *job = arena_push_one(TokenizeChunks, context->scratch);
+  zero_struct(TokenizeChunks, job);
 
-  u8      *kinds = arena_push_array(u8,      context->arena, tok_count);
-  SpanU32 *spans = arena_push_array(SpanU32, context->arena, tok_count);
+  u32 max_chunks = Min(2 * thread_count, TOKENIZE_MAX_CHUNKS);
 
-  kindlist_copy_to_array(&kindlist, kinds);
-  spanlist_copy_to_array(&spanlist, spans);
+  job->text        = text;
+  job->chunk_count = find_chunks(text, max_chunks, TOKENIZE_MIN_CHUNK_SIZE, job->starts);
+  job->joined      = tokens;
+
+  if (job->chunk_count == 1) {
+    arena_scope_end(context->scratch, scope);
+    return tokenize(context, text, tokens);
+  }
+
+  parallel_for(thread_count, job->chunk_count, tokenize_chunk, job);
+
+  b32 ok         = True;
+  u32 tok_count  = 0;
+  u32 line_count = 1;
+  for (u32 i = 0; i < job->chunk_count; i++) {
+    ok &= job->ok[i];
+
+    job->tok_offsets[i]  = tok_count;
+    job->line_offsets[i] = (i == 0) ? 0 : line_count;
+
+    tok_count  += job->parts[i].tok_count;
+    line_count += job->parts[i].line_count - 1;
+  }
+
+  if (!ok) {
+    // A chunk starts at a line outside of strings and comments, so tokenizing it on its own stops
+    // at the same error as tokenizing the whole text. Only the first chunk that failed is tokenized
+    // again, to report its error.
+    u32 failed = 0;
+    while (job->ok[failed]) {
+      failed += 1;
+    }
 
-  u32 *lines = arena_push_array(u32, context->arena, line_count);
-  lines_copy_to_array(&linelist, lines);
+    Tokens part;
+    tokenize_at(context, chunk_text(job, failed), job->starts[failed], &part);
+    tokens_deinit(&part);
+
+    for (u32 i = 0; i < job->chunk_count; i++) {
+      tokens_deinit(&job->parts[i]);
+    }
+
+    arena_scope_end(context->scratch, scope);
+
+    // The message is located with the lines of the whole text, which `tokenize` also has after an
+    // error.
+    *tokens = (Tokens){0};
+
+    u32 capacity;
+    ReservedArray kinds, spans, lines;
+    if (tokens_reserve(context->msg_sink, text.len, &capacity, &kinds, &spans, &lines)) {
+      *tokens = (Tokens){
+        .line_count = scan_lines(text, &lines),
+        .capacity   = capacity,
+        .committed  = lines.committed,
+        .kinds = kinds.base,
+        .spans = spans.base,
+        .lines = lines.base,
+      };
+    }
+
+    return False;
+  }
+
+  u32 capacity;
+  ReservedArray kinds, spans, lines;
+  if (!tokens_reserve(context->msg_sink, text.len, &capacity, &kinds, &spans, &lines)) {
+    for (u32 i = 0; i < job->chunk_count; i++) {
+      tokens_deinit(&job->parts[i]);
+    }
+
+    arena_scope_end(context->scratch, scope);
+    *tokens = (Tokens){0};
+    return False;
+  }
+
+  reserved_array_commit(&kinds, tok_count);
+  reserved_array_commit(&spans, tok_count);
+  reserved_array_commit(&lines, line_count);
 
   *tokens = (Tokens){
     .tok_count  = tok_count,
     .line_count = line_count,
-    .kinds = kinds,
-    .spans = spans,
-    .lines = lines,
+    .capacity   = capacity,
+    .committed  = kinds.committed + spans.committed + lines.committed,
+    .kinds = kinds.base,
+    .spans = spans.base,
+    .lines = lines.base,
   };
 
+  parallel_for(thread_count, job->chunk_count, join_chunk, job);
+
   arena_scope_end(context->scratch, scope);
 
-  return res == TokResult_end;
+  return True;
 }
 
 String token_string(Tokens *tokens, String text, TokenIndex tok) {
@@ -404,13 +974,13 @@ String token_string(Tokens *tokens, String text, TokenIndex tok) {
 
 char const *token_kind_string_literals[Tok_kind_max] = {
   "colon",        "semicolon",
-  "comma",        "dot", "arrow",
+  "comma",        "dot", "dot-dot", "dot-dot-equals", "arrow",
   "equals",       "minus",
   "plus",         "star",
   "slash",        "percent",
   "plus_equals",  "exclamation",
   "ampersand",    "bar",
-  "caret",        "tilde",
+  "caret",        "tilde", "question",
   "left-shift",   "right-shift",
   "cmp-eq",       "cmp-ne",
   "cmp-gt",       "cmp-ge",
@@ -425,9 +995,14 @@ char const *token_kind_string_literals[Tok_kind_max] = {
   "return",       "and",
   "or",           "defer",
   "const",        "cast",
-  "bitcast", "as", "mod", "no_cache", "inline",
+  "bitcast", "as", "mod", "struct", "no_cache", "inline",
   "identifier",   "#debug",
-  "line-comment", "newline",
+  "#sum",         "#min",
+  "#max",         "#all",
+  "#any",         "#size_of",
+  "#align_of",    "#offset_of",
+  "#ordered",     "#hot",
+  "#cold",
 };
 
 char const *token_kind_string(u8 kind) {
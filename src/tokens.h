@@ -9,6 +9,8 @@ enum TokenKind {
   Tok_semicolon,
   Tok_comma,
   Tok_dot,
+  Tok_dot_dot,
+  Tok_dot_dot_equals,
   Tok_arrow,
 
   Tok_equals,
@@ -23,6 +25,7 @@ enum TokenKind {
   Tok_bar,
   Tok_caret,
   Tok_tilde,
+  Tok_question,
   Tok_left_shift,
   Tok_right_shift,
   Tok_cmp_eq,
@@ -57,6 +60,7 @@ enum TokenKind {
   Tok_keyword_bitcast,
   Tok_keyword_as,
   Tok_keyword_mod,
+  Tok_keyword_struct,
 
   Tok_keyword_no_cache,
   Tok_keyword_inline,
@@ -64,9 +68,18 @@ enum TokenKind {
   Tok_identifier,
 
   Tok_builtin_debug,
-
-  Tok_line_comment,
-  Tok_newline,
+  Tok_builtin_sum,
+  Tok_builtin_min,
+  Tok_builtin_max,
+  Tok_builtin_all,
+  Tok_builtin_any,
+  Tok_builtin_size_of,
+  Tok_builtin_align_of,
+  Tok_builtin_offset_of,
+
+  Tok_attribute_ordered,
+  Tok_attribute_hot,
+  Tok_attribute_cold,
 
   Tok_kind_max,
 };
@@ -76,31 +89,66 @@ typedef struct {
   u32 end;
 } SpanU32;
 
+// The arrays are not stored in an arena but each in their own reserved memory, which is released
+// with `tokens_deinit`.
 typedef struct {
   u32      tok_count;
   u32      line_count;
+  u32      capacity;  // The number of elements reserved for each array.
+  usize    committed; // The bytes committed for the three arrays together, 0 if they are mapped.
   u8      *kinds;
   SpanU32 *spans;
   u32     *lines;
 } Tokens;
 
+// Tabs advance the display column to the next multiple of this.
+#define POSITION_TAB_WIDTH 8
+
 typedef struct {
-  u32 line;
-  u32 offset_start_of_line;
-  u32 line_len;
-} LineInfo;
+  u32 line;        // 1-based.
+  u32 col;         // 1-based, counted in UTF-8 code points.
+  u32 display_col; // 1-based, counted in code points with tabs expanded.
+  u32 line_start;  // Byte offset of the start of the line.
+  u32 line_len;    // Length of the line in bytes, without the newline.
+} SourcePosition;
+
+// Resolves byte offsets in a text to lines and columns, with a binary search over the line offsets
+// that `tokenize` found. The position of the last lookup is kept, so that a lookup further along
+// the same line only counts the columns in between.
+typedef struct {
+  String     text;
+  u32 const *lines;
+  u32        line_count;
+
+  u32            cached_offset;
+  SourcePosition cached;
+} PositionIndex;
 
-LineInfo tokens_find_line_info(String text, Tokens *tokens, u32 byte_offset);
+void position_index_init(PositionIndex *index, String text, Tokens *tokens);
+
+SourcePosition position_find(PositionIndex *index, u32 offset);
+
+// Resolves `count` offsets, in any order, in a single pass over them in increasing order.
+void position_find_batch(PositionIndex *index, Arena *scratch, u32 const *offsets, SourcePosition *out, u32 count);
 String token_string(Tokens *tokens, String text, TokenIndex tok);
 
 char const *token_kind_string(u8 kind);
 
 typedef struct {
   MessageSink *msg_sink;
-  Arena       *arena;
-  Arena       *scratch;
+  Arena       *scratch; // Only used by `tokenize_parallel`.
 } TokenizeContext;
 
-b32 tokenize(TokenizeContext *context, String text, Tokens *tokens);
+b32  tokenize(TokenizeContext *context, String text, Tokens *tokens);
+void tokens_deinit(Tokens *tokens);
+
+#define TOKENIZE_MAX_CHUNKS     64
+#define TOKENIZE_MIN_CHUNK_SIZE KiB(256)
+
+// Tokenizes `text` like `tokenize`, but on up to `thread_count` threads. The text is split into
+// chunks at the start of `mod` sections, which are tokenized in parallel and joined. If a chunk has
+// an error, the first chunk that failed is tokenized again on the calling thread, so the messages
+// are the same as those of `tokenize`.
+b32 tokenize_parallel(TokenizeContext *context, String text, u32 thread_count, Tokens *tokens);
 
 #endif // TOKENS_H
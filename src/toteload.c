@@ -35,15 +35,19 @@ i64 parse_i64(String s) {
 #define VC_EXTRA_LEAN
 #include <Windows.h>
 
-internal b32 is_sys_info_initialized = False;
-internal SYSTEM_INFO sys_info;
+internal usize windows_page_size = 0;
+
+// The page size is cached on first use, which can be from several threads at once.
 usize vmem_page_size(void) {
-  if (!is_sys_info_initialized) {
-    GetSystemInfo(&sys_info);
-    is_sys_info_initialized = True;
+  usize size = __atomic_load_n(&windows_page_size, __ATOMIC_RELAXED);
+  if (size == 0) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size = info.dwPageSize;
+    __atomic_store_n(&windows_page_size, size, __ATOMIC_RELAXED);
   }
 
-  return sys_info.dwPageSize;
+  return size;
 }
 
 void *vmem_reserve(usize size) {
@@ -58,25 +62,224 @@ b32 vmem_commit(void *p, usize size) {
 void vmem_release(void *p, usize size) {
   VirtualFree(p, size, MEM_RELEASE);
 }
+
+b32 file_map(FileMapping *mapping, char const *filename, u32 flags) {
+  DWORD attributes = FILE_ATTRIBUTE_NORMAL;
+  if (flags & FileMap_sequential) {
+    attributes |= FILE_FLAG_SEQUENTIAL_SCAN;
+  }
+
+  HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, Null, OPEN_EXISTING, attributes, Null);
+  if (file == INVALID_HANDLE_VALUE) {
+    return False;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return False;
+  }
+
+  *mapping = (FileMapping){ .base = Null, .size = Cast(usize, size.QuadPart) };
+
+  if (mapping->size == 0) {
+    CloseHandle(file);
+    return True;
+  }
+
+  b32 read_only = (flags & FileMap_read_only) != 0;
+
+  if (flags & FileMap_copy) {
+    u8 *p = VirtualAlloc(Null, mapping->size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (is_null(p)) {
+      CloseHandle(file);
+      return False;
+    }
+
+    usize at = 0;
+    while (at < mapping->size) {
+      DWORD n    = Cast(DWORD, Min(mapping->size - at, Cast(usize, 1) << 30));
+      DWORD read = 0;
+      if (!ReadFile(file, p + at, n, &read, Null) || read == 0) {
+        break;
+      }
+
+      at += read;
+    }
+
+    CloseHandle(file);
+
+    DWORD old;
+    if (at != mapping->size || (read_only && !VirtualProtect(p, mapping->size, PAGE_READONLY, &old))) {
+      VirtualFree(p, 0, MEM_RELEASE);
+      return False;
+    }
+
+    mapping->base   = p;
+    mapping->copied = True;
+
+    return True;
+  }
+
+  HANDLE section = CreateFileMappingA(file, Null, read_only ? PAGE_READONLY : PAGE_WRITECOPY, 0, 0, Null);
+  CloseHandle(file);
+  if (is_null(section)) {
+    return False;
+  }
+
+  // The view keeps the section alive, so the handle can be closed right away.
+  mapping->base = MapViewOfFile(section, read_only ? FILE_MAP_READ : FILE_MAP_COPY, 0, 0, 0);
+  CloseHandle(section);
+
+  return !is_null(mapping->base);
+}
+
+void file_unmap(FileMapping *mapping) {
+  if (mapping->base && mapping->copied) {
+    VirtualFree(mapping->base, 0, MEM_RELEASE);
+  } else if (mapping->base) {
+    UnmapViewOfFile(mapping->base);
+  }
+
+  memset(mapping, 0, sizeof(FileMapping));
+}
+
+b32 file_modified_time(char const *filename, u64 *time) {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &data)) {
+    return False;
+  }
+
+  u64 ticks = (Cast(u64, data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+
+  // A FILETIME counts in units of 100 nanoseconds.
+  *time = ticks * 100;
+
+  return True;
+}
+
+b32 directory_create(char const *path) {
+  return CreateDirectoryA(path, Null) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+u64 time_now_ns(void) {
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+
+  u64 freq  = Cast(u64, frequency.QuadPart);
+  u64 ticks = Cast(u64, counter.QuadPart);
+
+  // Split the conversion to avoid overflowing the multiplication.
+  return (ticks / freq) * 1000000000ull + ((ticks % freq) * 1000000000ull) / freq;
+}
+
+// A FILETIME of kernel plus user time, in units of 100 nanoseconds.
+internal u64 cpu_time_from_filetimes(FILETIME kernel, FILETIME user) {
+  u64 k = (Cast(u64, kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+  u64 u = (Cast(u64, user.dwHighDateTime) << 32) | user.dwLowDateTime;
+  return (k + u) * 100;
+}
+
+u64 process_cpu_time_ns(void) {
+  FILETIME creation, exit, kernel, user;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+    return 0;
+  }
+
+  return cpu_time_from_filetimes(kernel, user);
+}
+
+u64 thread_cpu_time_ns(void) {
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+    return 0;
+  }
+
+  return cpu_time_from_filetimes(kernel, user);
+}
+
+void sleep_ms(u32 milliseconds) {
+  Sleep(milliseconds);
+}
+
+u32 cpu_core_count(void) {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return Cast(u32, info.dwNumberOfProcessors);
+}
+
+internal DWORD WINAPI thread_entry(LPVOID p) {
+  Thread *thread = p;
+  thread->fn(thread->arg);
+  return 0;
+}
+
+b32 thread_start(Thread *thread, ThreadFunction fn, void *arg) {
+  thread->fn  = fn;
+  thread->arg = arg;
+
+  HANDLE handle = CreateThread(Null, 0, thread_entry, thread, 0, Null);
+  if (is_null(handle)) {
+    return False;
+  }
+
+  thread->handle = Cast(u64, Cast(uintptr_t, handle));
+
+  return True;
+}
+
+void thread_join(Thread *thread) {
+  HANDLE handle = Cast(HANDLE, Cast(uintptr_t, thread->handle));
+  WaitForSingleObject(handle, INFINITE);
+  CloseHandle(handle);
+}
+
+_Static_assert(sizeof(SRWLOCK) <= sizeof(Mutex), "Mutex is too small for an SRWLOCK.");
+
+void mutex_init(Mutex *mutex) {
+  InitializeSRWLock(Cast(SRWLOCK*, mutex->opaque));
+}
+
+void mutex_deinit(Mutex *mutex) {
+  Unused(mutex);
+}
+
+void mutex_lock(Mutex *mutex) {
+  AcquireSRWLockExclusive(Cast(SRWLOCK*, mutex->opaque));
+}
+
+void mutex_unlock(Mutex *mutex) {
+  ReleaseSRWLockExclusive(Cast(SRWLOCK*, mutex->opaque));
+}
 #endif // TTLD_OS_WINDOWS
 
 #ifdef TTLD_OS_MACOS
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/mman.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 
 internal usize macos_page_size = 0;
 
+// The page size is cached on first use, which can be from several threads at once.
 usize vmem_page_size(void) {
-  if (macos_page_size == 0) {
-    macos_page_size = Cast(usize, getpagesize());
+  usize size = __atomic_load_n(&macos_page_size, __ATOMIC_RELAXED);
+  if (size == 0) {
+    size = Cast(usize, getpagesize());
+    __atomic_store_n(&macos_page_size, size, __ATOMIC_RELAXED);
   }
 
-  return macos_page_size;
+  return size;
 }
 
 void *vmem_reserve(usize size) {
-  return mmap(Null, size, PROT_NONE, MAP_ANON | MAP_PRIVATE, -1, 0);
+  void *p = mmap(Null, size, PROT_NONE, MAP_ANON | MAP_PRIVATE, -1, 0);
+  return (p == MAP_FAILED) ? Null : p;
 }
 
 b32 vmem_commit(void *p, usize size) {
@@ -86,8 +289,246 @@ b32 vmem_commit(void *p, usize size) {
 void vmem_release(void *p, usize size) {
   munmap(p, size);
 }
+
+b32 file_map(FileMapping *mapping, char const *filename, u32 flags) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return False;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return False;
+  }
+
+  *mapping = (FileMapping){ .base = Null, .size = Cast(usize, st.st_size) };
+
+  if (mapping->size == 0) {
+    close(fd);
+    return True;
+  }
+
+  int prot = (flags & FileMap_read_only) ? PROT_READ : (PROT_READ | PROT_WRITE);
+
+  if (flags & FileMap_copy) {
+    u8 *p = mmap(Null, mapping->size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      return False;
+    }
+
+    usize at = 0;
+    while (at < mapping->size) {
+      ssize_t n = read(fd, p + at, mapping->size - at);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+
+      if (n <= 0) {
+        break;
+      }
+
+      at += Cast(usize, n);
+    }
+
+    close(fd);
+
+    if (at != mapping->size || mprotect(p, mapping->size, prot) != 0) {
+      munmap(p, mapping->size);
+      return False;
+    }
+
+    mapping->base   = p;
+    mapping->copied = True;
+
+    return True;
+  }
+
+  void *p = mmap(Null, mapping->size, prot, MAP_PRIVATE, fd, 0);
+  close(fd); // The mapping keeps its own reference to the file.
+
+  if (p == MAP_FAILED) {
+    return False;
+  }
+
+  if (flags & FileMap_sequential) {
+    // Only a hint, so a failure does not matter.
+    madvise(p, mapping->size, MADV_SEQUENTIAL);
+  }
+
+  mapping->base = p;
+
+  return True;
+}
+
+void file_unmap(FileMapping *mapping) {
+  if (mapping->base) {
+    munmap(mapping->base, mapping->size);
+  }
+
+  memset(mapping, 0, sizeof(FileMapping));
+}
+
+b32 file_modified_time(char const *filename, u64 *time) {
+  struct stat st;
+  if (stat(filename, &st) != 0) {
+    return False;
+  }
+
+#ifdef __APPLE__
+  struct timespec ts = st.st_mtimespec;
+#else
+  struct timespec ts = st.st_mtim;
+#endif
+
+  *time = Cast(u64, ts.tv_sec) * 1000000000ull + Cast(u64, ts.tv_nsec);
+
+  return True;
+}
+
+b32 directory_create(char const *path) {
+  return mkdir(path, 0777) == 0 || errno == EEXIST;
+}
+
+internal u64 clock_ns(clockid_t clock) {
+  struct timespec ts;
+  if (clock_gettime(clock, &ts) != 0) {
+    return 0;
+  }
+
+  return Cast(u64, ts.tv_sec) * 1000000000ull + Cast(u64, ts.tv_nsec);
+}
+
+u64 time_now_ns(void) {
+  return clock_ns(CLOCK_MONOTONIC);
+}
+
+u64 process_cpu_time_ns(void) {
+  return clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+u64 thread_cpu_time_ns(void) {
+  return clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void sleep_ms(u32 milliseconds) {
+  struct timespec ts = {
+    .tv_sec  = milliseconds / 1000,
+    .tv_nsec = Cast(long, milliseconds % 1000) * 1000000,
+  };
+
+  nanosleep(&ts, Null);
+}
+
+u32 cpu_core_count(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n > 0) ? Cast(u32, n) : 1;
+}
+
+internal void *thread_entry(void *p) {
+  Thread *thread = p;
+  thread->fn(thread->arg);
+  return Null;
+}
+
+_Static_assert(sizeof(pthread_t) <= sizeof(u64), "A pthread_t must fit in the handle of a Thread.");
+
+b32 thread_start(Thread *thread, ThreadFunction fn, void *arg) {
+  thread->fn  = fn;
+  thread->arg = arg;
+
+  pthread_t handle;
+  if (pthread_create(&handle, Null, thread_entry, thread) != 0) {
+    return False;
+  }
+
+  memcpy(&thread->handle, &handle, sizeof(pthread_t));
+
+  return True;
+}
+
+void thread_join(Thread *thread) {
+  pthread_t handle;
+  memcpy(&handle, &thread->handle, sizeof(pthread_t));
+  pthread_join(handle, Null);
+}
+
+_Static_assert(sizeof(pthread_mutex_t) <= sizeof(Mutex), "Mutex is too small for a pthread_mutex_t.");
+
+void mutex_init(Mutex *mutex) {
+  pthread_mutex_init(Cast(pthread_mutex_t*, mutex->opaque), Null);
+}
+
+void mutex_deinit(Mutex *mutex) {
+  pthread_mutex_destroy(Cast(pthread_mutex_t*, mutex->opaque));
+}
+
+void mutex_lock(Mutex *mutex) {
+  pthread_mutex_lock(Cast(pthread_mutex_t*, mutex->opaque));
+}
+
+void mutex_unlock(Mutex *mutex) {
+  pthread_mutex_unlock(Cast(pthread_mutex_t*, mutex->opaque));
+}
 #endif // TTLD_OS_MACOS
 
+typedef struct {
+  ParallelForFunction fn;
+  void               *context;
+  u32                 count;
+  u32                 next;
+} ParallelFor;
+
+typedef struct {
+  ParallelFor *job;
+  u32          worker;
+} ParallelForWorker;
+
+internal void parallel_for_worker(void *arg) {
+  ParallelForWorker *worker = arg;
+  ParallelFor       *job    = worker->job;
+
+  while (True) {
+    u32 index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+    if (index >= job->count) {
+      break;
+    }
+
+    job->fn(job->context, worker->worker, index);
+  }
+}
+
+void parallel_for(u32 thread_count, u32 count, ParallelForFunction fn, void *context) {
+  ParallelFor job = {
+    .fn      = fn,
+    .context = context,
+    .count   = count,
+    .next    = 0,
+  };
+
+  thread_count = Min(Min(thread_count, count), Max_parallel_for_threads);
+
+  Thread            threads[Max_parallel_for_threads];
+  ParallelForWorker workers[Max_parallel_for_threads];
+
+  // Worker 0 is the calling thread. If a thread fails to start, the others pick up its share.
+  u32 started = 1;
+  for (u32 i = 1; i < thread_count; i++) {
+    workers[started] = (ParallelForWorker){ .job = &job, .worker = started, };
+    if (thread_start(&threads[started], parallel_for_worker, &workers[started])) {
+      started += 1;
+    }
+  }
+
+  workers[0] = (ParallelForWorker){ .job = &job, .worker = 0, };
+  parallel_for_worker(&workers[0]);
+
+  for (u32 i = 1; i < started; i++) {
+    thread_join(&threads[i]);
+  }
+}
+
 void arena_init(Arena *arena, ArenaOptions *options) {
   void *p = vmem_reserve(options->reserve_size);
   if (options->initial_commit_size > 0) {
@@ -100,6 +541,7 @@ void arena_init(Arena *arena, ArenaOptions *options) {
     .commit_end  = ptr_offset(p, options->initial_commit_size),
     .reserve_end = ptr_offset(p, options->reserve_size),
     .at          = p,
+    .peak        = p,
   };
 }
 
@@ -118,7 +560,8 @@ void *arena_push(Arena *arena, usize size, u32 align) {
   void *at_after_alloc = ptr_offset(aligned, size);
 
   if (at_after_alloc <= arena->commit_end) {
-    arena->at = at_after_alloc;
+    arena->at   = at_after_alloc;
+    arena->peak = Max(arena->peak, at_after_alloc);
     return aligned;
   }
 
@@ -136,6 +579,7 @@ void *arena_push(Arena *arena, usize size, u32 align) {
   Assert(ok);
 
   arena->at = at_after_alloc;
+  arena->peak = at_after_alloc;
   arena->commit_end = ptr_offset(arena->commit_end, commit_size);
 
   return aligned;
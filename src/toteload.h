@@ -183,10 +183,85 @@ typedef struct Allocator {
 #define Free(allocator, ptr, size)                         (allocator).fn((allocator).ctx, ptr, size, 0, 0)
 
 usize vmem_page_size(void);
-void *vmem_reserve(usize size);
+void *vmem_reserve(usize size); // Returns Null if the address space could not be reserved.
 b32   vmem_commit(void *p, usize size);
 void  vmem_release(void *p, usize size);
 
+typedef struct {
+  void  *base;
+  usize  size;
+  b32    copied; // The file was read into memory of its own, see `FileMap_copy`.
+} FileMapping;
+
+enum FileMapFlag {
+  FileMap_read_only  = 1 << 0, // The mapping can not be written to.
+  FileMap_sequential = 1 << 1, // Hints that the file is read from front to back.
+  FileMap_copy       = 1 << 2, // Reads the file into memory instead of mapping it.
+};
+
+// Maps a whole file into memory. By default the mapping is private and copy-on-write: it can be
+// written to, but the changes are never written back to the file. `flags` are `FileMapFlag`s.
+//
+// The pages of a mapping are read from the file when they are first touched. If the file is
+// truncated in the meantime, touching a page past its new end raises SIGBUS on POSIX, and on
+// Windows the file can not be truncated at all while it is mapped. With `FileMap_copy` the file is
+// read up front instead, so the memory does not depend on the file afterwards. A file that changes
+// size while it is read fails to map.
+b32  file_map(FileMapping *mapping, char const *filename, u32 flags);
+void file_unmap(FileMapping *mapping);
+
+// The time a file was last modified, in nanoseconds since some fixed point in time. Returns False
+// if the file does not exist or can not be queried.
+b32 file_modified_time(char const *filename, u64 *time);
+
+// Creates a directory, but not its parents. Returns True if the directory exists afterwards.
+b32 directory_create(char const *path);
+
+// A monotonic clock in nanoseconds. Only the difference between two readings is meaningful.
+u64 time_now_ns(void);
+
+// The CPU time used so far by the whole process, or by the calling thread only, in nanoseconds.
+// Returns 0 if the platform can not tell.
+u64 process_cpu_time_ns(void);
+u64 thread_cpu_time_ns(void);
+
+void sleep_ms(u32 milliseconds);
+
+u32 cpu_core_count(void);
+
+typedef void (*ThreadFunction)(void *arg);
+
+typedef struct {
+  u64            handle;
+  ThreadFunction fn;
+  void          *arg;
+} Thread;
+
+// `thread` must stay alive until it is joined.
+b32  thread_start(Thread *thread, ThreadFunction fn, void *arg);
+void thread_join(Thread *thread);
+
+// Big enough for the mutex of every platform, the platform type is only known in toteload.c.
+typedef struct {
+  _Alignas(8) u8 opaque[64];
+} Mutex;
+
+void mutex_init(Mutex *mutex);
+void mutex_deinit(Mutex *mutex);
+void mutex_lock(Mutex *mutex);
+void mutex_unlock(Mutex *mutex);
+
+typedef void (*ParallelForFunction)(void *context, u32 worker, u32 index);
+
+// The most threads `parallel_for` runs a job on, any more that are asked for are ignored.
+#define Max_parallel_for_threads 64
+
+// Calls `fn` once for every index below `count`, spread over at most `thread_count` threads, one
+// of which is the calling thread. The indices are handed out in increasing order. `worker` is the
+// index of the thread a call runs on, below `thread_count`, so that every thread can have its own
+// resources. Returns once all calls have returned.
+void parallel_for(u32 thread_count, u32 count, ParallelForFunction fn, void *context);
+
 #define Stack(type) struct { type* data; u32 len; u32 cap; }
 
 #define stack_init(sp,p,c) do { (sp)->data = (p); (sp)->len = 0; (sp)->cap = (c); } while (0)
@@ -206,6 +281,7 @@ typedef struct {
   void *commit_end;
   void *reserve_end;
   void *at;
+  void *peak; // The furthest `at` has been since the arena was initialized.
 } Arena;
 
 typedef struct {
@@ -231,6 +307,23 @@ void *arena_push(Arena *arena, usize size, u32 align);
 
 String arena_copy_string(Arena *arena, String s);
 
+// The number of bytes committed for `arena`. An arena never gives committed memory back before it
+// is deinitialized, so this is also the most it has had committed at any point.
+always_inline usize arena_committed_size(Arena *arena) {
+  return Cast(usize, ptr_diff(arena->commit_end, arena->base));
+}
+
+// The number of bytes in use in `arena`.
+always_inline usize arena_used_size(Arena *arena) {
+  return Cast(usize, ptr_diff(arena->at, arena->base));
+}
+
+// The most bytes that have been in use in `arena` at any point, including those of scopes that have
+// since ended.
+always_inline usize arena_peak_size(Arena *arena) {
+  return Cast(usize, ptr_diff(arena->peak, arena->base));
+}
+
 always_inline ArenaSnapshot arena_scope_begin(Arena *arena) {
   return (ArenaSnapshot){ .arena = arena, .at = arena->at, };
 }
@@ -242,6 +335,11 @@ always_inline void arena_scope_end(Arena *arena, ArenaSnapshot snapshot) {
   arena->at = snapshot.at;
 }
 
+// Ends every scope of `arena` at once. The memory stays committed and is reused by the next pushes.
+always_inline void arena_clear(Arena *arena) {
+  arena->at = arena->base;
+}
+
 // The amount of memory pointed to by `mem` must be at least `stride * count` bytes.
 always_inline void freelist_grow(void **freelist, void *mem, usize stride, usize count) {
   for (usize i = 0; i < count-1; i++) {
@@ -257,11 +355,11 @@ always_inline void freelist_grow(void **freelist, void *mem, usize stride, usize
 
 always_inline void *freelist_alloc(void **freelist) {
   void *p = *freelist;
-  *freelist = *Cast(void***,freelist);
+  *freelist = *Cast(void**,p);
   return p;
 }
 
 always_inline void freelist_free(void **freelist, void *p) {
-  *Cast(void**,p) = **Cast(void***, freelist);
+  *Cast(void**,p) = *freelist;
   *freelist = p;
 }
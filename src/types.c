@@ -1,5 +1,6 @@
 #include "types.h"
 #include "value.h"
+#include "integer.h"
 
 #define XXH_INLINE_ALL
 #include "xxhash.h"
@@ -7,6 +8,182 @@
 internal b32 cmp_type(void *context, Type *a, Type *b);
 internal u32 hash_type(void *context, Type *x);
 
+internal b32 is_type_complete(TypeInterner *types, Type *x) {
+  switch (Cast(TypeKind, x->kind)) {
+  case Type_integer:
+  case Type_bool:
+  case Type_comptime_int:
+  case Type_never:
+  case Type_nil:
+  case Type_range:
+  case Type_type:
+    return True;
+  case Type_slice:
+    return x->data.slice.base_type != 0 && types_is_complete(types, x->data.slice.base_type);
+  case Type_optional:
+    return x->data.optional.base_type != 0 && types_is_complete(types, x->data.optional.base_type);
+  case Type_array:
+    return x->data.array.base_type != 0 && types_is_complete(types, x->data.array.base_type);
+  case Type_function: {
+    if (x->data.function.return_type == 0) {
+      return False;
+    }
+
+    for (u32 i = 0; i < x->data.function.param_count; i++) {
+      if (x->data.function.param_types[i] == 0) {
+        return False;
+      }
+    }
+  } break;
+  case Type_struct: {
+    for (u32 i = 0; i < x->data.struct_.field_count; i++) {
+      TypeIndex field_type = x->data.struct_.fields[i].type;
+      if (field_type == 0 || !types_is_complete(types, field_type)) {
+        return False;
+      }
+    }
+  } break;
+  }
+
+  return True;
+}
+
+// The unused bit patterns of a word of `size` bytes that holds an integer of `type`. The bits above
+// the bitwidth are a sign or zero extension, see integer.h.
+internal TypeNiche int_word_niche(u32 offset, u32 size, TypeInteger type) {
+  u32 bits = size * 8;
+  if (type.bitwidth >= bits) {
+    return (TypeNiche){0};
+  }
+
+  u64 mask = (bits == 64) ? UINT64_MAX : (Cast(u64, 1) << bits) - 1;
+
+  return (TypeNiche){
+    .offset = offset,
+    .size   = size,
+    .start  = Cast(u64, 1) << (type.signedness == Signed ? type.bitwidth - 1 : type.bitwidth),
+    .count  = mask - (Cast(u64, 1) << type.bitwidth) + 1,
+  };
+}
+
+internal TypeNiche type_niche(TypeInterner *types, Type *x) {
+  switch (Cast(TypeKind, x->kind)) {
+  case Type_comptime_int:
+  case Type_nil:
+  case Type_never:
+  case Type_slice:
+  case Type_type:
+    return (TypeNiche){0};
+  case Type_bool:
+    return (TypeNiche){ .offset = 0, .size = 1, .start = 2, .count = 254 };
+  case Type_integer: {
+    TypeInteger integer = x->data.integer;
+    if (integer.bitwidth <= 64) {
+      return int_word_niche(0, int_size_info(integer.bitwidth).size, integer);
+    }
+
+    // Only the most significant word has unused bits.
+    u32 n = int_word_count(integer.bitwidth);
+    TypeInteger top = { .signedness = integer.signedness, .bitwidth = Cast(u16, integer.bitwidth - (n - 1) * 64) };
+    return int_word_niche((n - 1) * sizeof(u64), sizeof(u64), top);
+  }
+  case Type_range: {
+    // The patterns right after `max`, up to the first one that is in use again. Negative values are
+    // sign-extended, so the patterns in use wrap around from `min` to `max`.
+    TypeRange range = x->data.range;
+    u32 size = int_size_info(types_range_storage(range).bitwidth).size;
+    u64 mask = (size == 8) ? UINT64_MAX : (Cast(u64, 1) << (size * 8)) - 1;
+
+    u64 start = (Cast(u64, range.max) + 1) & mask;
+    u64 count = mask - (Cast(u64, range.max) - Cast(u64, range.min));
+    if (count > 0 && count - 1 > mask - start) {
+      count = mask - start + 1;
+    }
+
+    return (TypeNiche){ .offset = 0, .size = size, .start = start, .count = count };
+  }
+  case Type_function:
+    // A function value always refers to code.
+    return (TypeNiche){
+      .offset = Offsetof(ValueFunc, chunk) + Offsetof(IrChunk, opcodes),
+      .size   = sizeof(u8*),
+      .start  = 0,
+      .count  = 1,
+    };
+  case Type_array: {
+    if (x->data.array.size == 0) {
+      return (TypeNiche){0};
+    }
+
+    return types_get_extra(types, x->data.array.base_type).niche;
+  }
+  case Type_struct: {
+    TypeNiche best = {0};
+    for (u32 i = 0; i < x->data.struct_.field_count; i++) {
+      TypeStructField *field = &x->data.struct_.fields[i];
+      TypeNiche niche = types_get_extra(types, field->type).niche;
+      if (niche.count > best.count) {
+        best = niche;
+        best.offset += field->offset;
+      }
+    }
+
+    return best;
+  }
+  case Type_optional: {
+    TypeInfo base = types_get_extra(types, x->data.optional.base_type);
+
+    // None takes the first pattern of the niche, the rest is left for an enclosing optional.
+    if (base.niche.count > 0) {
+      TypeNiche niche = base.niche;
+      niche.start += 1;
+      niche.count -= 1;
+      return niche.count > 0 ? niche : (TypeNiche){0};
+    }
+
+    return (TypeNiche){ .offset = base.size_info.size, .size = 1, .start = 2, .count = 254 };
+  }
+  }
+
+  Unreachable();
+}
+
+internal TypeInfo intern_type_info(TypeInterner *types, Type *x) {
+  return (TypeInfo){
+    .size_info   = types_size_info(types, x),
+    .niche       = type_niche(types, x),
+    .is_complete = is_type_complete(types, x),
+  };
+}
+
+internal TypeIndex *direct_type_slot(TypeInterner *types, Type *x) {
+  switch (Cast(TypeKind, x->kind)) {
+  case Type_comptime_int:
+  case Type_bool:
+  case Type_nil:
+  case Type_never:
+  case Type_type:
+    return &types->direct.kinds[x->kind];
+  case Type_integer: {
+    TypeInteger integer = x->data.integer;
+    if (integer.bitwidth > TYPE_DIRECT_MAX_BITWIDTH) {
+      return Null;
+    }
+
+    return &types->direct.integers[integer.signedness][integer.bitwidth];
+  }
+  case Type_function:
+  case Type_slice:
+  case Type_array:
+  case Type_struct:
+  case Type_optional:
+  case Type_range:
+    return Null;
+  }
+
+  Unreachable();
+}
+
 internal Type *intern_type(Arena *arena, Type *x) {
   u32 size = type_intern_byte_size(x);
   Type *intern = arena_push(arena, size, Align_of(Type));
@@ -14,13 +191,17 @@ internal Type *intern_type(Arena *arena, Type *x) {
   return intern;
 }
 
-#define INTERNER_NAME            TypeInterner
-#define INTERNER_TYPE            TypePtr
-#define INTERNER_INDEX_TYPE      TypeIndex
-#define INTERNER_FUNCTION_PREFIX types
-#define INTERNER_HASH_FN         hash_type
-#define INTERNER_COMPARE_FN      cmp_type
-#define INTERNER_COPY_FN         intern_type
+#define INTERNER_NAME              TypeInterner
+#define INTERNER_TYPE              TypePtr
+#define INTERNER_INDEX_TYPE        TypeIndex
+#define INTERNER_EXTRA_TYPE        TypeInfo
+#define INTERNER_EXTRA_INIT_FN     intern_type_info
+#define INTERNER_DIRECT_STATE_TYPE TypeDirectTable
+#define INTERNER_DIRECT_SLOT_FN    direct_type_slot
+#define INTERNER_FUNCTION_PREFIX   types
+#define INTERNER_HASH_FN           hash_type
+#define INTERNER_COMPARE_FN        cmp_type
+#define INTERNER_COPY_FN           intern_type
 #define INTERNER_RESERVE_ZERO_INDEX
 #define INTERNER_OUTPUT_DEFINITIONS
 #include "interner.h"
@@ -33,6 +214,7 @@ internal b32 cmp_type(void *context, Type *a, Type *b) {
   }
 
   switch (a->kind) {
+  case Type_comptime_int:
   case Type_nil:
   case Type_never:
   case Type_bool:
@@ -40,6 +222,10 @@ internal b32 cmp_type(void *context, Type *a, Type *b) {
     return True;
   case Type_slice:
     return a->data.slice.base_type == b->data.slice.base_type;
+  case Type_optional:
+    return a->data.optional.base_type == b->data.optional.base_type;
+  case Type_range:
+    return a->data.range.min == b->data.range.min && a->data.range.max == b->data.range.max;
   case Type_function: {
     if (a->data.function.return_type != b->data.function.return_type) {
       return False;
@@ -63,6 +249,26 @@ internal b32 cmp_type(void *context, Type *a, Type *b) {
   case Type_array: {
     return a->data.array.size == b->data.array.size && a->data.array.base_type == b->data.array.base_type;
   }
+  case Type_struct: {
+    // The offsets follow from the other properties, so they are not compared.
+    if (a->data.struct_.is_ordered != b->data.struct_.is_ordered) {
+      return False;
+    }
+
+    if (a->data.struct_.field_count != b->data.struct_.field_count) {
+      return False;
+    }
+
+    for (u32 i = 0; i < a->data.struct_.field_count; i++) {
+      TypeStructField *fa = &a->data.struct_.fields[i];
+      TypeStructField *fb = &b->data.struct_.fields[i];
+      if (fa->name != fb->name || fa->type != fb->type || fa->placement != fb->placement) {
+        return False;
+      }
+    }
+
+    return True;
+  }
   }
 
   return False;
@@ -81,6 +287,7 @@ internal u32 push_type_data(Arena *arena, Type *x) {
   Push_data(x->kind);
 
   switch (x->kind) {
+  case Type_comptime_int:
   case Type_nil:
   case Type_never:
   case Type_bool:
@@ -93,6 +300,13 @@ internal u32 push_type_data(Arena *arena, Type *x) {
   case Type_slice: {
     Push_data(x->data.slice.base_type);
   } break;
+  case Type_optional: {
+    Push_data(x->data.optional.base_type);
+  } break;
+  case Type_range: {
+    Push_data(x->data.range.min);
+    Push_data(x->data.range.max);
+  } break;
   case Type_function: {
     Push_data(x->data.function.return_type);
     Push_data(x->data.function.param_count);
@@ -102,6 +316,15 @@ internal u32 push_type_data(Arena *arena, Type *x) {
     Push_data(x->data.array.size);
     Push_data(x->data.array.base_type);
   } break;
+  case Type_struct: {
+    Push_data(x->data.struct_.is_ordered);
+    Push_data(x->data.struct_.field_count);
+    for (u32 i = 0; i < x->data.struct_.field_count; i++) {
+      Push_data(x->data.struct_.fields[i].name);
+      Push_data(x->data.struct_.fields[i].type);
+      Push_data(x->data.struct_.fields[i].placement);
+    }
+  } break;
   }
 
   return size;
@@ -132,9 +355,13 @@ u32 type_intern_byte_size(Type *type) {
   case Type_type:
   case Type_slice:
   case Type_array:
+  case Type_optional:
+  case Type_range:
     return sizeof(Type);
   case Type_function:
     return sizeof(Type) + type->data.function.param_count * sizeof(TypeIndex);
+  case Type_struct:
+    return sizeof(Type) + type->data.struct_.field_count * sizeof(TypeStructField);
   }
 
   Unreachable();
@@ -146,6 +373,8 @@ TypeSizeInfo types_size_info(TypeInterner *types, Type *type) {
   // ASSUME: pointers are 8 bytes.
 
   switch (type->kind) {
+  case Type_comptime_int:
+    return (TypeSizeInfo){ .size = sizeof(ComptimeInt), .align = Align_of(ComptimeInt), .stride = sizeof(ComptimeInt) };
   case Type_bool:
     return (TypeSizeInfo){ .size = 1, .align = 1, .stride = 1 };
   case Type_nil:
@@ -154,11 +383,10 @@ TypeSizeInfo types_size_info(TypeInterner *types, Type *type) {
     return (TypeSizeInfo){ .size = 0, .align = 0, .stride = 0 };
   case Type_type:
     return (TypeSizeInfo){ .size = 4, .align = 4, .stride = 4 };
-  case Type_integer: { 
-    // ASSUME: the bitwidth of integers is always a multiple of 8.
-    u32 size = type->data.integer.bitwidth / 8;
-    return (TypeSizeInfo){ .size = size, .align = size, .stride = size };
-  }
+  case Type_integer:
+    return int_size_info(type->data.integer.bitwidth);
+  case Type_range:
+    return int_size_info(types_range_storage(type->data.range).bitwidth);
   case Type_slice: {
     // A slice is stored as an 8-byte pointer and an 8-byte length.
     return (TypeSizeInfo){ .size = 16, .align = 8, .stride = 16 };
@@ -176,6 +404,35 @@ TypeSizeInfo types_size_info(TypeInterner *types, Type *type) {
     // A variable holding a function is stored as an 8-byte pointer to the actual code of the function.
     return (TypeSizeInfo){ .size = sizeof(ValueFunc), .align = Align_of(ValueFunc), .stride = sizeof(ValueFunc) };
   }
+  case Type_struct: {
+    // The offsets are already computed by `types_struct_layout`.
+    u32 align = 1;
+    u32 end   = 0;
+
+    for (u32 i = 0; i < type->data.struct_.field_count; i++) {
+      TypeStructField *field = &type->data.struct_.fields[i];
+      TypeSizeInfo size_info = types_size_info_by_index(types, field->type);
+
+      align = Max(align, size_info.align);
+      end   = Max(end, field->offset + size_info.size);
+    }
+
+    u32 size = Cast(u32, round_up_to_power_of_two(end, align));
+
+    return (TypeSizeInfo){ .size = size, .align = align, .stride = size };
+  }
+  case Type_optional: {
+    TypeInfo base = types_get_extra(types, type->data.optional.base_type);
+    if (base.niche.count > 0) {
+      return base.size_info;
+    }
+
+    // The tag byte follows the base value.
+    u32 align = Max(1, base.size_info.align);
+    u32 size  = Cast(u32, round_up_to_power_of_two(base.size_info.size + 1, align));
+
+    return (TypeSizeInfo){ .size = size, .align = align, .stride = size };
+  }
   }
 
   Unreachable();
@@ -183,9 +440,221 @@ TypeSizeInfo types_size_info(TypeInterner *types, Type *type) {
   return (TypeSizeInfo){0};
 }
 
-TypeSizeInfo types_size_info_by_index(TypeInterner *types, TypeIndex idx) {
+b32 types_struct_layout(TypeInterner *types, Arena *scratch, Type *type) {
+  TypeStruct *s = &type->data.struct_;
+
+  ArenaSnapshot snapshot = arena_scope_begin(scratch);
+
+  // The order in which the fields are placed, as indices into the fields.
+  u32 *order = arena_push_array(u32, scratch, s->field_count);
+  u32 *aligns = arena_push_array(u32, scratch, s->field_count);
+
+  for (u32 i = 0; i < s->field_count; i++) {
+    order[i]  = i;
+    aligns[i] = Max(1, types_size_info_by_index(types, s->fields[i].type).align);
+  }
+
+  if (!s->is_ordered) {
+    // A stable insertion sort by placement group and then by decreasing alignment. Structs have few
+    // fields, and keeping equal fields in declaration order makes the layout predictable.
+    for (u32 i = 1; i < s->field_count; i++) {
+      u32 x = order[i];
+      u32 j = i;
+
+      for (; j > 0; j--) {
+        u32 y = order[j-1];
+
+        b32 is_before = s->fields[x].placement < s->fields[y].placement ||
+                        (s->fields[x].placement == s->fields[y].placement && aligns[x] > aligns[y]);
+        if (!is_before) {
+          break;
+        }
+
+        order[j] = y;
+      }
+
+      order[j] = x;
+    }
+  }
+
+  u64 at = 0;
+
+  for (u32 start = 0; start < s->field_count && at <= UINT32_MAX;) {
+    // The fields of the placement group are `order[start..end)`. Every field of an ordered struct is
+    // a group of its own.
+    u32 end = start + 1;
+    while (!s->is_ordered && end < s->field_count && s->fields[order[end]].placement == s->fields[order[start]].placement) {
+      end += 1;
+    }
+
+    // The first field of a group can need more alignment than the last field of the group before
+    // it. The smallest fields of the group, at its end, go in the padding in between for as long as
+    // they fit, so that the groups are packed as tightly as the fields within a group.
+    u64 first = round_up_to_power_of_two(at, aligns[order[start]]);
+    u32 last  = end;
+    while (last > start + 1) {
+      u32 k = order[last - 1];
+
+      u64 offset = round_up_to_power_of_two(at, aligns[k]);
+      u64 size   = types_size_info_by_index(types, s->fields[k].type).size;
+      if (offset + size > first || offset > UINT32_MAX) {
+        break;
+      }
+
+      s->fields[k].offset = Cast(u32, offset);
+      at    = offset + size;
+      last -= 1;
+    }
+
+    for (u32 i = start; i < last; i++) {
+      TypeStructField *field = &s->fields[order[i]];
+
+      at = round_up_to_power_of_two(at, aligns[order[i]]);
+      if (at > UINT32_MAX) {
+        break;
+      }
+
+      field->offset = Cast(u32, at);
+      at += types_size_info_by_index(types, field->type).size;
+    }
+
+    start = end;
+  }
+
+  arena_scope_end(scratch, snapshot);
+
+  return at <= UINT32_MAX;
+}
+
+OptionalLayout types_optional_layout(TypeInterner *types, Type *optional) {
+  Assert(optional->kind == Type_optional);
+
+  TypeInfo base = types_get_extra(types, optional->data.optional.base_type);
+  if (base.niche.count > 0) {
+    return (OptionalLayout){
+      .is_tagged = False,
+      .offset    = base.niche.offset,
+      .size      = base.niche.size,
+      .none      = base.niche.start,
+    };
+  }
+
+  return (OptionalLayout){ .is_tagged = True, .offset = base.size_info.size, .size = 1, .none = 0 };
+}
+
+// ASSUME: the target is little-endian, like the bit patterns of a niche.
+
+void optional_store_none(OptionalLayout layout, void *payload) {
+  memcpy(ptr_offset(payload, layout.offset), &layout.none, layout.size);
+}
+
+void optional_store_some(OptionalLayout layout, void *payload) {
+  if (layout.is_tagged) {
+    *Cast(u8*, ptr_offset(payload, layout.offset)) = 1;
+  }
+}
+
+b32 optional_is_some(OptionalLayout layout, void const *payload) {
+  u64 x = 0;
+  memcpy(&x, ptr_offset(payload, layout.offset), layout.size);
+  return x != layout.none;
+}
+
+// The number of bits a signed integer needs to hold `x`.
+internal u16 signed_bitwidth(ComptimeInt x) {
+  return Cast(u16, bitwidth(Cast(u64, x < 0 ? ~x : x)) + 1);
+}
+
+TypeInteger types_range_storage(TypeRange range) {
+  if (range.min >= 0) {
+    return (TypeInteger){ .signedness = Unsigned, .bitwidth = Cast(u16, Max(1, bitwidth(Cast(u64, range.max)))) };
+  }
+
+  return (TypeInteger){ .signedness = Signed, .bitwidth = Max(signed_bitwidth(range.min), signed_bitwidth(range.max)) };
+}
+
+b32 types_integer_storage(Type *type, TypeInteger *out) {
+  switch (type->kind) {
+  case Type_comptime_int:
+    *out = (TypeInteger){ .signedness = Signed, .bitwidth = sizeof(ComptimeInt) * 8 };
+    return True;
+  case Type_integer:
+    *out = type->data.integer;
+    return True;
+  case Type_range:
+    *out = types_range_storage(type->data.range);
+    return True;
+  }
+
+  return False;
+}
+
+// The values of `integer` clamped to those representable as a `ComptimeInt`. Returns False if any
+// were clamped.
+internal b32 integer_type_range(TypeInteger integer, TypeRange *out) {
+  u32 value_bits = Cast(u32, integer.bitwidth) - Cast(u32, integer.signedness == Signed ? 1 : 0);
+  if (value_bits >= 64) {
+    *out = (TypeRange){ .min = (integer.signedness == Signed) ? INT64_MIN : 0, .max = INT64_MAX };
+    return False;
+  }
+
+  ComptimeInt max = Cast(ComptimeInt, (Cast(u64, 1) << value_bits) - 1);
+  *out = (TypeRange){ .min = (integer.signedness == Signed) ? -max - 1 : 0, .max = max };
+
+  return True;
+}
+
+b32 types_integer_range(TypeInterner *types, TypeIndex idx, TypeRange *out) {
   Type *type = types_get(types, idx);
-  return types_size_info(types, type);
+  if (type->kind == Type_range) {
+    *out = type->data.range;
+    return True;
+  }
+
+  TypeInteger integer;
+  if (!types_integer_storage(type, &integer)) {
+    return False;
+  }
+
+  return integer_type_range(integer, out);
+}
+
+b32 types_integer_contains(TypeInterner *types, TypeIndex to, TypeIndex from) {
+  if (to == from) {
+    return True;
+  }
+
+  Type *type_to   = types_get(types, to);
+  Type *type_from = types_get(types, from);
+
+  TypeInteger storage_to, storage_from;
+  if (!types_integer_storage(type_to, &storage_to) || !types_integer_storage(type_from, &storage_from)) {
+    return False;
+  }
+
+  // Integers may be wider than a `ComptimeInt`, so they are compared by their bitwidths.
+  if (type_to->kind == Type_integer && type_from->kind == Type_integer) {
+    if (storage_to.signedness == storage_from.signedness) {
+      return storage_from.bitwidth <= storage_to.bitwidth;
+    }
+
+    return storage_from.signedness == Unsigned && storage_from.bitwidth < storage_to.bitwidth;
+  }
+
+  // The values of `from` must all be representable, the values of `to` may be clamped. A range
+  // never holds a value outside of those of a `ComptimeInt`.
+  TypeRange range_to, range_from;
+  if (!types_integer_range(types, from, &range_from)) {
+    return False;
+  }
+
+  if (type_to->kind == Type_range) {
+    range_to = type_to->data.range;
+  } else {
+    integer_type_range(storage_to, &range_to);
+  }
+
+  return range_to.min <= range_from.min && range_from.max <= range_to.max;
 }
 
 b32 is_type_coercible_to(TypeInterner *types, TypeIndex to, TypeIndex from) {
@@ -196,5 +665,11 @@ b32 is_type_coercible_to(TypeInterner *types, TypeIndex to, TypeIndex from) {
   Type *type_to = types_get(types, to);
   Type *type_from = types_get(types, from);
 
+  // A coercion between integers and ranges is only allowed without a check if it can not fail.
+  TypeInteger ignored;
+  if (types_integer_storage(type_to, &ignored) && types_integer_storage(type_from, &ignored)) {
+    return types_integer_contains(types, to, from);
+  }
+
   Todo();
 }
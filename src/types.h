@@ -12,9 +12,14 @@ typedef enum {
   Type_never,
   Type_slice,
   Type_array,
+  Type_struct,
+  Type_optional,
+  Type_range,
   Type_type,
 } TypeKind;
 
+#define TYPE_KIND_COUNT (Type_type + 1) // Type_type is the last kind.
+
 // How a comptime_int is actually stored. This will probably grow at some point.
 typedef i64 ComptimeInt;
 
@@ -43,12 +48,45 @@ typedef struct {
   u64 size;
 } TypeArray;
 
+typedef struct {
+  TypeIndex base_type;
+} TypeOptional;
+
+// An integer that only takes the values from `min` up to and including `max`. It is stored as the
+// narrowest integer type that holds all of them, see `types_range_storage`.
+typedef struct {
+  ComptimeInt min;
+  ComptimeInt max;
+} TypeRange;
+
 typedef struct {
   TypeIndex return_type;
   u32 param_count;
   TypeIndex param_types[];
 } TypeFunction;
 
+// Fields are laid out per placement group, hot fields first and cold fields last, so that the hot
+// fields share the first cache line of the struct.
+typedef enum {
+  FieldPlacement_hot,
+  FieldPlacement_default,
+  FieldPlacement_cold,
+} FieldPlacement;
+
+typedef struct {
+  StringIndex name;
+  TypeIndex   type;
+  u32         offset; // Computed by `types_struct_layout`.
+  u8          placement;
+} TypeStructField;
+
+// The fields are stored in declaration order, only their offsets reflect the layout.
+typedef struct {
+  b8 is_ordered; // Lay out the fields in declaration order.
+  u32 field_count;
+  TypeStructField fields[];
+} TypeStruct;
+
 typedef struct {
   u8 kind;
 
@@ -59,27 +97,109 @@ typedef struct {
     TypeSlice    slice;
     TypeArray    array;
     TypeFunction function;
+    TypeStruct   struct_;
+    TypeOptional optional;
+    TypeRange    range;
   } data;
 #pragma clang diagnostic pop
 } Type;
 
 typedef Type *TypePtr;
 
-#define INTERNER_NAME            TypeInterner
-#define INTERNER_TYPE            TypePtr
-#define INTERNER_INDEX_TYPE      TypeIndex
-#define INTERNER_FUNCTION_PREFIX types
+// A niche is a range of bit patterns that no value of a type uses, such as the values 2 to 255 of a
+// bool. `?T` stores none in a niche of `T` if it has one, so it is no larger than `T`.
+typedef struct {
+  u32 offset; // Byte offset of the niche within a value.
+  u32 size;   // Size of the niche in bytes, at most 8.
+  u64 start;  // The first unused bit pattern, read as a little-endian integer of `size` bytes.
+  u64 count;  // The number of unused bit patterns from `start` on, 0 if the type has no niche.
+} TypeNiche;
+
+// Information about a type that is computed once when the type is interned and stored as its extra
+// data.
+typedef struct {
+  TypeSizeInfo size_info;
+  TypeNiche niche;
+
+  // A type is incomplete if it contains an unknown type, e.g. the function type `(i32, ?) bool`.
+  b32 is_complete;
+} TypeInfo;
+
+// Types that are fully described by their kind and integer types up to this bitwidth are looked up
+// in a table instead of being hashed.
+#define TYPE_DIRECT_MAX_BITWIDTH 128
+
+typedef struct {
+  TypeIndex kinds[TYPE_KIND_COUNT];
+  TypeIndex integers[2][TYPE_DIRECT_MAX_BITWIDTH + 1]; // Indexed by signedness and bitwidth.
+} TypeDirectTable;
+
+#define INTERNER_NAME              TypeInterner
+#define INTERNER_TYPE              TypePtr
+#define INTERNER_INDEX_TYPE        TypeIndex
+#define INTERNER_EXTRA_TYPE        TypeInfo
+#define INTERNER_DIRECT_STATE_TYPE TypeDirectTable
+#define INTERNER_FUNCTION_PREFIX   types
 #define INTERNER_OUTPUT_TYPES
 #define INTERNER_OUTPUT_DECLARATIONS
 #include "interner.h"
 
 #define arena_push_type_function(arena,param_count) arena_push(arena, sizeof(Type) + (param_count) *sizeof(TypeIndex), Align_of(Type))
+#define arena_push_type_struct(arena,field_count) arena_push(arena, sizeof(Type) + (field_count) *sizeof(TypeStructField), Align_of(Type))
 
 // Types are variable in size. This functions returns the actual size in bytes for a given type.
 u32 type_intern_byte_size(Type *type);
 
+// Computes the size info of a type that does not have to be interned. The types it refers to must
+// be interned.
 TypeSizeInfo types_size_info(TypeInterner *types, Type *type);
-TypeSizeInfo types_size_info_by_index(TypeInterner *types, TypeIndex idx);
+
+// Computes the field offsets of a struct type that is not interned yet. Unless the struct is ordered,
+// the fields of each placement group are sorted by decreasing alignment, which leaves no padding
+// between fields with power of two sizes. Padding before the first field of a group is filled with
+// the smallest fields of that group. The field types must be interned. Returns False if the struct
+// does not fit in 4GiB.
+b32 types_struct_layout(TypeInterner *types, Arena *scratch, Type *type);
+
+always_inline TypeSizeInfo types_size_info_by_index(TypeInterner *types, TypeIndex idx) {
+  return types_get_extra(types, idx).size_info;
+}
+
+always_inline b32 types_is_complete(TypeInterner *types, TypeIndex idx) {
+  return types_get_extra(types, idx).is_complete;
+}
+
+// Where an optional value tells whether it is none. Without a niche in the base type a tag byte
+// follows the base value, which is 0 for none and 1 for some.
+typedef struct {
+  b32 is_tagged;
+  u32 offset;
+  u32 size;
+  u64 none; // The bit pattern at `offset` of none.
+} OptionalLayout;
+
+OptionalLayout types_optional_layout(TypeInterner *types, Type *optional);
+
+// A some value holds the base value at offset 0. The bytes of a none value outside of its pattern are
+// zero, `optional_store_none` expects them to be cleared already.
+void optional_store_none(OptionalLayout layout, void *payload);
+void optional_store_some(OptionalLayout layout, void *payload);
+b32  optional_is_some(OptionalLayout layout, void const *payload);
+
+// The narrowest integer type that holds every value of `range`. It is unsigned unless the range
+// contains negative values, so `0..200` is stored as a `u8`.
+TypeInteger types_range_storage(TypeRange range);
+
+// How a value of an integer, range or comptime_int type is stored. Returns False for other types.
+b32 types_integer_storage(Type *type, TypeInteger *out);
+
+// The values of an integer, range or comptime_int type. Returns False if they are not all
+// representable as a `ComptimeInt`, such as those of a u64.
+b32 types_integer_range(TypeInterner *types, TypeIndex idx, TypeRange *out);
+
+// Whether every value of `from` is also a value of `to`, both being integer, range or comptime_int
+// types. A coercion that is proven this way can not fail, so it needs no check.
+b32 types_integer_contains(TypeInterner *types, TypeIndex to, TypeIndex from);
 
 b32 is_type_coercible_to(TypeInterner *types, TypeIndex to, TypeIndex from);
 
@@ -9,53 +9,432 @@
 #define SEGMENTLIST_OUTPUT_DEFINITIONS
 #include "segment_list.h"
 
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+internal u32 hash_value_key(void *context, ValueKey key) {
+  Unused(context);
+  return XXH32(key.data, key.size, key.type);
+}
+
+internal b32 cmp_value_key(void *context, ValueKey a, ValueKey b) {
+  Unused(context);
+  return a.type == b.type && a.size == b.size && memcmp(a.data, b.data, a.size) == 0;
+}
+
+#define HASHMAP_NAME            ValueInternMap
+#define HASHMAP_KEY_TYPE        ValueKey
+#define HASHMAP_VALUE_TYPE      ValueIndex
+#define HASHMAP_FUNCTION_PREFIX intern_map
+#define HASHMAP_HASH_FN         hash_value_key
+#define HASHMAP_KEY_COMPARE_FN  cmp_value_key
+#define HASHMAP_LINKAGE         internal
+#define HASHMAP_OUTPUT_DEFINITIONS
+#include "hashmap.h"
+
+#ifdef TTLD_DEBUG
+#define SEGMENTLIST_NAME            ValueGenerationList
+#define SEGMENTLIST_TYPE            u8
+#define SEGMENTLIST_MIN_SIZE_LOG2   6
+#define SEGMENTLIST_SEGMENT_COUNT   24
+#define SEGMENTLIST_FUNCTION_PREFIX generations
+#define SEGMENTLIST_LINKAGE         internal
+#define SEGMENTLIST_OUTPUT_DEFINITIONS
+#include "segment_list.h"
+#endif
+
+// `data_size` of a slot that is on the free list.
+#define DATA_SIZE_FREE 0x7fffffff
+
 void values_init(ValueStore *values, ValueStoreOptions *options) {
   *values = (ValueStore){
     .arena             = options->arena,
     .payload_allocator = options->payload_allocator,
     .list              = {0},
+    .free_list         = VALUE_FREE_LIST_END,
+    .collect_threshold = VALUE_COLLECT_MIN_THRESHOLD,
   };
-  list_push(&values->list, values->arena); // Reserve nil entry
+  *list_push(&values->list, values->arena) = (Value){0}; // Reserve nil entry
+
+  intern_map_init(
+    &values->interned,
+    &(HashMapOptions){
+      .allocator = options->payload_allocator,
+      .initial_size = 64,
+    }
+  );
+
+#ifdef TTLD_DEBUG
+  *generations_push(&values->generations, values->arena) = 0;
+#endif
 }
 
-ValueIndex values_alloc(ValueStore *values, Value **out) {
-  u32 idx = values->list.len;
-  *out = list_push(&values->list, values->arena);
-  return idx;
+internal ValueIndex index_of_slot(ValueStore *values, u32 slot) {
+#ifdef TTLD_DEBUG
+  u8 generation = generations_at_unchecked(&values->generations, slot);
+  return slot | (Cast(u32, generation) << VALUE_INDEX_SLOT_BITS);
+#else
+  Unused(values);
+  return slot;
+#endif
 }
 
-void *values_alloc_data(ValueStore *values, u32 size, u32 align) {
-  return Alloc(values->payload_allocator, size, align);
+internal ValueIndex alloc_slot(ValueStore *values, Value **out) {
+  u32 slot;
+
+  if (values->free_list != VALUE_FREE_LIST_END) {
+    slot = values->free_list;
+    *out = list_ptr_at_unchecked(&values->list, slot);
+    values->free_list = (*out)->next_free;
+  } else {
+    slot = values->list.len;
+    Assert(slot < VALUE_INDEX_SLOT_MASK);
+    *out = list_push(&values->list, values->arena);
+
+#ifdef TTLD_DEBUG
+    *generations_push(&values->generations, values->arena) = 0;
+#endif
+  }
+
+  values->live_count += 1;
+
+  return index_of_slot(values, slot);
 }
 
-void values_dealloc_data(ValueStore *values, void *data, u32 size) {
-  Free(values->payload_allocator, data, size);
+// Only called for payloads that are too big to be stored inline.
+internal u32 size_class_of(u32 size) {
+  return bitwidth(size - 1) - VALUE_SIZE_CLASS_MIN_LOG2;
+}
+
+// The number of bytes that is taken from the arena when a size class runs out.
+#define SIZE_CLASS_GROW_SIZE KiB(4)
+
+// Payloads that are not stored inline are always aligned to 16 bytes.
+internal void *alloc_payload(ValueStore *values, u32 size, u32 align) {
+  Assert(align <= 16);
+
+  if (size > VALUE_SIZE_CLASS_MAX) {
+    return Alloc(values->payload_allocator, size, 16);
+  }
+
+  u32 class = size_class_of(size);
+  void **freelist = &values->size_classes[class];
+
+  if (!*freelist) {
+    u32 stride = Cast(u32, 1) << (class + VALUE_SIZE_CLASS_MIN_LOG2);
+    u32 count = SIZE_CLASS_GROW_SIZE / stride;
+    void *mem = arena_push(values->arena, count * stride, 16);
+    freelist_grow(freelist, mem, stride, count);
+  }
+
+  return freelist_alloc(freelist);
+}
+
+internal void free_payload(ValueStore *values, void *p, u32 size) {
+  if (size > VALUE_SIZE_CLASS_MAX) {
+    Free(values->payload_allocator, p, size);
+    return;
+  }
+
+  freelist_free(&values->size_classes[size_class_of(size)], p);
+}
+
+ValueIndex values_alloc(ValueStore *values, TypeIndex type, u32 size, u32 align, void **data) {
+  Value *v;
+  ValueIndex idx = alloc_slot(values, &v);
+
+  *v = (Value){
+    .type = type,
+    .data_size = size,
+  };
+
+  if (size <= VALUE_INLINE_SIZE) {
+    Assert(align <= 8);
+  } else {
+    v->data = alloc_payload(values, size, align);
+  }
+
+  *data = value_data(v);
+
+  return idx;
+}
+
+void values_deinit(ValueStore *values) {
+  intern_map_deinit(&values->interned);
 }
 
 void values_dealloc(ValueStore *values, ValueIndex idx) {
+  Assert(idx != 0);
+
   Value *p = values_get(values, idx);
-  if (p->data_size > 0) {
-    Free(values->payload_allocator, p->data, p->data_size);
+  if (p->is_interned) {
+    return;
+  }
+
+  if (p->data_size > VALUE_INLINE_SIZE) {
+    free_payload(values, p->data, p->data_size);
   }
+
+  u32 slot = value_index_slot(idx);
+
+#ifdef TTLD_DEBUG
+  u8 *generation = generations_ptr_at_unchecked(&values->generations, slot);
+  *generation = (*generation + 1) & VALUE_INDEX_GENERATION_MASK;
+#endif
+
+  *p = (Value){
+    .next_free = values->free_list,
+    .data_size = DATA_SIZE_FREE,
+  };
+
+  values->free_list = slot;
+  values->live_count -= 1;
+}
+
+b32 values_is_live(ValueStore *values, ValueIndex idx) {
+  u32 slot = value_index_slot(idx);
+
+  if (slot >= values->list.len) {
+    return False;
+  }
+
+#ifdef TTLD_DEBUG
+  u8 generation = generations_at_unchecked(&values->generations, slot);
+  if (idx >> VALUE_INDEX_SLOT_BITS != generation) {
+    return False;
+  }
+#endif
+
+  return list_ptr_at_unchecked(&values->list, slot)->data_size != DATA_SIZE_FREE;
+}
+
+ValueIndex values_intern(ValueStore *values, TypeIndex type, void const *data, u32 size) {
+  ValueKey key = { .type = type, .size = size, .data = data };
+
+  ValueIndex *found = intern_map_find(&values->interned, key);
+  if (found) {
+    return *found;
+  }
+
+  // As in `values_copy`, the alignment of a payload only depends on its size.
+  void *payload;
+  ValueIndex idx = values_alloc(values, type, size, 1, &payload);
+  memcpy(payload, data, size);
+
+  values_get(values, idx)->is_interned = True;
+
+  key.data = payload;
+  intern_map_insert(&values->interned, key, idx);
+
+  return idx;
 }
 
 Value *values_get(ValueStore *values, ValueIndex idx) {
-  return list_ptr_at_unchecked(&values->list, idx);
+  Assert(values_is_live(values, idx));
+  return list_ptr_at_unchecked(&values->list, value_index_slot(idx));
 }
 
 ValueIndex values_copy(ValueStore *values, ValueIndex val) {
-  Value *v;
-  ValueIndex res = values_alloc(values, &v);
-  {
-    Value *s = values_get(values, val);
-    u32 align = 16; // TODO: not the nicest solution as this could be too small.
-    void *data = values_alloc_data(values, s->data_size, align);
-    memcpy(data, s->data, s->data_size);
-    *v = (Value){
-      .type = s->type,
-      .data = data,
-      .data_size = s->data_size,
-    };
+  Value *s = values_get(values, val);
+
+  if (s->is_interned) {
+    return val;
   }
+
+  // Payloads of the same size always get the same alignment, so the alignment of `s` is enough.
+  void *data;
+  ValueIndex res = values_alloc(values, s->type, s->data_size, 1, &data);
+
+  // `s` is still valid, the values are stored in a segment list which never moves its elements.
+  memcpy(data, value_data(s), s->data_size);
+
   return res;
 }
+
+// -------------------------------------------------------------------------------------------------
+
+void values_collect_begin(ValueCollector *c, ValueStore *values, TypeInterner *types, Arena *scratch) {
+  u32 slot_count = values->list.len;
+
+  *c = (ValueCollector){
+    .values = values,
+    .types = types,
+    .scratch = scratch,
+    .snapshot = arena_scope_begin(scratch),
+    .slot_count = slot_count,
+  };
+
+  u32 mark_bytes = (slot_count + 7) / 8;
+  c->marks = arena_push_array(u8, scratch, mark_bytes);
+  memset(c->marks, 0, mark_bytes);
+
+  // Every live value is pushed at most once.
+  c->worklist = arena_push_array(ValueIndex, scratch, values->live_count);
+}
+
+void values_mark(ValueCollector *c, ValueIndex idx) {
+  if (idx == 0) {
+    return;
+  }
+
+  Assert(values_is_live(c->values, idx));
+
+  u32 slot = value_index_slot(idx);
+  u8 bit = Cast(u8, 1 << (slot % 8));
+
+  if (c->marks[slot / 8] & bit) {
+    return;
+  }
+
+  c->marks[slot / 8] |= bit;
+  c->worklist[c->worklist_len++] = idx;
+}
+
+void values_mark_ref(ValueCollector *c, Ref ref) {
+  if (ref_is_some_value_index(ref)) {
+    values_mark(c, ref_to_value_index(ref));
+  }
+}
+
+internal void mark_operand(ValueCollector *c, IrOperand operand) {
+  if (operand.kind == IrOperand_ref) {
+    values_mark_ref(c, (Ref){ *operand.p });
+  }
+}
+
+void values_mark_chunk(ValueCollector *c, IrChunk *chunk) {
+  for (InstructionIndex i = 0; i < chunk->opcode_count; i++) {
+    u32 count = chunk_operand_count(chunk, i);
+    for (u32 j = 0; j < count; j++) {
+      mark_operand(c, chunk_operand_at(chunk, i, j));
+    }
+  }
+}
+
+void values_mark_builder(ValueCollector *c, IrBuilder *builder) {
+  for (InstructionIndex i = 0; i < builder->kinds.len; i++) {
+    u32 count = inst_operand_count(builder, i);
+    for (u32 j = 0; j < count; j++) {
+      mark_operand(c, inst_operand_at(builder, i, j));
+    }
+  }
+}
+
+// Function values are the only values that refer to other values, through their code. They can also
+// be stored inside arrays, structs and optionals.
+internal b32 may_refer_to_values(TypeInterner *types, TypeIndex type_idx) {
+  Type *type = types_get(types, type_idx);
+
+  switch (Cast(TypeKind, type->kind)) {
+  case Type_function:
+    return True;
+  case Type_array:
+    return may_refer_to_values(types, type->data.array.base_type);
+  case Type_optional:
+    return may_refer_to_values(types, type->data.optional.base_type);
+  case Type_struct: {
+    for (u32 i = 0; i < type->data.struct_.field_count; i++) {
+      if (may_refer_to_values(types, type->data.struct_.fields[i].type)) {
+        return True;
+      }
+    }
+  } break;
+  case Type_comptime_int:
+  case Type_integer:
+  case Type_bool:
+  case Type_nil:
+  case Type_never:
+  case Type_slice:
+  case Type_range:
+  case Type_type:
+    break;
+  }
+
+  return False;
+}
+
+internal void mark_payload(ValueCollector *c, TypeIndex type_idx, void *data) {
+  Type *type = types_get(c->types, type_idx);
+
+  switch (Cast(TypeKind, type->kind)) {
+  case Type_function: {
+    values_mark_chunk(c, &Cast(ValueFunc*, data)->chunk);
+  } break;
+  case Type_array: {
+    TypeIndex base_type = type->data.array.base_type;
+    if (!may_refer_to_values(c->types, base_type)) {
+      break;
+    }
+
+    u32 stride = types_size_info_by_index(c->types, base_type).stride;
+    for (u64 i = 0; i < type->data.array.size; i++) {
+      mark_payload(c, base_type, ptr_offset(data, i * stride));
+    }
+  } break;
+  case Type_struct: {
+    for (u32 i = 0; i < type->data.struct_.field_count; i++) {
+      TypeStructField *field = &type->data.struct_.fields[i];
+      mark_payload(c, field->type, ptr_offset(data, field->offset));
+    }
+  } break;
+  case Type_optional: {
+    if (optional_is_some(types_optional_layout(c->types, type), data)) {
+      mark_payload(c, type->data.optional.base_type, data);
+    }
+  } break;
+  case Type_comptime_int:
+  case Type_integer:
+  case Type_bool:
+  case Type_nil:
+  case Type_never:
+  case Type_slice:
+  case Type_range:
+  case Type_type:
+    break;
+  }
+}
+
+internal void free_slot(ValueStore *values, ValueIndex idx) {
+  Value *v = values_get(values, idx);
+
+  if (v->is_interned) {
+    ValueKey key = { .type = v->type, .size = v->data_size, .data = value_data(v) };
+    intern_map_remove(&values->interned, key);
+    v->is_interned = False;
+  }
+
+  values_dealloc(values, idx);
+}
+
+u32 values_collect_end(ValueCollector *c) {
+  ValueStore *values = c->values;
+
+  while (c->worklist_len > 0) {
+    ValueIndex idx = c->worklist[--c->worklist_len];
+    Value *v = values_get(values, idx);
+    mark_payload(c, v->type, value_data(v));
+  }
+
+  u32 freed = 0;
+
+  // Slots that were allocated after `values_collect_begin` are not touched.
+  for (u32 slot = 1; slot < c->slot_count; slot++) {
+    if (c->marks[slot / 8] & (1 << (slot % 8))) {
+      continue;
+    }
+
+    Value *v = list_ptr_at_unchecked(&values->list, slot);
+    if (v->data_size == DATA_SIZE_FREE) {
+      continue;
+    }
+
+    free_slot(values, index_of_slot(values, slot));
+    freed += 1;
+  }
+
+  values->collect_threshold = Max(VALUE_COLLECT_MIN_THRESHOLD, values->live_count * 2);
+
+  arena_scope_end(c->scratch, c->snapshot);
+
+  return freed;
+}
@@ -6,11 +6,48 @@
 #include "ir.h"
 
 typedef struct {
-  TypeIndex  type;
-  u32        data_size;
-  void      *data;
+  union {
+    TypeIndex type;
+    u32       next_free; // Slot of the next free value if this slot is on the free list.
+  };
+  u32 data_size   : 31;
+  u32 is_interned : 1; // See `values_intern`.
+
+  // Payloads of up to `VALUE_INLINE_SIZE` bytes are stored inline. Use `value_data` to get to the
+  // payload.
+  union {
+    void *data;
+    u8    inline_data[8];
+  };
 } Value;
 
+#define VALUE_INLINE_SIZE 8
+
+always_inline void *value_data(Value *v) {
+  return v->data_size <= VALUE_INLINE_SIZE ? v->inline_data : v->data;
+}
+
+// Deallocated slots are put on a free list and reused by later allocations. In debug builds the
+// upper bits of a `ValueIndex` hold the generation of its slot. The generation is bumped when the
+// slot is deallocated, so that using an index after its value was deallocated is caught by
+// `values_get`. The MSB is left alone, because `IrRef` uses it to tell instruction and value
+// indices apart.
+//
+// Every build defines TTLD_DEBUG, so the generation is kept to 4 bits to leave 27 bits for the
+// slot. A generation only has to differ from the one a stale index was made with, which 4 bits do
+// for the next 15 deallocations of the slot.
+#ifdef TTLD_DEBUG
+#define VALUE_INDEX_SLOT_BITS       27
+#define VALUE_INDEX_GENERATION_MASK 0xf
+#else
+#define VALUE_INDEX_SLOT_BITS       31
+#endif
+
+#define VALUE_INDEX_SLOT_MASK ((Cast(u32, 1) << VALUE_INDEX_SLOT_BITS) - 1)
+#define VALUE_FREE_LIST_END   VALUE_INDEX_SLOT_MASK
+
+always_inline u32 value_index_slot(ValueIndex idx) { return idx & VALUE_INDEX_SLOT_MASK; }
+
 #define SEGMENTLIST_NAME          ValueList
 #define SEGMENTLIST_TYPE          Value
 #define SEGMENTLIST_MIN_SIZE_LOG2 6
@@ -23,10 +60,55 @@ typedef struct {
   void  *data;
 } ValueSlice;
 
+// An interned value is identified by its type and payload bytes.
+typedef struct {
+  TypeIndex   type;
+  u32         size;
+  void const *data;
+} ValueKey;
+
+#define HASHMAP_NAME            ValueInternMap
+#define HASHMAP_KEY_TYPE        ValueKey
+#define HASHMAP_VALUE_TYPE      ValueIndex
+#define HASHMAP_FUNCTION_PREFIX intern_map
+#define HASHMAP_OUTPUT_TYPES
+#include "hashmap.h"
+
+#ifdef TTLD_DEBUG
+#define SEGMENTLIST_NAME          ValueGenerationList
+#define SEGMENTLIST_TYPE          u8
+#define SEGMENTLIST_MIN_SIZE_LOG2 6
+#define SEGMENTLIST_SEGMENT_COUNT 24
+#define SEGMENTLIST_OUTPUT_TYPES
+#include "segment_list.h"
+#endif
+
+// Payloads that are not stored inline are allocated from size classes of 16 to 2048 bytes. The
+// memory for the size classes comes from `arena` and is never returned to it, freed payloads go on
+// the free list of their size class. Larger payloads use `payload_allocator`.
+#define VALUE_SIZE_CLASS_COUNT    8
+#define VALUE_SIZE_CLASS_MIN_LOG2 4
+#define VALUE_SIZE_CLASS_MAX      (Cast(u32, 1) << (VALUE_SIZE_CLASS_MIN_LOG2 + VALUE_SIZE_CLASS_COUNT - 1))
+
 struct ValueStore {
   Arena     *arena;
   Allocator  payload_allocator;
   ValueList  list;
+
+  void *size_classes[VALUE_SIZE_CLASS_COUNT];
+
+  u32 free_list; // Slot of the first free value or `VALUE_FREE_LIST_END`.
+  u32 live_count;
+
+  // A collection is due once `live_count` reaches this number. See `values_should_collect`.
+  u32 collect_threshold;
+
+  // The keys point to the payloads of the interned values.
+  ValueInternMap interned;
+
+#ifdef TTLD_DEBUG
+  ValueGenerationList generations;
+#endif
 };
 
 typedef struct {
@@ -41,14 +123,64 @@ typedef struct {
 void values_init(ValueStore *values, ValueStoreOptions *options);
 void values_deinit(ValueStore *values);
 
-ValueIndex  values_alloc(ValueStore *values, Value **out);
-void       *values_alloc_data(ValueStore *values, u32 size, u32 align);
-void        values_dealloc_data(ValueStore *values, void *data, u32 size);
+// Allocates a value with room for a payload of `size` bytes. `data` is set to the uninitialized
+// payload.
+ValueIndex  values_alloc(ValueStore *values, TypeIndex type, u32 size, u32 align, void **data);
 void        values_dealloc(ValueStore *values, ValueIndex idx);
+
+// Returns the value with the given type and payload, which is created the first time it is
+// requested. Interned values are shared and must not be modified. Two interned values are equal if
+// and only if their indices are equal. `values_copy` of an interned value returns the same index and
+// `values_dealloc` leaves it alone, so code that owns its values does not need to know whether a
+// value is interned.
+ValueIndex  values_intern(ValueStore *values, TypeIndex type, void const *data, u32 size);
+
 Value      *values_get(ValueStore *values, ValueIndex idx);
+b32         values_is_live(ValueStore *values, ValueIndex idx);
 ValueIndex  values_copy(ValueStore *values, ValueIndex val);
 
-#define values_alloc_data_type(values, type) \
-  Cast(type*, values_alloc_data((values), sizeof(type), Align_of(type)))
+// -------------------------------------------------------------------------------------------------
+// Mark and sweep collection
+//
+// Values that are explicitly deallocated are freed right away, but values whose owner forgets
+// about them are only reclaimed by a collection. A collection can only run at a point where every
+// value that is still in use can be reached from a root. The owners of those roots mark them between
+// `values_collect_begin` and `values_collect_end`. Values that are referenced by the chunk of a
+// marked function value are marked as well. Interned values are collected like any other value.
+
+#define VALUE_COLLECT_MIN_THRESHOLD 4096
+
+typedef struct {
+  ValueStore   *values;
+  TypeInterner *types;
+  Arena        *scratch;
+  ArenaSnapshot snapshot;
+
+  u8  *marks; // One bit per slot.
+  u32  slot_count;
+
+  // Values that are marked, but whose payload has not been traced yet.
+  ValueIndex *worklist;
+  u32         worklist_len;
+} ValueCollector;
+
+always_inline b32 values_should_collect(ValueStore *values) {
+  return values->live_count >= values->collect_threshold;
+}
+
+void values_collect_begin(ValueCollector *c, ValueStore *values, TypeInterner *types, Arena *scratch);
+void values_mark(ValueCollector *c, ValueIndex idx);
+void values_mark_ref(ValueCollector *c, Ref ref);
+void values_mark_chunk(ValueCollector *c, IrChunk *chunk);
+void values_mark_builder(ValueCollector *c, IrBuilder *builder);
+
+// Frees every value that was not marked and returns the number of freed values.
+u32 values_collect_end(ValueCollector *c);
+
+#define values_intern_typed(values, type, data_type, data) \
+  values_intern((values), (type), (data), sizeof(data_type))
+
+#define values_alloc_typed(values, type, data_type, data) \
+  values_alloc((values), (type), sizeof(data_type), Align_of(data_type), Cast(void**, (data)))
 
 #endif // VALUE_H
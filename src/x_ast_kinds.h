@@ -8,11 +8,15 @@ X(Ast_block,          AstBlock,        "block")
 X(Ast_type_slice,     AstTypeSlice,    "type-slice")
 X(Ast_type_array,     AstTypeArray,    "type-array")
 X(Ast_type_function,  AstTypeFunction, "type-function")
+X(Ast_type_struct,    AstTypeStruct,   "type-struct")
+X(Ast_type_optional,  AstTypeOptional, "type-optional")
+X(Ast_type_range,     AstTypeRange,    "type-range")
 X(Ast_builtin,        AstBuiltin,      "builtin")
 X(Ast_declaration,    AstDeclaration,  "declaration")
 X(Ast_assign,         AstAssign,       "assign")
 X(Ast_literal_int,    TokenIndex,      "literal-int")
 X(Ast_literal_string, TokenIndex,      "literal-string")
+X(Ast_literal_sequence, AstLiteralSequence, "literal-sequence")
 X(Ast_identifier,     TokenIndex,      "identifier")
 X(Ast_call,           AstCall,         "call")
 X(Ast_index,          AstIndexData,    "index")
@@ -20,9 +24,11 @@ X(Ast_unary_op,       AstUnaryOp,      "unary-op")
 X(Ast_binary_op,      AstBinaryOp,     "binary-op")
 X(Ast_function,       AstFunction,     "function")
 X(Ast_param,          AstParam,        "param")
+X(Ast_field,          AstField,        "field")
 X(Ast_if_else,        AstIfElse,       "if-else")
 X(Ast_for,            AstFor,          "for")
 X(Ast_defer,          AstDefer,        "defer")
 X(Ast_const,          AstConst,        "const")
 X(Ast_cast,           AstCast,         "cast")
 X(Ast_as,             AstAs,           "as")
+X(Ast_lazy_body,      TokenIndex,      "lazy-body")
@@ -4,6 +4,8 @@
 
 X(IR_nop,           False, u32,           "nop")
 X(IR_builtin_debug, False, u32,           "#debug")
+X(IR_builtin_reduce,True, IrReduce,      "reduce")
+X(IR_builtin_layout,True,  IrLayout,      "layout")
 X(IR_func,          True,  IrFunc,        "func")
 X(IR_param,         False, u32,           "param")
 X(IR_alloc,         False, u32,           "alloc")
@@ -23,6 +25,9 @@ X(IR_lookup_value,  False, u32,           "lookup_value")
 X(IR_as,            True,  IrAs,          "as")
 X(IR_unify,         True,  IrUnify,       "unify")
 X(IR_type,          True,  IrType,        "type")
+X(IR_type_struct,   True,  IrTypeStruct,  "type_struct")
 X(IR_typeof,        False, u32,           "typeof")
 X(IR_return_type,   False, u32,           "return_type")
 X(IR_param_type,    True,  IrParamType,   "param_type")
+X(IR_binary_op,     True,  IrBinaryOp,    "binary_op")
+X(IR_sequence,      True,  IrSequence,    "sequence")
@@ -0,0 +1,135 @@
+#include "toteload.h"
+#include "blu.h"
+#include "compiler.h"
+#include "source_file.h"
+#include "test.h"
+
+#include <stdio.h>
+
+#define Reset_test_source "compiler.test.tmp.blu"
+#define Reset_test_image  "compiler.test.tmp.blir"
+
+// `Test_program_text`, but `main` no longer returns the same value.
+internal char const reset_test_changed_text[] =
+  "mod main\n"
+  "\n"
+  "main: () i32 = || one() * 41\n"
+  "\n"
+  "one := ||: i32 2\n";
+
+// Builds the program and returns its IR image, which holds the whole of `main`, in `arena`.
+internal b32 build_image(Compiler *compiler, Arena *arena, String *out) {
+  if (!compile(compiler) || !emit_image(compiler, string_lit(Reset_test_image))) {
+    return False;
+  }
+
+  b32 ok = test_read_file(Reset_test_image, arena, out);
+  remove(Reset_test_image);
+
+  return ok;
+}
+
+void test_compiler_reset_rebuild(TestResult *test, void *user) {
+  Unused(user);
+
+  Arena arena;
+  arena_init(&arena, &(ArenaOptions){
+    .reserve_size        = MiB(4),
+    .initial_commit_size = KiB(64),
+  });
+
+  CLIOptions options = { .jobs = 1 };
+
+  b32 written = test_write_file(Reset_test_source, string_lit(Test_program_text));
+
+  Compiler compiler;
+  compiler_init(&compiler, &options);
+  compiler_add_sourcefile(&compiler, string_lit(Reset_test_source));
+
+  // A rebuild without changes gives the same program.
+  String first  = {0};
+  String second = {0};
+  b32 first_ok = written && build_image(&compiler, &arena, &first);
+
+  compiler_reset(&compiler);
+  b32 second_ok = first_ok && build_image(&compiler, &arena, &second);
+
+  // A rebuild after a change gives the same program as a new compiler. The file system may not
+  // tell two writes in quick succession apart, so the source is marked as changed by hand.
+  written = written && test_write_file(Reset_test_source, string_lit(reset_test_changed_text));
+  compiler_get_source(&compiler, 1)->modified_time = 0;
+
+  String changed = {0};
+  compiler_reset(&compiler);
+  b32 changed_ok = second_ok && written && build_image(&compiler, &arena, &changed);
+
+  compiler_deinit(&compiler);
+
+  Compiler fresh;
+  compiler_init(&fresh, &options);
+  compiler_add_sourcefile(&fresh, string_lit(Reset_test_source));
+
+  String expected = {0};
+  b32 expected_ok = written && build_image(&fresh, &arena, &expected);
+
+  compiler_deinit(&fresh);
+  remove(Reset_test_source);
+
+  b32 same_unchanged = second_ok && string_eq(first, second);
+  b32 same_changed   = changed_ok && expected_ok && string_eq(changed, expected);
+  b32 differs        = changed_ok && !string_eq(first, changed);
+
+  arena_deinit(&arena);
+
+  Test_assert(first_ok);
+  Test_assert(second_ok);
+  Test_assert(changed_ok);
+  Test_assert(expected_ok);
+  Test_assert(same_unchanged);
+  Test_assert(same_changed);
+  Test_assert(differs);
+}
+
+void test_compiler_reset_memory(TestResult *test, void *user) {
+  Unused(user);
+
+  CLIOptions options = { .jobs = 1 };
+
+  b32 written = test_write_file(Reset_test_source, string_lit(Test_program_text));
+
+  Compiler compiler;
+  compiler_init(&compiler, &options);
+  compiler_add_sourcefile(&compiler, string_lit(Reset_test_source));
+
+  b32 ok = written && compile(&compiler);
+
+  usize build_used    = arena_used_size(&compiler.build);
+  usize compiler_used = arena_used_size(&compiler.arena);
+
+  // Every rebuild of the same program takes the same memory, instead of adding to that of the
+  // previous builds.
+  b32 same_build    = True;
+  b32 same_compiler = True;
+
+  for (u32 i = 0; ok && i < 16; i++) {
+    compiler_get_source(&compiler, 1)->modified_time = 0;
+    compiler_reset(&compiler);
+
+    ok = compile(&compiler);
+
+    same_build    &= arena_used_size(&compiler.build) == build_used;
+    same_compiler &= arena_used_size(&compiler.arena) == compiler_used;
+  }
+
+  compiler_deinit(&compiler);
+  remove(Reset_test_source);
+
+  Test_assert(ok);
+  Test_assert(same_build);
+  Test_assert(same_compiler);
+}
+
+void register_compiler_tests(TestRunner *runner) {
+  test_runner_register_test(runner, string_lit("test_compiler_reset_rebuild"), test_compiler_reset_rebuild, Null);
+  test_runner_register_test(runner, string_lit("test_compiler_reset_memory"), test_compiler_reset_memory, Null);
+}
@@ -0,0 +1,127 @@
+#include "toteload.h"
+#include "blu.h"
+#include "compiler.h"
+#include "interpret.h"
+#include "ir_image.h"
+#include "test.h"
+
+#include <stdio.h>
+
+#define Image_test_source "ir_image.test.tmp.blu"
+#define Image_test_image  "ir_image.test.tmp.blir"
+
+// Compiles the test source and writes its `main` to the test image.
+internal b32 emit_test_image(void) {
+  if (!test_write_file(Image_test_source, string_lit(Test_program_text))) {
+    return False;
+  }
+
+  CLIOptions options = { .jobs = 1 };
+
+  Compiler compiler;
+  compiler_init(&compiler, &options);
+  compiler_add_sourcefile(&compiler, string_lit(Image_test_source));
+
+  b32 ok = compile(&compiler) && emit_image(&compiler, string_lit(Image_test_image));
+
+  compiler_deinit(&compiler);
+  remove(Image_test_source);
+
+  return ok;
+}
+
+void test_ir_image_round_trip(TestResult *test, void *user) {
+  Unused(user);
+
+  b32 emitted = emit_test_image();
+
+  // The image is run by a new compiler, whose value and type indices do not match the old ones.
+  CLIOptions options = { .jobs = 1 };
+
+  Compiler compiler;
+  compiler_init(&compiler, &options);
+
+  IrImage image;
+  u32 err = emitted ? ir_image_load(&image, string_lit(Image_test_image), &compiler.scratch, &compiler.types, &compiler.values)
+                    : IrImage_error_could_not_open_file;
+
+  u32 run_err = Interpret_ok;
+  i32 result  = 0;
+
+  if (err == IrImage_ok) {
+    Interpreter in = {
+      .scratch  = &compiler.scratch,
+      .msg_sink = &compiler.msg_sink,
+      .compiler = &compiler,
+    };
+
+    stack_init(&in.call_stack, arena_push_array(CallFrame2, &compiler.scratch, 64), 64);
+
+    // Collect before the first step. The chunks of the image belong to no declaration, so only the
+    // call frames keep them and the functions they call alive.
+    compiler.values.collect_threshold = 0;
+
+    ValueIndex res;
+    run_err = interpreter_call(&in, &image.chunk, (ValueIndex[]){0}, 0, &res);
+
+    if (run_err == Interpret_ok) {
+      memcpy(&result, value_data(values_get(&compiler.values, res)), sizeof(result));
+    }
+
+    ir_image_unload(&image);
+  }
+
+  compiler_deinit(&compiler);
+  remove(Image_test_image);
+
+  Test_assert(emitted);
+  Test_assert_eq(err, IrImage_ok);
+  Test_assert_eq(run_err, Interpret_ok);
+  Test_assert_eq(result, 42);
+}
+
+void test_ir_image_truncated(TestResult *test, void *user) {
+  Unused(user);
+
+  b32 emitted = emit_test_image();
+
+  Arena arena;
+  arena_init(&arena, &(ArenaOptions){
+    .reserve_size        = MiB(4),
+    .initial_commit_size = KiB(64),
+  });
+
+  // The image is copied, because the file is overwritten below.
+  String image_bytes = {0};
+  b32 mapped = emitted && test_read_file(Image_test_image, &arena, &image_bytes);
+
+  // Every prefix of the image that is cut at a word is rejected.
+  u32 accepted = 0;
+  for (usize len = 0; mapped && len < image_bytes.len; len += 8) {
+    test_write_file(Image_test_image, (String){ .str = image_bytes.str, .len = len });
+
+    CLIOptions options = { .jobs = 1 };
+
+    Compiler compiler;
+    compiler_init(&compiler, &options);
+
+    IrImage image;
+    if (ir_image_load(&image, string_lit(Image_test_image), &compiler.scratch, &compiler.types, &compiler.values) == IrImage_ok) {
+      accepted += 1;
+      ir_image_unload(&image);
+    }
+
+    compiler_deinit(&compiler);
+  }
+
+  arena_deinit(&arena);
+  remove(Image_test_image);
+
+  Test_assert(mapped);
+  Test_assert_eq(accepted, 0);
+}
+
+void register_ir_image_tests(TestRunner *runner) {
+  test_runner_register_test(runner, string_lit("test_ir_image_round_trip"), test_ir_image_round_trip, Null);
+  test_runner_register_test(runner, string_lit("test_ir_image_truncated"), test_ir_image_truncated, Null);
+}
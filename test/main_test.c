@@ -18,6 +18,12 @@ void test_assert_eq(TestResult *test, void *user) {
 
 extern void register_tokenizer_tests(TestRunner *runner);
 extern void register_parser_tests(TestRunner *runner);
+extern void register_source_cache_tests(TestRunner *runner);
+extern void register_ir_image_tests(TestRunner *runner);
+extern void register_compiler_tests(TestRunner *runner);
+extern void register_source_file_tests(TestRunner *runner);
+extern void register_simd_tests(TestRunner *runner);
+extern void register_types_tests(TestRunner *runner);
 
 int main(void) {
   TestRunner runner;
@@ -25,6 +31,12 @@ int main(void) {
 
   register_tokenizer_tests(&runner);
   register_parser_tests(&runner);
+  register_source_cache_tests(&runner);
+  register_ir_image_tests(&runner);
+  register_compiler_tests(&runner);
+  register_source_file_tests(&runner);
+  register_simd_tests(&runner);
+  register_types_tests(&runner);
   test_runner_register_test(&runner, string_lit("test_assert_eq"), test_assert_eq, Null);
   test_runner_register_test(&runner, string_lit("test_assert"), test_assert, Null);
 
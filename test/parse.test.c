@@ -44,6 +44,7 @@ void parser_test(TestResult *test, void *user) {
 
   fn(test, &context);
 
+  tokens_deinit(&context.tokens);
   arena_deinit(&arena);
   arena_deinit(&scratch);
 }
@@ -53,10 +54,10 @@ void parser_test(TestResult *test, void *user) {
 internal b32 do_parse(ParserTestContext *context, String src, AstNodes *ast) {
   TokenizeContext tokenize_context = {
     .msg_sink = context->msg_sink,
-    .arena    = context->arena,
-    .scratch  = context->scratch,
   };
 
+  tokens_deinit(&context->tokens);
+
   if (!tokenize(&tokenize_context, src, &context->tokens)) {
     return False;
   }
@@ -180,6 +181,263 @@ void test_parse_function(TestResult *test, ParserTestContext *context) {
   Test_assert_eq(ast.kinds[fn->body], Ast_block);
 }
 
+void test_parse_lazy_function_body(TestResult *test, ParserTestContext *context) {
+  String src = string_lit("mod main\nf : = || { { 1 } + 2 }\ng : = || 2");
+
+  TokenizeContext tokenize_context = {
+    .msg_sink = context->msg_sink,
+  };
+
+  Test_assert(tokenize(&tokenize_context, src, &context->tokens));
+
+  ParseContext parse_context = {
+    .msg_sink = context->msg_sink,
+    .arena    = context->arena,
+    .scratch  = context->scratch,
+
+    .lazy_function_bodies = True,
+  };
+
+  AstNodes ast;
+  Test_assert(parse(&parse_context, &context->tokens, &ast));
+
+  AstSource     *source = ast_data(&ast, Root);
+  AstModSection *mod    = ast_data(&ast, source->items[0]);
+  Test_assert_eq(mod->count, 2);
+
+  AstDeclaration *f = ast_data(&ast, mod->items[0]);
+  AstDeclaration *g = ast_data(&ast, mod->items[1]);
+
+  // Only a body that is a block is skipped.
+  AstFunction *fn_f = ast_data(&ast, f->value);
+  AstFunction *fn_g = ast_data(&ast, g->value);
+  Test_assert_eq(ast.kinds[fn_f->body], Ast_lazy_body);
+  Test_assert_eq(ast.kinds[fn_g->body], Ast_literal_int);
+
+  u32 count = ast.count;
+  Test_assert(parse_function_body(&parse_context, &context->tokens, &ast, f->value));
+
+  Test_assert(ast.count > count);
+  Test_assert_eq(ast.kinds[fn_f->body], Ast_block);
+  Test_assert(fn_f->body >= count);
+
+  AstBlock *block = ast_data(&ast, fn_f->body);
+  Test_assert_eq(block->count, 1);
+  Test_assert_eq(ast.kinds[block->items[0]], Ast_binary_op);
+}
+
+void test_parse_parallel(TestResult *test, ParserTestContext *context) {
+  // A section is 21 tokens, so there are enough of them for the tokens to be split into chunks.
+  u32 section_count = 4 * PARSE_MIN_CHUNK_TOKENS / 21;
+
+  Arena arena;
+  arena_init(&arena, &(ArenaOptions){
+    .reserve_size        = MiB(64),
+    .initial_commit_size = MiB(1),
+  });
+
+  Arena scratch;
+  arena_init(&scratch, &(ArenaOptions){
+    .reserve_size        = MiB(64),
+    .initial_commit_size = MiB(1),
+  });
+
+  usize cap  = section_count * 64;
+  u8   *text = arena_push_array(u8, &arena, cap);
+  usize len  = 0;
+  for (u32 i = 0; i < section_count; i++) {
+    len += Cast(usize, snprintf(Cast(char *, text + len), cap - len,
+      "mod m%u\na : i32 = 1\nb : i32 = a + %u\nc : = || { b }\n", i, i));
+  }
+
+  TokenizeContext tokenize_context = {
+    .msg_sink = context->msg_sink,
+  };
+
+  Test_assert(tokenize(&tokenize_context, (String){ .str = text, .len = len, }, &context->tokens));
+
+  ParseContext parse_context = {
+    .msg_sink = context->msg_sink,
+    .arena    = &arena,
+    .scratch  = &scratch,
+
+    .lazy_function_bodies = True,
+  };
+
+  AstNodes sequential;
+  AstNodes parallel;
+  Test_assert(parse(&parse_context, &context->tokens, &sequential));
+  Test_assert(parse_parallel(&parse_context, &context->tokens, 4, &parallel));
+
+  // The chunks are joined into the same tree as a sequential parse.
+  Test_assert_eq(parallel.count, sequential.count);
+  Test_assert(memcmp(parallel.kinds, sequential.kinds, sequential.count * sizeof(u8)) == 0);
+  Test_assert(memcmp(parallel.spans, sequential.spans, sequential.count * sizeof(SpanToken)) == 0);
+
+  AstSource *source = ast_data(&parallel, Root);
+  Test_assert_eq(source->count, section_count);
+
+  AstModSection  *mod  = ast_data(&parallel, source->items[section_count - 1]);
+  AstDeclaration *decl = ast_data(&parallel, mod->items[1]);
+  AstBinaryOp    *op   = ast_data(&parallel, decl->value);
+  Test_assert_eq(parallel.kinds[op->lhs], Ast_identifier);
+  Test_assert_eq(parallel.kinds[op->rhs], Ast_literal_int);
+
+  arena_deinit(&arena);
+  arena_deinit(&scratch);
+}
+
+typedef struct {
+  u32             count;
+  MessageLocation location;
+  String          format;
+} ParserMessages;
+
+internal void parser_record_message(void *user, u8 severity, MessageLocation location, String format, ...) {
+  Unused(severity);
+
+  ParserMessages *messages = user;
+  messages->count   += 1;
+  messages->location = location;
+  messages->format   = format;
+}
+
+void test_parse_parallel_error(TestResult *test, ParserTestContext *context) {
+  u32 section_count = 4 * PARSE_MIN_CHUNK_TOKENS / 21;
+
+  Arena arena;
+  arena_init(&arena, &(ArenaOptions){
+    .reserve_size        = MiB(64),
+    .initial_commit_size = MiB(1),
+  });
+
+  // The last declaration of a section in the middle is cut off by the next `mod`, which may also be
+  // where a chunk starts.
+  usize cap  = section_count * 64;
+  u8   *text = arena_push_array(u8, &arena, cap);
+  usize len  = 0;
+  for (u32 i = 0; i < section_count; i++) {
+    len += Cast(usize, snprintf(Cast(char *, text + len), cap - len,
+      "mod m%u\na : i32 = 1\nb : i32 = a + %u\n%s", i, i, i == section_count / 2 ? "c : = a +\n" : ""));
+  }
+
+  TokenizeContext tokenize_context = {
+    .msg_sink = context->msg_sink,
+  };
+
+  Test_assert(tokenize(&tokenize_context, (String){ .str = text, .len = len, }, &context->tokens));
+
+  ParserMessages sequential = {0};
+  ParserMessages parallel   = {0};
+
+  // The scratch arena of the context is too small for the whole source, so the sequential parse
+  // has to use its own.
+  ParseContext parse_context = {
+    .msg_sink = &(MessageSink){ .user = &sequential, .add_message = parser_record_message, },
+    .arena    = &arena,
+    .scratch  = context->scratch,
+  };
+
+  AstNodes ast;
+  b32 sequential_ok = parse(&parse_context, &context->tokens, &ast);
+
+  parse_context.msg_sink = &(MessageSink){ .user = &parallel, .add_message = parser_record_message, };
+  b32 parallel_ok = parse_parallel(&parse_context, &context->tokens, 4, &ast);
+
+  arena_deinit(&arena);
+
+  // Only the chunk that failed is parsed again, and it reports the same error.
+  Test_assert(!sequential_ok);
+  Test_assert(!parallel_ok);
+  Test_assert_eq(sequential.count, 1);
+  Test_assert_eq(parallel.count, 1);
+  Test_assert_eq(parallel.location.kind, sequential.location.kind);
+  Test_assert_eq(parallel.location.data.token_index, sequential.location.data.token_index);
+  Test_assert(string_eq(parallel.format, sequential.format));
+}
+
+void test_parse_literal_sequence(TestResult *test, ParserTestContext *context) {
+  AstNodes ast;
+  b32 ok = do_parse(context, string_lit("mod main\nx : [3]i32 = .{ 1, 2 + 3, 4, }"), &ast);
+
+  Test_assert(ok);
+
+  AstSource      *source = ast_data(&ast, Root);
+  AstModSection  *mod    = ast_data(&ast, source->items[0]);
+  AstDeclaration *decl   = ast_data(&ast, mod->items[0]);
+
+  Test_assert_eq(ast.kinds[decl->type], Ast_type_array);
+  Test_assert_eq(ast.kinds[decl->value], Ast_literal_sequence);
+
+  AstLiteralSequence *sequence = ast_data(&ast, decl->value);
+  Test_assert_eq(sequence->count, 3);  // the trailing comma does not add an item
+  Test_assert_eq(ast.kinds[sequence->items[0]], Ast_literal_int);
+  Test_assert_eq(ast.kinds[sequence->items[1]], Ast_binary_op);
+  Test_assert_eq(ast.kinds[sequence->items[2]], Ast_literal_int);
+}
+
+void test_parse_struct(TestResult *test, ParserTestContext *context) {
+  AstNodes ast;
+  b32 ok = do_parse(context, string_lit("mod main\nP : type = struct #ordered { a: u8, b: u64 #hot, c: [2]u16 #cold }"), &ast);
+
+  Test_assert(ok);
+
+  AstSource      *source = ast_data(&ast, Root);
+  AstModSection  *mod    = ast_data(&ast, source->items[0]);
+  AstDeclaration *decl   = ast_data(&ast, mod->items[0]);
+
+  Test_assert_eq(ast.kinds[decl->value], Ast_type_struct);
+
+  AstTypeStruct *type_struct = ast_data(&ast, decl->value);
+  Test_assert_eq(type_struct->attributes, StructAttribute_ordered);
+  Test_assert_eq(type_struct->count, 3);
+
+  AstField *a = ast_data(&ast, type_struct->fields[0]);
+  AstField *b = ast_data(&ast, type_struct->fields[1]);
+  AstField *c = ast_data(&ast, type_struct->fields[2]);
+  Test_assert_eq(a->attributes, 0);
+  Test_assert_eq(b->attributes, FieldAttribute_hot);
+  Test_assert_eq(c->attributes, FieldAttribute_cold);
+  Test_assert_eq(ast.kinds[c->type], Ast_type_array);
+}
+
+void test_parse_optional(TestResult *test, ParserTestContext *context) {
+  AstNodes ast;
+  b32 ok = do_parse(context, string_lit("mod main\nx : ??bool = nil"), &ast);
+
+  Test_assert(ok);
+
+  AstSource      *source = ast_data(&ast, Root);
+  AstModSection  *mod    = ast_data(&ast, source->items[0]);
+  AstDeclaration *decl   = ast_data(&ast, mod->items[0]);
+
+  Test_assert_eq(ast.kinds[decl->type], Ast_type_optional);
+
+  AstTypeOptional *outer = ast_data(&ast, decl->type);
+  Test_assert_eq(ast.kinds[outer->base], Ast_type_optional);
+
+  AstTypeOptional *inner = ast_data(&ast, outer->base);
+  Test_assert_eq(ast.kinds[inner->base], Ast_identifier);
+}
+
+void test_parse_range(TestResult *test, ParserTestContext *context) {
+  AstNodes ast;
+  b32 ok = do_parse(context, string_lit("mod main\nx : -5..=N = 0"), &ast);
+
+  Test_assert(ok);
+
+  AstSource      *source = ast_data(&ast, Root);
+  AstModSection  *mod    = ast_data(&ast, source->items[0]);
+  AstDeclaration *decl   = ast_data(&ast, mod->items[0]);
+
+  Test_assert_eq(ast.kinds[decl->type], Ast_type_range);
+
+  AstTypeRange *range = ast_data(&ast, decl->type);
+  Test_assert(range->is_inclusive);
+  Test_assert_eq(ast.kinds[range->lo], Ast_unary_op);
+  Test_assert_eq(ast.kinds[range->hi], Ast_identifier);
+}
+
 // The flatten pass lays payloads out in node-index order, starting at offset 0, so a node's payload
 // always precedes the payloads of nodes allocated after it.
 void test_parse_payload_layout(TestResult *test, ParserTestContext *context) {
@@ -224,6 +482,13 @@ void register_parser_tests(TestRunner *runner) {
     Test(test_parse_declaration_without_type),
     Test(test_parse_binary_precedence),
     Test(test_parse_function),
+    Test(test_parse_lazy_function_body),
+    Test(test_parse_parallel),
+    Test(test_parse_parallel_error),
+    Test(test_parse_literal_sequence),
+    Test(test_parse_struct),
+    Test(test_parse_optional),
+    Test(test_parse_range),
     Test(test_parse_payload_layout),
     Test(test_parse_missing_mod_name),
     Test(test_parse_missing_value),
@@ -0,0 +1,289 @@
+#include "toteload.h"
+#include "blu.h"
+#include "compiler.h"
+#include "simd.h"
+#include "ast.h"
+#include "test.h"
+#include "rng.h"
+
+// The SIMD kernels only compute the prefix of an array that fills whole vectors, so the lengths are
+// chosen to leave a remainder for the scalar code for every element size.
+internal u32 const simd_test_lengths[] = { 1, 3, 16, 31, 33, 64, 67, 130 };
+internal u32 const simd_test_bits[]    = { 8, 16, 32, 64 };
+
+internal u8 const simd_test_ops[] = {
+  Add, Sub, Mul, Div, Bit_and, Bit_or, Bit_xor,
+  Cmp_equal, Cmp_not_equal, Cmp_greater_than, Cmp_greater_equal, Cmp_less_than, Cmp_less_equal,
+};
+
+typedef struct {
+  Compiler compiler;
+  PRng     rng;
+} SimdTestContext;
+
+internal void simd_test_init(SimdTestContext *context, CLIOptions *options) {
+  compiler_init(&context->compiler, options);
+  PRng_seed(&context->rng, 0x5eed);
+}
+
+internal TypeIndex integer_type(Compiler *compiler, u32 bits, b32 is_signed) {
+  return types_add(&compiler->types, &(Type){
+    .kind = Type_integer,
+    .data.integer = { .signedness = is_signed ? Signed : Unsigned, .bitwidth = bits },
+  });
+}
+
+internal TypeIndex array_type(Compiler *compiler, TypeIndex base_type, u32 count) {
+  return types_add(&compiler->types, &(Type){
+    .kind = Type_array,
+    .data.array = { .base_type = base_type, .size = count },
+  });
+}
+
+// An array of random elements. Equal neighbours are made likely, so that the comparisons do not
+// almost always have the same result.
+internal ValueIndex random_array(SimdTestContext *context, TypeIndex type) {
+  TypeSizeInfo size_info = types_size_info_by_index(&context->compiler.types, type);
+
+  void *data;
+  ValueIndex idx = values_alloc(&context->compiler.values, type, size_info.size, size_info.align, &data);
+
+  u8 *bytes = data;
+  for (u32 i = 0; i < size_info.size; i++) {
+    bytes[i] = Cast(u8, PRng_next(&context->rng) % 4 == 0 ? 0 : PRng_next(&context->rng));
+  }
+
+  return idx;
+}
+
+// Makes the low byte of every element odd, so that no element is 0 and a division can not fail.
+internal void make_nonzero(Compiler *compiler, ValueIndex idx, u32 stride, u32 count) {
+  u8 *bytes = value_data(values_get(&compiler->values, idx));
+  for (u32 i = 0; i < count; i++) {
+    bytes[i * stride] |= 1;
+  }
+}
+
+// Whether `res` holds the result of `op` on the elements `a` and `b` of type `type`, as computed
+// for single values, which never use the SIMD kernels.
+internal b32 scalar_result_is(Compiler *compiler, u8 op, TypeIndex type, u32 stride, u8 const *a, u8 const *b, u8 const *res) {
+  ValueStore *values = &compiler->values;
+
+  void *data;
+  ValueIndex x = values_alloc(values, type, stride, stride, &data);
+  memcpy(data, a, stride);
+  ValueIndex y = values_alloc(values, type, stride, stride, &data);
+  memcpy(data, b, stride);
+
+  ValueIndex z;
+  u32 err = eval_binary_op(&compiler->scratch, &compiler->types, values, compiler->common.type.bool, op, values_get(values, x), values_get(values, y), &z);
+
+  b32 same = err == BinaryOpResult_ok;
+  if (same) {
+    u32 size = (values_get(values, z)->type == compiler->common.type.bool) ? 1 : stride;
+    same = memcmp(value_data(values_get(values, z)), res, size) == 0;
+    values_dealloc(values, z);
+  }
+
+  values_dealloc(values, x);
+  values_dealloc(values, y);
+
+  return same;
+}
+
+void test_simd_array_ops(TestResult *test, void *user) {
+  Unused(user);
+
+  CLIOptions options = { .jobs = 1 };
+
+  SimdTestContext context;
+  simd_test_init(&context, &options);
+
+  Compiler *compiler = &context.compiler;
+
+  u32 failed     = 0;
+  u32 mismatches = 0;
+
+  for (u32 bi = 0; bi < Count_of(simd_test_bits); bi++)
+  for (u32 is_signed = 0; is_signed < 2; is_signed++)
+  for (u32 li = 0; li < Count_of(simd_test_lengths); li++)
+  for (u32 oi = 0; oi < Count_of(simd_test_ops); oi++) {
+    u32 bits   = simd_test_bits[bi];
+    u32 stride = bits / 8;
+    u32 count  = simd_test_lengths[li];
+    u8  op     = simd_test_ops[oi];
+
+    TypeIndex base  = integer_type(compiler, bits, is_signed);
+    TypeIndex array = array_type(compiler, base, count);
+
+    ValueIndex lhs = random_array(&context, array);
+    ValueIndex rhs = random_array(&context, array);
+    make_nonzero(compiler, rhs, stride, count);
+
+    ValueIndex res;
+    u32 err = eval_binary_op(&compiler->scratch, &compiler->types, &compiler->values, compiler->common.type.bool, op, values_get(&compiler->values, lhs), values_get(&compiler->values, rhs), &res);
+    if (err) {
+      failed += 1;
+      continue;
+    }
+
+    u32 stride_res = (op >= Cmp_equal) ? 1 : stride;
+    for (u32 i = 0; i < count; i++) {
+      u8 const *a = Cast(u8 *, value_data(values_get(&compiler->values, lhs))) + i * stride;
+      u8 const *b = Cast(u8 *, value_data(values_get(&compiler->values, rhs))) + i * stride;
+      u8 const *d = Cast(u8 *, value_data(values_get(&compiler->values, res))) + i * stride_res;
+
+      if (!scalar_result_is(compiler, op, base, stride, a, b, d)) {
+        mismatches += 1;
+      }
+    }
+  }
+
+  compiler_deinit(compiler);
+
+  Test_assert_eq(failed, 0);
+  Test_assert_eq(mismatches, 0);
+}
+
+// Loads an element of `bits` bits, extended to 64 bits.
+internal u64 load_element(u8 const *p, u32 bits, b32 is_signed) {
+  u64 x = 0;
+  memcpy(&x, p, bits / 8);
+
+  if (is_signed && bits < 64 && (x >> (bits - 1)) & 1) {
+    x |= UINT64_MAX << bits;
+  }
+
+  return x;
+}
+
+void test_simd_reduce(TestResult *test, void *user) {
+  Unused(user);
+
+  CLIOptions options = { .jobs = 1 };
+
+  SimdTestContext context;
+  simd_test_init(&context, &options);
+
+  Compiler *compiler = &context.compiler;
+
+  u8 const builtins[] = { Builtin_sum, Builtin_min, Builtin_max };
+
+  u32 failed     = 0;
+  u32 mismatches = 0;
+
+  for (u32 bi = 0; bi < Count_of(simd_test_bits); bi++)
+  for (u32 is_signed = 0; is_signed < 2; is_signed++)
+  for (u32 li = 0; li < Count_of(simd_test_lengths); li++)
+  for (u32 ri = 0; ri < Count_of(builtins); ri++) {
+    u32 bits    = simd_test_bits[bi];
+    u32 stride  = bits / 8;
+    u32 count   = simd_test_lengths[li];
+    u8  builtin = builtins[ri];
+
+    TypeIndex array = array_type(compiler, integer_type(compiler, bits, is_signed), count);
+    ValueIndex val  = random_array(&context, array);
+
+    ValueIndex res;
+    u32 err = eval_reduce(&compiler->scratch, &compiler->types, &compiler->values, builtin, values_get(&compiler->values, val), &res);
+    if (err) {
+      failed += 1;
+      continue;
+    }
+
+    u8 const *a = value_data(values_get(&compiler->values, val));
+
+    u64 expected = load_element(a, bits, is_signed);
+    for (u32 i = 1; i < count; i++) {
+      u64 x = load_element(a + i * stride, bits, is_signed);
+
+      b32 less = is_signed ? (Cast(i64, x) < Cast(i64, expected)) : (x < expected);
+      switch (builtin) {
+      case Builtin_sum: expected += x; break;
+      case Builtin_min: expected = less ? x : expected; break;
+      case Builtin_max: expected = (!less && x != expected) ? x : expected; break;
+      }
+    }
+
+    u64 actual = load_element(value_data(values_get(&compiler->values, res)), bits, is_signed);
+    if (bits < 64) {
+      u64 mask = (Cast(u64, 1) << bits) - 1;
+      expected &= mask;
+      actual   &= mask;
+    }
+
+    if (actual != expected) {
+      mismatches += 1;
+    }
+  }
+
+  // #all and #any of bools, which are reduced as the minimum and maximum of bytes.
+  for (u32 li = 0; li < Count_of(simd_test_lengths); li++)
+  for (u32 density = 0; density < 3; density++) {
+    u32 count = simd_test_lengths[li];
+
+    TypeIndex array = array_type(compiler, compiler->common.type.bool, count);
+
+    void *data;
+    ValueIndex val = values_alloc(&compiler->values, array, count, 1, &data);
+
+    // All false, mixed or all true.
+    u8 *bools = data;
+    for (u32 i = 0; i < count; i++) {
+      bools[i] = (density == 1) ? Cast(u8, PRng_next(&context.rng) & 1) : Cast(u8, density / 2);
+    }
+
+    b32 all = True;
+    b32 any = False;
+    for (u32 i = 0; i < count; i++) {
+      all = all && bools[i];
+      any = any || bools[i];
+    }
+
+    ValueIndex res_all, res_any;
+    u32 err = eval_reduce(&compiler->scratch, &compiler->types, &compiler->values, Builtin_all, values_get(&compiler->values, val), &res_all) |
+              eval_reduce(&compiler->scratch, &compiler->types, &compiler->values, Builtin_any, values_get(&compiler->values, val), &res_any);
+    if (err) {
+      failed += 1;
+      continue;
+    }
+
+    if (*Cast(u8 *, value_data(values_get(&compiler->values, res_all))) != all ||
+        *Cast(u8 *, value_data(values_get(&compiler->values, res_any))) != any) {
+      mismatches += 1;
+    }
+  }
+
+  compiler_deinit(compiler);
+
+  Test_assert_eq(failed, 0);
+  Test_assert_eq(mismatches, 0);
+}
+
+// A kernel leaves the elements after the last whole vector to the caller, and none of a division.
+void test_simd_kernel_prefix(TestResult *test, void *user) {
+  Unused(user);
+
+  u32 a[67] = {0};
+  u32 b[67] = {0};
+  u32 d[67];
+
+  u32 done     = simd_binary_op(Add, 32, True, d, a, b, Count_of(a));
+  u32 done_div = simd_binary_op(Div, 32, True, d, a, b, Count_of(a));
+
+  Test_assert_eq(done_div, 0);
+  Test_assert(done <= Count_of(a));
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+  Test_assert(done > 0);
+  Test_assert(Count_of(a) - done < 8);
+#else
+  Test_assert_eq(done, 0);
+#endif
+}
+
+void register_simd_tests(TestRunner *runner) {
+  test_runner_register_test(runner, string_lit("test_simd_array_ops"), test_simd_array_ops, Null);
+  test_runner_register_test(runner, string_lit("test_simd_reduce"), test_simd_reduce, Null);
+  test_runner_register_test(runner, string_lit("test_simd_kernel_prefix"), test_simd_kernel_prefix, Null);
+}
@@ -0,0 +1,164 @@
+#include "toteload.h"
+#include "blu.h"
+#include "source_file.h"
+#include "source_cache.h"
+#include "test.h"
+
+#include <stdio.h>
+
+#define Cache_test_dir    "source_cache.test.tmp"
+#define Cache_test_source Cache_test_dir "/main.blu"
+
+internal char const cache_test_text[] =
+  "mod main\n"
+  "\n"
+  "main: () i32 = || {\n"
+  "  a: i32 = 2\n"
+  "  b: i32 = 3\n"
+  "  { a + b } * 2\n"
+  "}\n"
+  "\n"
+  "foo := ||: bool true\n";
+
+typedef struct {
+  Arena       scratch;
+  Source      stored; // Tokenized, parsed and stored in the cache.
+  char const *entry;  // The filename of the entry of `stored`.
+} CacheTestContext;
+
+typedef void (*FnCacheTest)(TestResult *, CacheTestContext *);
+
+internal b32 load_source(Source *source, CacheTestContext *context) {
+  source_file_init(source, 1, string_lit(Cache_test_source));
+  return source_read_file(source, False) && source_cache_load(source, string_lit(Cache_test_dir), &context->scratch);
+}
+
+void cache_test(TestResult *test, void *user) {
+  FnCacheTest fn = Cast(FnCacheTest, user);
+
+  CacheTestContext context = {0};
+  arena_init(&context.scratch, &(ArenaOptions){
+    .reserve_size        = MiB(4),
+    .initial_commit_size = KiB(64),
+  });
+
+  Source *stored = &context.stored;
+  source_file_init(stored, 1, string_lit(Cache_test_source));
+
+  b32 ok = directory_create(Cache_test_dir) &&
+           test_write_file(Cache_test_source, string_lit(cache_test_text)) &&
+           source_read_file(stored, False) &&
+           source_tokenize(stored, &context.scratch, 1) &&
+           source_parse(stored, &context.scratch, 1) &&
+           source_cache_store(stored, string_lit(Cache_test_dir), &context.scratch);
+
+  context.entry = source_cache_entry_filename(&context.scratch, string_lit(Cache_test_dir), stored->text);
+
+  if (ok) {
+    fn(test, &context);
+  } else {
+    test->line     = __LINE__;
+    test->filename = __FILE__;
+    test->failed   = True;
+    test->reason   = string_lit("  Could not set up the cache directory.\n");
+  }
+
+  source_file_deinit(stored);
+
+  remove(context.entry);
+  remove(Cache_test_source);
+  remove(Cache_test_dir);
+
+  arena_deinit(&context.scratch);
+}
+
+void test_source_cache_round_trip(TestResult *test, CacheTestContext *context) {
+  Source loaded;
+  b32 ok = load_source(&loaded, context);
+
+  Source *stored = &context->stored;
+  Tokens *a = &stored->tokens;
+  Tokens *b = &loaded.tokens;
+
+  AstNodes *x = &stored->ast;
+  AstNodes *y = &loaded.ast;
+
+  b32 same_tokens =
+    ok &&
+    a->tok_count == b->tok_count &&
+    a->line_count == b->line_count &&
+    memcmp(a->kinds, b->kinds, a->tok_count) == 0 &&
+    memcmp(a->spans, b->spans, a->tok_count * sizeof(SpanU32)) == 0 &&
+    memcmp(a->lines, b->lines, a->line_count * sizeof(u32)) == 0;
+
+  b32 same_ast =
+    ok &&
+    x->count == y->count &&
+    x->extra_size == y->extra_size &&
+    memcmp(x->kinds + 1, y->kinds + 1, x->count - 1) == 0 &&
+    memcmp(x->spans + 1, y->spans + 1, (x->count - 1) * sizeof(SpanToken)) == 0 &&
+    memcmp(x->datas + 1, y->datas + 1, (x->count - 1) * sizeof(u32)) == 0 &&
+    memcmp(x->extra, y->extra, x->extra_size) == 0;
+
+  source_file_deinit(&loaded);
+
+  Test_assert(ok);
+  Test_assert(same_tokens);
+  Test_assert(same_ast);
+}
+
+void test_source_cache_truncated(TestResult *test, CacheTestContext *context) {
+  String entry;
+  Test_assert(test_read_file(context->entry, &context->scratch, &entry));
+  Test_assert(test_write_file(context->entry, (String){ .str = entry.str, .len = entry.len / 2 }));
+
+  Source loaded;
+  b32 ok = load_source(&loaded, context);
+  u32 tok_count = loaded.tokens.tok_count;
+  u32 node_count = loaded.ast.count;
+  source_file_deinit(&loaded);
+
+  Test_assert(!ok);
+  Test_assert_eq(tok_count, 0);
+  Test_assert_eq(node_count, 0);
+}
+
+void test_source_cache_corrupted(TestResult *test, CacheTestContext *context) {
+  String entry;
+  Test_assert(test_read_file(context->entry, &context->scratch, &entry));
+
+  // Flip a byte in each part of the entry after the header, one at a time.
+  for (usize at = 64; at < entry.len; at += 7) {
+    u8 *bytes = Cast(u8*, entry.str);
+    bytes[at] ^= 0x80;
+    b32 written = test_write_file(context->entry, entry);
+    bytes[at] ^= 0x80;
+
+    Test_assert(written);
+
+    Source loaded;
+    b32 ok = load_source(&loaded, context);
+    source_file_deinit(&loaded);
+
+    Test_assert(!ok);
+  }
+}
+
+typedef struct {
+  String      name;
+  FnCacheTest fn;
+} CacheTest;
+
+#define Test(function) { .name = string_lit(#function), .fn = function }
+
+void register_source_cache_tests(TestRunner *runner) {
+  CacheTest tests[] = {
+    Test(test_source_cache_round_trip),
+    Test(test_source_cache_truncated),
+    Test(test_source_cache_corrupted),
+  };
+
+  for (u32 i = 0; i < Count_of(tests); i++) {
+    test_runner_register_test(runner, tests[i].name, Cast(FnTest, cache_test), Cast(void *, tests[i].fn));
+  }
+}
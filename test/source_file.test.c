@@ -0,0 +1,86 @@
+#include "toteload.h"
+#include "blu.h"
+#include "source_file.h"
+#include "test.h"
+
+#include <stdio.h>
+
+#define Read_test_source "source_file.test.tmp.blu"
+
+internal char const read_test_text[] =
+  "mod main\n"
+  "\n"
+  "main: () i32 = || 42\n";
+
+// Reads the test source, mapped or copied, and checks that its text is `expected`.
+internal b32 read_source_is(b32 copy, String expected) {
+  Source source;
+  source_file_init(&source, 1, string_lit(Read_test_source));
+
+  b32 ok = source_read_file(&source, copy) &&
+           string_eq(source.text, expected) &&
+           source.mapping.copied == (copy && expected.len > 0);
+
+  source_file_deinit(&source);
+
+  return ok;
+}
+
+void test_source_read_file(TestResult *test, void *user) {
+  Unused(user);
+
+  String text = { .str = Cast(u8 const *, read_test_text), .len = sizeof(read_test_text) - 1, };
+
+  b32 written = test_write_file(Read_test_source, text);
+  b32 mapped  = written && read_source_is(False, text);
+  b32 copied  = written && read_source_is(True, text);
+
+  // An empty file has no mapping, but its text is still valid.
+  b32 empty_written = test_write_file(Read_test_source, string_lit(""));
+  b32 empty_mapped  = empty_written && read_source_is(False, string_lit(""));
+  b32 empty_copied  = empty_written && read_source_is(True, string_lit(""));
+
+  remove(Read_test_source);
+
+  Source missing;
+  source_file_init(&missing, 1, string_lit(Read_test_source));
+  b32 missing_ok = source_read_file(&missing, False);
+  b32 missing_copy_ok = source_read_file(&missing, True);
+  source_file_deinit(&missing);
+
+  Test_assert(written);
+  Test_assert(mapped);
+  Test_assert(copied);
+  Test_assert(empty_mapped);
+  Test_assert(empty_copied);
+  Test_assert(!missing_ok);
+  Test_assert(!missing_copy_ok);
+}
+
+// A copied source is unaffected by its file being truncated, which would raise SIGBUS on the next
+// read of a mapped source.
+void test_source_read_file_copy_truncated(TestResult *test, void *user) {
+  Unused(user);
+
+  String text = { .str = Cast(u8 const *, read_test_text), .len = sizeof(read_test_text) - 1, };
+
+  Source source;
+  source_file_init(&source, 1, string_lit(Read_test_source));
+
+  b32 ok = test_write_file(Read_test_source, text) &&
+           source_read_file(&source, True) &&
+           test_write_file(Read_test_source, string_lit(""));
+
+  b32 same = ok && string_eq(source.text, text);
+
+  source_file_deinit(&source);
+  remove(Read_test_source);
+
+  Test_assert(ok);
+  Test_assert(same);
+}
+
+void register_source_file_tests(TestRunner *runner) {
+  test_runner_register_test(runner, string_lit("test_source_read_file"), test_source_read_file, Null);
+  test_runner_register_test(runner, string_lit("test_source_read_file_copy_truncated"), test_source_read_file_copy_truncated, Null);
+}
@@ -19,6 +19,31 @@ void test_runner_init(TestRunner *runner) {
   runner->tests = (TestList){0};
 }
 
+b32 test_write_file(char const *filename, String data) {
+  FILE *f = fopen(filename, "wb");
+  if (!f) {
+    return False;
+  }
+
+  b32 ok = fwrite(data.str, 1, data.len, f) == data.len;
+  return (fclose(f) == 0) && ok;
+}
+
+b32 test_read_file(char const *filename, Arena *arena, String *out) {
+  FileMapping mapping;
+  if (!file_map(&mapping, filename, FileMap_read_only)) {
+    return False;
+  }
+
+  u8 *buf = arena_push_array(u8, arena, mapping.size);
+  memcpy(buf, mapping.base, mapping.size);
+  *out = (String){ .str = buf, .len = mapping.size };
+
+  file_unmap(&mapping);
+
+  return True;
+}
+
 void test_runner_deinit(TestRunner *runner) {
   arena_deinit(&runner->arena);
 }
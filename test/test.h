@@ -43,6 +43,21 @@ void test_runner_deinit(TestRunner *runner);
 void test_runner_register_test(TestRunner *runner, String name, FnTest fn, void *user);
 void test_runner_run(TestRunner *runner);
 
+// Writes `data` to `filename`, replacing the file if it exists. Returns False if that failed.
+b32 test_write_file(char const *filename, String data);
+
+// Reads the whole of `filename` into `arena`.
+b32 test_read_file(char const *filename, Arena *arena, String *out);
+
+// A program whose `main` returns 42 by calling another function, so its IR has more than one
+// chunk.
+#define Test_program_text             \
+  "mod main\n"                        \
+  "\n"                                \
+  "main: () i32 = || one() + 41\n"    \
+  "\n"                                \
+  "one := ||: i32 1\n"
+
 #define Test_assert(e) do { if (!(e)) { test->line = __LINE__; test->filename = __FILE__; \
     test->failed = True; \
     i32 n = snprintf(Cast(char*,test->buf), Test_reason_buf_size, "  Assertion failed: %s\n", #e); \
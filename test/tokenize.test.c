@@ -3,7 +3,14 @@
 #include "tokens.h"
 #include "test.h"
 
-typedef void (*FnTokenizerTest)(TestResult*, TokenizeContext*);
+#include <stdio.h>
+
+typedef struct {
+  TokenizeContext tokenize;
+  Tokens          tokens; // Of the last call to `do_tokenize`.
+} TokenizerTestContext;
+
+typedef void (*FnTokenizerTest)(TestResult*, TokenizerTestContext*);
 
 void dummy_add_message(void *user, u8 severity, MessageLocation location, String format, ...) { 
   Unused(user, severity, location, format);
@@ -17,64 +24,58 @@ void tokenizer_test(TestResult *test, void *user) {
     .add_message = dummy_add_message,
   };
 
-  Arena arena;
-  arena_init(&arena, &(ArenaOptions){
-    .reserve_size        = MiB(1),
-    .initial_commit_size = KiB(64),
-  });
-
-  Arena scratch;
-  arena_init(&scratch, &(ArenaOptions){
-    .reserve_size        = MiB(1),
-    .initial_commit_size = KiB(64),
-  });
-
-  TokenizeContext context = {
-    .msg_sink = &sink,
-    .arena    = &arena,
-    .scratch  = &scratch,
+  TokenizerTestContext context = {
+    .tokenize.msg_sink = &sink,
   };
 
   fn(test, &context);
 
-  arena_deinit(&arena);
-  arena_deinit(&scratch);
+  tokens_deinit(&context.tokens);
+}
+
+// Tokenizes `src` into the tokens of the context, which are released by the test harness.
+internal b32 do_tokenize(TokenizerTestContext *context, String src) {
+  tokens_deinit(&context->tokens);
+  return tokenize(&context->tokenize, src, &context->tokens);
 }
 
-void test_empty_input(TestResult *test, TokenizeContext *context) {
-  Tokens toks;
-  b32 ok = tokenize(context, string_lit(""), &toks);
+void test_empty_input(TestResult *test, TokenizerTestContext *context) {
+  Tokens *toks = &context->tokens;
+  b32 ok = do_tokenize(context, string_lit(""));
 
   Test_assert(ok);
-  Test_assert_eq(toks.tok_count, 0);
+  Test_assert_eq(toks->tok_count, 0);
 }
 
 // Tokenize `src`, assert success, and assert the exact kind sequence.
 #define Assert_kinds(src, ...)                                                  \
   do {                                                                          \
     u8 expected[] = { __VA_ARGS__ };                                            \
-    Tokens toks;                                                                \
-    b32 ok = tokenize(context, string_lit(src), &toks);                         \
+    Tokens *toks = &context->tokens;                                            \
+    b32 ok = do_tokenize(context, string_lit(src));                             \
     Test_assert(ok);                                                            \
-    Test_assert_eq(toks.tok_count, Count_of(expected));                         \
-    for (u32 i = 0; i < Count_of(expected); i++) {                             \
-      Test_assert_eq(toks.kinds[i], expected[i]);                               \
+    Test_assert_eq(toks->tok_count, Count_of(expected));                        \
+    for (u32 i = 0; i < Count_of(expected); i++) {                              \
+      Test_assert_eq(toks->kinds[i], expected[i]);                              \
     }                                                                           \
   } while (0)
 
-void test_single_char_tokens(TestResult *test, TokenizeContext *context) {
+void test_single_char_tokens(TestResult *test, TokenizerTestContext *context) {
   Assert_kinds(",.:{}()[]",
     Tok_comma, Tok_dot, Tok_colon,
     Tok_brace_open, Tok_brace_close,
     Tok_paren_open, Tok_paren_close,
     Tok_bracket_open, Tok_bracket_close);
-  Assert_kinds("* / % & | ^ ~",
+  Assert_kinds("* / % & | ^ ~ ?",
     Tok_star, Tok_slash, Tok_percent,
-    Tok_ampersand, Tok_bar, Tok_caret, Tok_tilde);
+    Tok_ampersand, Tok_bar, Tok_caret, Tok_tilde, Tok_question);
 }
 
-void test_multichar_operators(TestResult *test, TokenizeContext *context) {
+void test_multichar_operators(TestResult *test, TokenizerTestContext *context) {
   Assert_kinds("->",  Tok_arrow);
+  Assert_kinds("..",  Tok_dot_dot);
+  Assert_kinds("..=", Tok_dot_dot_equals);
+  Assert_kinds("0..200", Tok_literal_int, Tok_dot_dot, Tok_literal_int);
   Assert_kinds("==",  Tok_cmp_eq);
   Assert_kinds("=",   Tok_equals);
   Assert_kinds("+=",  Tok_plus_equals);
@@ -90,14 +91,14 @@ void test_multichar_operators(TestResult *test, TokenizeContext *context) {
   Assert_kinds("-",   Tok_minus);
 }
 
-void test_literals(TestResult *test, TokenizeContext *context) {
+void test_literals(TestResult *test, TokenizerTestContext *context) {
   Assert_kinds("0",          Tok_literal_int);
   Assert_kinds("12345",      Tok_literal_int);
   Assert_kinds("\"hi\"",     Tok_literal_string);
   Assert_kinds("\"a\\\"b\"", Tok_literal_string);     // escaped quote inside string
 }
 
-void test_keywords_and_identifiers(TestResult *test, TokenizeContext *context) {
+void test_keywords_and_identifiers(TestResult *test, TokenizerTestContext *context) {
   Assert_kinds("foo _bar baz123",
     Tok_identifier, Tok_identifier, Tok_identifier);
   Assert_kinds("if else for do break continue return",
@@ -108,60 +109,79 @@ void test_keywords_and_identifiers(TestResult *test, TokenizeContext *context) {
     Tok_keyword_cast, Tok_keyword_bitcast, Tok_keyword_as, Tok_keyword_mod,
     Tok_keyword_no_cache, Tok_keyword_inline);
   Assert_kinds("#debug",  Tok_builtin_debug);
+  Assert_kinds("#sum #min #max #all #any",
+    Tok_builtin_sum, Tok_builtin_min, Tok_builtin_max, Tok_builtin_all, Tok_builtin_any);
+  Assert_kinds("#size_of #align_of #offset_of",
+    Tok_builtin_size_of, Tok_builtin_align_of, Tok_builtin_offset_of);
+  Assert_kinds("struct #ordered #hot #cold",
+    Tok_keyword_struct, Tok_attribute_ordered, Tok_attribute_hot, Tok_attribute_cold);
   Assert_kinds("returns", Tok_identifier);   // keyword is a prefix, not a full match
+  Assert_kinds("ant cost dx z", Tok_identifier, Tok_identifier, Tok_identifier, Tok_identifier);
+
+  Test_assert(!do_tokenize(context, string_lit("#alk")));
+  Test_assert(!do_tokenize(context, string_lit("#anl")));
+  Test_assert(!do_tokenize(context, string_lit("#mix")));
+  Test_assert(!do_tokenize(context, string_lit("#a")));
+  Test_assert(!do_tokenize(context, string_lit("#")));
 }
 
-void test_newlines_and_comments_dropped(TestResult *test, TokenizeContext *context) {
-  Tokens toks;
-  b32 ok = tokenize(context, string_lit("a\n; comment\nb"), &toks);
+void test_newlines_and_comments_dropped(TestResult *test, TokenizerTestContext *context) {
+  Tokens *toks = &context->tokens;
+  b32 ok = do_tokenize(context, string_lit("a\n; comment\nb"));
   Test_assert(ok);
-  Test_assert_eq(toks.tok_count, 2);          // only `a` and `b`
-  Test_assert_eq(toks.kinds[0], Tok_identifier);
-  Test_assert_eq(toks.kinds[1], Tok_identifier);
-  Test_assert(toks.line_count > 1);           // lines were recorded
+  Test_assert_eq(toks->tok_count, 2);          // only `a` and `b`
+  Test_assert_eq(toks->kinds[0], Tok_identifier);
+  Test_assert_eq(toks->kinds[1], Tok_identifier);
+  Test_assert(toks->line_count > 1);           // lines were recorded
 }
 
-void test_whitespace_skipped(TestResult *test, TokenizeContext *context) {
+void test_whitespace_skipped(TestResult *test, TokenizerTestContext *context) {
   Assert_kinds("  \t a\t=\r 1 ",
     Tok_identifier, Tok_equals, Tok_literal_int);
 }
 
-void test_spans(TestResult *test, TokenizeContext *context) {
-  Tokens toks;
-  b32 ok = tokenize(context, string_lit("foo == 42"), &toks);
+void test_spans(TestResult *test, TokenizerTestContext *context) {
+  Tokens *toks = &context->tokens;
+  b32 ok = do_tokenize(context, string_lit("foo == 42"));
   Test_assert(ok);
-  Test_assert(toks.tok_count >= 3);
-  Test_assert_eq(toks.spans[0].start, 0);   // foo
-  Test_assert_eq(toks.spans[0].end,   3);
-  Test_assert_eq(toks.spans[1].start, 4);   // ==
-  Test_assert_eq(toks.spans[1].end,   6);
-  Test_assert_eq(toks.spans[2].start, 7);   // 42
-  Test_assert_eq(toks.spans[2].end,   9);
+  Test_assert(toks->tok_count >= 3);
+  Test_assert_eq(toks->spans[0].start, 0);   // foo
+  Test_assert_eq(toks->spans[0].end,   3);
+  Test_assert_eq(toks->spans[1].start, 4);   // ==
+  Test_assert_eq(toks->spans[1].end,   6);
+  Test_assert_eq(toks->spans[2].start, 7);   // 42
+  Test_assert_eq(toks->spans[2].end,   9);
+}
+
+void test_error_cases(TestResult *test, TokenizerTestContext *context) {
+  Test_assert(!do_tokenize(context, string_lit("\"unterminated")));
+  Test_assert(!do_tokenize(context, string_lit("$")));
 }
 
-void test_error_cases(TestResult *test, TokenizeContext *context) {
-  Tokens toks;
-  Test_assert(!tokenize(context, string_lit("\"unterminated"), &toks));
-  Test_assert(!tokenize(context, string_lit("$"), &toks));
+// A text that does not fit the 32-bit offsets of the tokens is rejected before it is read.
+void test_too_large(TestResult *test, TokenizerTestContext *context) {
+  String huge = { .str = Cast(u8 const *, ""), .len = UINT32_MAX, };
+  Test_assert(!do_tokenize(context, huge));
+  Test_assert_eq(context->tokens.capacity, 0);
 }
 
-void test_declaration_snippet(TestResult *test, TokenizeContext *context) {
+void test_declaration_snippet(TestResult *test, TokenizerTestContext *context) {
   Assert_kinds("x : i32 = 42",
     Tok_identifier, Tok_colon, Tok_identifier, Tok_equals, Tok_literal_int);
 }
 
-void test_string_escapes(TestResult *test, TokenizeContext *context) {
+void test_string_escapes(TestResult *test, TokenizerTestContext *context) {
   Assert_kinds("\"\"",     Tok_literal_string);   // empty string
   Assert_kinds("\"\\\\\"", Tok_literal_string);   // "\\"  — escaped backslash
   Assert_kinds("\"\\n\"",  Tok_literal_string);   // "\n"
 }
 
-void test_no_whitespace(TestResult *test, TokenizeContext *context) {
+void test_no_whitespace(TestResult *test, TokenizerTestContext *context) {
   Assert_kinds("x:i32=42",
     Tok_identifier, Tok_colon, Tok_identifier, Tok_equals, Tok_literal_int);
 }
 
-void test_operator_munch_boundaries(TestResult *test, TokenizeContext *context) {
+void test_operator_munch_boundaries(TestResult *test, TokenizerTestContext *context) {
   Assert_kinds("===", Tok_cmp_eq,      Tok_equals);
   Assert_kinds("+==", Tok_plus_equals, Tok_equals);
   Assert_kinds("!==", Tok_cmp_ne,      Tok_equals);
@@ -169,17 +189,202 @@ void test_operator_munch_boundaries(TestResult *test, TokenizeContext *context)
   Assert_kinds("<<<", Tok_left_shift,  Tok_cmp_lt);
 }
 
-void test_number_then_identifier(TestResult *test, TokenizeContext *context) {
+void test_number_then_identifier(TestResult *test, TokenizerTestContext *context) {
   Assert_kinds("123abc", Tok_literal_int, Tok_identifier);
 }
 
-void test_string_span(TestResult *test, TokenizeContext *context) {
-  Tokens toks;
-  b32 ok = tokenize(context, string_lit("\"hi\""), &toks);
+void test_string_span(TestResult *test, TokenizerTestContext *context) {
+  Tokens *toks = &context->tokens;
+  b32 ok = do_tokenize(context, string_lit("\"hi\""));
   Test_assert(ok);
-  Test_assert(toks.tok_count >= 1);
-  Test_assert_eq(toks.spans[0].start, 0);
-  Test_assert_eq(toks.spans[0].end,   4);   // includes both quotes
+  Test_assert(toks->tok_count >= 1);
+  Test_assert_eq(toks->spans[0].start, 0);
+  Test_assert_eq(toks->spans[0].end,   4);   // includes both quotes
+}
+
+// Long enough that the whitespace, comment, string and identifier scans cross whole vectors.
+void test_long_runs(TestResult *test, TokenizerTestContext *context) {
+  String src = string_lit(
+    "a_very_long_identifier_that_spans_more_than_one_vector_of_bytes_0123456789\n"
+    "                                                                  ; comment that is long as well, long enough\n"
+    "\n\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\n"
+    "\"a string with an \\\" escaped quote, long enough to fill a vector of thirty two bytes\" b"
+  );
+
+  Tokens *toks = &context->tokens;
+  b32 ok = do_tokenize(context, src);
+  Test_assert(ok);
+  Test_assert_eq(toks->tok_count, 3);
+  Test_assert_eq(toks->kinds[0], Tok_identifier);
+  Test_assert_eq(toks->spans[0].end, 74);
+  Test_assert_eq(toks->kinds[1], Tok_literal_string);
+  Test_assert_eq(toks->kinds[2], Tok_identifier);
+  Test_assert_eq(toks->spans[2].end, src.len);
+
+  u32 lines[] = { 0, 75, 185, 186, 187, 230 };
+  Test_assert_eq(toks->line_count, Count_of(lines));
+  for (u32 i = 0; i < Count_of(lines); i++) {
+    Test_assert_eq(toks->lines[i], lines[i]);
+  }
+}
+
+void test_positions(TestResult *test, TokenizerTestContext *context) {
+  // The string holds a two byte UTF-8 sequence, 'é'.
+  String src = string_lit("a\n\tb \"\xc3\xa9\" c\nlast");
+
+  Tokens *toks = &context->tokens;
+  b32 ok = do_tokenize(context, src);
+  Test_assert(ok);
+
+  PositionIndex index;
+  position_index_init(&index, src, toks);
+
+  SourcePosition c = position_find(&index, 10);
+  Test_assert_eq(c.line, 2);
+  Test_assert_eq(c.col, 8);
+  Test_assert_eq(c.display_col, 15);
+  Test_assert_eq(c.line_start, 2);
+  Test_assert_eq(c.line_len, 9);
+
+  // Before the cached position, on the same line.
+  SourcePosition b = position_find(&index, 3);
+  Test_assert_eq(b.line, 2);
+  Test_assert_eq(b.col, 2);
+  Test_assert_eq(b.display_col, 9);
+
+  SourcePosition end = position_find(&index, src.len);
+  Test_assert_eq(end.line, 3);
+  Test_assert_eq(end.col, 5);
+  Test_assert_eq(end.line_len, 4);
+
+  Arena scratch;
+  arena_init(&scratch, &(ArenaOptions){
+    .reserve_size        = MiB(1),
+    .initial_commit_size = KiB(64),
+  });
+
+  u32 offsets[] = { 15, 0, 10, 3 };
+  SourcePosition out[Count_of(offsets)];
+  position_find_batch(&index, &scratch, offsets, out, Count_of(offsets));
+
+  arena_deinit(&scratch);
+
+  Test_assert_eq(out[0].line, 3);
+  Test_assert_eq(out[0].col, 4);
+  Test_assert_eq(out[1].line, 1);
+  Test_assert_eq(out[1].col, 1);
+  Test_assert_eq(out[2].col, 8);
+  Test_assert_eq(out[2].display_col, 15);
+  Test_assert_eq(out[3].line, 2);
+  Test_assert_eq(out[3].display_col, 9);
+}
+
+void test_tokenize_parallel(TestResult *test, TokenizerTestContext *context) {
+  // Enough sections for the text to be split into several chunks.
+  u32 section_count = 4 * TOKENIZE_MIN_CHUNK_SIZE / 48;
+
+  Arena scratch;
+  arena_init(&scratch, &(ArenaOptions){
+    .reserve_size        = MiB(64),
+    .initial_commit_size = MiB(1),
+  });
+
+  context->tokenize.scratch = &scratch;
+
+  usize cap  = section_count * 64;
+  u8   *text = arena_push_array(u8, &scratch, cap);
+  usize len  = 0;
+  for (u32 i = 0; i < section_count; i++) {
+    len += Cast(usize, snprintf(Cast(char *, text + len), cap - len,
+      "mod m%u\na : i32 = 1 ; one\nb := \"%u\"\n\n", i, i));
+  }
+
+  String src = { .str = text, .len = len, };
+
+  Tokens serial;
+  Tokens chunked;
+  Test_assert(tokenize(&context->tokenize, src, &serial));
+  Test_assert(tokenize_parallel(&context->tokenize, src, 4, &chunked));
+
+  // The chunks are joined into the same tokens and lines as a serial tokenize.
+  Test_assert_eq(chunked.tok_count, serial.tok_count);
+  Test_assert_eq(chunked.line_count, serial.line_count);
+  Test_assert(memcmp(chunked.kinds, serial.kinds, serial.tok_count * sizeof(u8)) == 0);
+  Test_assert(memcmp(chunked.spans, serial.spans, serial.tok_count * sizeof(SpanU32)) == 0);
+  Test_assert(memcmp(chunked.lines, serial.lines, serial.line_count * sizeof(u32)) == 0);
+
+  tokens_deinit(&serial);
+  tokens_deinit(&chunked);
+
+  arena_deinit(&scratch);
+}
+
+typedef struct {
+  u32             count;
+  MessageLocation location;
+} TokenizerMessages;
+
+internal void record_message(void *user, u8 severity, MessageLocation location, String format, ...) {
+  Unused(severity, format);
+
+  TokenizerMessages *messages = user;
+  messages->count   += 1;
+  messages->location = location;
+}
+
+void test_tokenize_parallel_error(TestResult *test, TokenizerTestContext *context) {
+  Unused(context);
+
+  u32 section_count = 4 * TOKENIZE_MIN_CHUNK_SIZE / 48;
+
+  Arena scratch;
+  arena_init(&scratch, &(ArenaOptions){
+    .reserve_size        = MiB(64),
+    .initial_commit_size = MiB(1),
+  });
+
+  // A section past the first chunk has a character that is not a token.
+  usize cap  = section_count * 64;
+  u8   *text = arena_push_array(u8, &scratch, cap);
+  usize len  = 0;
+  for (u32 i = 0; i < section_count; i++) {
+    len += Cast(usize, snprintf(Cast(char *, text + len), cap - len,
+      "mod m%u\na : i32 = 1 %s\nb := \"%u\"\n\n", i, i == 3 * section_count / 4 ? "$" : "", i));
+  }
+
+  String src = { .str = text, .len = len, };
+
+  TokenizerMessages serial_messages  = {0};
+  TokenizerMessages chunked_messages = {0};
+
+  TokenizeContext serial_context = {
+    .msg_sink = &(MessageSink){ .user = &serial_messages, .add_message = record_message, },
+  };
+
+  TokenizeContext chunked_context = {
+    .msg_sink = &(MessageSink){ .user = &chunked_messages, .add_message = record_message, },
+    .scratch  = &scratch,
+  };
+
+  Tokens serial;
+  Tokens chunked;
+  b32 serial_ok  = tokenize(&serial_context, src, &serial);
+  b32 chunked_ok = tokenize_parallel(&chunked_context, src, 4, &chunked);
+
+  // Only the chunk that failed is tokenized again. Its error is at the same offset in the text, and
+  // the lines of the whole text are there to locate it.
+  Test_assert(!serial_ok);
+  Test_assert(!chunked_ok);
+  Test_assert_eq(serial_messages.count, 1);
+  Test_assert_eq(chunked_messages.count, 1);
+  Test_assert_eq(chunked_messages.location.data.offset, serial_messages.location.data.offset);
+  Test_assert_eq(chunked.line_count, serial.line_count);
+  Test_assert(memcmp(chunked.lines, serial.lines, serial.line_count * sizeof(u32)) == 0);
+
+  tokens_deinit(&serial);
+  tokens_deinit(&chunked);
+
+  arena_deinit(&scratch);
 }
 
 typedef struct {
@@ -197,9 +402,14 @@ void register_tokenizer_tests(TestRunner *runner) {
     Test(test_literals),
     Test(test_keywords_and_identifiers),
     Test(test_newlines_and_comments_dropped),
+    Test(test_long_runs),
+    Test(test_positions),
+    Test(test_tokenize_parallel),
+    Test(test_tokenize_parallel_error),
     Test(test_whitespace_skipped),
     Test(test_spans),
     Test(test_error_cases),
+    Test(test_too_large),
     Test(test_declaration_snippet),
     Test(test_string_escapes),
     Test(test_no_whitespace),
@@ -0,0 +1,302 @@
+#include "toteload.h"
+#include "blu.h"
+#include "compiler.h"
+#include "types.h"
+#include "test.h"
+
+typedef struct {
+  Compiler compiler;
+
+  TypeIndex u8;
+  TypeIndex u16;
+  TypeIndex u32;
+  TypeIndex u64;
+} TypesTestContext;
+
+typedef void (*FnTypesTest)(TestResult *, TypesTestContext *);
+
+internal TypeIndex unsigned_type(Compiler *compiler, u32 bits) {
+  return types_add(&compiler->types, &(Type){
+    .kind = Type_integer,
+    .data.integer = { .signedness = Unsigned, .bitwidth = bits },
+  });
+}
+
+void types_test(TestResult *test, void *user) {
+  FnTypesTest fn = Cast(FnTypesTest, user);
+
+  CLIOptions options = { .jobs = 1 };
+
+  TypesTestContext context;
+  compiler_init(&context.compiler, &options);
+
+  context.u8  = unsigned_type(&context.compiler, 8);
+  context.u16 = unsigned_type(&context.compiler, 16);
+  context.u32 = unsigned_type(&context.compiler, 32);
+  context.u64 = unsigned_type(&context.compiler, 64);
+
+  fn(test, &context);
+
+  compiler_deinit(&context.compiler);
+}
+
+typedef struct {
+  TypeIndex type;
+  u8        placement;
+} FieldSpec;
+
+// Lays out a struct with the given fields, in declaration order, and interns it.
+internal Type *struct_layout(TypesTestContext *context, FieldSpec const *specs, u32 count, b32 is_ordered, TypeSizeInfo *size_info) {
+  Compiler *compiler = &context->compiler;
+
+  Type *type = arena_push_type_struct(&compiler->arena, count);
+  type->kind = Type_struct;
+  type->data.struct_.is_ordered  = is_ordered;
+  type->data.struct_.field_count = count;
+
+  for (u32 i = 0; i < count; i++) {
+    type->data.struct_.fields[i] = (TypeStructField){
+      .name      = i + 1,
+      .type      = specs[i].type,
+      .placement = specs[i].placement,
+    };
+  }
+
+  if (!types_struct_layout(&compiler->types, &compiler->scratch, type)) {
+    return Null;
+  }
+
+  *size_info = types_size_info_by_index(&compiler->types, types_add(&compiler->types, type));
+
+  return type;
+}
+
+#define Field_offset(type, i) ((type)->data.struct_.fields[i].offset)
+
+void test_struct_layout_sorted(TestResult *test, TypesTestContext *context) {
+  FieldSpec fields[] = {
+    { context->u8,  FieldPlacement_default },
+    { context->u64, FieldPlacement_default },
+    { context->u16, FieldPlacement_default },
+    { context->u32, FieldPlacement_default },
+  };
+
+  TypeSizeInfo size_info;
+  Type *type = struct_layout(context, fields, Count_of(fields), False, &size_info);
+  Test_assert(type);
+
+  // By decreasing alignment, without any padding.
+  Test_assert_eq(Field_offset(type, 1), 0);
+  Test_assert_eq(Field_offset(type, 3), 8);
+  Test_assert_eq(Field_offset(type, 2), 12);
+  Test_assert_eq(Field_offset(type, 0), 14);
+
+  Test_assert_eq(size_info.size, 16);
+  Test_assert_eq(size_info.align, 8);
+  Test_assert_eq(size_info.stride, 16);
+}
+
+void test_struct_layout_ordered(TestResult *test, TypesTestContext *context) {
+  FieldSpec fields[] = {
+    { context->u8,  FieldPlacement_default },
+    { context->u64, FieldPlacement_default },
+    { context->u16, FieldPlacement_default },
+    { context->u32, FieldPlacement_default },
+  };
+
+  TypeSizeInfo size_info;
+  Type *type = struct_layout(context, fields, Count_of(fields), True, &size_info);
+  Test_assert(type);
+
+  Test_assert_eq(Field_offset(type, 0), 0);
+  Test_assert_eq(Field_offset(type, 1), 8);
+  Test_assert_eq(Field_offset(type, 2), 16);
+  Test_assert_eq(Field_offset(type, 3), 20);
+
+  Test_assert_eq(size_info.size, 24);
+  Test_assert_eq(size_info.align, 8);
+}
+
+void test_struct_layout_placement(TestResult *test, TypesTestContext *context) {
+  FieldSpec fields[] = {
+    { context->u64, FieldPlacement_cold    },
+    { context->u32, FieldPlacement_default },
+    { context->u8,  FieldPlacement_hot     },
+    { context->u8,  FieldPlacement_default },
+  };
+
+  TypeSizeInfo size_info;
+  Type *type = struct_layout(context, fields, Count_of(fields), False, &size_info);
+  Test_assert(type);
+
+  // The hot field comes first. The small default field fills the padding before the u32, instead
+  // of following it and leaving padding before the cold u64.
+  Test_assert_eq(Field_offset(type, 2), 0);
+  Test_assert_eq(Field_offset(type, 3), 1);
+  Test_assert_eq(Field_offset(type, 1), 4);
+  Test_assert_eq(Field_offset(type, 0), 8);
+
+  Test_assert_eq(size_info.size, 16);
+  Test_assert_eq(size_info.align, 8);
+}
+
+void test_struct_layout_fill_in_order(TestResult *test, TypesTestContext *context) {
+  FieldSpec fields[] = {
+    { context->u8,  FieldPlacement_hot     },
+    { context->u64, FieldPlacement_default },
+    { context->u16, FieldPlacement_default },
+    { context->u8,  FieldPlacement_default },
+    { context->u32, FieldPlacement_default },
+    { context->u8,  FieldPlacement_default },
+  };
+
+  TypeSizeInfo size_info;
+  Type *type = struct_layout(context, fields, Count_of(fields), False, &size_info);
+  Test_assert(type);
+
+  // The 7 bytes before the u64 take the smallest default fields, from the end of the group: the two
+  // u8s and the u16. The u32 does not fit there, so it stays after the u64.
+  Test_assert_eq(Field_offset(type, 0), 0);
+  Test_assert_eq(Field_offset(type, 5), 1);
+  Test_assert_eq(Field_offset(type, 3), 2);
+  Test_assert_eq(Field_offset(type, 2), 4);
+  Test_assert_eq(Field_offset(type, 1), 8);
+  Test_assert_eq(Field_offset(type, 4), 16);
+
+  Test_assert_eq(size_info.size, 24);
+  Test_assert_eq(size_info.align, 8);
+}
+
+internal TypeIndex optional_type(TypesTestContext *context, TypeIndex base_type) {
+  return types_add(&context->compiler.types, &(Type){
+    .kind = Type_optional,
+    .data.optional = { .base_type = base_type },
+  });
+}
+
+// Whether a none and a some value of `type`, stored with its layout, read back as such. `some` is a
+// value of the base type.
+internal b32 optional_round_trips(TypesTestContext *context, TypeIndex type, u8 const *some) {
+  TypeInterner *types = &context->compiler.types;
+
+  Type *optional = types_get(types, type);
+  OptionalLayout layout = types_optional_layout(types, optional);
+  u32 size = types_size_info_by_index(types, optional->data.optional.base_type).size;
+
+  u8 none[32] = {0};
+  optional_store_none(layout, none);
+
+  u8 value[32] = {0};
+  memcpy(value, some, size);
+  optional_store_some(layout, value);
+
+  return !optional_is_some(layout, none) && optional_is_some(layout, value);
+}
+
+void test_optional_niche(TestResult *test, TypesTestContext *context) {
+  TypeInterner *types = &context->compiler.types;
+
+  TypeIndex type_bool = context->compiler.common.type.bool;
+  TypeIndex type_u7   = unsigned_type(&context->compiler, 7);
+  TypeIndex type_i7   = types_add(types, &(Type){ .kind = Type_integer, .data.integer = { .signedness = Signed, .bitwidth = 7 } });
+  TypeIndex type_r    = types_add(types, &(Type){ .kind = Type_range, .data.range = { .min = 0, .max = 200 } });
+
+  // The niche of a bool is 2 to 255, of a u7 128 to 255, of a sign-extended i7 64 to 191 and of
+  // 0..200 201 to 255. None is the first pattern of the niche.
+  TypeIndex bases[] = { type_bool, type_u7, type_i7, type_r };
+  u64       nones[] = { 2,         128,     64,      201    };
+
+  for (u32 i = 0; i < Count_of(bases); i++) {
+    TypeIndex opt = optional_type(context, bases[i]);
+    OptionalLayout layout = types_optional_layout(types, types_get(types, opt));
+
+    Test_assert_eq(types_size_info_by_index(types, opt).size, types_size_info_by_index(types, bases[i]).size);
+    Test_assert(!layout.is_tagged);
+    Test_assert_eq(layout.offset, 0);
+    Test_assert_eq(layout.size, 1);
+    Test_assert_eq(layout.none, nones[i]);
+    Test_assert(optional_round_trips(context, opt, (u8[]){ 1 }));
+  }
+
+  // The niche of a struct is that of one of its fields, at the offset of the field.
+  FieldSpec fields[] = {
+    { context->u32, FieldPlacement_default },
+    { type_bool,    FieldPlacement_default },
+  };
+
+  TypeSizeInfo size_info;
+  Type *type = struct_layout(context, fields, Count_of(fields), False, &size_info);
+  Test_assert(type);
+
+  TypeIndex opt_struct = optional_type(context, types_add(types, type));
+  OptionalLayout layout = types_optional_layout(types, types_get(types, opt_struct));
+
+  Test_assert_eq(types_size_info_by_index(types, opt_struct).size, size_info.size);
+  Test_assert(!layout.is_tagged);
+  Test_assert_eq(layout.offset, 4);
+  Test_assert_eq(layout.none, 2);
+  Test_assert(optional_round_trips(context, opt_struct, (u8[]){ 7, 0, 0, 0, 1, 0, 0, 0 }));
+
+  // An optional leaves the rest of the niche to an enclosing optional.
+  TypeIndex opt_opt_bool = optional_type(context, optional_type(context, type_bool));
+  OptionalLayout nested = types_optional_layout(types, types_get(types, opt_opt_bool));
+
+  Test_assert_eq(types_size_info_by_index(types, opt_opt_bool).size, 1);
+  Test_assert(!nested.is_tagged);
+  Test_assert_eq(nested.none, 3);
+}
+
+void test_optional_tagged(TestResult *test, TypesTestContext *context) {
+  TypeInterner *types = &context->compiler.types;
+
+  // Integers that fill their storage have no niche, so the tag follows the value and the size is
+  // rounded up to the alignment.
+  TypeIndex bases[] = { context->u8, context->u16, context->u32, context->u64 };
+  u32       sizes[] = { 2,           4,            8,            16           };
+
+  for (u32 i = 0; i < Count_of(bases); i++) {
+    TypeIndex opt = optional_type(context, bases[i]);
+    TypeSizeInfo base = types_size_info_by_index(types, bases[i]);
+    OptionalLayout layout = types_optional_layout(types, types_get(types, opt));
+
+    Test_assert_eq(types_size_info_by_index(types, opt).size, sizes[i]);
+    Test_assert_eq(types_size_info_by_index(types, opt).align, base.align);
+    Test_assert(layout.is_tagged);
+    Test_assert_eq(layout.offset, base.size);
+    Test_assert_eq(layout.size, 1);
+    Test_assert_eq(layout.none, 0);
+    Test_assert(optional_round_trips(context, opt, (u8[8]){ 0 }));
+  }
+
+  // The tag of `?u32` has a niche, so `??u32` is no larger.
+  TypeIndex opt_u32     = optional_type(context, context->u32);
+  TypeIndex opt_opt_u32 = optional_type(context, opt_u32);
+  OptionalLayout layout = types_optional_layout(types, types_get(types, opt_opt_u32));
+
+  Test_assert_eq(types_size_info_by_index(types, opt_opt_u32).size, 8);
+  Test_assert(!layout.is_tagged);
+  Test_assert_eq(layout.offset, 4);
+  Test_assert_eq(layout.none, 2);
+}
+
+typedef struct {
+  String      name;
+  FnTypesTest fn;
+} TypesTest;
+
+#define Test(function) { .name = string_lit(#function), .fn = function }
+
+void register_types_tests(TestRunner *runner) {
+  TypesTest tests[] = {
+    Test(test_struct_layout_sorted),
+    Test(test_struct_layout_ordered),
+    Test(test_struct_layout_placement),
+    Test(test_struct_layout_fill_in_order),
+    Test(test_optional_niche),
+    Test(test_optional_tagged),
+  };
+
+  for (u32 i = 0; i < Count_of(tests); i++) {
+    test_runner_register_test(runner, tests[i].name, Cast(FnTest, types_test), Cast(void *, tests[i].fn));
+  }
+}